@@ -1,32 +1,157 @@
 #include <string>
+#include <vector>
 #include <iostream>
 #include <stdexcept>
+#include <ctime>
+#include <cctype>
+#include <algorithm>
+
+#include "ArgumentsHandler.h"
 
 using std::string;
+using std::vector;
 using std::cout;
 using std::cerr;
 
 void printManual(const string& programName) {
 	cout << "\nWrong arguments - unfortunately the maze guard had to turn you away!\n\n";
-    cout << "Usage: " << programName << " <width> <height> <number_of_items>\n\n";
+    cout << "Usage: " << programName << " <width> <height> <number_of_items> [--difficulty <target>] [--difficulty-timeout <seconds>]\n";
+    cout << "       " << programName << "     [--minotaur-band <low%>-<high%>] [--view <radius>] [--levels <n>] [--campaign <n>]\n";
+    cout << "       " << programName << "     [--pool <dir> [--pool-depth <n>]] [--record <file.cast>]\n";
+    cout << "       " << programName << " --resume <save_file>\n";
+    cout << "       " << programName << " --load <maze.txt>\n";
+    cout << "       " << programName << " --replay <replay_file> | --replay-render <replay_file> [--speed <moves_per_second>]\n";
+    cout << "       " << programName << " render <out.png|out.pbm> (<width> <height> <number_of_items> [--seed <n>] | --load <maze>) [--overlay <list>]\n";
+    cout << "       " << programName << " serve [--socket <path>] [--threads <n>]\n";
+    cout << "       " << programName << " connect <width> <height> <number_of_items> [--socket <path>]\n";
+    cout << "       " << programName << " watch [<game_id>] [--socket <path>]\n";
+    cout << "       " << programName << " analyze (<width> <height> <number_of_items> [--count <n>] [--seed <first>] [--prim-only] | --load <maze>...) [--threads <n>] [--out <file.csv>]\n";
+    cout << "       " << programName << " farm <out_prefix> <width> <height> <number_of_items> --count <n> [--seed <first>] [--threads <n>] [--file-mb <n>]\n";
+    cout << "       " << programName << " bench <width> <height> <number_of_items> [--count <n>] [--seed <first>]\n";
+    cout << "       " << programName << " pool <dir> <width> <height> <number_of_items> [--depth <n>]\n";
+    cout << "       " << programName << " marathon build <file.ktm> <width> <height> <number_of_items> [--seed <n>]\n";
+    cout << "       " << programName << " marathon <file.ktm> [--cache-mb <n>]\n";
+    cout << "       " << programName << " endless [--seed <n>]\n";
+    cout << "       " << programName << " stats [--from YYYY-MM-DD] [--to YYYY-MM-DD] [--min-size <n>] [--max-size <n>] [--file <log>]\n\n";
     cout << "Parameters:\n";
     cout << "  width           - Width of the maze (must be > 15)\n";
     cout << "  height          - Height of the maze (must be > 15)\n";
     cout << "  number_of_items - Number of special items to place (must be > 3)\n\n";
+    cout << "Options:\n";
+    cout << "  --resume <file>         - Continue a game saved when quitting with Q (.ksav)\n";
+    cout << "  --load <file>           - Play a hand-drawn maze (# wall, . passage, U entrance, I exit, P item) or a .pbm\n";
+    cout << "  --replay-log <file>     - Record every key of this game for later replay\n";
+    cout << "  --record <file.cast>    - Record the screen as an asciicast (play it with asciinema); also with\n";
+    cout << "                            --load, --resume and --replay-render\n";
+    cout << "  --replay <file>         - Re-run a recorded game headless at full speed and verify it\n";
+    cout << "  --replay-render <file>  - Re-run a recorded game on screen\n";
+    cout << "  --speed <n>             - Moves per second for --replay-render (default 10)\n";
+    cout << "  --difficulty <target>   - easy, medium, hard, or ranges like path=1.2-1.6,deadends=0.17-,minotaur=-0.8\n";
+    cout << "                            (path and minotaur distance in maze heights); mazes are generated on all\n";
+    cout << "                            cores until one fits, or the closest after --difficulty-timeout (default 5)\n";
+    cout << "  --minotaur-band <a-b>   - Minotaur starts a-b percent of the longest walk away from you (default 30-60)\n";
+    cout << "  --view <radius>         - Exploration mode: see only what's in line of sight up to radius cells away;\n";
+    cout << "                            places you've seen stay dimmed on the map (also with --load and --resume)\n";
+    cout << "  --levels <n>            - Descend n floors (2-50) by the stairs '>' to reach the exit on the last one;\n";
+    cout << "                            the Minotaur follows you down or up if he is close behind\n";
+    cout << "  --campaign <n>          - Escape n mazes (2-20) in a row, each a quarter wider and taller with one\n";
+    cout << "                            more item; the next one is built while you play the current one\n";
+    cout << "  --pool <dir>            - Start with a ready-made maze from the pool in dir, if it has one, and\n";
+    cout << "                            refill it in the background to --pool-depth (default " << MazePool::DEFAULT_DEPTH << ") mazes\n\n";
+    cout << "'render' streams the maze into an image, one pixel per cell; --overlay takes 'all' or a comma\n";
+    cout << "separated list of robot, minotaur, items, doors (PNG only). PBM images load back with --load.\n\n";
+    cout << "'serve' hosts many games at once on a local socket (default " << GameServer::DEFAULT_SOCKET_PATH << ");\n";
+    cout << "'connect' plays one of them from this terminal; 'watch' follows a game by id, or lists them.\n\n";
+    cout << "'analyze' measures solution length, dead ends, junctions, corridors and reachable items of\n";
+    cout << "consecutive seeds (or of maze files) on all cores and prints one CSV row per maze.\n\n";
+    cout << "'farm' pre-generates --count mazes from consecutive seeds, checks that each one is playable and\n";
+    cout << "packs them into <out_prefix>_0001.kml, ... files of about --file-mb (default 64) each.\n";
+    cout << "'bench' times --count (default " << BenchRequest::DEFAULT_COUNT << ") mazes as a heap Matrix against the fixed-size\n";
+    cout << "board of 17x17, 31x31 or 63x63, after checking that both generate the same mazes.\n";
+    cout << "'pool' fills the pool of that size in dir up to --depth mazes, for --pool to start games from;\n";
+    cout << "any number of games may share a pool.\n\n";
+    cout << "'marathon build' streams a maze of any size to disk in 256x256 tiles; 'marathon' plays it in a\n";
+    cout << "window that follows the robot, keeping at most --cache-mb (default 64) of tiles in memory.\n";
+    cout << "'endless' has no edges: the maze is generated chunk by chunk ahead of you; find an exit.\n\n";
+    cout << "Every finished game is appended to " << ResultsStore::DEFAULT_FILENAME << "; 'stats' summarises it\n";
+    cout << "(win rates, duration percentiles), optionally filtered by date and by maze width/height.\n\n";
     cout << "Example: " << programName << " 25 20 5\n";
 }
 
-bool parseArguments(int argc, char* argv[], unsigned int& width,
-    unsigned int& height, unsigned int& items) {
+// Accepts YYYY-MM-DD or YYYYMMDD; returns local midnight (or the last microsecond of the day)
+static bool parseDate(const string& text, bool endOfDay, uint64_t& timestamp) {
+    string digits;
+    for (char c : text) {
+        if (c != '-') digits += c;
+    }
+    if (digits.size() != 8 || digits.find_first_not_of("0123456789") != string::npos) {
+        return false;
+    }
+
+    struct tm date = {};
+    date.tm_year = std::stoi(digits.substr(0, 4)) - 1900;
+    date.tm_mon = std::stoi(digits.substr(4, 2)) - 1;
+    date.tm_mday = std::stoi(digits.substr(6, 2)) + (endOfDay ? 1 : 0);
+    date.tm_isdst = -1;
 
-    if (argc != 4) {
+    time_t seconds = mktime(&date);
+    if (seconds == static_cast<time_t>(-1)) {
         return false;
     }
+    timestamp = static_cast<uint64_t>(seconds) * 1000000ULL - (endOfDay ? 1 : 0);
+    return true;
+}
+
+static bool parseStatsArguments(int argc, char* argv[], GameOptions& options) {
+    for (int i = 2; i < argc; ++i) {
+        string argument = argv[i];
+
+        if (i + 1 >= argc) {
+            cerr << "Error: " << argument << " needs a value\n";
+            return false;
+        }
+        string value = argv[++i];
+
+        try {
+            if (argument == "--from" || argument == "--to") {
+                uint64_t& timestamp = argument == "--from" ? options.statsQuery.from_timestamp : options.statsQuery.to_timestamp;
+                if (!parseDate(value, argument == "--to", timestamp)) {
+                    cerr << "Error: Dates look like 2025-01-31 (got " << value << ")\n";
+                    return false;
+                }
+            }
+            else if (argument == "--min-size") {
+                options.statsQuery.min_size = static_cast<uint32_t>(std::stoul(value));
+            }
+            else if (argument == "--max-size") {
+                options.statsQuery.max_size = static_cast<uint32_t>(std::stoul(value));
+            }
+            else if (argument == "--file") {
+                options.resultsFile = value;
+            }
+            else {
+                cerr << "Error: Unknown stats option " << argument << "\n";
+                return false;
+            }
+        }
+        catch (const std::exception&) {
+            cerr << "Error: Invalid number for " << argument << "\n";
+            return false;
+        }
+    }
+    return true;
+}
+
+// <width> <height> <number_of_items> starting at positional[first]
+static bool parseMazeDimensions(const vector<string>& positional, size_t first, GameOptions& options) {
+    unsigned int& width = options.width;
+    unsigned int& height = options.height;
+    unsigned int& items = options.items;
 
     try {
-        width = static_cast<unsigned int>(std::stoul(argv[1]));
-        height = static_cast<unsigned int>(std::stoul(argv[2]));
-        items = static_cast<unsigned int>(std::stoul(argv[3]));
+        width = static_cast<unsigned int>(std::stoul(positional[first]));
+        height = static_cast<unsigned int>(std::stoul(positional[first + 1]));
+        items = static_cast<unsigned int>(std::stoul(positional[first + 2]));
 
         if (width <= 15) {
             cerr << "Error: Width must be greater than 15 (provided: " << width << ")\n";
@@ -43,7 +168,7 @@ bool parseArguments(int argc, char* argv[], unsigned int& width,
             return false;
         }
 
-        if (items > width*height/3) {
+        if (items > static_cast<unsigned long long>(width) * height / 3) {
             cerr << "Error: Too many items... Sorry!\n";
             return false;
         }
@@ -61,8 +186,669 @@ bool parseArguments(int argc, char* argv[], unsigned int& width,
     }
 }
 
-void handleArguments(int argc, char* argv[], unsigned int& width, unsigned int& height, unsigned int& items) {
-    if (!parseArguments(argc, argv, width, height, items)) {
+// "<low>-<high>", both percentages with low <= high
+static bool parseSpawnBand(const string& text, SpawnBand& band) {
+    size_t dash = text.find('-');
+    if (dash == string::npos || dash == 0 || dash + 1 == text.size() ||
+        text.find_first_not_of("0123456789-") != string::npos || text.find('-', dash + 1) != string::npos) {
+        return false;
+    }
+    try {
+        band.low = static_cast<unsigned int>(std::stoul(text.substr(0, dash)));
+        band.high = static_cast<unsigned int>(std::stoul(text.substr(dash + 1)));
+    }
+    catch (const std::exception&) {
+        return false;
+    }
+    return band.low <= band.high && band.high <= 100;
+}
+
+static bool parseOverlays(const string& list, ImageOverlays& overlays) {
+    size_t start = 0;
+    while (start <= list.size()) {
+        size_t comma = list.find(',', start);
+        string name = list.substr(start, comma == string::npos ? string::npos : comma - start);
+
+        if (name == "all") {
+            overlays.robot = overlays.minotaur = overlays.items = overlays.entrance_exit = true;
+        }
+        else if (name == "robot") overlays.robot = true;
+        else if (name == "minotaur") overlays.minotaur = true;
+        else if (name == "items") overlays.items = true;
+        else if (name == "doors") overlays.entrance_exit = true;
+        else {
+            cerr << "Error: Unknown overlay '" << name << "' (use robot, minotaur, items, doors or all)\n";
+            return false;
+        }
+
+        if (comma == string::npos) break;
+        start = comma + 1;
+    }
+    return true;
+}
+
+static bool parseRenderArguments(int argc, char* argv[], GameOptions& options) {
+    vector<string> positional;
+
+    for (int i = 2; i < argc; ++i) {
+        string argument = argv[i];
+
+        if (argument.compare(0, 2, "--") != 0) {
+            positional.push_back(argument);
+            continue;
+        }
+        if (i + 1 >= argc) {
+            cerr << "Error: " << argument << " needs a value\n";
+            return false;
+        }
+        string value = argv[++i];
+
+        if (argument == "--load") {
+            options.loadFile = value;
+        }
+        else if (argument == "--overlay") {
+            if (!parseOverlays(value, options.overlays)) return false;
+        }
+        else if (argument == "--seed") {
+            try {
+                options.seed = static_cast<unsigned int>(std::stoul(value));
+                options.hasSeed = true;
+            }
+            catch (const std::exception&) {
+                cerr << "Error: Invalid seed " << value << "\n";
+                return false;
+            }
+        }
+        else {
+            cerr << "Error: Unknown render option " << argument << "\n";
+            return false;
+        }
+    }
+
+    if (positional.empty()) {
+        return false;
+    }
+    options.imageFile = positional[0];
+
+    string extension = options.imageFile.size() >= 4 ? options.imageFile.substr(options.imageFile.size() - 4) : "";
+    std::transform(extension.begin(), extension.end(), extension.begin(), ::tolower);
+    if (extension != ".png" && extension != ".pbm") {
+        cerr << "Error: Image files must end in .pbm or .png (got " << options.imageFile << ")\n";
+        return false;
+    }
+
+    if (!options.loadFile.empty()) {
+        return positional.size() == 1 && !options.hasSeed;
+    }
+    if (positional.size() != 4) {
+        return false;
+    }
+    return parseMazeDimensions(positional, 1, options);
+}
+
+// marathon build <file> <width> <height> <items> [--seed <n>] | marathon <file> [--cache-mb <n>]
+static bool parseMarathonArguments(int argc, char* argv[], GameOptions& options) {
+    vector<string> positional;
+
+    for (int i = 2; i < argc; ++i) {
+        string argument = argv[i];
+
+        if (argument.compare(0, 2, "--") != 0) {
+            positional.push_back(argument);
+            continue;
+        }
+        if (i + 1 >= argc) {
+            cerr << "Error: " << argument << " needs a value\n";
+            return false;
+        }
+        string value = argv[++i];
+
+        try {
+            if (argument == "--seed") {
+                options.seed = static_cast<unsigned int>(std::stoul(value));
+                options.hasSeed = true;
+            }
+            else if (argument == "--cache-mb") {
+                options.tileCacheBytes = static_cast<size_t>(std::stoul(value)) * 1024 * 1024;
+            }
+            else {
+                cerr << "Error: Unknown marathon option " << argument << "\n";
+                return false;
+            }
+        }
+        catch (const std::exception&) {
+            cerr << "Error: Invalid number for " << argument << "\n";
+            return false;
+        }
+    }
+
+    options.buildMarathon = !positional.empty() && positional[0] == "build";
+    if (!options.buildMarathon) {
+        if (positional.size() != 1 || options.hasSeed) {
+            return false;
+        }
+        options.marathonFile = positional[0];
+        return true;
+    }
+
+    if (positional.size() != 5) {
+        return false;
+    }
+    options.marathonFile = positional[1];
+    return parseMazeDimensions(positional, 2, options);
+}
+
+// analyze (<width> <height> <items> [--count <n>] [--seed <first>] [--prim-only] | --load <maze>...)
+//   [--threads <n>] [--out <file.csv>]
+static bool parseAnalyzeArguments(int argc, char* argv[], GameOptions& options) {
+    AnalysisRequest& request = options.analysis;
+    vector<string> positional;
+
+    for (int i = 2; i < argc; ++i) {
+        string argument = argv[i];
+
+        if (argument.compare(0, 2, "--") != 0) {
+            positional.push_back(argument);
+            continue;
+        }
+        if (argument == "--prim-only") {
+            request.primOnly = true;
+            continue;
+        }
+        if (i + 1 >= argc) {
+            cerr << "Error: " << argument << " needs a value\n";
+            return false;
+        }
+        string value = argv[++i];
+
+        try {
+            if (argument == "--load") {
+                request.mazeFiles.push_back(value);
+            }
+            else if (argument == "--out") {
+                request.csvFile = value;
+            }
+            else if (argument == "--count") {
+                request.count = static_cast<unsigned int>(std::stoul(value));
+            }
+            else if (argument == "--seed") {
+                request.firstSeed = static_cast<unsigned int>(std::stoul(value));
+                request.hasSeed = true;
+            }
+            else if (argument == "--threads") {
+                request.threads = static_cast<unsigned int>(std::stoul(value));
+            }
+            else {
+                cerr << "Error: Unknown analyze option " << argument << "\n";
+                return false;
+            }
+        }
+        catch (const std::exception&) {
+            cerr << "Error: Invalid number for " << argument << "\n";
+            return false;
+        }
+    }
+
+    if (!request.mazeFiles.empty()) {
+        return positional.empty() && !request.hasSeed && !request.primOnly;
+    }
+    if (positional.size() != 3 || request.count == 0 || !parseMazeDimensions(positional, 0, options)) {
+        return false;
+    }
+    request.width = options.width;
+    request.height = options.height;
+    request.no_of_items = options.items;
+    return true;
+}
+
+// farm <out_prefix> <width> <height> <items> --count <n> [--seed <first>] [--threads <n>] [--file-mb <n>]
+static bool parseFarmArguments(int argc, char* argv[], GameOptions& options) {
+    FarmRequest& request = options.farm;
+    vector<string> positional;
+
+    for (int i = 2; i < argc; ++i) {
+        string argument = argv[i];
+
+        if (argument.compare(0, 2, "--") != 0) {
+            positional.push_back(argument);
+            continue;
+        }
+        if (i + 1 >= argc) {
+            cerr << "Error: " << argument << " needs a value\n";
+            return false;
+        }
+        string value = argv[++i];
+
+        try {
+            if (argument == "--count") {
+                request.count = static_cast<unsigned int>(std::stoul(value));
+            }
+            else if (argument == "--seed") {
+                request.firstSeed = static_cast<unsigned int>(std::stoul(value));
+                request.hasSeed = true;
+            }
+            else if (argument == "--threads") {
+                request.threads = static_cast<unsigned int>(std::stoul(value));
+            }
+            else if (argument == "--file-mb") {
+                request.fileBytes = static_cast<size_t>(std::stoul(value)) * 1024 * 1024;
+            }
+            else {
+                cerr << "Error: Unknown farm option " << argument << "\n";
+                return false;
+            }
+        }
+        catch (const std::exception&) {
+            cerr << "Error: Invalid number for " << argument << "\n";
+            return false;
+        }
+    }
+
+    if (positional.size() != 4 || request.count == 0 || request.fileBytes == 0 || !parseMazeDimensions(positional, 1, options)) {
+        return false;
+    }
+    request.outputPrefix = positional[0];
+    request.width = options.width;
+    request.height = options.height;
+    request.no_of_items = options.items;
+    return true;
+}
+
+// bench <width> <height> <items> [--count <n>] [--seed <first>]
+static bool parseBenchArguments(int argc, char* argv[], GameOptions& options) {
+    BenchRequest& request = options.bench;
+    vector<string> positional;
+
+    for (int i = 2; i < argc; ++i) {
+        string argument = argv[i];
+
+        if (argument.compare(0, 2, "--") != 0) {
+            positional.push_back(argument);
+            continue;
+        }
+        if (i + 1 >= argc) {
+            cerr << "Error: " << argument << " needs a value\n";
+            return false;
+        }
+        string value = argv[++i];
+
+        try {
+            if (argument == "--count") {
+                request.count = static_cast<unsigned int>(std::stoul(value));
+            }
+            else if (argument == "--seed") {
+                request.firstSeed = static_cast<unsigned int>(std::stoul(value));
+                request.hasSeed = true;
+            }
+            else {
+                cerr << "Error: Unknown bench option " << argument << "\n";
+                return false;
+            }
+        }
+        catch (const std::exception&) {
+            cerr << "Error: Invalid number for " << argument << "\n";
+            return false;
+        }
+    }
+
+    if (positional.size() != 3 || request.count == 0 || !parseMazeDimensions(positional, 0, options)) {
+        return false;
+    }
+    request.width = options.width;
+    request.height = options.height;
+    request.no_of_items = options.items;
+    return true;
+}
+
+// pool <dir> <width> <height> <items> [--depth <n>]
+static bool parsePoolArguments(int argc, char* argv[], GameOptions& options) {
+    vector<string> positional;
+
+    for (int i = 2; i < argc; ++i) {
+        string argument = argv[i];
+
+        if (argument.compare(0, 2, "--") != 0) {
+            positional.push_back(argument);
+            continue;
+        }
+        if (i + 1 >= argc) {
+            cerr << "Error: " << argument << " needs a value\n";
+            return false;
+        }
+        string value = argv[++i];
+
+        try {
+            if (argument == "--depth") {
+                options.poolDepth = static_cast<unsigned int>(std::stoul(value));
+            }
+            else {
+                cerr << "Error: Unknown pool option " << argument << "\n";
+                return false;
+            }
+        }
+        catch (const std::exception&) {
+            cerr << "Error: Invalid number for " << argument << "\n";
+            return false;
+        }
+    }
+
+    if (positional.size() != 4 || options.poolDepth == 0 || !parseMazeDimensions(positional, 1, options)) {
+        return false;
+    }
+    options.poolDirectory = positional[0];
+    return true;
+}
+
+// serve [--socket <path>] [--threads <n>]  /  connect <width> <height> <items> [--socket <path>]
+//   /  watch [<game_id>] [--socket <path>]
+static bool parseServerArguments(int argc, char* argv[], GameOptions& options) {
+    vector<string> positional;
+
+    for (int i = 2; i < argc; ++i) {
+        string argument = argv[i];
+
+        if (argument.compare(0, 2, "--") != 0) {
+            positional.push_back(argument);
+            continue;
+        }
+        if (i + 1 >= argc) {
+            cerr << "Error: " << argument << " needs a value\n";
+            return false;
+        }
+        string value = argv[++i];
+
+        if (argument == "--socket") {
+            options.socketPath = value;
+        }
+        else if (argument == "--threads" && options.mode == RunMode::SERVE) {
+            try {
+                options.serverThreads = static_cast<unsigned int>(std::stoul(value));
+            }
+            catch (const std::exception&) {
+                cerr << "Error: Invalid number of threads " << value << "\n";
+                return false;
+            }
+        }
+        else {
+            cerr << "Error: Unknown option " << argument << "\n";
+            return false;
+        }
+    }
+
+    if (options.mode == RunMode::SERVE) {
+        return positional.empty();
+    }
+    if (options.mode == RunMode::WATCH) {
+        if (positional.empty()) {
+            return true;
+        }
+        if (positional.size() != 1 || positional[0].find_first_not_of("0123456789") != string::npos) {
+            return false;
+        }
+        try {
+            options.gameId = std::stoull(positional[0]);
+        }
+        catch (const std::exception&) {
+            return false;
+        }
+        options.hasGameId = true;
+        return true;
+    }
+    if (positional.size() != 3) {
+        return false;
+    }
+    return parseMazeDimensions(positional, 0, options);
+}
+
+bool parseArguments(int argc, char* argv[], GameOptions& options) {
+    vector<string> positional;
+
+    if (argc > 1 && string(argv[1]) == "stats") {
+        options.mode = RunMode::STATS;
+        return parseStatsArguments(argc, argv, options);
+    }
+
+    if (argc > 1 && string(argv[1]) == "render") {
+        options.mode = RunMode::RENDER;
+        return parseRenderArguments(argc, argv, options);
+    }
+
+    if (argc > 1 && string(argv[1]) == "analyze") {
+        options.mode = RunMode::ANALYZE;
+        return parseAnalyzeArguments(argc, argv, options);
+    }
+
+    if (argc > 1 && string(argv[1]) == "farm") {
+        options.mode = RunMode::FARM;
+        return parseFarmArguments(argc, argv, options);
+    }
+
+    if (argc > 1 && string(argv[1]) == "bench") {
+        options.mode = RunMode::BENCH;
+        return parseBenchArguments(argc, argv, options);
+    }
+
+    if (argc > 1 && string(argv[1]) == "pool") {
+        options.mode = RunMode::POOL;
+        return parsePoolArguments(argc, argv, options);
+    }
+
+    if (argc > 1 && string(argv[1]) == "endless") {
+        options.mode = RunMode::ENDLESS;
+        if (argc == 4 && string(argv[2]) == "--seed") {
+            try {
+                options.seed = static_cast<unsigned int>(std::stoul(argv[3]));
+                options.hasSeed = true;
+                return true;
+            }
+            catch (const std::exception&) {
+                cerr << "Error: Invalid number for --seed\n";
+                return false;
+            }
+        }
+        return argc == 2;
+    }
+
+    if (argc > 1 && string(argv[1]) == "marathon") {
+        options.mode = RunMode::MARATHON;
+        return parseMarathonArguments(argc, argv, options);
+    }
+
+    if (argc > 1 && (string(argv[1]) == "serve" || string(argv[1]) == "connect" || string(argv[1]) == "watch")) {
+        string command = argv[1];
+        options.mode = command == "serve" ? RunMode::SERVE : command == "connect" ? RunMode::CONNECT : RunMode::WATCH;
+        return parseServerArguments(argc, argv, options);
+    }
+
+    for (int i = 1; i < argc; ++i) {
+        string argument = argv[i];
+
+        bool takesValue = argument == "--resume" || argument == "--load" || argument == "--replay-log" ||
+            argument == "--replay" || argument == "--replay-render" || argument == "--speed" ||
+            argument == "--difficulty" || argument == "--difficulty-timeout" || argument == "--minotaur-band" ||
+            argument == "--view" || argument == "--levels" || argument == "--campaign" ||
+            argument == "--record" || argument == "--pool" || argument == "--pool-depth";
+
+        if (takesValue && i + 1 >= argc) {
+            cerr << "Error: " << argument << " needs a value\n";
+            return false;
+        }
+
+        if (argument == "--resume") {
+            options.resumeFile = argv[++i];
+        }
+        else if (argument == "--load") {
+            options.loadFile = argv[++i];
+        }
+        else if (argument == "--replay-log") {
+            options.replayLogFile = argv[++i];
+        }
+        else if (argument == "--record") {
+            options.recordFile = argv[++i];
+        }
+        else if (argument == "--replay" || argument == "--replay-render") {
+            options.replayFile = argv[++i];
+            options.replayRender = argument == "--replay-render";
+        }
+        else if (argument == "--speed") {
+            try {
+                options.replaySpeed = static_cast<unsigned int>(std::stoul(argv[++i]));
+            }
+            catch (const std::exception&) {
+                options.replaySpeed = 0;
+            }
+            if (options.replaySpeed == 0) {
+                cerr << "Error: --speed must be a positive number of moves per second\n";
+                return false;
+            }
+        }
+        else if (argument == "--difficulty") {
+            string error;
+            if (!DifficultySearch::parse(argv[++i], options.difficulty, error)) {
+                cerr << "Error: " << error << "\n";
+                return false;
+            }
+            options.hasDifficulty = true;
+        }
+        else if (argument == "--difficulty-timeout") {
+            double seconds = 0;
+            try {
+                seconds = std::stod(argv[++i]);
+            }
+            catch (const std::exception&) {
+                seconds = 0;
+            }
+            if (!(seconds > 0)) {
+                cerr << "Error: --difficulty-timeout must be a positive number of seconds\n";
+                return false;
+            }
+            options.difficulty.timeout = std::chrono::milliseconds(static_cast<long long>(seconds * 1000));
+        }
+        else if (argument == "--minotaur-band") {
+            if (!parseSpawnBand(argv[++i], options.minotaurBand)) {
+                cerr << "Error: --minotaur-band takes two percentages like 30-60\n";
+                return false;
+            }
+        }
+        else if (argument == "--view") {
+            try {
+                options.viewRadius = static_cast<unsigned int>(std::stoul(argv[++i]));
+            }
+            catch (const std::exception&) {
+                options.viewRadius = 0;
+            }
+            if (options.viewRadius == 0 || options.viewRadius > 1000) {
+                cerr << "Error: --view must be a radius between 1 and 1000 cells\n";
+                return false;
+            }
+        }
+        else if (argument == "--levels") {
+            try {
+                options.levels = static_cast<unsigned int>(std::stoul(argv[++i]));
+            }
+            catch (const std::exception&) {
+                options.levels = 0;
+            }
+            if (options.levels < 2 || options.levels > 50) {
+                cerr << "Error: --levels must be between 2 and 50 floors\n";
+                return false;
+            }
+        }
+        else if (argument == "--pool") {
+            options.poolDirectory = argv[++i];
+        }
+        else if (argument == "--pool-depth") {
+            try {
+                options.poolDepth = static_cast<unsigned int>(std::stoul(argv[++i]));
+            }
+            catch (const std::exception&) {
+                options.poolDepth = 0;
+            }
+            if (options.poolDepth == 0 || options.poolDepth > 10000) {
+                cerr << "Error: --pool-depth must be between 1 and 10000 mazes\n";
+                return false;
+            }
+        }
+        else if (argument == "--campaign") {
+            try {
+                options.campaign = static_cast<unsigned int>(std::stoul(argv[++i]));
+            }
+            catch (const std::exception&) {
+                options.campaign = 0;
+            }
+            if (options.campaign < 2 || options.campaign > 20) {
+                cerr << "Error: --campaign must be between 2 and 20 mazes\n";
+                return false;
+            }
+        }
+        else if (argument.compare(0, 2, "--") == 0) {
+            cerr << "Error: Unknown option " << argument << "\n";
+            return false;
+        }
+        else {
+            positional.push_back(argument);
+        }
+    }
+
+    // Only a freshly generated maze can be picked for its difficulty
+    if (options.hasDifficulty && (!options.replayFile.empty() || !options.loadFile.empty() || !options.resumeFile.empty())) {
+        cerr << "Error: --difficulty only applies to new games\n";
+        return false;
+    }
+
+    // Saves, replays and difficulty searches all describe a single maze
+    if (options.levels > 1 && (!options.replayFile.empty() || !options.loadFile.empty() || !options.resumeFile.empty() ||
+        !options.replayLogFile.empty() || options.hasDifficulty)) {
+        cerr << "Error: --levels only applies to new games, without --difficulty or --replay-log\n";
+        return false;
+    }
+
+    if (options.campaign > 0 && (!options.replayFile.empty() || !options.loadFile.empty() || !options.resumeFile.empty() ||
+        !options.replayLogFile.empty() || options.hasDifficulty)) {
+        cerr << "Error: --campaign only applies to new games, without --difficulty or --replay-log\n";
+        return false;
+    }
+
+    // A pooled maze comes without the generator's state, which a replay log would need
+    if (!options.poolDirectory.empty() && (!options.replayFile.empty() || !options.loadFile.empty() || !options.resumeFile.empty() ||
+        !options.replayLogFile.empty() || options.hasDifficulty || options.levels > 1 || options.campaign > 0)) {
+        cerr << "Error: --pool only applies to single new games, without --difficulty, --levels, --campaign or --replay-log\n";
+        return false;
+    }
+
+    // Everything about a replayed game comes from the replay log
+    if (!options.replayFile.empty()) {
+        return positional.empty() && options.resumeFile.empty() && options.loadFile.empty() && options.replayLogFile.empty() &&
+            options.viewRadius == 0;
+    }
+
+    // A hand-drawn maze brings its own size and items; replays and saves rebuild
+    // mazes from a seed, so neither can describe it
+    if (!options.loadFile.empty()) {
+        if (!options.replayLogFile.empty()) {
+            cerr << "Error: A loaded maze cannot be recorded for replay\n";
+            return false;
+        }
+        return positional.empty() && options.resumeFile.empty();
+    }
+
+    // Everything about a resumed game comes from the save file
+    if (!options.resumeFile.empty()) {
+        if (!options.replayLogFile.empty()) {
+            cerr << "Error: A resumed game cannot be recorded for replay\n";
+            return false;
+        }
+        return positional.empty();
+    }
+
+    if (positional.size() != 3) {
+        return false;
+    }
+    return parseMazeDimensions(positional, 0, options);
+}
+
+void handleArguments(int argc, char* argv[], GameOptions& options) {
+    if (!parseArguments(argc, argv, options)) {
         printManual(argv[0]);
         exit(1);
     }
@@ -1,11 +1,79 @@
 #pragma once
 
 #include <string>
+#include "ResultsStore.h"
+#include "MazeImage.h"
+#include "GameServer.h"
+#include "MazeAnalyzer.h"
+#include "DifficultySearch.h"
+#include "TiledMaze.h"
+#include "MazeFarm.h"
+#include "MazeBench.h"
+#include "MazePool.h"
 
 using std::string;
 
-void handleArguments(int argc, char* argv[], unsigned int& width, unsigned int& height, unsigned int& items);
+enum class RunMode {
+    PLAY,
+    STATS,      // aggregate the results log instead of playing
+    RENDER,     // export a generated or loaded maze as an image
+    SERVE,      // host games for many clients over a Unix socket
+    CONNECT,    // play on a server from this terminal
+    WATCH,      // follow a game on a server without playing
+    ANALYZE,    // write difficulty metrics of many mazes as CSV
+    MARATHON,   // build or play a tiled on-disk maze
+    ENDLESS,    // play a maze generated chunk by chunk as you walk
+    FARM,       // pre-generate a library of mazes into .kml files
+    BENCH,      // time heap against fixed-size maze generation
+    POOL        // fill an on-disk pool of ready-made mazes
+};
 
-bool parseArguments(int argc, char* argv[], unsigned int& width, unsigned int& height, unsigned int& items);
+struct GameOptions {
+    RunMode mode;
+    unsigned int width;
+    unsigned int height;
+    unsigned int items;
+    string resumeFile;
+    string loadFile;
+    string replayLogFile;
+    string recordFile;              // asciicast of everything shown on screen
+    string replayFile;
+    bool replayRender;
+    unsigned int replaySpeed;
+    string resultsFile;
+    ResultQuery statsQuery;
+    string imageFile;
+    bool hasSeed;
+    unsigned int seed;
+    ImageOverlays overlays;
+    string socketPath;
+    unsigned int serverThreads;
+    bool hasGameId;
+    unsigned long long gameId;
+    AnalysisRequest analysis;
+    FarmRequest farm;
+    BenchRequest bench;
+    bool hasDifficulty;
+    DifficultyTarget difficulty;
+    SpawnBand minotaurBand;
+    unsigned int viewRadius;        // 0 = the whole maze is on screen
+    unsigned int levels;            // floors of a new game, linked by stairs
+    unsigned int campaign;          // mazes to escape in a row, each bigger; 0 = a single game
+    string poolDirectory;           // take new games from (and refill) a MazePool here
+    unsigned int poolDepth;
+    string marathonFile;
+    bool buildMarathon;
+    size_t tileCacheBytes;
+
+    GameOptions() : mode(RunMode::PLAY), width(0), height(0), items(0), replayRender(false), replaySpeed(10),
+        resultsFile(ResultsStore::DEFAULT_FILENAME), hasSeed(false), seed(0),
+        socketPath(GameServer::DEFAULT_SOCKET_PATH), serverThreads(0),
+        hasGameId(false), gameId(0), hasDifficulty(false), viewRadius(0), levels(1), campaign(0),
+        poolDepth(MazePool::DEFAULT_DEPTH), buildMarathon(false), tileCacheBytes(TiledMaze::DEFAULT_BUDGET) {}
+};
+
+void handleArguments(int argc, char* argv[], GameOptions& options);
+
+bool parseArguments(int argc, char* argv[], GameOptions& options);
 
 void printManual(const string& programName);
\ No newline at end of file
@@ -0,0 +1,243 @@
+#include <iostream>
+#include <cstdio>
+#include <atomic>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <cerrno>
+#include <fcntl.h>      // open flags
+#include <unistd.h>     // write, fsync, close
+#endif
+
+#include "AsyncFileWriter.h"
+#include "MemoryStats.h"
+
+using std::string;
+using std::mutex;
+using std::unique_lock;
+using std::lock_guard;
+using std::thread;
+using std::cerr;
+
+// Large enough that even a 10k x 10k dump goes out in a dozen writes
+static const size_t WRITE_CHUNK_SIZE = 8 * 1024 * 1024;
+
+// Gives up on finding a free name after this many numbered attempts
+static const unsigned int MAX_NAME_ATTEMPTS = 1000;
+
+// Unique per process and per write, so concurrent writers never share a temp file
+static string temporaryPathFor(const string& path) {
+    static std::atomic<unsigned int> writeCounter(0);
+#ifdef _WIN32
+    unsigned long processId = GetCurrentProcessId();
+#else
+    unsigned long processId = static_cast<unsigned long>(getpid());
+#endif
+    return path + ".tmp." + std::to_string(processId) + "." + std::to_string(writeCounter++);
+}
+
+// "dir/name.txt", 3 -> "dir/name_3.txt"
+static string numberedPath(const string& path, unsigned int number) {
+    if (number < 2) {
+        return path;
+    }
+    size_t dot = path.find_last_of('.');
+    size_t slash = path.find_last_of("/\\");
+    if (dot == string::npos || (slash != string::npos && dot < slash)) {
+        return path + "_" + std::to_string(number);
+    }
+    return path.substr(0, dot) + "_" + std::to_string(number) + path.substr(dot);
+}
+
+AsyncFileWriter::AsyncFileWriter()
+    : jobsInProgress(0), stopping(false) {
+    worker = thread(&AsyncFileWriter::run, this);
+}
+
+AsyncFileWriter::~AsyncFileWriter() {
+    {
+        lock_guard<mutex> lock(jobsMutex);
+        stopping = true;
+    }
+    jobAvailable.notify_all();
+    if (worker.joinable()) {
+        worker.join();
+    }
+}
+
+AsyncFileWriter& AsyncFileWriter::getInstance() {
+    static AsyncFileWriter instance;
+    return instance;
+}
+
+void AsyncFileWriter::submit(const string& path, string&& contents, bool replaceExisting) {
+    WriteJob job;
+    job.path = path;
+    job.contents = std::move(contents);
+    job.replaceExisting = replaceExisting;
+    enqueue(std::move(job));
+}
+
+void AsyncFileWriter::submitTask(std::function<void()>&& task) {
+    WriteJob job;
+    job.replaceExisting = true;
+    job.task = std::move(task);
+    enqueue(std::move(job));
+}
+
+void AsyncFileWriter::enqueue(WriteJob&& job) {
+    unique_lock<mutex> lock(jobsMutex);
+    slotAvailable.wait(lock, [this] { return jobs.size() < MAX_PENDING_JOBS; });
+
+    jobs.push_back(std::move(job));
+
+    lock.unlock();
+    jobAvailable.notify_one();
+}
+
+void AsyncFileWriter::waitForPendingWrites() {
+    unique_lock<mutex> lock(jobsMutex);
+    jobsDrained.wait(lock, [this] { return jobs.empty() && jobsInProgress == 0; });
+}
+
+void AsyncFileWriter::run() {
+    while (true) {
+        WriteJob job;
+        {
+            unique_lock<mutex> lock(jobsMutex);
+            jobAvailable.wait(lock, [this] { return stopping || !jobs.empty(); });
+
+            // Pending jobs are still written on shutdown - nothing gets dropped
+            if (jobs.empty()) {
+                return;
+            }
+
+            job = std::move(jobs.front());
+            jobs.pop_front();
+            ++jobsInProgress;
+        }
+        slotAvailable.notify_one();
+
+        MemoryScope scope(MemorySubsystem::FILES);
+        if (job.task) {
+            job.task();
+        }
+        else if (!writeFileAtomically(job.path, job.contents, job.replaceExisting)) {
+            cerr << "Error: Could not write file " << job.path << "\n";
+        }
+
+        {
+            lock_guard<mutex> lock(jobsMutex);
+            --jobsInProgress;
+        }
+        jobsDrained.notify_all();
+    }
+}
+
+#ifdef _WIN32
+bool AsyncFileWriter::writeFileAtomically(const string& path, const string& contents, bool replaceExisting) {
+    string tempPath = temporaryPathFor(path);
+
+    HANDLE file = CreateFileA(tempPath.c_str(), GENERIC_WRITE, 0, nullptr,
+        CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (file == INVALID_HANDLE_VALUE) {
+        return false;
+    }
+
+    size_t written = 0;
+    while (written < contents.size()) {
+        DWORD chunk = static_cast<DWORD>(
+            (contents.size() - written < WRITE_CHUNK_SIZE) ? contents.size() - written : WRITE_CHUNK_SIZE);
+        DWORD chunkWritten = 0;
+        if (!WriteFile(file, contents.data() + written, chunk, &chunkWritten, nullptr)) {
+            CloseHandle(file);
+            DeleteFileA(tempPath.c_str());
+            return false;
+        }
+        written += chunkWritten;
+    }
+
+    bool flushed = FlushFileBuffers(file) != 0;
+    CloseHandle(file);
+
+    if (!flushed) {
+        DeleteFileA(tempPath.c_str());
+        return false;
+    }
+
+    if (replaceExisting) {
+        if (!MoveFileExA(tempPath.c_str(), path.c_str(), MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH)) {
+            DeleteFileA(tempPath.c_str());
+            return false;
+        }
+        return true;
+    }
+
+    // Without REPLACE_EXISTING the move fails if the name is taken - try the next one
+    for (unsigned int attempt = 1; attempt <= MAX_NAME_ATTEMPTS; ++attempt) {
+        if (MoveFileExA(tempPath.c_str(), numberedPath(path, attempt).c_str(), MOVEFILE_WRITE_THROUGH)) {
+            return true;
+        }
+        if (GetLastError() != ERROR_ALREADY_EXISTS && GetLastError() != ERROR_FILE_EXISTS) {
+            break;
+        }
+    }
+    DeleteFileA(tempPath.c_str());
+    return false;
+}
+#else
+bool AsyncFileWriter::writeFileAtomically(const string& path, const string& contents, bool replaceExisting) {
+    string tempPath = temporaryPathFor(path);
+
+    int fd = open(tempPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        return false;
+    }
+
+    size_t written = 0;
+    while (written < contents.size()) {
+        size_t chunk = (contents.size() - written < WRITE_CHUNK_SIZE) ? contents.size() - written : WRITE_CHUNK_SIZE;
+        ssize_t result = write(fd, contents.data() + written, chunk);
+        if (result < 0 && errno == EINTR) {
+            continue;
+        }
+        if (result < 0) {
+            close(fd);
+            unlink(tempPath.c_str());
+            return false;
+        }
+        written += static_cast<size_t>(result);
+    }
+
+    bool synced = fsync(fd) == 0;
+    close(fd);
+
+    if (!synced) {
+        unlink(tempPath.c_str());
+        return false;
+    }
+
+    if (replaceExisting) {
+        if (std::rename(tempPath.c_str(), path.c_str()) != 0) {
+            unlink(tempPath.c_str());
+            return false;
+        }
+        return true;
+    }
+
+    // link() fails with EEXIST instead of replacing, which makes claiming a name atomic
+    // even when several processes finish games in the same second
+    for (unsigned int attempt = 1; attempt <= MAX_NAME_ATTEMPTS; ++attempt) {
+        if (link(tempPath.c_str(), numberedPath(path, attempt).c_str()) == 0) {
+            unlink(tempPath.c_str());
+            return true;
+        }
+        if (errno != EEXIST) {
+            break;
+        }
+    }
+    unlink(tempPath.c_str());
+    return false;
+}
+#endif
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <string>
+#include <deque>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <functional>
+
+/**
+ * @brief Process-wide background writer for finished files.
+ *
+ * The game thread hands over a fully built buffer and returns immediately;
+ * the writer thread writes it with a few large writes into a temporary file,
+ * fsyncs it and atomically renames it into place. The job queue is bounded,
+ * so a stalled disk throttles producers instead of growing memory.
+ */
+class AsyncFileWriter {
+private:
+    struct WriteJob {
+        std::string path;
+        std::string contents;
+        bool replaceExisting;
+        std::function<void()> task;     // when set, runs instead of a file write
+    };
+
+    static const size_t MAX_PENDING_JOBS = 8;
+
+    std::deque<WriteJob> jobs;
+    std::mutex jobsMutex;
+    std::condition_variable jobAvailable;
+    std::condition_variable slotAvailable;
+    std::condition_variable jobsDrained;
+    std::thread worker;
+    unsigned int jobsInProgress;
+    bool stopping;
+
+    AsyncFileWriter();
+    void run();
+    void enqueue(WriteJob&& job);
+
+public:
+    AsyncFileWriter(const AsyncFileWriter&) = delete;
+    AsyncFileWriter& operator=(const AsyncFileWriter&) = delete;
+    ~AsyncFileWriter();
+
+    static AsyncFileWriter& getInstance();
+
+    /**
+     * @brief Queue a file for writing. Blocks only while the queue is full.
+     * @param path Final path of the file
+     * @param contents Complete file contents, moved into the queue
+     * @param replaceExisting If false, an existing file is kept and the new one gets a _2, _3... suffix
+     */
+    void submit(const std::string& path, std::string&& contents, bool replaceExisting = true);
+
+    /**
+     * @brief Queue arbitrary I/O work (e.g. a log append) to run on the writer thread, in order.
+     */
+    void submitTask(std::function<void()>&& task);
+
+    /**
+     * @brief Block until every queued file has been written and renamed.
+     */
+    void waitForPendingWrites();
+
+    /**
+     * @brief Synchronously write contents to path via temp file + fsync + rename.
+     * @return True if the file is in place and durable
+     */
+    static bool writeFileAtomically(const std::string& path, const std::string& contents, bool replaceExisting = true);
+};
@@ -0,0 +1,80 @@
+#include <algorithm>
+
+#include "BackgroundMaze.h"
+#include "FixedMatrix.h"
+
+BackgroundMaze::BackgroundMaze(unsigned int width, unsigned int height, unsigned int no_of_items, unsigned int seed, unsigned int levelCount)
+    : width(width), height(height), no_of_items(no_of_items), seed(seed), levelCount(levelCount),
+    matrix(nullptr), levels(nullptr), generationTime(std::chrono::microseconds::zero()),
+    cancelled(false), finished(false), steps(0) {
+    worker = std::thread(&BackgroundMaze::run, this);
+}
+
+BackgroundMaze::~BackgroundMaze() {
+    cancel();
+    wait();
+    delete matrix;
+    delete levels;
+}
+
+// Same sequence as generating on the caller's thread: seed, then generate
+void BackgroundMaze::run() {
+    RNGEngine::seed(seed);
+
+    // The usual sizes are generated on the stack and copied into the Matrix the game
+    // plays on: the same maze, drawn from the same random numbers
+    auto generateTier = [&](auto& tier) {
+        auto start = std::chrono::high_resolution_clock::now();
+        tier.generateMatrix(no_of_items);
+        matrix = tier.toMatrix();
+        generationTime = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::high_resolution_clock::now() - start);
+    };
+
+    if (levelCount > 1) {
+        levels = new LevelStack(width, height, levelCount);
+        generationTime = levels->generate(no_of_items, seed);
+    }
+    else if (!MatrixTiers::withTier(width, height, generateTier)) {
+        matrix = new Matrix(width, height);
+        matrix->setCancellation(&cancelled);
+        matrix->setProgress(&steps);
+        generationTime = matrix->generateMatrix(no_of_items);
+        matrix->setCancellation(nullptr);
+        matrix->setProgress(nullptr);
+    }
+
+    rngState = RNGEngine::getState();
+    finished = true;
+}
+
+double BackgroundMaze::progress() const {
+    if (finished) {
+        return 1.0;
+    }
+    // Prim carves every other cell in both directions
+    double cells = std::max(1.0, static_cast<double>(width / 2) * (height / 2));
+    return std::min(0.99, steps.load(std::memory_order_relaxed) / cells);
+}
+
+void BackgroundMaze::cancel() {
+    cancelled = true;
+}
+
+bool BackgroundMaze::wait() {
+    if (worker.joinable()) {
+        worker.join();
+    }
+    return !cancelled;
+}
+
+Matrix* BackgroundMaze::takeMatrix() {
+    Matrix* taken = matrix;
+    matrix = nullptr;
+    return taken;
+}
+
+LevelStack* BackgroundMaze::takeLevels() {
+    LevelStack* taken = levels;
+    levels = nullptr;
+    return taken;
+}
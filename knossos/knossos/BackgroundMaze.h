@@ -0,0 +1,63 @@
+#pragma once
+
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include "Matrix.h"
+#include "LevelStack.h"
+#include "RNGEngine.h"
+
+/**
+ * @brief A maze (or a stack of floors) built on a thread of its own from the moment
+ * it is constructed, so the caller can print the introduction or play the previous
+ * level meanwhile.
+ *
+ * The worker seeds its own thread's engine and keeps where the sequence ended up;
+ * a game that adopts that state draws exactly the numbers it would have drawn after
+ * generating the maze itself, so seeds, saves and replays are unaffected.
+ */
+class BackgroundMaze {
+private:
+    unsigned int width;
+    unsigned int height;
+    unsigned int no_of_items;
+    unsigned int seed;
+    unsigned int levelCount;
+    Matrix* matrix;
+    LevelStack* levels;
+    mersenne_twister rngState;
+    std::chrono::microseconds generationTime;
+    std::atomic<bool> cancelled;
+    std::atomic<bool> finished;
+    std::atomic<unsigned int> steps;
+    std::thread worker;
+
+    void run();
+
+public:
+    BackgroundMaze(unsigned int width, unsigned int height, unsigned int no_of_items, unsigned int seed, unsigned int levelCount = 1);
+    // Cancels the build if it is still running; frees whatever wasn't taken
+    ~BackgroundMaze();
+    BackgroundMaze(const BackgroundMaze&) = delete;
+    BackgroundMaze& operator=(const BackgroundMaze&) = delete;
+
+    bool ready() const { return finished; }
+    // Rough share of a single maze carved so far; floors of a stack only report 0 until done
+    double progress() const;
+    // A single maze stops within a few thousand steps; a stack of floors finishes first
+    void cancel();
+    // Blocks until the worker is done; false if the build was cancelled
+    bool wait();
+
+    // After a successful wait: the caller owns what it takes (the stack owns its current floor)
+    Matrix* takeMatrix();
+    LevelStack* takeLevels();
+    const mersenne_twister& getRngState() const { return rngState; }
+    std::chrono::microseconds getGenerationTime() const { return generationTime; }
+
+    unsigned int getWidth() const { return width; }
+    unsigned int getHeight() const { return height; }
+    unsigned int getItemCount() const { return no_of_items; }
+    unsigned int getSeed() const { return seed; }
+    unsigned int getLevelCount() const { return levelCount; }
+};
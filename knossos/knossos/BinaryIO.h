@@ -0,0 +1,71 @@
+#pragma once
+
+#include <string>
+#include <cstdint>
+
+// Little-endian helpers shared by the binary file formats (saves, replays, ...)
+
+inline void appendU8(std::string& buffer, uint8_t value) {
+    buffer += static_cast<char>(value);
+}
+
+inline void appendU16(std::string& buffer, uint16_t value) {
+    buffer += static_cast<char>(value & 0xFF);
+    buffer += static_cast<char>((value >> 8) & 0xFF);
+}
+
+inline void appendU32(std::string& buffer, uint32_t value) {
+    for (int shift = 0; shift < 32; shift += 8) {
+        buffer += static_cast<char>((value >> shift) & 0xFF);
+    }
+}
+
+inline void appendU64(std::string& buffer, uint64_t value) {
+    for (int shift = 0; shift < 64; shift += 8) {
+        buffer += static_cast<char>((value >> shift) & 0xFF);
+    }
+}
+
+inline uint8_t readU8(const char* data) {
+    return static_cast<uint8_t>(data[0]);
+}
+
+inline uint16_t readU16(const char* data) {
+    return static_cast<uint16_t>(static_cast<unsigned char>(data[0]) |
+        (static_cast<unsigned char>(data[1]) << 8));
+}
+
+inline uint32_t readU32(const char* data) {
+    uint32_t value = 0;
+    for (int i = 0; i < 4; ++i) {
+        value |= static_cast<uint32_t>(static_cast<unsigned char>(data[i])) << (8 * i);
+    }
+    return value;
+}
+
+inline uint64_t readU64(const char* data) {
+    uint64_t value = 0;
+    for (int i = 0; i < 8; ++i) {
+        value |= static_cast<uint64_t>(static_cast<unsigned char>(data[i])) << (8 * i);
+    }
+    return value;
+}
+
+// Cursor-style readers: read at offset and advance it
+inline uint16_t readU16(const std::string& buffer, size_t& offset) {
+    uint16_t value = readU16(buffer.data() + offset);
+    offset += 2;
+    return value;
+}
+
+inline uint32_t readU32(const std::string& buffer, size_t& offset) {
+    uint32_t value = readU32(buffer.data() + offset);
+    offset += 4;
+    return value;
+}
+
+inline uint64_t readU64(const std::string& buffer, size_t& offset) {
+    uint64_t value = readU64(buffer.data() + offset);
+    offset += 8;
+    return value;
+}
\ No newline at end of file
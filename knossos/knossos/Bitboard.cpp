@@ -0,0 +1,256 @@
+#include <algorithm>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+#include "Bitboard.h"
+
+using std::vector;
+
+namespace {
+
+// Fill the open runs of a row that hold a reached cell. Upwards (towards higher x) an
+// addition does it: a carry entering a run of ones ripples to its end. Downwards there
+// is no carry, so reach is doubled six times instead, over shrinking runs of open cells
+void fillRuns(uint64_t* reached, const uint64_t* open, size_t words) {
+    uint64_t carry = 0;
+    for (size_t i = 0; i < words; ++i) {
+        uint64_t sum = open[i] + reached[i];
+        uint64_t overflow = sum < open[i];
+        uint64_t total = sum + carry;
+        overflow |= total < sum;
+        reached[i] |= (total ^ open[i]) & open[i];
+        carry = overflow;
+    }
+
+    uint64_t incoming = 0;
+    for (size_t i = words; i-- > 0;) {
+        uint64_t fill = reached[i] | (incoming << 63 & open[i]);
+        uint64_t through = open[i];
+        fill |= through & (fill >> 1);
+        through &= through >> 1;
+        fill |= through & (fill >> 2);
+        through &= through >> 2;
+        fill |= through & (fill >> 4);
+        through &= through >> 4;
+        fill |= through & (fill >> 8);
+        through &= through >> 8;
+        fill |= through & (fill >> 16);
+        through &= through >> 16;
+        fill |= through & (fill >> 32);
+        reached[i] = fill;
+        incoming = fill & 1;
+    }
+}
+
+// The set bits of each byte, side by side in the bytes of the result
+uint64_t byteCounts(uint64_t bits) {
+    bits = bits - ((bits >> 1) & 0x5555555555555555ULL);
+    bits = (bits & 0x3333333333333333ULL) + ((bits >> 2) & 0x3333333333333333ULL);
+    return (bits + (bits >> 4)) & 0x0F0F0F0F0F0F0F0FULL;
+}
+
+}
+
+unsigned int Bitboard::lowestBit(uint64_t bits) {
+#ifdef _MSC_VER
+    unsigned long index;
+    _BitScanForward64(&index, bits);
+    return index;
+#else
+    return __builtin_ctzll(bits);
+#endif
+}
+
+unsigned int Bitboard::bitCount(uint64_t bits) {
+#ifdef _MSC_VER
+    return static_cast<unsigned int>(__popcnt64(bits));
+#else
+    return __builtin_popcountll(bits);
+#endif
+}
+
+Bitboard::Bitboard(unsigned int width, unsigned int height)
+    : width(width), height(height), wordsPerRow((width + 63) / 64), words(static_cast<size_t>(height) * wordsPerRow, 0) {}
+
+Bitboard Bitboard::walkable(const Matrix& matrix) {
+    Bitboard board(matrix.getWidth(), matrix.getHeight());
+    // The matrix is column-major, so one column at a time fills a bit of every row
+    for (unsigned int x = 0; x < board.width; ++x) {
+        uint64_t bit = uint64_t(1) << (x % 64);
+        uint64_t* word = &board.words[x / 64];
+        for (unsigned int y = 0; y < board.height; ++y, word += board.wordsPerRow) {
+            if (matrix.getField(x, y)->isWalkable()) *word |= bit;
+        }
+    }
+    return board;
+}
+
+// A word holds eight blocks side by side, a byte each. The byte counts of a block's
+// eight rows add up in place: at most 64 per byte, so no count spills into the next
+vector<uint8_t> Bitboard::blockCounts() const {
+    vector<uint8_t> counts(blockRows() * blocksPerRow(), 0);
+    vector<uint64_t> sums(wordsPerRow);
+
+    for (size_t blockY = 0; blockY < blockRows(); ++blockY) {
+        std::fill(sums.begin(), sums.end(), 0);
+        unsigned int last = std::min<unsigned int>(height, static_cast<unsigned int>(blockY + 1) * BLOCK);
+        for (unsigned int y = static_cast<unsigned int>(blockY) * BLOCK; y < last; ++y) {
+            const uint64_t* bits = row(y);
+            for (size_t i = 0; i < wordsPerRow; ++i) {
+                sums[i] += byteCounts(bits[i]);
+            }
+        }
+
+        uint8_t* out = &counts[blockY * blocksPerRow()];
+        for (size_t i = 0; i < wordsPerRow; ++i) {
+            for (unsigned int byte = 0; byte < 8; ++byte) {
+                out[i * 8 + byte] = static_cast<uint8_t>(sums[i] >> (byte * 8));
+            }
+        }
+    }
+    return counts;
+}
+
+unsigned int Bitboard::blockCount(size_t blockX, size_t blockY) const {
+    unsigned int total = 0;
+    unsigned int last = std::min<unsigned int>(height, static_cast<unsigned int>(blockY + 1) * BLOCK);
+    for (unsigned int y = static_cast<unsigned int>(blockY) * BLOCK; y < last; ++y) {
+        total += bitCount((row(y)[blockX / 8] >> (blockX % 8 * BLOCK)) & 0xFF);
+    }
+    return total;
+}
+
+size_t Bitboard::count() const {
+    size_t total = 0;
+    for (uint64_t word : words) {
+        total += bitCount(word);
+    }
+    return total;
+}
+
+bool Bitboard::any() const {
+    uint64_t all = 0;
+    for (uint64_t word : words) {
+        all |= word;
+    }
+    return all != 0;
+}
+
+bool Bitboard::intersects(const Bitboard& other) const {
+    uint64_t common = 0;
+    for (size_t i = 0; i < words.size(); ++i) {
+        common |= words[i] & other.words[i];
+    }
+    return common != 0;
+}
+
+Bitboard& Bitboard::operator&=(const Bitboard& other) {
+    for (size_t i = 0; i < words.size(); ++i) {
+        words[i] &= other.words[i];
+    }
+    return *this;
+}
+
+Bitboard& Bitboard::operator|=(const Bitboard& other) {
+    for (size_t i = 0; i < words.size(); ++i) {
+        words[i] |= other.words[i];
+    }
+    return *this;
+}
+
+Bitboard Bitboard::floodFill(const Bitboard& open) const {
+    Bitboard reached(*this);
+    reached &= open;
+
+    // Depth-first over words: a word with new cells fills the open runs they lie in,
+    // then hands whatever it gained to the words above and below it and, where a run
+    // crosses a word boundary, to its left and right. spreadBits remembers what a
+    // word has already handed on, so every cell is passed along once
+    vector<uint64_t> spreadBits(words.size(), 0);
+    vector<size_t> pending;
+    for (size_t word = 0; word < words.size(); ++word) {
+        if (reached.words[word] != 0) pending.push_back(word);
+    }
+
+    while (!pending.empty()) {
+        size_t word = pending.back();
+        pending.pop_back();
+
+        uint64_t filled = reached.words[word];
+        fillRuns(&filled, &open.words[word], 1);
+        uint64_t fresh = filled & ~spreadBits[word];
+        if (fresh == 0) continue;
+        reached.words[word] = filled;
+        spreadBits[word] = filled;
+
+        auto hand = [&](size_t target, uint64_t bits) {
+            bits &= open.words[target] & ~reached.words[target];
+            if (bits != 0) {
+                reached.words[target] |= bits;
+                pending.push_back(target);
+            }
+        };
+        if (word >= wordsPerRow) hand(word - wordsPerRow, fresh);
+        if (word + wordsPerRow < words.size()) hand(word + wordsPerRow, fresh);
+        if ((fresh >> 63) && (word + 1) % wordsPerRow != 0) hand(word + 1, 1);
+        if ((fresh & 1) && word % wordsPerRow != 0) hand(word - 1, uint64_t(1) << 63);
+    }
+    return reached;
+}
+
+DistanceLayers::DistanceLayers(const Bitboard& open, const Bitboard& start)
+    : open(open), reachedCells(start), frontierCells(open.width, open.height), candidates(open.width, open.height), layer(0) {
+    reachedCells &= open;
+    for (size_t word = 0; word < reachedCells.words.size(); ++word) {
+        if (reachedCells.words[word] != 0) {
+            frontierCells.words[word] = reachedCells.words[word];
+            active.push_back(word);
+        }
+    }
+}
+
+void DistanceLayers::spread(size_t word, uint64_t bits) {
+    const size_t wordsPerRow = open.wordsPerRow;
+    auto add = [this](size_t target, uint64_t more) {
+        if (candidates.words[target] == 0) touched.push_back(target);
+        candidates.words[target] |= more;
+    };
+
+    add(word, bits << 1 | bits >> 1);
+    // Across a word boundary only within the row; the division is rarely needed
+    if ((bits >> 63) && (word + 1) % wordsPerRow != 0) add(word + 1, 1);
+    if ((bits & 1) && word % wordsPerRow != 0) add(word - 1, uint64_t(1) << 63);
+    if (word >= wordsPerRow) add(word - wordsPerRow, bits);
+    if (word + wordsPerRow < open.words.size()) add(word + wordsPerRow, bits);
+}
+
+bool DistanceLayers::next() {
+    if (active.empty()) {
+        return false;
+    }
+
+    touched.clear();
+    for (size_t word : active) {
+        spread(word, frontierCells.words[word]);
+        frontierCells.words[word] = 0;
+    }
+
+    active.clear();
+    for (size_t word : touched) {
+        uint64_t fresh = candidates.words[word] & open.words[word] & ~reachedCells.words[word];
+        candidates.words[word] = 0;
+        if (fresh != 0) {
+            reachedCells.words[word] |= fresh;
+            frontierCells.words[word] = fresh;
+            active.push_back(word);
+        }
+    }
+
+    if (active.empty()) {
+        return false;
+    }
+    ++layer;
+    return true;
+}
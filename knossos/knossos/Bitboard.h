@@ -0,0 +1,111 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include "Matrix.h"
+
+/**
+ * @brief One bit per cell, each row packed into 64-bit words (cell x of a row is bit
+ * x % 64 of word x / 64), so a whole stretch of a row is shifted, masked or combined
+ * in one operation. Padding bits past the last column are always clear.
+ *
+ * The whole-board operations are plain loops over the word array, written so the
+ * compiler can vectorise them with whatever SIMD the target has.
+ */
+class Bitboard {
+private:
+    unsigned int width;
+    unsigned int height;
+    size_t wordsPerRow;
+    std::vector<uint64_t> words;
+
+    friend class DistanceLayers;
+
+    uint64_t* row(unsigned int y) { return &words[y * wordsPerRow]; }
+    const uint64_t* row(unsigned int y) const { return &words[y * wordsPerRow]; }
+
+    static unsigned int lowestBit(uint64_t bits);      // bits must not be 0
+    static unsigned int bitCount(uint64_t bits);
+
+public:
+    Bitboard(unsigned int width, unsigned int height);
+
+    // The cells of a maze that can be walked on (everything but walls)
+    static Bitboard walkable(const Matrix& matrix);
+
+    unsigned int getWidth() const { return width; }
+    unsigned int getHeight() const { return height; }
+
+    bool test(unsigned int x, unsigned int y) const { return (row(y)[x / 64] >> (x % 64)) & 1; }
+    void set(unsigned int x, unsigned int y) { row(y)[x / 64] |= uint64_t(1) << (x % 64); }
+    void reset(unsigned int x, unsigned int y) { row(y)[x / 64] &= ~(uint64_t(1) << (x % 64)); }
+
+    // Set cells per BLOCK x BLOCK square, blocks row-major, blocksPerRow() to a row
+    // (the last ones may reach past the width and only count what's inside)
+    static const unsigned int BLOCK = 8;
+    size_t blocksPerRow() const { return wordsPerRow * (64 / BLOCK); }
+    size_t blockRows() const { return (height + BLOCK - 1) / BLOCK; }
+    std::vector<uint8_t> blockCounts() const;
+    unsigned int blockCount(size_t blockX, size_t blockY) const;
+
+    size_t count() const;
+    bool any() const;
+    bool intersects(const Bitboard& other) const;
+    Bitboard& operator&=(const Bitboard& other);
+    Bitboard& operator|=(const Bitboard& other);
+
+    /**
+     * @brief Every cell of open connected to one of these cells. Seeds outside open are
+     * dropped. A worklist of words is worked through depth-first: a word fills the open
+     * runs its reached cells lie in with a few word operations, then passes the cells it
+     * newly gained to the words above and below and, across word boundaries, to its
+     * neighbours in the row, until no word gains anything.
+     */
+    Bitboard floodFill(const Bitboard& open) const;
+};
+
+/**
+ * @brief Breadth-first search one distance at a time: next() moves the frontier a step
+ * out with word-wide shifts and masks. Only words the frontier touches are visited, so
+ * a layer costs as much as its frontier, not as much as the maze.
+ */
+class DistanceLayers {
+private:
+    const Bitboard& open;
+    Bitboard reachedCells;
+    Bitboard frontierCells;         // zero outside the words listed in active
+    Bitboard candidates;            // next layer before masking, zero between calls
+    std::vector<size_t> active;
+    std::vector<size_t> touched;
+    unsigned int layer;
+
+    void spread(size_t word, uint64_t bits);
+
+public:
+    // Layer 0 is start & open
+    DistanceLayers(const Bitboard& open, const Bitboard& start);
+
+    // Move one step out; false once there is nothing left to reach, the frontier then empty
+    bool next();
+
+    unsigned int distance() const { return layer; }
+    bool done() const { return active.empty(); }
+    const Bitboard& frontier() const { return frontierCells; }
+    const Bitboard& reached() const { return reachedCells; }
+
+    // Calls visit(x, y) for every cell of the current layer, a word at a time
+    template <typename Visit>
+    void forEachFrontierCell(Visit visit) const;
+};
+
+template <typename Visit>
+void DistanceLayers::forEachFrontierCell(Visit visit) const {
+    for (size_t word : active) {
+        unsigned int y = static_cast<unsigned int>(word / frontierCells.wordsPerRow);
+        unsigned int baseX = static_cast<unsigned int>(word % frontierCells.wordsPerRow) * 64;
+        for (uint64_t bits = frontierCells.words[word]; bits != 0; bits &= bits - 1) {
+            visit(baseX + Bitboard::lowestBit(bits), y);
+        }
+    }
+}
@@ -0,0 +1,104 @@
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <cstddef>
+
+/**
+ * @brief Fixed-capacity lock-free queue for any number of producers and consumers.
+ *
+ * Every slot carries a sequence number that tells whose turn it is: a producer may
+ * fill slot i of lap n when its sequence is n * capacity + i, a consumer may empty it
+ * once the producer has advanced it by one. Positions are claimed with a single
+ * compare-and-swap, so a push or pop never blocks - a full or empty queue just
+ * returns false and the caller decides how to wait.
+ */
+template <typename T>
+class BoundedQueue {
+private:
+    struct Slot {
+        std::atomic<size_t> sequence;
+        T value;
+    };
+
+    std::unique_ptr<Slot[]> slots;
+    size_t mask;
+    alignas(64) std::atomic<size_t> pushPosition;
+    alignas(64) std::atomic<size_t> popPosition;
+
+public:
+    // The capacity is rounded up to a power of two
+    explicit BoundedQueue(size_t minimumCapacity);
+    BoundedQueue(const BoundedQueue&) = delete;
+    BoundedQueue& operator=(const BoundedQueue&) = delete;
+
+    // Moves value in and returns true, or leaves it alone if the queue is full
+    bool tryPush(T& value);
+    bool tryPop(T& value);
+
+    // Only a snapshot while other threads push and pop
+    size_t size() const;
+    size_t capacity() const { return mask + 1; }
+};
+
+template <typename T>
+BoundedQueue<T>::BoundedQueue(size_t minimumCapacity) : pushPosition(0), popPosition(0) {
+    size_t capacity = 2;
+    while (capacity < minimumCapacity) capacity *= 2;
+    slots.reset(new Slot[capacity]);
+    mask = capacity - 1;
+    for (size_t i = 0; i < capacity; ++i) {
+        slots[i].sequence.store(i, std::memory_order_relaxed);
+    }
+}
+
+template <typename T>
+bool BoundedQueue<T>::tryPush(T& value) {
+    size_t position = pushPosition.load(std::memory_order_relaxed);
+    while (true) {
+        Slot& slot = slots[position & mask];
+        size_t sequence = slot.sequence.load(std::memory_order_acquire);
+        if (sequence == position) {
+            if (pushPosition.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+                slot.value = std::move(value);
+                slot.sequence.store(position + 1, std::memory_order_release);
+                return true;
+            }
+        }
+        else if (sequence < position) {
+            return false;
+        }
+        else {
+            position = pushPosition.load(std::memory_order_relaxed);
+        }
+    }
+}
+
+template <typename T>
+bool BoundedQueue<T>::tryPop(T& value) {
+    size_t position = popPosition.load(std::memory_order_relaxed);
+    while (true) {
+        Slot& slot = slots[position & mask];
+        size_t sequence = slot.sequence.load(std::memory_order_acquire);
+        if (sequence == position + 1) {
+            if (popPosition.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+                value = std::move(slot.value);
+                slot.sequence.store(position + mask + 1, std::memory_order_release);
+                return true;
+            }
+        }
+        else if (sequence < position + 1) {
+            return false;
+        }
+        else {
+            position = popPosition.load(std::memory_order_relaxed);
+        }
+    }
+}
+
+template <typename T>
+size_t BoundedQueue<T>::size() const {
+    size_t pushed = pushPosition.load(std::memory_order_relaxed);
+    size_t popped = popPosition.load(std::memory_order_relaxed);
+    return pushed > popped ? pushed - popped : 0;
+}
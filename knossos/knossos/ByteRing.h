@@ -0,0 +1,84 @@
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <cstring>
+#include <cstddef>
+#include <algorithm>
+
+/**
+ * @brief Fixed-capacity lock-free byte ring for exactly one writing and one reading
+ * thread.
+ *
+ * Both positions only ever grow; the writer publishes what it wrote by advancing its
+ * position with release ordering, the reader hands space back the same way. A write
+ * goes in whole or not at all, so records written in one call never arrive torn.
+ */
+class ByteRing {
+private:
+    std::unique_ptr<char[]> bytes;
+    size_t mask;
+    alignas(64) std::atomic<size_t> writePosition;
+    alignas(64) std::atomic<size_t> readPosition;
+
+    void copyIn(size_t position, const void* data, size_t size);
+    void copyOut(size_t position, void* data, size_t size) const;
+
+public:
+    // The capacity is rounded up to a power of two
+    explicit ByteRing(size_t minimumCapacity);
+    ByteRing(const ByteRing&) = delete;
+    ByteRing& operator=(const ByteRing&) = delete;
+
+    // Writer: appends head and then body, or nothing if both don't fit
+    bool tryWrite(const void* head, size_t headSize, const void* body, size_t bodySize);
+
+    // Reader: what can be read now; read takes at most that much
+    size_t readable() const;
+    void read(void* data, size_t size);
+
+    size_t capacity() const { return mask + 1; }
+};
+
+inline ByteRing::ByteRing(size_t minimumCapacity) : writePosition(0), readPosition(0) {
+    size_t capacity = 2;
+    while (capacity < minimumCapacity) capacity *= 2;
+    bytes.reset(new char[capacity]);
+    mask = capacity - 1;
+}
+
+inline void ByteRing::copyIn(size_t position, const void* data, size_t size) {
+    size_t offset = position & mask;
+    size_t first = std::min(size, mask + 1 - offset);
+    std::memcpy(&bytes[offset], data, first);
+    std::memcpy(&bytes[0], static_cast<const char*>(data) + first, size - first);
+}
+
+inline void ByteRing::copyOut(size_t position, void* data, size_t size) const {
+    size_t offset = position & mask;
+    size_t first = std::min(size, mask + 1 - offset);
+    std::memcpy(data, &bytes[offset], first);
+    std::memcpy(static_cast<char*>(data) + first, &bytes[0], size - first);
+}
+
+inline bool ByteRing::tryWrite(const void* head, size_t headSize, const void* body, size_t bodySize) {
+    size_t position = writePosition.load(std::memory_order_relaxed);
+    size_t used = position - readPosition.load(std::memory_order_acquire);
+    if (headSize + bodySize > capacity() - used) {
+        return false;
+    }
+    copyIn(position, head, headSize);
+    copyIn(position + headSize, body, bodySize);
+    writePosition.store(position + headSize + bodySize, std::memory_order_release);
+    return true;
+}
+
+inline size_t ByteRing::readable() const {
+    return writePosition.load(std::memory_order_acquire) - readPosition.load(std::memory_order_relaxed);
+}
+
+inline void ByteRing::read(void* data, size_t size) {
+    size_t position = readPosition.load(std::memory_order_relaxed);
+    copyOut(position, data, size);
+    readPosition.store(position + size, std::memory_order_release);
+}
@@ -0,0 +1,220 @@
+#include <sstream>
+#include <algorithm>
+#include <cstring>
+#include <cstdlib>
+
+#include "ChunkedWorld.h"
+#include "EllerRows.h"
+
+using std::string;
+using std::unique_ptr;
+
+namespace {
+
+const unsigned int ROOMS = ChunkedWorld::CHUNK_SIZE / 2;      // rooms per chunk row, on odd coordinates
+const unsigned int START_CHUNK = 1u << 25;                   // the middle of the coordinate range
+const unsigned int START_ROOM = ChunkedWorld::CHUNK_SIZE / 2 + 1;
+const unsigned int ITEMS_PER_CHUNK = 2;                      // at most
+const unsigned int EXIT_ODDS = 12;                           // one chunk in this many has an exit
+
+uint64_t chunkKey(unsigned int chunkX, unsigned int chunkY) {
+    return static_cast<uint64_t>(chunkY) << 32 | chunkX;
+}
+
+}
+
+ChunkedWorld::ChunkedWorld(unsigned int seed)
+    : seed(seed), lastKey(UINT64_MAX), lastChunk(nullptr), round(0), builtOnTheSpot(0), stopping(false) {
+    // The first screen is built before the game starts, the rest while it runs
+    for (unsigned int chunkY = START_CHUNK - PREFETCH_RADIUS; chunkY <= START_CHUNK + PREFETCH_RADIUS; ++chunkY) {
+        for (unsigned int chunkX = START_CHUNK - PREFETCH_RADIUS; chunkX <= START_CHUNK + PREFETCH_RADIUS; ++chunkX) {
+            unique_ptr<Chunk> built(new Chunk);
+            build(chunkKey(chunkX, chunkY), *built);
+            resident.emplace(chunkKey(chunkX, chunkY), ResidentChunk{ std::move(built), round });
+        }
+    }
+    worker = std::thread(&ChunkedWorld::work, this);
+}
+
+ChunkedWorld::~ChunkedWorld() {
+    {
+        std::lock_guard<std::mutex> lock(queueMutex);
+        stopping = true;
+    }
+    wake.notify_one();
+    worker.join();
+}
+
+unsigned int ChunkedWorld::getStartX() const {
+    return START_CHUNK * CHUNK_SIZE + START_ROOM;
+}
+
+unsigned int ChunkedWorld::getStartY() const {
+    return START_CHUNK * CHUNK_SIZE + START_ROOM;
+}
+
+void ChunkedWorld::build(uint64_t key, Chunk& chunk) const {
+    unsigned int chunkX = static_cast<unsigned int>(key), chunkY = static_cast<unsigned int>(key >> 32);
+    std::seed_seq sequence{ seed, chunkX, chunkY };
+    mersenne_twister rng(sequence);
+    auto draw = [&](unsigned int min, unsigned int max) {
+        return std::uniform_int_distribution<unsigned int>(min, max)(rng);
+    };
+    auto at = [&](unsigned int x, unsigned int y) -> uint8_t& {
+        return chunk.cells[y * CHUNK_SIZE + x];
+    };
+
+    std::memset(chunk.cells, TiledCell::WALL, sizeof(chunk.cells));
+    EllerRows eller(ROOMS, rng);
+    for (unsigned int row = 0; row < ROOMS; ++row) {
+        unsigned int y = 2 * row + 1;
+        eller.nextRow(row == ROOMS - 1);
+        for (unsigned int c = 0; c < ROOMS; ++c) {
+            at(2 * c + 1, y) = TiledCell::PASSAGE;
+            if (eller.east[c]) at(2 * c + 2, y) = TiledCell::PASSAGE;
+            if (eller.down[c]) at(2 * c + 1, y + 1) = TiledCell::PASSAGE;
+        }
+    }
+
+    // Doors in the wall column and row this chunk owns, to its left and top neighbours
+    for (unsigned int door = draw(1, 2); door > 0; --door) {
+        at(0, 2 * draw(0, ROOMS - 1) + 1) = TiledCell::PASSAGE;
+        at(2 * draw(0, ROOMS - 1) + 1, 0) = TiledCell::PASSAGE;
+    }
+
+    bool startChunk = chunkX == START_CHUNK && chunkY == START_CHUNK;
+    if (startChunk) {
+        at(START_ROOM, START_ROOM) = TiledCell::ENTRANCE;
+    }
+    else if (draw(1, EXIT_ODDS) == 1) {
+        at(2 * draw(0, ROOMS - 1) + 1, 2 * draw(0, ROOMS - 1) + 1) = TiledCell::EXIT;
+    }
+    for (unsigned int item = draw(0, ITEMS_PER_CHUNK); item > 0; --item) {
+        uint8_t& room = at(2 * draw(0, ROOMS - 1) + 1, 2 * draw(0, ROOMS - 1) + 1);
+        if (room == TiledCell::PASSAGE) room = TiledCell::SWORD + draw(0, 3);
+    }
+}
+
+void ChunkedWorld::work() {
+    std::unique_lock<std::mutex> lock(queueMutex);
+    while (true) {
+        wake.wait(lock, [this] { return stopping || !wanted.empty(); });
+        if (stopping) return;
+        uint64_t key = wanted.front();
+        wanted.pop_front();
+
+        lock.unlock();
+        unique_ptr<Chunk> built(new Chunk);
+        build(key, *built);
+        lock.lock();
+        finished.emplace_back(key, std::move(built));
+    }
+}
+
+void ChunkedWorld::collectFinished() {
+    std::vector<std::pair<uint64_t, unique_ptr<Chunk>>> collected;
+    {
+        std::lock_guard<std::mutex> lock(queueMutex);
+        collected.swap(finished);
+    }
+    for (auto& entry : collected) {
+        pending.erase(entry.first);
+        if (resident.find(entry.first) == resident.end()) {
+            resident[entry.first] = ResidentChunk{ std::move(entry.second), round };
+        }
+    }
+}
+
+const ChunkedWorld::Chunk* ChunkedWorld::chunk(uint64_t key) {
+    if (key == lastKey) return lastChunk;
+
+    auto found = resident.find(key);
+    if (found == resident.end()) {
+        collectFinished();
+        found = resident.find(key);
+    }
+    if (found == resident.end()) {
+        // Not even queued (or not done yet): this turn waits for it after all
+        unique_ptr<Chunk> built(new Chunk);
+        build(key, *built);
+        ++builtOnTheSpot;
+        found = resident.emplace(key, ResidentChunk{ std::move(built), round }).first;
+    }
+
+    lastKey = key;
+    lastChunk = found->second.chunk.get();
+    return lastChunk;
+}
+
+bool ChunkedWorld::isBoundary(unsigned int x, unsigned int y) const {
+    return x == 0 || y == 0 || x >= UINT32_MAX - 1 || y >= UINT32_MAX - 1;
+}
+
+void ChunkedWorld::setCell(unsigned int x, unsigned int y, uint8_t cell) {
+    changes[static_cast<uint64_t>(y) << 32 | x] = cell;
+}
+
+uint8_t ChunkedWorld::getCell(unsigned int x, unsigned int y) {
+    if (x >= UINT32_MAX || y >= UINT32_MAX) {
+        return TiledCell::WALL;
+    }
+    if (!changes.empty()) {
+        auto change = changes.find(static_cast<uint64_t>(y) << 32 | x);
+        if (change != changes.end()) return change->second;
+    }
+    return chunk(chunkKey(x / CHUNK_SIZE, y / CHUNK_SIZE))->cells[(y % CHUNK_SIZE) * CHUNK_SIZE + x % CHUNK_SIZE];
+}
+
+void ChunkedWorld::prefetchAround(unsigned int x, unsigned int y) {
+    ++round;
+    collectFinished();
+
+    // Nearest chunks first, so the thread gets to the one the robot is heading into early
+    int centerX = static_cast<int>(x / CHUNK_SIZE), centerY = static_cast<int>(y / CHUNK_SIZE);
+    const int maxChunk = static_cast<int>(UINT32_MAX / CHUNK_SIZE);
+    bool queued = false;
+    for (int ring = 0; ring <= PREFETCH_RADIUS; ++ring) {
+        for (int dy = -ring; dy <= ring; ++dy) {
+            for (int dx = -ring; dx <= ring; ++dx) {
+                if (std::max(std::abs(dx), std::abs(dy)) != ring) continue;
+                int chunkX = centerX + dx, chunkY = centerY + dy;
+                if (chunkX < 0 || chunkY < 0 || chunkX > maxChunk || chunkY > maxChunk) continue;
+
+                uint64_t key = chunkKey(chunkX, chunkY);
+                auto found = resident.find(key);
+                if (found != resident.end()) {
+                    found->second.lastWanted = round;
+                }
+                else if (pending.insert(key).second) {
+                    std::lock_guard<std::mutex> lock(queueMutex);
+                    wanted.push_back(key);
+                    queued = true;
+                }
+            }
+        }
+    }
+    if (queued) {
+        wake.notify_one();
+    }
+
+    for (auto it = resident.begin(); it != resident.end();) {
+        if (round - it->second.lastWanted > EVICT_AFTER) {
+            if (it->first == lastKey) lastKey = UINT64_MAX;
+            it = resident.erase(it);
+        }
+        else {
+            ++it;
+        }
+    }
+}
+
+string ChunkedWorld::title() const {
+    return "Endless labyrinth, seed " + std::to_string(seed);
+}
+
+string ChunkedWorld::cacheStatus() const {
+    std::ostringstream status;
+    status << "|  chunks in memory " << resident.size() << ", being built " << pending.size()
+        << ", waited for " << builtOnTheSpot;
+    return status.str();
+}
@@ -0,0 +1,93 @@
+#pragma once
+
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <condition_variable>
+#include <deque>
+#include <vector>
+#include <unordered_map>
+#include <unordered_set>
+#include "MarathonMaze.h"
+
+/**
+ * @brief An endless maze: the plane is cut into CHUNK_SIZE x CHUNK_SIZE chunks and
+ * each one is generated only when the robot comes near, from nothing but the seed
+ * and its chunk coordinates - so a chunk dropped from memory comes back exactly
+ * as it was.
+ *
+ * Every cell belongs to exactly one chunk, and a chunk owns the wall column on its
+ * left and the wall row on its top. Inside, its rooms form a perfect maze (Eller's
+ * algorithm); in the walls it owns, it opens one or two doors to its left and top
+ * neighbours. The neighbours never need to agree on anything, which is what keeps
+ * the borders consistent, and every chunk being connected inside and to all four
+ * neighbours makes the whole plane one maze. Each chunk also gets a few items, and
+ * some of them an exit.
+ *
+ * A background thread builds the chunks ahead of the robot; the game only builds
+ * one itself if it needs a chunk the thread has not finished yet.
+ */
+class ChunkedWorld : public MarathonMaze {
+public:
+    static const unsigned int CHUNK_SIZE = 64;
+    static const int PREFETCH_RADIUS = 2;       // chunks around the robot built ahead
+    static const uint64_t EVICT_AFTER = 256;    // prefetch rounds a chunk may go unwanted
+
+private:
+    struct Chunk {
+        uint8_t cells[CHUNK_SIZE * CHUNK_SIZE];     // row-major
+    };
+    struct ResidentChunk {
+        std::unique_ptr<Chunk> chunk;
+        uint64_t lastWanted;        // prefetch round that last asked for it
+    };
+
+    unsigned int seed;
+    std::unordered_map<uint64_t, ResidentChunk> resident;
+    std::unordered_set<uint64_t> pending;   // handed to the thread, not collected yet
+    std::unordered_map<uint64_t, uint8_t> changes;      // survive eviction
+    uint64_t lastKey;           // one-entry cache in front of the map
+    const Chunk* lastChunk;
+    uint64_t round;
+    uint64_t builtOnTheSpot;
+
+    // Shared with the background thread
+    std::mutex queueMutex;
+    std::condition_variable wake;
+    std::deque<uint64_t> wanted;
+    std::vector<std::pair<uint64_t, std::unique_ptr<Chunk>>> finished;
+    bool stopping;
+    std::thread worker;
+
+    void work();
+    void build(uint64_t key, Chunk& chunk) const;
+    void collectFinished();
+    const Chunk* chunk(uint64_t key);
+
+public:
+    explicit ChunkedWorld(unsigned int seed);
+    ~ChunkedWorld();
+    ChunkedWorld(const ChunkedWorld&) = delete;
+    ChunkedWorld& operator=(const ChunkedWorld&) = delete;
+
+    uint8_t getCell(unsigned int x, unsigned int y) override;
+    void setCell(unsigned int x, unsigned int y, uint8_t cell) override;
+    bool isBoundary(unsigned int x, unsigned int y) const override;
+
+    // Queue the chunks around (x, y) for the background thread and drop the ones
+    // nobody has been near for a while
+    void prefetchAround(unsigned int x, unsigned int y) override;
+
+    // Coordinates are unsigned, so "endless" is 2^32 cells each way, starting in the middle
+    unsigned int getWidth() const override { return UINT32_MAX; }
+    unsigned int getHeight() const override { return UINT32_MAX; }
+    unsigned int getStartX() const override;
+    unsigned int getStartY() const override;
+    unsigned int getItemCount() const override { return 0; }
+    unsigned int getSeed() const override { return seed; }
+    std::string title() const override;
+    std::string cacheStatus() const override;
+
+    size_t residentChunks() const { return resident.size(); }
+    uint64_t chunksBuiltOnTheSpot() const { return builtOnTheSpot; }
+};
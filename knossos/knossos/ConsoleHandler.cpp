@@ -1,11 +1,17 @@
 #include <cctype>       // for tolower
 #include <iostream>     
+#include <algorithm>
 
 #ifdef _WIN32
 #include <conio.h>      // Windows: for _getch()
 #else
 #include <termios.h>    // Unix/Linux/Mac: for terminal control
 #include <unistd.h>     // Unix/Linux/Mac: for STDIN_FILENO
+#include <fcntl.h>
+#include <csignal>
+#include <cerrno>
+#include <cstdio>
+#include <sys/select.h>
 #endif
 
 #include "ConsoleHandler.h"
@@ -22,6 +28,9 @@ namespace ANSICodes {
     extern const char* ENTRANCE_STYLE = "\x1B[33m";
     extern const char* EXIT_STYLE = "\x1B[32m";
     extern const char* ITEM_STYLE = "\x1B[31m";
+    extern const char* STAIRS_STYLE = "\x1B[1;36m";
+    extern const char* REMEMBERED_STYLE = "\x1B[2;38;5;245m";
+    extern const char* REMEMBERED_WALL_STYLE = "\x1B[48;5;240m";
     extern const char* RESET = "\x1B[0m";
 }
 
@@ -38,12 +47,75 @@ pair<int, int> getConsoleSize() {
 #include <sys/ioctl.h>
 
 pair<int, int> getConsoleSize() {
-    struct winsize w;
-    ioctl(STDOUT_FILENO, TIOCGWINSZ, &w);
+    struct winsize w = {};
+
+    // Not a terminal (e.g. output piped to a file) - assume the classic size
+    if (ioctl(STDOUT_FILENO, TIOCGWINSZ, &w) != 0 || w.ws_row == 0) {
+        return make_pair(80, 24);
+    }
     return make_pair(w.ws_col, w.ws_row);
 }
 #endif
 
+#ifdef _WIN32
+void watchTerminalResizes() {}
+#else
+// The SIGWINCH handler writes a byte here, so a resize wakes up the select() a key is
+// waited for with - even one that arrives just before the select starts
+static int resizePipe[2] = { -1, -1 };
+
+static void onResize(int) {
+    int savedErrno = errno;
+    char byte = 0;
+    ssize_t written = write(resizePipe[1], &byte, 1);
+    (void)written;
+    errno = savedErrno;
+}
+
+void watchTerminalResizes() {
+    if (resizePipe[0] >= 0 || pipe(resizePipe) != 0) {
+        return;
+    }
+    for (int end : resizePipe) {
+        fcntl(end, F_SETFL, fcntl(end, F_GETFL) | O_NONBLOCK);
+        fcntl(end, F_SETFD, FD_CLOEXEC);
+    }
+
+    // Keys are read one at a time straight from the terminal, so select() never
+    // sleeps on keys stdio has already buffered
+    setvbuf(stdin, nullptr, _IONBF, 0);
+
+    struct sigaction action = {};
+    action.sa_handler = onResize;
+    sigemptyset(&action.sa_mask);
+    action.sa_flags = SA_RESTART;
+    sigaction(SIGWINCH, &action, nullptr);
+}
+
+// True if the terminal was resized (any number of times) before a key came in
+static bool waitForKeyOrResize() {
+    if (resizePipe[0] < 0) {
+        return false;
+    }
+    while (true) {
+        fd_set ready;
+        FD_ZERO(&ready);
+        FD_SET(STDIN_FILENO, &ready);
+        FD_SET(resizePipe[0], &ready);
+        if (select(std::max(STDIN_FILENO, resizePipe[0]) + 1, &ready, nullptr, nullptr, nullptr) < 0) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+        if (!FD_ISSET(resizePipe[0], &ready)) {
+            return false;
+        }
+        char drained[64];
+        while (read(resizePipe[0], drained, sizeof(drained)) > 0) {}
+        return true;
+    }
+}
+#endif
+
 char getValidKeyPress() {
     char key;
 
@@ -82,6 +154,11 @@ char getValidKeyPress() {
         // Apply new settings immediately
         tcsetattr(STDIN_FILENO, TCSANOW, &newTermios);
 
+        if (waitForKeyOrResize()) {
+            tcsetattr(STDIN_FILENO, TCSANOW, &oldTermios);
+            return RESIZE_EVENT;
+        }
+
         // Read single character
         key = getchar();
 
@@ -113,13 +190,60 @@ char getValidKeyPress() {
         key = tolower(key);
 
         // Only accept our valid game keys
-        if (key == 'w' || key == 'a' || key == 's' || key == 'd' || key == 'q' || key == 'e') {
+        if (isGameKey(key)) {
             return key;
         }
     }
 }
 
-void moveCursorToMatrixPosition(unsigned int x, unsigned int y, unsigned int height, pair<int, int> initial_console_size) {
+#ifdef _WIN32
+char pollKeyPress(unsigned int timeout_ms) {
+    for (unsigned int waited = 0; ; waited += 10) {
+        while (_kbhit()) {
+            char key = static_cast<char>(tolower(_getch()));
+            if (isGameKey(key)) {
+                return key;
+            }
+        }
+        if (waited >= timeout_ms) {
+            return 0;
+        }
+        Sleep(10);
+    }
+}
+#else
+char pollKeyPress(unsigned int timeout_ms) {
+    struct termios oldTermios, newTermios;
+    bool terminal = tcgetattr(STDIN_FILENO, &oldTermios) == 0;
+    if (terminal) {
+        newTermios = oldTermios;
+        newTermios.c_lflag &= ~(ICANON | ECHO);
+        tcsetattr(STDIN_FILENO, TCSANOW, &newTermios);
+    }
+
+    fd_set ready;
+    FD_ZERO(&ready);
+    FD_SET(STDIN_FILENO, &ready);
+    struct timeval timeout = { static_cast<time_t>(timeout_ms / 1000), static_cast<suseconds_t>(timeout_ms % 1000 * 1000) };
+
+    // Straight from the descriptor: stdio would swallow keys the game loop reads later
+    char key = 0;
+    if (select(STDIN_FILENO + 1, &ready, nullptr, nullptr, &timeout) > 0 && read(STDIN_FILENO, &key, 1) == 1) {
+        key = static_cast<char>(tolower(key));
+    }
+
+    if (terminal) {
+        tcsetattr(STDIN_FILENO, TCSANOW, &oldTermios);
+    }
+    return isGameKey(key) ? key : 0;
+}
+#endif
+
+bool isGameKey(char key) {
+    return key == 'w' || key == 'a' || key == 's' || key == 'd' || key == 'q' || key == 'e' || key == 'm';
+}
+
+void moveCursorToMatrixPosition(unsigned int x, unsigned int y, unsigned int height, pair<int, int> initial_console_size, std::ostream& out) {
     int console_width = initial_console_size.first;
     int console_height = initial_console_size.second;
 
@@ -128,24 +252,21 @@ void moveCursorToMatrixPosition(unsigned int x, unsigned int y, unsigned int hei
     unsigned int terminal_row = console_height - matrix_start_from_bottom + y;
     unsigned int terminal_col = x + 3;
 
-    cout << "\033[" << terminal_row << ";" << terminal_col << "H";
+    out << "\033[" << terminal_row << ";" << terminal_col << "H";
 }
 
+// Home, clear the screen and its scrollback - what clear and cls do, without a shell
 void clearScreen() {
-#ifdef _WIN32
-    system("cls");
-#else
-    system("clear");
-#endif
+    cout << "\033[H\033[2J\033[3J";
     cout.flush();
 }
 
-void hideCursor() {
-    cout << "\033[?25l";
-    cout.flush();
+void hideCursor(std::ostream& out) {
+    out << "\033[?25l";
+    out.flush();
 }
 
-void showCursor() {
-    cout << "\033[?25h";
-    cout.flush();
+void showCursor(std::ostream& out) {
+    out << "\033[?25h";
+    out.flush();
 }
\ No newline at end of file
@@ -1,5 +1,8 @@
 #pragma once
 
+#include <iostream>
+#include <utility>
+
 using std::pair;
 
 namespace ANSICodes {
@@ -9,15 +12,31 @@ namespace ANSICodes {
     extern const char* ENTRANCE_STYLE;
     extern const char* EXIT_STYLE;
     extern const char* ITEM_STYLE;
+    extern const char* STAIRS_STYLE;
+    extern const char* REMEMBERED_STYLE;
+    extern const char* REMEMBERED_WALL_STYLE;
     extern const char* RESET;
 }
 
+// What getValidKeyPress returns instead of a key once the terminal has changed size
+const char RESIZE_EVENT = '\0';
+
+// From now on a SIGWINCH ends the wait for a key with RESIZE_EVENT (not on Windows,
+// whose console has no such signal). Call it before the first key is read
+void watchTerminalResizes();
+
 char getValidKeyPress();
 
+// The game key (lowercase) pressed within the timeout, or 0 - for waits the player may cut short
+char pollKeyPress(unsigned int timeout_ms);
+
+// True for the keys the game reacts to (w, a, s, d, e, m, q) - expects lowercase
+bool isGameKey(char key);
+
 pair<int, int> getConsoleSize();
 
-void moveCursorToMatrixPosition(unsigned int x, unsigned int y, unsigned int height, pair<int, int> initial_console_size);
+void moveCursorToMatrixPosition(unsigned int x, unsigned int y, unsigned int height, pair<int, int> initial_console_size, std::ostream& out = std::cout);
 
 void clearScreen();
-void hideCursor();
-void showCursor();
+void hideCursor(std::ostream& out = std::cout);
+void showCursor(std::ostream& out = std::cout);
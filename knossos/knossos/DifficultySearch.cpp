@@ -0,0 +1,200 @@
+#include <iostream>
+#include <sstream>
+#include <vector>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <thread>
+#include <limits>
+#include <algorithm>
+#include <stdexcept>
+
+#include "DifficultySearch.h"
+
+using std::string;
+using std::vector;
+using std::cerr;
+
+namespace {
+
+const double UNBOUNDED = std::numeric_limits<double>::infinity();
+
+// Bands picked from the spread of generated mazes (see `knossos analyze`):
+// each preset matches somewhere between one maze in two and one in twelve
+bool applyPreset(const string& name, DifficultyTarget& target) {
+    if (name == "easy") {
+        target.pathLength.high = 1.5;
+        target.minotaurDistance.low = 0.95;
+    }
+    else if (name == "medium") {
+        target.pathLength.low = 1.45;
+        target.pathLength.high = 1.8;
+        target.minotaurDistance.low = 0.5;
+        target.minotaurDistance.high = 1.4;
+    }
+    else if (name == "hard") {
+        target.pathLength.low = 1.7;
+        target.minotaurDistance.high = 0.85;
+    }
+    else {
+        return false;
+    }
+    return true;
+}
+
+// "a-b", "a-" or "-b"
+bool parseBand(const string& text, DifficultyBand& band) {
+    size_t dash = text.find('-');
+    if (dash == string::npos) {
+        return false;
+    }
+
+    try {
+        string low = text.substr(0, dash);
+        string high = text.substr(dash + 1);
+        size_t used = 0;
+        if (!low.empty()) {
+            band.low = std::stod(low, &used);
+            if (used != low.size()) return false;
+        }
+        if (!high.empty()) {
+            band.high = std::stod(high, &used);
+            if (used != high.size()) return false;
+        }
+    }
+    catch (const std::exception&) {
+        return false;
+    }
+    return band.low >= 0 && band.low <= band.high;
+}
+
+}
+
+DifficultyBand::DifficultyBand() : low(0), high(UNBOUNDED) {}
+
+bool DifficultyBand::contains(double value) const {
+    return value >= low && value <= high;
+}
+
+double DifficultyBand::distance(double value) const {
+    if (value < low) return (low - value) / low;
+    if (value > high) return (value - high) / std::max(high, 1e-9);
+    return 0;
+}
+
+double DifficultyTarget::distance(const MazeMetrics& metrics) const {
+    // A maze without a way out (or a Minotaur with no way to the hero) never qualifies
+    if (metrics.solutionLength < 0 || metrics.minotaurDistance < 0) {
+        return UNBOUNDED;
+    }
+
+    double height = metrics.height;
+    return pathLength.distance(metrics.solutionLength / height) +
+        deadEnds.distance(metrics.deadEndRatio) +
+        minotaurDistance.distance(metrics.minotaurDistance / height);
+}
+
+bool DifficultySearch::parse(const string& spec, DifficultyTarget& target, string& error) {
+    target.name = spec;
+
+    std::istringstream parts(spec);
+    string part;
+    while (std::getline(parts, part, ',')) {
+        if (applyPreset(part, target)) {
+            continue;
+        }
+
+        size_t equals = part.find('=');
+        string key = part.substr(0, equals);
+        DifficultyBand* band = key == "path" ? &target.pathLength :
+            key == "deadends" ? &target.deadEnds :
+            key == "minotaur" ? &target.minotaurDistance : nullptr;
+
+        if (equals == string::npos || band == nullptr) {
+            error = "Unknown difficulty '" + part + "' (use easy, medium, hard or path=, deadends=, minotaur= ranges)";
+            return false;
+        }
+        if (!parseBand(part.substr(equals + 1), *band)) {
+            error = "Invalid range in '" + part + "' (expected e.g. 1.2-1.6, 1.2- or -1.6)";
+            return false;
+        }
+    }
+    return true;
+}
+
+GeneratedMaze DifficultySearch::find(unsigned int width, unsigned int height, unsigned int no_of_items,
+    const DifficultyTarget& target, SpawnBand minotaurBand) {
+    std::mutex mutex;
+    std::condition_variable progress;
+    std::atomic<bool> stop(false);
+    GeneratedMaze best;
+    double bestDistance = UNBOUNDED;
+    bool haveCandidate = false;
+
+    auto worker = [&]() {
+        while (!stop) {
+            // Same sequence as Gameplay::initializeGame: seed, generate, place the Minotaur
+            unsigned int seed = RNGEngine::generateSeed();
+            RNGEngine::seed(seed);
+
+            Matrix* matrix = new Matrix(width, height);
+            matrix->setCancellation(&stop);
+            matrix->generateMatrix(no_of_items);
+            matrix->setCancellation(nullptr);
+            if (stop) {
+                delete matrix;      // someone else already won; this one may be half built
+                break;
+            }
+
+            pair<unsigned int, unsigned int> minotaur = matrix->getRandomPassageForMinotaur(matrix->getEntranceX(), minotaurBand);
+            mersenne_twister rngState = RNGEngine::getState();
+            double distance = target.distance(MazeAnalyzer::analyze(*matrix, "", minotaur));
+
+            std::lock_guard<std::mutex> lock(mutex);
+            ++best.candidates;
+            if (!haveCandidate || distance < bestDistance) {
+                delete best.matrix;
+                best.matrix = matrix;
+                best.seed = seed;
+                best.minotaur = minotaur;
+                best.rngState = rngState;
+                bestDistance = distance;
+                haveCandidate = true;
+            }
+            else {
+                delete matrix;
+            }
+
+            if (distance == 0) {
+                best.matched = true;
+                stop = true;
+            }
+            progress.notify_one();
+        }
+    };
+
+    unsigned int threadCount = std::max(1u, std::thread::hardware_concurrency());
+    vector<std::thread> threads;
+    for (unsigned int i = 0; i < threadCount; ++i) {
+        threads.emplace_back(worker);
+    }
+
+    {
+        // Past the timeout, settle for the closest maze - but there has to be one
+        auto deadline = std::chrono::steady_clock::now() + target.timeout;
+        std::unique_lock<std::mutex> lock(mutex);
+        progress.wait_until(lock, deadline, [&]() { return best.matched; });
+        progress.wait(lock, [&]() { return haveCandidate; });
+        stop = true;
+    }
+
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+
+    if (!best.matched) {
+        cerr << "Warning: None of " << best.candidates << " mazes was '" << target.name
+            << "' enough in time - playing the closest one\n";
+    }
+    return best;
+}
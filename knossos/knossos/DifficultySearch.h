@@ -0,0 +1,67 @@
+#pragma once
+
+#include <string>
+#include <chrono>
+#include "Matrix.h"
+#include "MazeAnalyzer.h"
+#include "RNGEngine.h"
+
+// Inclusive range; an open end is 0 or infinity
+struct DifficultyBand {
+    double low;
+    double high;
+
+    DifficultyBand();
+    bool contains(double value) const;
+    // 0 inside the band, otherwise how far outside relative to the nearest bound
+    double distance(double value) const;
+};
+
+/**
+ * @brief What a maze has to look like. Lengths are measured in maze heights,
+ * since the shortest possible way from the top to the bottom row is one height.
+ */
+struct DifficultyTarget {
+    std::string name;
+    DifficultyBand pathLength;      // entrance to exit
+    DifficultyBand deadEnds;        // dead ends per open cell
+    DifficultyBand minotaurDistance;    // entrance to the Minotaur's spawn
+    std::chrono::milliseconds timeout;
+
+    DifficultyTarget() : timeout(5000) {}
+
+    // 0 for a maze inside every band, larger the further it misses
+    double distance(const MazeMetrics& metrics) const;
+};
+
+// A finished maze plus everything needed to start playing it on another thread
+struct GeneratedMaze {
+    Matrix* matrix;                 // owned by whoever takes it
+    unsigned int seed;
+    pair<unsigned int, unsigned int> minotaur;
+    mersenne_twister rngState;      // the gameplay stream right after the Minotaur was placed
+    bool matched;                   // false if this is only the closest candidate
+    unsigned int candidates;        // mazes generated in total
+
+    GeneratedMaze() : matrix(nullptr), seed(0), minotaur(0, 0), matched(false), candidates(0) {}
+};
+
+/**
+ * @brief Generate-and-filter on all cores: every worker builds mazes from fresh
+ * seeds and measures them (see MazeAnalyzer) until one falls inside the target,
+ * at which point the rest abandon the maze they're generating. If nothing matches
+ * before the timeout the closest candidate is used instead.
+ *
+ * The winning seed rebuilds the same maze, so saves and replays work as usual.
+ */
+class DifficultySearch {
+public:
+    /**
+     * @brief Parse easy, medium, hard or a list like "path=1.2-1.6,deadends=0.17-,minotaur=-0.8"
+     * @param error Set to a message when the spec is invalid
+     */
+    static bool parse(const std::string& spec, DifficultyTarget& target, std::string& error);
+
+    static GeneratedMaze find(unsigned int width, unsigned int height, unsigned int no_of_items,
+        const DifficultyTarget& target, SpawnBand minotaurBand);
+};
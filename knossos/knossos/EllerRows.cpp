@@ -0,0 +1,75 @@
+#include <algorithm>
+
+#include "EllerRows.h"
+
+EllerRows::EllerRows(unsigned int columns, mersenne_twister& rng)
+    : columns(columns), rng(rng), bits(0), bitsLeft(0),
+    setOf(columns), parent(columns), size(columns), pick(columns), seen(columns), firstDown(columns),
+    hasDown(columns), east(columns, 0), down(columns, 0) {
+    for (unsigned int c = 0; c < columns; ++c) setOf[c] = c;
+}
+
+bool EllerRows::coin() {
+    if (bitsLeft == 0) {
+        bits = static_cast<uint32_t>(rng());
+        bitsLeft = 32;
+    }
+    bool flip = bits & 1;
+    bits >>= 1;
+    --bitsLeft;
+    return flip;
+}
+
+uint32_t EllerRows::find(uint32_t set) {
+    while (parent[set] != set) {
+        parent[set] = parent[parent[set]];
+        set = parent[set];
+    }
+    return set;
+}
+
+void EllerRows::nextRow(bool lastRow) {
+    const uint32_t UNASSIGNED = UINT32_MAX;
+    for (unsigned int c = 0; c < columns; ++c) {
+        parent[c] = c;
+        size[c] = 0;
+        seen[c] = 0;
+        hasDown[c] = 0;
+        firstDown[c] = UNASSIGNED;
+        east[c] = 0;
+        down[c] = 0;
+    }
+
+    for (unsigned int c = 0; c + 1 < columns; ++c) {
+        uint32_t left = find(setOf[c]), right = find(setOf[c + 1]);
+        if (left != right && (lastRow || coin())) {
+            east[c] = 1;
+            parent[right] = left;
+        }
+    }
+    if (lastRow) return;
+
+    // Sets are final for this row now; look each room's up once. The coin flips
+    // are random, so these loops stay free of branches on them where they can
+    for (unsigned int c = 0; c < columns; ++c) {
+        uint32_t root = find(setOf[c]);
+        setOf[c] = root;
+        ++size[root];
+        down[c] = coin();
+        hasDown[root] |= down[c];
+    }
+    for (unsigned int c = 0; c < columns; ++c) {
+        uint32_t root = setOf[c];
+        if (!hasDown[root]) {
+            if (seen[root] == 0) pick[root] = std::uniform_int_distribution<uint32_t>(0, size[root] - 1)(rng);
+            down[c] = seen[root]++ == pick[root];
+        }
+        firstDown[root] = std::min(firstDown[root], down[c] ? c : UNASSIGNED);
+    }
+
+    // Rooms that went down stay in their set, now named after its first room that
+    // went down; every other room starts a set of its own, named after its column
+    for (unsigned int c = 0; c < columns; ++c) {
+        setOf[c] = down[c] ? firstDown[setOf[c]] : c;
+    }
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include "RNGEngine.h"
+
+/**
+ * @brief Eller's algorithm, one row of rooms at a time. Every room carries the set
+ * (connected piece) it belongs to; sets are merged sideways at random, then every
+ * set sends at least one room down into the next row. The last row merges whatever
+ * is left, so all rows together form a perfect maze. Memory is a few words per
+ * column, however many rows there are.
+ */
+class EllerRows {
+private:
+    unsigned int columns;
+    mersenne_twister& rng;
+    uint32_t bits;              // 32 coin flips per draw - one or two are needed for every room
+    int bitsLeft;
+    std::vector<uint32_t> setOf, parent, size, pick, seen, firstDown;
+    std::vector<uint8_t> hasDown;
+
+    bool coin();
+    uint32_t find(uint32_t set);
+
+public:
+    std::vector<uint8_t> east;      // after nextRow: room c is open to room c + 1
+    std::vector<uint8_t> down;      // after nextRow: room c is open to the row below
+
+    EllerRows(unsigned int columns, mersenne_twister& rng);
+
+    void nextRow(bool lastRow);
+};
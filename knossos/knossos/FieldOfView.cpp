@@ -0,0 +1,134 @@
+#include "FieldOfView.h"
+
+using std::vector;
+using std::make_pair;
+
+bool FieldOfView::Window::contains(int x, int y) const {
+    int dx = x - origin_x + radius;
+    int dy = y - origin_y + radius;
+    int side = 2 * radius + 1;
+    if (radius < 0 || dx < 0 || dy < 0 || dx >= side || dy >= side) {
+        return false;
+    }
+    return lit[dx * side + dy] != 0;
+}
+
+void FieldOfView::Window::light(int x, int y) {
+    int side = 2 * radius + 1;
+    lit[(x - origin_x + radius) * side + (y - origin_y + radius)] = 1;
+}
+
+FieldOfView::FieldOfView(unsigned int width, unsigned int height)
+    : width(width), height(height),
+    explored(width, height) {}
+
+bool FieldOfView::isOpaque(const Matrix& matrix, int x, int y) const {
+    if (x < 0 || y < 0 || x >= static_cast<int>(width) || y >= static_cast<int>(height)) {
+        return true;
+    }
+    return matrix.getFieldType(x, y) == FieldType::WALL;
+}
+
+// One octant of the classic recursive shadowcast: rows move away from the viewer,
+// [start, end] is the slope range still unblocked, and (xx, xy, yx, yy) maps the
+// octant's (column, row) onto the maze
+void FieldOfView::castLight(const Matrix& matrix, int row, double start, double end,
+    int xx, int xy, int yx, int yy) {
+    if (start < end) {
+        return;
+    }
+
+    int radius = current.radius;
+    int radiusSquared = radius * radius + radius;      // the extra r rounds off the circle
+    double nextStart = start;
+
+    for (int distance = row; distance <= radius; ++distance) {
+        bool blocked = false;
+        int dy = -distance;
+
+        for (int dx = -distance; dx <= 0; ++dx) {
+            double leftSlope = (dx - 0.5) / (dy + 0.5);
+            double rightSlope = (dx + 0.5) / (dy - 0.5);
+            if (start < rightSlope) continue;
+            if (end > leftSlope) break;
+
+            int x = current.origin_x + dx * xx + dy * xy;
+            int y = current.origin_y + dx * yx + dy * yy;
+            bool opaque = isOpaque(matrix, x, y);
+
+            if (dx * dx + dy * dy <= radiusSquared && x >= 0 && y >= 0 &&
+                x < static_cast<int>(width) && y < static_cast<int>(height)) {
+                current.light(x, y);
+            }
+
+            if (blocked) {
+                if (opaque) {
+                    nextStart = rightSlope;
+                    continue;
+                }
+                blocked = false;
+                start = nextStart;
+            }
+            else if (opaque && distance < radius) {
+                blocked = true;
+                castLight(matrix, distance + 1, start, leftSlope, xx, xy, yx, yy);
+                nextStart = rightSlope;
+            }
+        }
+
+        if (blocked) break;
+    }
+}
+
+void FieldOfView::update(const Matrix& matrix, unsigned int x, unsigned int y, unsigned int radius,
+    vector<pair<unsigned int, unsigned int>>& entered,
+    vector<pair<unsigned int, unsigned int>>& left) {
+    entered.clear();
+    left.clear();
+
+    std::swap(previous, current);
+    current.origin_x = static_cast<int>(x);
+    current.origin_y = static_cast<int>(y);
+    current.radius = static_cast<int>(radius);
+    size_t side = 2 * radius + 1;
+    current.lit.assign(side * side, 0);
+
+    current.light(current.origin_x, current.origin_y);
+    static const int octants[8][4] = {
+        { 1, 0, 0, 1 }, { 0, 1, 1, 0 }, { 0, -1, 1, 0 }, { -1, 0, 0, 1 },
+        { -1, 0, 0, -1 }, { 0, -1, -1, 0 }, { 0, 1, -1, 0 }, { 1, 0, 0, -1 }
+    };
+    for (const int* octant : octants) {
+        castLight(matrix, 1, 1.0, 0.0, octant[0], octant[1], octant[2], octant[3]);
+    }
+
+    // Only the two windows are compared, never the whole maze
+    int r = current.radius;
+    for (int cx = current.origin_x - r; cx <= current.origin_x + r; ++cx) {
+        for (int cy = current.origin_y - r; cy <= current.origin_y + r; ++cy) {
+            if (!current.contains(cx, cy)) continue;
+
+            explored.set(cx, cy);
+            if (!previous.contains(cx, cy)) {
+                entered.push_back(make_pair(cx, cy));
+            }
+        }
+    }
+
+    r = previous.radius;
+    for (int px = previous.origin_x - r; px <= previous.origin_x + r; ++px) {
+        for (int py = previous.origin_y - r; py <= previous.origin_y + r; ++py) {
+            if (previous.contains(px, py) && !current.contains(px, py)) {
+                left.push_back(make_pair(px, py));
+            }
+        }
+    }
+}
+
+bool FieldOfView::isVisible(unsigned int x, unsigned int y) const {
+    return current.contains(static_cast<int>(x), static_cast<int>(y));
+}
+
+bool FieldOfView::isExplored(unsigned int x, unsigned int y) const {
+    return explored.test(x, y);
+}
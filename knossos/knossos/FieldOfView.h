@@ -0,0 +1,57 @@
+#pragma once
+
+#include <vector>
+#include <utility>
+#include <cstdint>
+#include "Matrix.h"
+#include "Bitboard.h"
+
+using std::pair;
+
+/**
+ * @brief Line of sight from one cell via recursive shadowcasting: walls block the
+ * view, and everything within the radius that isn't behind one is visible.
+ *
+ * Only a (2r+1)^2 window around the viewer is kept per turn, so an update costs
+ * O(r^2) whatever the size of the maze. Cells seen at least once stay in a
+ * one-bit-per-cell explored set so they can be drawn as remembered.
+ */
+class FieldOfView {
+private:
+    struct Window {
+        int origin_x;
+        int origin_y;
+        int radius;
+        std::vector<uint8_t> lit;      // (2r+1)^2, column-major like the maze
+
+        Window() : origin_x(0), origin_y(0), radius(-1) {}
+        bool contains(int x, int y) const;
+        void light(int x, int y);
+    };
+
+    unsigned int width;
+    unsigned int height;
+    Bitboard explored;
+    Window current;
+    Window previous;
+
+    bool isOpaque(const Matrix& matrix, int x, int y) const;
+    void castLight(const Matrix& matrix, int row, double start, double end,
+        int xx, int xy, int yx, int yy);
+
+public:
+    FieldOfView(unsigned int width, unsigned int height);
+
+    /**
+     * @brief Recompute what can be seen from (x, y)
+     * @param entered Filled with the cells that just came into view
+     * @param left Filled with the cells that just went out of view
+     */
+    void update(const Matrix& matrix, unsigned int x, unsigned int y, unsigned int radius,
+        std::vector<pair<unsigned int, unsigned int>>& entered,
+        std::vector<pair<unsigned int, unsigned int>>& left);
+
+    bool isVisible(unsigned int x, unsigned int y) const;
+    bool isExplored(unsigned int x, unsigned int y) const;
+    const Bitboard& getExplored() const { return explored; }
+};
@@ -1,17 +1,25 @@
 #include "FileHandler.h"
 #include "Matrix.h"
 #include "MatrixField.h"
-#include <fstream>
+#include "AsyncFileWriter.h"
+#include "BinaryIO.h"
+#include "ResultsStore.h"
+#include "MemoryStats.h"
 #include <iostream>
+#include <fstream>
 #include <sstream>
 #include <iomanip>
 #include <ctime>
+#include <cstdint>
+#include <algorithm>
 
-using std::ofstream;
+using std::ostringstream;
+using std::ifstream;
+using std::ios;
 using std::string;
+using std::vector;
 using std::to_string;
 using std::cerr;
-using std::endl;
 using std::chrono::microseconds;
 using std::chrono::milliseconds;
 using std::chrono::duration_cast;
@@ -23,7 +31,7 @@ string FileHandler::generateTimestamp() const {
 #ifdef _WIN32
     localtime_s(&timeinfo, &now);
 #else
-    timeinfo = *std::localtime(&now);
+    localtime_r(&now, &timeinfo);
 #endif
 
     std::ostringstream oss;
@@ -50,6 +58,16 @@ string FileHandler::generateFilename() const {
     return "labyrinth_game_" + generateTimestamp() + ".txt";
 }
 
+string FileHandler::generateSaveFilename() const {
+    return "labyrinth_save_" + generateTimestamp() + ".ksav";
+}
+
+// Binary saves are little-endian regardless of the host
+static const char SAVE_MAGIC[4] = { 'K', 'N', 'S', 'V' };
+static const uint16_t SAVE_FORMAT_VERSION = 1;
+static const size_t SAVE_HEADER_SIZE = 4 + 2 + 2 + 13 * 4 + 8 + 4;
+static const size_t SAVE_CHANGE_SIZE = 4 + 4 + 1;
+
 bool FileHandler::saveGameResult(const Matrix* matrix,
     unsigned int robot_x, unsigned int robot_y,
     unsigned int minotaur_x, unsigned int minotaur_y,
@@ -57,72 +75,75 @@ bool FileHandler::saveGameResult(const Matrix* matrix,
     const microseconds& game_duration,
     unsigned int moves_made) const {
 
+    MemoryScope scope(MemorySubsystem::FILES);
     if (!matrix) {
-        cerr << "Error: Matrix pointer is null!" << endl;
+        cerr << "Error: Matrix pointer is null!\n";
         return false;
     }
 
-    string filename = generateFilename();
-    ofstream file(filename);
-
-    if (!file.is_open()) {
-        cerr << "Error: Could not create file " << filename << endl;
-        return false;
-    }
+    // Everything is built in memory; the writer thread does the actual I/O
+    ostringstream header;
 
     // Write header with game information
-    file << "=====================================" << endl;
-    file << "   LABYRINTH OF KNOSSOS - GAME RESULT" << endl;
-    file << "=====================================" << endl;
-    file << "Game completed at: " << generateTimestamp() << endl;
-    file << "Final result: " << gameResultToString(result) << endl;
-    file << "Game duration: " << duration_cast<milliseconds>(game_duration).count()
-        << " ms (" << game_duration.count() << " microseconds)" << endl;
-    file << "Total moves made: " << moves_made << endl;
-    file << "=====================================" << endl << endl;
+    header << "=====================================\n";
+    header << "   LABYRINTH OF KNOSSOS - GAME RESULT\n";
+    header << "=====================================\n";
+    header << "Game completed at: " << generateTimestamp() << "\n";
+    header << "Final result: " << gameResultToString(result) << "\n";
+    header << "Game duration: " << duration_cast<milliseconds>(game_duration).count()
+        << " ms (" << game_duration.count() << " microseconds)\n";
+    header << "Total moves made: " << moves_made << "\n";
+    header << "=====================================\n\n";
 
     // Write final positions
-    file << "FINAL POSITIONS:" << endl;
-    file << "Robot (R): (" << robot_x << ", " << robot_y << ")" << endl;
+    header << "FINAL POSITIONS:\n";
+    header << "Robot (R): (" << robot_x << ", " << robot_y << ")\n";
 
     if (minotaur_x == static_cast<unsigned int>(-1) && minotaur_y == static_cast<unsigned int>(-1)) {
-        file << "Minotaur (M): SLAIN" << endl;
+        header << "Minotaur (M): SLAIN\n";
     }
     else {
-        file << "Minotaur (M): (" << minotaur_x << ", " << minotaur_y << ")" << endl;
+        header << "Minotaur (M): (" << minotaur_x << ", " << minotaur_y << ")\n";
     }
-    file << endl;
+    header << "\n";
 
     // Write legend
-    file << "LEGEND:" << endl;
-    file << "R = Robot (Theseus)" << endl;
-    file << "M = Minotaur" << endl;
-    file << "U = Entrance" << endl;
-    file << "E = Exit" << endl;
-    file << "I = Exit (alternate symbol)" << endl;
-    file << "P = Item (Sword/Shield/Hammer/Fog of War)" << endl;
-    file << "# = Wall" << endl;
-    file << "  = Passage" << endl;
-    file << endl;
+    header << "LEGEND:\n";
+    header << "R = Robot (Theseus)\n";
+    header << "M = Minotaur\n";
+    header << "U = Entrance\n";
+    header << "E = Exit\n";
+    header << "I = Exit (alternate symbol)\n";
+    header << "P = Item (Sword/Shield/Hammer/Fog of War)\n";
+    header << "# = Wall\n";
+    header << "  = Passage\n";
+    header << "\n";
 
     // Write final matrix state
-    file << "FINAL MATRIX STATE:" << endl;
-    file << endl;
+    header << "FINAL MATRIX STATE:\n";
+    header << "\n";
 
-    // Get matrix dimensions (assuming these methods exist or can be added)
     unsigned int width = matrix->getWidth();
     unsigned int height = matrix->getHeight();
 
+    string contents = header.str();
+    // row label (at most 10 digits) + space + row + newline, plus column header and footer
+    contents.reserve(contents.size() + static_cast<size_t>(height) * (width + 12) + width + 256);
+
     // Add column numbers header
-    file << "   ";
+    contents += "   ";
     for (unsigned int j = 0; j < width; ++j) {
-        file << (j % 10);
+        contents += static_cast<char>('0' + j % 10);
     }
-    file << endl;
+    contents += '\n';
 
     // Print matrix with row numbers
     for (unsigned int i = 0; i < height; ++i) {
-        file << std::setw(2) << i << " ";
+        if (i < 10) {
+            contents += ' ';
+        }
+        contents += to_string(i);
+        contents += ' ';
 
         for (unsigned int j = 0; j < width; ++j) {
             char symbol;
@@ -143,64 +164,213 @@ bool FileHandler::saveGameResult(const Matrix* matrix,
                 symbol = field ? field->getSymbol() : '#';
             }
 
-            file << symbol;
+            contents += symbol;
         }
-        file << endl;
+        contents += '\n';
     }
 
-    file << endl;
-    file << "=====================================" << endl;
-    file << "Game saved successfully!" << endl;
-    file << "=====================================" << endl;
+    contents += "\n";
+    contents += "=====================================\n";
+    contents += "Game saved successfully!\n";
+    contents += "=====================================\n";
 
-    file.close();
+    // Games finishing in the same second get numbered files instead of overwriting each other
+    AsyncFileWriter::getInstance().submit(generateFilename(), std::move(contents), false);
 
     return true;
 }
 
+void FileHandler::appendResultRecord(unsigned int width, unsigned int height, unsigned int no_of_items,
+    GameResult result, const microseconds& game_duration,
+    unsigned int moves_made, unsigned int seed) const {
+
+    MemoryScope scope(MemorySubsystem::FILES);
+    ResultRecord record;
+    record.timestamp = static_cast<uint64_t>(duration_cast<microseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count());
+    record.width = width;
+    record.height = height;
+    record.no_of_items = no_of_items;
+    record.result = result;
+    record.duration = static_cast<uint64_t>(game_duration.count());
+    record.moves = moves_made;
+    record.seed = seed;
+
+    // Process-wide, and all zero unless built with KNOSSOS_MEMORY_STATS
+    MemorySnapshot memory = MemoryStats::snapshot();
+    record.peak_heap_kb = static_cast<uint32_t>(memory.peakHeapBytes / 1024);
+    record.peak_resident_kb = static_cast<uint32_t>(memory.peakResidentBytes / 1024);
+    record.allocations = static_cast<uint32_t>(std::min<uint64_t>(memory.allocations(), UINT32_MAX));
+    record.turn_allocations = static_cast<uint32_t>(std::min<uint64_t>(memory.of(MemorySubsystem::TURN).allocations, UINT32_MAX));
+
+    AsyncFileWriter::getInstance().submitTask([record]() {
+        ResultsStore::append(ResultsStore::DEFAULT_FILENAME, record);
+    });
+}
+
 bool FileHandler::saveMatrixState(const Matrix* matrix,
     unsigned int robot_x, unsigned int robot_y,
     unsigned int minotaur_x, unsigned int minotaur_y,
     const string& filename) const {
 
+    MemoryScope scope(MemorySubsystem::FILES);
     if (!matrix) {
-        cerr << "Error: Matrix pointer is null!" << endl;
+        cerr << "Error: Matrix pointer is null!\n";
         return false;
     }
 
-    ofstream file(filename);
-
-    if (!file.is_open()) {
-        cerr << "Error: Could not create file " << filename << endl;
-        return false;
-    }
+    ostringstream header;
 
-    file << "MATRIX STATE SNAPSHOT" << endl;
-    file << "=====================" << endl;
-    file << "Timestamp: " << generateTimestamp() << endl;
-    file << "Robot position: (" << robot_x << ", " << robot_y << ")" << endl;
-    file << "Minotaur position: (" << minotaur_x << ", " << minotaur_y << ")" << endl;
-    file << endl;
+    header << "MATRIX STATE SNAPSHOT\n";
+    header << "=====================\n";
+    header << "Timestamp: " << generateTimestamp() << "\n";
+    header << "Robot position: (" << robot_x << ", " << robot_y << ")\n";
+    header << "Minotaur position: (" << minotaur_x << ", " << minotaur_y << ")\n";
+    header << "\n";
 
     unsigned int width = matrix->getWidth();
     unsigned int height = matrix->getHeight();
 
+    string contents = header.str();
+    contents.reserve(contents.size() + static_cast<size_t>(height) * (width + 1));
+
     for (unsigned int i = 0; i < height; ++i) {
         for (unsigned int j = 0; j < width; ++j) {
             if (robot_x == j && robot_y == i) {
-                file << 'R';
+                contents += 'R';
             }
             else if (minotaur_x == j && minotaur_y == i) {
-                file << 'M';
+                contents += 'M';
             }
             else {
                 MatrixField* field = matrix->getField(j, i);
-                file << (field ? field->getSymbol() : '#');
+                contents += (field ? field->getSymbol() : '#');
             }
         }
-        file << endl;
+        contents += '\n';
+    }
+
+    if (!AsyncFileWriter::writeFileAtomically(filename, contents)) {
+        cerr << "Error: Could not create file " << filename << "\n";
+        return false;
+    }
+    return true;
+}
+
+bool FileHandler::saveGame(const SavedGame& saved, string& filename) const {
+    MemoryScope scope(MemorySubsystem::FILES);
+    string contents;
+    contents.reserve(SAVE_HEADER_SIZE + saved.field_changes.size() * SAVE_CHANGE_SIZE);
+
+    contents.append(SAVE_MAGIC, sizeof(SAVE_MAGIC));
+    appendU16(contents, SAVE_FORMAT_VERSION);
+    appendU16(contents, static_cast<uint16_t>(Matrix::GENERATOR_VERSION));
+    appendU32(contents, saved.seed);
+    appendU32(contents, saved.width);
+    appendU32(contents, saved.height);
+    appendU32(contents, saved.no_of_items);
+    appendU32(contents, saved.robot_x);
+    appendU32(contents, saved.robot_y);
+    appendU32(contents, saved.minotaur_x);
+    appendU32(contents, saved.minotaur_y);
+    appendU32(contents, saved.sword_rounds_left);
+    appendU32(contents, saved.shield_rounds_left);
+    appendU32(contents, saved.hammer_rounds_left);
+    appendU32(contents, saved.fog_of_war_rounds_left);
+    appendU32(contents, saved.moves_made);
+    appendU64(contents, static_cast<uint64_t>(saved.game_duration.count()));
+    appendU32(contents, static_cast<uint32_t>(saved.field_changes.size()));
+
+    for (const FieldChange& change : saved.field_changes) {
+        appendU32(contents, change.x);
+        appendU32(contents, change.y);
+        contents += static_cast<char>(change.fieldType);
+    }
+
+    filename = generateSaveFilename();
+    AsyncFileWriter::getInstance().submit(filename, std::move(contents));
+
+    return true;
+}
+
+bool FileHandler::loadGame(const string& filename, SavedGame& saved) const {
+    MemoryScope scope(MemorySubsystem::FILES);
+    ifstream file(filename, ios::binary);
+
+    if (!file.is_open()) {
+        cerr << "Error: Could not open save file " << filename << "\n";
+        return false;
+    }
+
+    string contents((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+
+    if (contents.size() < SAVE_HEADER_SIZE || contents.compare(0, sizeof(SAVE_MAGIC), SAVE_MAGIC, sizeof(SAVE_MAGIC)) != 0) {
+        cerr << "Error: " << filename << " is not a labyrinth save file\n";
+        return false;
+    }
+
+    size_t offset = sizeof(SAVE_MAGIC);
+    uint16_t formatVersion = readU16(contents, offset);
+    uint16_t generatorVersion = readU16(contents, offset);
+
+    if (formatVersion != SAVE_FORMAT_VERSION) {
+        cerr << "Error: Unsupported save format version " << formatVersion << "\n";
+        return false;
+    }
+    if (generatorVersion != Matrix::GENERATOR_VERSION) {
+        cerr << "Error: Save was made by a different maze generator (version " << generatorVersion
+            << ", this build has " << Matrix::GENERATOR_VERSION << ")\n";
+        return false;
+    }
+
+    saved.seed = readU32(contents, offset);
+    saved.width = readU32(contents, offset);
+    saved.height = readU32(contents, offset);
+    saved.no_of_items = readU32(contents, offset);
+    saved.robot_x = readU32(contents, offset);
+    saved.robot_y = readU32(contents, offset);
+    saved.minotaur_x = readU32(contents, offset);
+    saved.minotaur_y = readU32(contents, offset);
+    saved.sword_rounds_left = readU32(contents, offset);
+    saved.shield_rounds_left = readU32(contents, offset);
+    saved.hammer_rounds_left = readU32(contents, offset);
+    saved.fog_of_war_rounds_left = readU32(contents, offset);
+    saved.moves_made = readU32(contents, offset);
+    saved.game_duration = microseconds(static_cast<long long>(readU64(contents, offset)));
+    uint32_t changeCount = readU32(contents, offset);
+
+    bool minotaurSlain = saved.minotaur_x == static_cast<unsigned int>(-1) && saved.minotaur_y == static_cast<unsigned int>(-1);
+
+    if (saved.width <= 15 || saved.height <= 15 ||
+        saved.robot_x >= saved.width || saved.robot_y >= saved.height ||
+        (!minotaurSlain && (saved.minotaur_x >= saved.width || saved.minotaur_y >= saved.height)) ||
+        saved.sword_rounds_left > 4 || saved.shield_rounds_left > 4 ||
+        saved.hammer_rounds_left > 4 || saved.fog_of_war_rounds_left > 4) {
+        cerr << "Error: Save file " << filename << " is corrupted\n";
+        return false;
+    }
+
+    if (contents.size() - offset != static_cast<size_t>(changeCount) * SAVE_CHANGE_SIZE) {
+        cerr << "Error: Save file " << filename << " is truncated\n";
+        return false;
+    }
+
+    saved.field_changes.clear();
+    saved.field_changes.reserve(changeCount);
+
+    for (uint32_t i = 0; i < changeCount; ++i) {
+        FieldChange change;
+        change.x = readU32(contents, offset);
+        change.y = readU32(contents, offset);
+        unsigned char type = static_cast<unsigned char>(contents[offset++]);
+
+        if (change.x >= saved.width || change.y >= saved.height || type > static_cast<unsigned char>(FieldType::ITEM)) {
+            cerr << "Error: Save file " << filename << " is corrupted\n";
+            return false;
+        }
+        change.fieldType = static_cast<FieldType>(type);
+        saved.field_changes.push_back(change);
     }
 
-    file.close();
     return true;
 }
\ No newline at end of file
@@ -2,6 +2,8 @@
 
 #include <string>
 #include <chrono>
+#include <vector>
+#include "MatrixField.h"
 
 // Forward declaration
 class Matrix;
@@ -13,17 +15,39 @@ enum class GameResult {
     FORFEITED              // Player quit with 'Q'
 };
 
+// Everything needed to rebuild a game: the maze is regenerated from the seed,
+// then the recorded changes are replayed on top of it
+struct SavedGame {
+    unsigned int seed;
+    unsigned int width;
+    unsigned int height;
+    unsigned int no_of_items;
+    unsigned int robot_x;
+    unsigned int robot_y;
+    unsigned int minotaur_x;
+    unsigned int minotaur_y;
+    unsigned int sword_rounds_left;
+    unsigned int shield_rounds_left;
+    unsigned int hammer_rounds_left;
+    unsigned int fog_of_war_rounds_left;
+    unsigned int moves_made;
+    std::chrono::microseconds game_duration;
+    std::vector<FieldChange> field_changes;
+};
+
 class FileHandler {
 private:
     std::string generateTimestamp() const;
     std::string gameResultToString(GameResult result) const;
     std::string generateFilename() const;
+    std::string generateSaveFilename() const;
 
 public:
     FileHandler() = default;
     ~FileHandler() = default;
 
-    // Main method to save game state and result
+    // Main method to save game state and result; the file itself is written
+    // on the background writer thread, so this returns as soon as it's queued
     bool saveGameResult(const Matrix* matrix,
         unsigned int robot_x, unsigned int robot_y,
         unsigned int minotaur_x, unsigned int minotaur_y,
@@ -36,4 +60,15 @@ public:
         unsigned int robot_x, unsigned int robot_y,
         unsigned int minotaur_x, unsigned int minotaur_y,
         const std::string& filename) const;
+
+    // Queues one fixed-size record for the shared results log (see ResultsStore)
+    void appendResultRecord(unsigned int width, unsigned int height, unsigned int no_of_items,
+        GameResult result, const std::chrono::microseconds& game_duration,
+        unsigned int moves_made, unsigned int seed) const;
+
+    // Compact binary save (seed + changes since generation), written in the background
+    bool saveGame(const SavedGame& saved, std::string& filename) const;
+
+    // Reads a save written by saveGame; reports problems on cerr
+    bool loadGame(const std::string& filename, SavedGame& saved) const;
 };
@@ -0,0 +1,25 @@
+#include "FixedMatrix.h"
+
+namespace {
+
+const Passage passage;
+const Wall wall;
+const Entrance entrance;
+const Exit exitField;
+const Sword sword;
+const Shield shield;
+const Hammer hammer;
+const FogOfWar fogOfWar;
+const StairsUp stairsUp;
+const StairsDown stairsDown;
+
+// Indexed by TiledCell code
+const MatrixField* const FIELDS[] = {
+    &passage, &wall, &entrance, &exitField, &sword, &shield, &hammer, &fogOfWar, &stairsUp, &stairsDown
+};
+
+}
+
+const MatrixField* FixedCells::field(uint8_t cell) {
+    return cell < sizeof(FIELDS) / sizeof(FIELDS[0]) ? FIELDS[cell] : &wall;
+}
@@ -0,0 +1,427 @@
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <stdexcept>
+#include <algorithm>
+#include <utility>
+#include "Matrix.h"
+#include "MarathonMaze.h"
+#include "RNGEngine.h"
+
+// Shared, immutable field objects for FixedMatrix::getField - one per TiledCell code
+namespace FixedCells {
+    const MatrixField* field(uint8_t cell);
+}
+
+/**
+ * @brief A Matrix whose size is fixed at compile time, for the few small sizes most
+ * games are played at (see MatrixTiers). The cells are TiledCell codes in one
+ * std::array, column-major like Matrix, so the maze lives wherever the object does -
+ * on the stack, usually - and the scratch space generation needs is fixed-size
+ * locals. Neighbours are constant offsets and bounds checks constant comparisons;
+ * nothing touches the heap.
+ *
+ * generateMatrix and getRandomPassageForMinotaur draw the same random numbers as
+ * Matrix, in the same order, so a seed gives the same maze and the same Minotaur
+ * start either way.
+ */
+template <unsigned int W, unsigned int H>
+class FixedMatrix {
+    static_assert(W > 3 && H > 3, "a maze needs room inside its outer wall");
+    static_assert(W * H < 0xFFFF, "cell indices are 16-bit");
+
+public:
+    static const unsigned int CELLS = W * H;
+
+private:
+    using Cell = uint16_t;          // column-major index, x * H + y
+    static const Cell NO_CELL = 0xFFFF;
+
+    std::array<uint8_t, CELLS> cells;
+
+    static constexpr Cell at(unsigned int x, unsigned int y) { return static_cast<Cell>(x * H + y); }
+
+    // Up, down, left, right - the order Matrix tries them in while connecting
+    static constexpr int step(unsigned int direction) {
+        return direction == 0 ? -1 : direction == 1 ? 1 : direction == 2 ? -static_cast<int>(H) : static_cast<int>(H);
+    }
+
+    std::pair<unsigned int, unsigned int> setEntranceAndExit();
+    void generativePrim(unsigned int entrance_x);
+    void breakUpBottomRow();
+    void placeItems(unsigned int no_of_items, unsigned int robot_x, unsigned int robot_y);
+    void connectComponents(unsigned int robot_x, unsigned int robot_y);
+
+public:
+    FixedMatrix() { cells.fill(TiledCell::WALL); }
+
+    // Wrapping below zero makes one unsigned comparison per axis cover outside too
+    static constexpr bool isBoundaryOrOutside(unsigned int x, unsigned int y) {
+        return x - 1 >= W - 2 || y - 1 >= H - 2;
+    }
+
+    static constexpr unsigned int getWidth() { return W; }
+    static constexpr unsigned int getHeight() { return H; }
+
+    uint8_t getCell(unsigned int x, unsigned int y) const { return x < W && y < H ? cells[at(x, y)] : TiledCell::WALL; }
+    // Every cell, column-major (x * H + y), e.g. for MazeRecord::append
+    const uint8_t* getCells() const { return cells.data(); }
+    FieldType getFieldType(unsigned int x, unsigned int y) const { return TiledCell::fieldType(getCell(x, y)); }
+    const MatrixField* getField(unsigned int x, unsigned int y) const { return x < W && y < H ? FixedCells::field(cells[at(x, y)]) : nullptr; }
+    unsigned int getEntranceX() const;
+
+    std::chrono::microseconds generateMatrix(unsigned int no_of_items, bool connectExit = true);
+    std::pair<unsigned int, unsigned int> getRandomPassageForMinotaur(unsigned int robot_x, SpawnBand band = SpawnBand()) const;
+
+    // The same maze as a heap Matrix, for what plays on one (Gameplay)
+    Matrix* toMatrix() const;
+};
+
+template <unsigned int W, unsigned int H>
+Matrix* FixedMatrix<W, H>::toMatrix() const {
+    Matrix* matrix = new Matrix(W, H, false);
+    for (unsigned int x = 0; x < W; ++x) {
+        for (unsigned int y = 0; y < H; ++y) {
+            uint8_t cell = cells[at(x, y)];
+            if (TiledCell::fieldType(cell) == FieldType::ITEM) {
+                matrix->initializeItem(x, y, TiledCell::itemType(cell));
+            }
+            else {
+                matrix->initializeField(x, y, TiledCell::fieldType(cell));
+            }
+        }
+    }
+    return matrix;
+}
+
+template <unsigned int W, unsigned int H>
+unsigned int FixedMatrix<W, H>::getEntranceX() const {
+    for (unsigned int x = 0; x < W; ++x) {
+        if (cells[at(x, 0)] == TiledCell::ENTRANCE) return x;
+    }
+    return 0;
+}
+
+template <unsigned int W, unsigned int H>
+std::pair<unsigned int, unsigned int> FixedMatrix<W, H>::setEntranceAndExit() {
+    unsigned int entrance_x = RNGEngine::getRandomNumber(1, W - 2);
+    unsigned int exit_x = RNGEngine::getRandomNumber(1, W - 2);
+    cells[at(entrance_x, 0)] = TiledCell::ENTRANCE;
+    cells[at(exit_x, H - 1)] = TiledCell::EXIT;
+    return std::make_pair(entrance_x, exit_x);
+}
+
+template <unsigned int W, unsigned int H>
+void FixedMatrix<W, H>::generativePrim(unsigned int entrance_x) {
+    cells[at(entrance_x, 1)] = TiledCell::PASSAGE;
+
+    // Every cell becomes a frontier at most once, so CELLS slots always suffice
+    std::array<Cell, CELLS> frontiers;
+    std::array<bool, CELLS> visited{};
+    unsigned int frontierCount = 0;
+    auto markVisited = [&](unsigned int x, unsigned int y) {
+        visited[at(x, y)] = true;
+        frontiers[frontierCount++] = at(x, y);
+    };
+
+    markVisited(entrance_x, 3);
+    if (!isBoundaryOrOutside(entrance_x + 2, 1)) {
+        markVisited(entrance_x + 2, 1);
+    }
+    if (!isBoundaryOrOutside(entrance_x - 2, 1)) {
+        markVisited(entrance_x - 2, 1);
+    }
+
+    Cell reconnectionPoints[4];
+    while (frontierCount > 0) {
+        unsigned int chosenOne = RNGEngine::getRandomNumber(0, frontierCount - 1);
+        Cell current = frontiers[chosenOne];
+        frontiers[chosenOne] = frontiers[--frontierCount];
+        cells[current] = TiledCell::PASSAGE;
+
+        const unsigned int x = current / H, y = current % H;
+        const unsigned int neighbours[4][2] = { { x, y - 2 }, { x + 2, y }, { x, y + 2 }, { x - 2, y } };
+
+        unsigned int reconnectionCount = 0;
+        for (const unsigned int* neighbour : neighbours) {
+            if (isBoundaryOrOutside(neighbour[0], neighbour[1])) {
+                continue;
+            }
+            Cell cell = at(neighbour[0], neighbour[1]);
+            if (cells[cell] == TiledCell::PASSAGE) {
+                reconnectionPoints[reconnectionCount++] = cell;
+            }
+            else if (!visited[cell]) {
+                markVisited(neighbour[0], neighbour[1]);
+            }
+        }
+
+        // Two cells apart in a row or a column: the wall between them is the midpoint index
+        Cell chosenPoint = reconnectionPoints[RNGEngine::getRandomNumber(0, reconnectionCount - 1)];
+        cells[(current + chosenPoint) / 2] = TiledCell::PASSAGE;
+    }
+}
+
+template <unsigned int W, unsigned int H>
+void FixedMatrix<W, H>::breakUpBottomRow() {
+    for (unsigned int x = 1; x < W - 1; ++x) {
+        if (cells[at(x, H - 2)] == TiledCell::WALL && RNGEngine::getRandomNumber(1, 3) == 1) {
+            cells[at(x, H - 2)] = TiledCell::PASSAGE;
+        }
+    }
+}
+
+template <unsigned int W, unsigned int H>
+void FixedMatrix<W, H>::placeItems(unsigned int no_of_items, unsigned int robot_x, unsigned int robot_y) {
+    std::array<Cell, CELLS> availablePositions;
+    unsigned int available = 0;
+
+    for (unsigned int x = 1; x < W - 1; ++x) {
+        for (unsigned int y = 1; y < H - 1; ++y) {
+            if (x == robot_x && y == robot_y) continue;
+            if (cells[at(x, y)] == TiledCell::PASSAGE) {
+                availablePositions[available++] = at(x, y);
+            }
+        }
+    }
+
+    if (available == 0) {
+        std::cerr << "Warning: No available positions for items!\n";
+        return;
+    }
+
+    unsigned int itemsToPlace = std::min(no_of_items, available);
+    RNGEngine::shuffle(availablePositions.begin(), availablePositions.begin() + available);
+    for (unsigned int i = 0; i < itemsToPlace; ++i) {
+        cells[availablePositions[i]] = static_cast<uint8_t>(TiledCell::SWORD + RNGEngine::getRandomNumber(1, 4) - 1);
+    }
+}
+
+template <unsigned int W, unsigned int H>
+void FixedMatrix<W, H>::connectComponents(unsigned int robot_x, unsigned int robot_y) {
+    // Union-find over the open cells, as in Matrix
+    std::array<Cell, CELLS> parent;
+    std::array<uint8_t, CELLS> rank{};
+    std::array<bool, CELLS> open;
+    std::array<Cell, CELLS> required;
+    unsigned int requiredCount = 0;
+
+    auto find = [&](Cell cell) {
+        while (parent[cell] != cell) {
+            parent[cell] = parent[parent[cell]];
+            cell = parent[cell];
+        }
+        return cell;
+    };
+    auto unite = [&](Cell a, Cell b) {
+        a = find(a);
+        b = find(b);
+        if (a == b) return;
+        if (rank[a] < rank[b]) std::swap(a, b);
+        parent[b] = a;
+        if (rank[a] == rank[b]) ++rank[a];
+    };
+
+    for (Cell cell = 0; cell < CELLS; ++cell) {
+        parent[cell] = cell;
+        open[cell] = cells[cell] != TiledCell::WALL;
+        if (!open[cell]) continue;
+
+        FieldType type = TiledCell::fieldType(cells[cell]);
+        if (type == FieldType::EXIT || type == FieldType::ITEM) {
+            required[requiredCount++] = cell;
+        }
+        if (cell % H > 0 && open[cell - 1]) unite(cell, cell - 1);
+        if (cell >= H && open[cell - H]) unite(cell, cell - H);
+    }
+
+    // The 0-1 BFS of Matrix::connectComponents with a ring for its deque: a cell is
+    // queued at most twice (once at each of two neighbouring costs), so 2 * CELLS is room enough
+    const Cell start = at(robot_x, robot_y);
+    const uint16_t UNSETTLED = 0xFFFF;
+    std::array<uint16_t, CELLS> cost;
+    std::array<uint8_t, CELLS> cameFrom;
+    std::array<Cell, CELLS> touched;
+    std::array<Cell, 2 * CELLS> ring;
+    unsigned int touchedCount = 0;
+    cost.fill(UNSETTLED);
+
+    for (unsigned int r = 0; r < requiredCount; ++r) {
+        const Cell origin = required[r];
+        if (find(origin) == find(start)) {
+            continue;
+        }
+
+        const Cell mainComponent = find(start);
+        Cell link = NO_CELL;
+        size_t head = 0, tail = 0;      // ring positions, head <= tail, taken modulo its size
+        auto pushFront = [&](Cell cell) { head = (head + ring.size() - 1) % ring.size(); ring[head] = cell; };
+        auto pushBack = [&](Cell cell) { ring[tail] = cell; tail = (tail + 1) % ring.size(); };
+
+        cost[origin] = 0;
+        touched[touchedCount++] = origin;
+        pushBack(origin);
+
+        while (head != tail) {
+            Cell cell = ring[head];
+            head = (head + 1) % ring.size();
+            if (open[cell] && find(cell) == mainComponent) {
+                link = cell;
+                break;
+            }
+
+            const unsigned int x = cell / H, y = cell % H;
+            for (uint8_t direction = 0; direction < 4; ++direction) {
+                unsigned int next_x = x + (direction == 2 ? -1 : direction == 3 ? 1 : 0);
+                unsigned int next_y = y + (direction == 0 ? -1 : direction == 1 ? 1 : 0);
+                if (next_x >= W || next_y >= H) continue;
+
+                Cell next = static_cast<Cell>(cell + step(direction));
+                if (!open[next] && isBoundaryOrOutside(next_x, next_y)) continue;
+
+                uint16_t nextCost = static_cast<uint16_t>(cost[cell] + (open[next] ? 0 : 1));
+                if (nextCost < cost[next]) {
+                    if (cost[next] == UNSETTLED) touched[touchedCount++] = next;
+                    cost[next] = nextCost;
+                    cameFrom[next] = direction;
+                    if (open[next]) pushFront(next);
+                    else pushBack(next);
+                }
+            }
+        }
+
+        if (link == NO_CELL) {
+            throw std::logic_error("Connectivity pass could not link a required cell to the start");
+        }
+
+        for (Cell cell = link; cell != origin;) {
+            Cell previous = static_cast<Cell>(cell - step(cameFrom[cell]));
+            if (!open[cell]) {
+                cells[cell] = TiledCell::PASSAGE;
+                open[cell] = true;
+            }
+            unite(cell, previous);
+            cell = previous;
+        }
+
+        for (unsigned int i = 0; i < touchedCount; ++i) cost[touched[i]] = UNSETTLED;
+        touchedCount = 0;
+    }
+}
+
+template <unsigned int W, unsigned int H>
+std::chrono::microseconds FixedMatrix<W, H>::generateMatrix(unsigned int no_of_items, bool connectExit) {
+    auto start_time = std::chrono::high_resolution_clock::now();
+
+    std::pair<unsigned int, unsigned int> entrance_and_exit = setEntranceAndExit();
+    generativePrim(entrance_and_exit.first);
+    if (connectExit && H % 2 == 0) {
+        breakUpBottomRow();
+    }
+    placeItems(no_of_items, entrance_and_exit.first, 1);
+    if (connectExit) {
+        connectComponents(entrance_and_exit.first, 1);
+    }
+
+    return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::high_resolution_clock::now() - start_time);
+}
+
+template <unsigned int W, unsigned int H>
+std::pair<unsigned int, unsigned int> FixedMatrix<W, H>::getRandomPassageForMinotaur(unsigned int robot_x, SpawnBand band) const {
+    const unsigned int robot_y = 1;
+    const uint16_t UNREACHED = 0xFFFF;
+
+    std::array<uint16_t, CELLS> distance;
+    std::array<Cell, CELLS> reached;
+    unsigned int reachedCount = 0;
+    distance.fill(UNREACHED);
+
+    const Cell start = at(robot_x, robot_y);
+    distance[start] = 0;
+    reached[reachedCount++] = start;
+
+    for (unsigned int head = 0; head < reachedCount; ++head) {
+        Cell cell = reached[head];
+        const unsigned int x = cell / H, y = cell % H;
+        const unsigned int neighbours[4][2] = { { x, y - 1 }, { x + 1, y }, { x, y + 1 }, { x - 1, y } };
+        for (const unsigned int* neighbour : neighbours) {
+            if (neighbour[0] >= W || neighbour[1] >= H) continue;
+
+            Cell next = at(neighbour[0], neighbour[1]);
+            if (distance[next] == UNREACHED && cells[next] != TiledCell::WALL) {
+                distance[next] = static_cast<uint16_t>(distance[cell] + 1);
+                reached[reachedCount++] = next;
+            }
+        }
+    }
+
+    unsigned int farthest = distance[reached[reachedCount - 1]];
+    unsigned int low = farthest * band.low / 100;
+    unsigned int high = (farthest * band.high + 99) / 100;
+
+    std::array<Cell, CELLS> availablePositions;
+    unsigned int available = 0;
+    Cell closest = NO_CELL;
+    unsigned int closestGap = static_cast<unsigned int>(-1);
+
+    for (unsigned int i = 0; i < reachedCount; ++i) {
+        Cell cell = reached[i];
+        const unsigned int x = cell / H, y = cell % H;
+        if (cell == start || cells[cell] != TiledCell::PASSAGE || (robot_x + 1) % 2 != (x + y) % 2) {
+            continue;
+        }
+
+        unsigned int steps = distance[cell];
+        if (steps >= low && steps <= high) {
+            availablePositions[available++] = cell;
+        }
+        else {
+            unsigned int gap = steps < low ? low - steps : steps - high;
+            if (gap < closestGap) {
+                closestGap = gap;
+                closest = cell;
+            }
+        }
+    }
+
+    if (available > 0) {
+        Cell chosen = availablePositions[RNGEngine::getRandomNumber(0, available - 1)];
+        return std::make_pair(chosen / H, chosen % H);
+    }
+    if (closest == NO_CELL) {
+        std::cerr << "Warning: No available positions for minotaur!\n";
+        return std::make_pair(static_cast<unsigned int>(-1), static_cast<unsigned int>(-1));
+    }
+    return std::make_pair(closest / H, closest % H);
+}
+
+/**
+ * @brief The board sizes that get a FixedMatrix. withTier builds the one matching a
+ * size on the stack and hands it to use (a generic lambda); false when the size has
+ * no tier and the caller should fall back to Matrix. New games (BackgroundMaze)
+ * and bulk generation (MazeFarm, MazePool) go through it.
+ */
+namespace MatrixTiers {
+    template <typename Use>
+    bool withTier(unsigned int width, unsigned int height, Use&& use) {
+        if (width == 17 && height == 17) {
+            FixedMatrix<17, 17> matrix;
+            use(matrix);
+            return true;
+        }
+        if (width == 31 && height == 31) {
+            FixedMatrix<31, 31> matrix;
+            use(matrix);
+            return true;
+        }
+        if (width == 63 && height == 63) {
+            FixedMatrix<63, 63> matrix;
+            use(matrix);
+            return true;
+        }
+        return false;
+    }
+}
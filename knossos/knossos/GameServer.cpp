@@ -0,0 +1,714 @@
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <memory>
+#include <atomic>
+#include <thread>
+#include <chrono>
+#include <unordered_map>
+#include <cctype>
+#include <algorithm>
+
+#include "GameServer.h"
+
+#ifdef __linux__
+#include <cerrno>
+#include <csignal>
+#include <fcntl.h>
+#include <poll.h>
+#include <termios.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#include "Gameplay.h"
+#include "ConsoleHandler.h"
+#include "SpectatorHub.h"
+#endif
+
+using std::string;
+using std::vector;
+using std::cout;
+using std::cerr;
+
+const char* GameServer::DEFAULT_SOCKET_PATH = "/tmp/knossos.sock";
+
+#ifdef __linux__
+
+namespace {
+
+// A client that leaves this much output unread is considered gone
+const size_t MAX_PENDING_OUTPUT = 4 * 1024 * 1024;
+
+// Output buffers grow to a full screen on the first frame; idle sessions give that back
+const size_t IDLE_OUTPUT_CAPACITY = 16 * 1024;
+
+const size_t MAX_HELLO_LENGTH = 128;
+const unsigned int MAX_SERVER_DIMENSION = 1000;
+const int MAX_EVENTS = 256;
+
+// How often a worker looks for games whose spectators are waiting on a full redraw
+const auto KEYFRAME_POLL_INTERVAL = std::chrono::milliseconds(100);
+
+std::atomic<bool> stopRequested(false);
+
+void requestStop(int) {
+    stopRequested = true;
+}
+
+struct ServerCounters {
+    std::atomic<unsigned long> activeSessions;
+    std::atomic<unsigned long> sessionsServed;
+    std::atomic<unsigned long> movesPlayed;
+
+    ServerCounters() : activeSessions(0), sessionsServed(0), movesPlayed(0) {}
+};
+
+// Appends whatever the game writes to the output of the session being served.
+// One per worker: every session on that worker shares it, so a session only
+// costs its pending bytes rather than a whole ostream
+class SessionOutputBuffer : public std::streambuf {
+private:
+    string* target;
+
+protected:
+    int_type overflow(int_type ch) override {
+        if (ch != traits_type::eof()) {
+            target->push_back(static_cast<char>(ch));
+        }
+        return ch;
+    }
+
+    std::streamsize xsputn(const char* data, std::streamsize count) override {
+        target->append(data, static_cast<size_t>(count));
+        return count;
+    }
+
+public:
+    SessionOutputBuffer() : target(nullptr) {}
+    void setTarget(string* output) { target = output; }
+};
+
+enum class EscapeState : unsigned char {
+    NONE,
+    AFTER_ESCAPE,   // ESC seen
+    IN_SEQUENCE     // ESC [ ... until the final byte (arrow keys etc.)
+};
+
+struct Session {
+    std::unique_ptr<Gameplay> game;     // created once the hello line arrives
+    std::shared_ptr<SpectatorChannel> spectators;
+    string hello;
+    string output;
+    size_t written;
+    EscapeState escape;
+    bool waitingForWritable;
+    bool finished;
+
+    Session() : written(0), escape(EscapeState::NONE), waitingForWritable(false), finished(false) {}
+};
+
+class Worker {
+private:
+    int listenFd;
+    int epollFd;
+    std::unordered_map<int, std::unique_ptr<Session>> sessions;
+    SessionOutputBuffer outputBuffer;
+    std::ostream sessionStream;
+    ServerCounters& counters;
+    SpectatorHub& hub;
+
+    void acceptConnections();
+    void handleReadable(int fd, Session& session);
+    bool handleHello(Session& session);
+    bool handleWatch(int fd, Session& session);
+    void handleKey(Session& session, char key);
+    void publishKeyframes();
+    bool flush(int fd, Session& session);
+    void closeSession(int fd);
+
+public:
+    Worker(int listenFd, ServerCounters& counters, SpectatorHub& hub)
+        : listenFd(listenFd), epollFd(-1), sessionStream(&outputBuffer), counters(counters), hub(hub) {}
+
+    ~Worker() {
+        for (auto& entry : sessions) {
+            if (entry.second->spectators) {
+                entry.second->spectators->finish();
+            }
+            close(entry.first);
+        }
+        counters.activeSessions -= sessions.size();
+        if (epollFd >= 0) {
+            close(epollFd);
+        }
+    }
+
+    bool initialize();
+    void run();
+};
+
+bool Worker::initialize() {
+    epollFd = epoll_create1(EPOLL_CLOEXEC);
+    if (epollFd < 0) {
+        return false;
+    }
+
+    // Every worker waits on the listening socket; EPOLLEXCLUSIVE wakes only one per connection
+    epoll_event event = {};
+    event.events = EPOLLIN | EPOLLEXCLUSIVE;
+    event.data.fd = listenFd;
+    return epoll_ctl(epollFd, EPOLL_CTL_ADD, listenFd, &event) == 0;
+}
+
+void Worker::run() {
+    epoll_event events[MAX_EVENTS];
+    auto lastKeyframePoll = std::chrono::steady_clock::now();
+
+    while (!stopRequested) {
+        // The timeout bounds how long a stop request or a new spectator can go unnoticed
+        int count = epoll_wait(epollFd, events, MAX_EVENTS, 100);
+        if (count < 0 && errno != EINTR) {
+            cerr << "Error: epoll_wait failed\n";
+            return;
+        }
+
+        auto now = std::chrono::steady_clock::now();
+        if (now - lastKeyframePoll >= KEYFRAME_POLL_INTERVAL) {
+            publishKeyframes();
+            lastKeyframePoll = now;
+        }
+
+        for (int i = 0; i < count; ++i) {
+            int fd = events[i].data.fd;
+            if (fd == listenFd) {
+                acceptConnections();
+                continue;
+            }
+
+            auto found = sessions.find(fd);
+            if (found == sessions.end()) {
+                continue;
+            }
+            Session& session = *found->second;
+
+            if (events[i].events & (EPOLLERR | EPOLLHUP)) {
+                closeSession(fd);
+                continue;
+            }
+            if (events[i].events & EPOLLOUT) {
+                if (!flush(fd, session)) {
+                    closeSession(fd);
+                    continue;
+                }
+            }
+            if (events[i].events & EPOLLIN) {
+                handleReadable(fd, session);
+            }
+        }
+    }
+}
+
+void Worker::acceptConnections() {
+    while (true) {
+        int fd = accept4(listenFd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0) {
+            // EAGAIN: another worker took it, or the backlog is empty
+            return;
+        }
+
+        epoll_event event = {};
+        event.events = EPOLLIN | EPOLLRDHUP;
+        event.data.fd = fd;
+        if (epoll_ctl(epollFd, EPOLL_CTL_ADD, fd, &event) != 0) {
+            close(fd);
+            continue;
+        }
+
+        sessions[fd].reset(new Session());
+        ++counters.activeSessions;
+    }
+}
+
+void Worker::handleReadable(int fd, Session& session) {
+    char buffer[4096];
+
+    while (true) {
+        ssize_t received = read(fd, buffer, sizeof(buffer));
+        if (received < 0 && errno == EINTR) {
+            continue;
+        }
+        if (received < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            break;
+        }
+        if (received <= 0) {
+            closeSession(fd);
+            return;
+        }
+
+        for (ssize_t i = 0; i < received && !session.finished; ++i) {
+            if (!session.game) {
+                session.hello += buffer[i];
+                if (buffer[i] == '\n') {
+                    if (session.hello.compare(0, 5, "WATCH") == 0) {
+                        if (handleWatch(fd, session)) {
+                            return;     // the connection now belongs to the spectator hub
+                        }
+                        session.finished = true;
+                    }
+                    else if (!handleHello(session)) {
+                        session.finished = true;
+                    }
+                }
+                else if (session.hello.size() > MAX_HELLO_LENGTH) {
+                    closeSession(fd);
+                    return;
+                }
+            }
+            else {
+                handleKey(session, buffer[i]);
+            }
+        }
+    }
+
+    if (!flush(fd, session)) {
+        closeSession(fd);
+    }
+}
+
+bool Worker::handleHello(Session& session) {
+    std::istringstream line(session.hello);
+    string greeting;
+    int columns = 0, rows = 0;
+    unsigned int width = 0, height = 0, items = 0;
+
+    line >> greeting >> columns >> rows >> width >> height >> items;
+    string().swap(session.hello);
+
+    if (!line || greeting != "HELLO") {
+        session.output += "Error: Expected HELLO <columns> <rows> <width> <height> <number_of_items>\n";
+        return false;
+    }
+    if (width <= 15 || height <= 15 || width > MAX_SERVER_DIMENSION || height > MAX_SERVER_DIMENSION) {
+        session.output += "Error: Width and height must be between 16 and " + std::to_string(MAX_SERVER_DIMENSION) + "\n";
+        return false;
+    }
+    if (items <= 3 || items > width * height / 3) {
+        session.output += "Error: Number of items must be greater than 3 and fit in the maze\n";
+        return false;
+    }
+
+    // The game id goes in the terminal title, where the screen redraws won't wipe it
+    session.spectators = hub.openChannel(std::make_pair(columns, rows));
+    session.output += "\033]0;Knossos - game " + std::to_string(session.spectators->gameId) + "\007";
+
+    outputBuffer.setTarget(&session.output);
+
+    session.game.reset(new Gameplay(width, height, sessionStream));
+    session.game->attachRemoteTerminal(std::make_pair(columns, rows));
+    session.game->initializeGame(items);
+    session.game->beginTurns();
+
+    ++counters.sessionsServed;
+    return true;
+}
+
+// WATCH lists the running games; WATCH <id> hands the connection to the spectator hub
+bool Worker::handleWatch(int fd, Session& session) {
+    std::istringstream line(session.hello);
+    string command;
+    unsigned long long gameId = 0;
+
+    line >> command >> gameId;
+    string().swap(session.hello);
+
+    if (!line) {
+        string games = hub.listGames();
+        session.output += games.empty() ? "No games are being played\n" : games;
+        return false;
+    }
+
+    string error;
+    if (!hub.watch(fd, gameId, error)) {
+        session.output += error;
+        return false;
+    }
+
+    // Not closed: the descriptor lives on in the hub
+    epoll_ctl(epollFd, EPOLL_CTL_DEL, fd, nullptr);
+    sessions.erase(fd);
+    --counters.activeSessions;
+    return true;
+}
+
+void Worker::handleKey(Session& session, char key) {
+    // Arrow keys arrive as ESC [ A and must not turn into 'a'
+    switch (session.escape) {
+    case EscapeState::AFTER_ESCAPE:
+        session.escape = (key == '[' || key == 'O') ? EscapeState::IN_SEQUENCE : EscapeState::NONE;
+        return;
+    case EscapeState::IN_SEQUENCE:
+        if (key >= 0x40 && key <= 0x7E) {
+            session.escape = EscapeState::NONE;
+        }
+        return;
+    case EscapeState::NONE:
+        break;
+    }
+
+    if (key == 27) {
+        session.escape = EscapeState::AFTER_ESCAPE;
+        return;
+    }
+
+    key = static_cast<char>(std::tolower(static_cast<unsigned char>(key)));
+    if (!isGameKey(key)) {
+        return;
+    }
+
+    outputBuffer.setTarget(&session.output);
+
+    // Spectators always watch the maze: the overview (M) and the way back from it go
+    // to the player alone, and looking at it is not a move
+    const bool overview = key == 'm';
+    if (!overview) {
+        ++counters.movesPlayed;
+        session.game->closeMinimap();
+    }
+    size_t frameStart = session.output.size();
+
+    bool running = session.game->playTurn(key);
+    if (!running) {
+        session.game->finishGame(key);
+        session.finished = true;
+    }
+
+    // The turn's output is copied once into a shared frame, however many are watching
+    if (session.spectators->watched() && !overview && session.output.size() > frameStart) {
+        session.spectators->publish(
+            std::make_shared<const string>(session.output, frameStart), false);
+    }
+    if (!running) {
+        session.spectators->finish();
+    }
+}
+
+void Worker::publishKeyframes() {
+    string frame;
+    for (auto& entry : sessions) {
+        Session& session = *entry.second;
+        if (!session.spectators || session.finished || !session.spectators->takeKeyframeRequest()) {
+            continue;
+        }
+
+        outputBuffer.setTarget(&frame);
+        session.game->renderKeyframe();
+        session.spectators->publish(std::make_shared<const string>(std::move(frame)), true);
+        frame.clear();
+    }
+}
+
+// Write as much pending output as the socket takes; false means the session should go
+bool Worker::flush(int fd, Session& session) {
+    while (session.written < session.output.size()) {
+        ssize_t sent = send(fd, session.output.data() + session.written,
+            session.output.size() - session.written, MSG_NOSIGNAL);
+        if (sent < 0 && errno == EINTR) {
+            continue;
+        }
+        if (sent < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            break;
+        }
+        if (sent < 0) {
+            return false;
+        }
+        session.written += static_cast<size_t>(sent);
+    }
+
+    bool drained = session.written == session.output.size();
+
+    if (drained) {
+        session.output.clear();
+        session.written = 0;
+        if (session.output.capacity() > IDLE_OUTPUT_CAPACITY) {
+            string().swap(session.output);
+        }
+        if (session.finished) {
+            return false;
+        }
+    }
+    else if (session.output.size() - session.written > MAX_PENDING_OUTPUT) {
+        return false;
+    }
+
+    // Only ask for EPOLLOUT while something is actually waiting
+    if (drained == session.waitingForWritable) {
+        epoll_event event = {};
+        event.events = EPOLLIN | EPOLLRDHUP | (drained ? 0u : static_cast<uint32_t>(EPOLLOUT));
+        event.data.fd = fd;
+        epoll_ctl(epollFd, EPOLL_CTL_MOD, fd, &event);
+        session.waitingForWritable = !drained;
+    }
+    return true;
+}
+
+void Worker::closeSession(int fd) {
+    auto found = sessions.find(fd);
+    if (found != sessions.end() && found->second->spectators) {
+        found->second->spectators->finish();
+    }
+
+    // Closing the descriptor also removes it from the epoll set
+    close(fd);
+    sessions.erase(fd);
+    --counters.activeSessions;
+}
+
+// Thousands of sessions need thousands of descriptors
+void raiseDescriptorLimit() {
+    rlimit limit;
+    if (getrlimit(RLIMIT_NOFILE, &limit) == 0 && limit.rlim_cur < limit.rlim_max) {
+        limit.rlim_cur = limit.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &limit);
+    }
+}
+
+int openListeningSocket(const string& socketPath) {
+    sockaddr_un address = {};
+    address.sun_family = AF_UNIX;
+    if (socketPath.size() >= sizeof(address.sun_path)) {
+        cerr << "Error: Socket path is too long\n";
+        return -1;
+    }
+    socketPath.copy(address.sun_path, socketPath.size());
+
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        cerr << "Error: Could not create socket\n";
+        return -1;
+    }
+
+    // A socket file left behind by a previous server would make bind fail
+    unlink(socketPath.c_str());
+
+    if (bind(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0 || listen(fd, SOMAXCONN) != 0) {
+        cerr << "Error: Could not listen on " << socketPath << "\n";
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+} // namespace
+
+bool GameServer::run(const string& socketPath, unsigned int threadCount) {
+    if (threadCount == 0) {
+        threadCount = std::max(1u, std::min(4u, std::thread::hardware_concurrency()));
+    }
+
+    raiseDescriptorLimit();
+    signal(SIGPIPE, SIG_IGN);
+    signal(SIGINT, requestStop);
+    signal(SIGTERM, requestStop);
+
+    int listenFd = openListeningSocket(socketPath);
+    if (listenFd < 0) {
+        return false;
+    }
+
+    SpectatorHub hub;
+    if (!hub.start()) {
+        cerr << "Error: Could not set up the spectator hub\n";
+        close(listenFd);
+        return false;
+    }
+
+    ServerCounters counters;
+    vector<std::unique_ptr<Worker>> workers;
+    vector<std::thread> threads;
+
+    for (unsigned int i = 0; i < threadCount; ++i) {
+        workers.emplace_back(new Worker(listenFd, counters, hub));
+        if (!workers.back()->initialize()) {
+            cerr << "Error: Could not set up the event loop\n";
+            close(listenFd);
+            return false;
+        }
+    }
+    for (auto& worker : workers) {
+        threads.emplace_back(&Worker::run, worker.get());
+    }
+
+    cout << "Serving labyrinths on " << socketPath << " with " << threadCount << " threads (Ctrl+C to stop)\n";
+    cout.flush();
+
+    unsigned long lastMoves = 0;
+    auto lastReport = std::chrono::steady_clock::now();
+
+    while (!stopRequested) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(200));
+
+        auto now = std::chrono::steady_clock::now();
+        auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(now - lastReport);
+        if (elapsed.count() >= 10000) {
+            unsigned long moves = counters.movesPlayed;
+            cout << counters.activeSessions << " sessions connected, "
+                << (moves - lastMoves) * 1000 / static_cast<unsigned long>(elapsed.count()) << " moves/s\n";
+            cout.flush();
+            lastMoves = moves;
+            lastReport = now;
+        }
+    }
+
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+    workers.clear();
+    hub.stop();
+
+    close(listenFd);
+    unlink(socketPath.c_str());
+
+    cout << "Server stopped after " << counters.sessionsServed << " games and " << counters.movesPlayed << " moves\n";
+    return true;
+}
+
+namespace {
+
+// -1 (with a message) if nothing is listening on socketPath
+int connectToServer(const string& socketPath) {
+    sockaddr_un address = {};
+    address.sun_family = AF_UNIX;
+    if (socketPath.size() >= sizeof(address.sun_path)) {
+        cerr << "Error: Socket path is too long\n";
+        return -1;
+    }
+    socketPath.copy(address.sun_path, socketPath.size());
+
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0 || connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0) {
+        cerr << "Error: No server is listening on " << socketPath << "\n";
+        if (fd >= 0) close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+// Copy the server's output to stdout until it hangs up. Players' keys are sent on;
+// spectators can only press q to stop watching
+int relayTerminal(int fd, const string& request, bool forwardKeys) {
+    if (send(fd, request.data(), request.size(), MSG_NOSIGNAL) != static_cast<ssize_t>(request.size())) {
+        cerr << "Error: Could not talk to the server\n";
+        close(fd);
+        return 1;
+    }
+
+    // Keys go out as they're pressed - no line buffering, no local echo
+    termios originalTermios;
+    bool terminal = tcgetattr(STDIN_FILENO, &originalTermios) == 0;
+    if (terminal) {
+        termios rawTermios = originalTermios;
+        rawTermios.c_lflag &= ~(ICANON | ECHO);
+        rawTermios.c_cc[VMIN] = 1;
+        rawTermios.c_cc[VTIME] = 0;
+        tcsetattr(STDIN_FILENO, TCSANOW, &rawTermios);
+    }
+
+    pollfd watched[2];
+    watched[0].fd = fd;
+    watched[0].events = POLLIN;
+    watched[1].fd = STDIN_FILENO;
+    watched[1].events = POLLIN;
+    nfds_t watchedCount = 2;
+    char buffer[65536];
+    bool quit = false;
+
+    while (!quit) {
+        if (poll(watched, watchedCount, -1) < 0) {
+            if (errno == EINTR) continue;
+            break;
+        }
+
+        if (watched[0].revents & (POLLIN | POLLHUP | POLLERR)) {
+            ssize_t received = read(fd, buffer, sizeof(buffer));
+            if (received <= 0) {
+                break;      // the server closes the connection when the game is over
+            }
+            for (ssize_t offset = 0; offset < received;) {
+                ssize_t written = write(STDOUT_FILENO, buffer + offset, static_cast<size_t>(received - offset));
+                if (written < 0 && errno != EINTR) break;
+                if (written > 0) offset += written;
+            }
+        }
+
+        if (watchedCount > 1 && (watched[1].revents & (POLLIN | POLLHUP))) {
+            ssize_t typed = read(STDIN_FILENO, buffer, 64);
+            if (typed <= 0) {
+                watchedCount = 1;   // input ended - keep showing output until the server is done
+            }
+            else if (!forwardKeys) {
+                quit = std::find(buffer, buffer + typed, 'q') != buffer + typed;
+            }
+            else if (send(fd, buffer, static_cast<size_t>(typed), MSG_NOSIGNAL) < 0) {
+                break;
+            }
+        }
+    }
+
+    if (terminal) {
+        tcsetattr(STDIN_FILENO, TCSANOW, &originalTermios);
+    }
+    cout << "\033[?25h";
+    cout.flush();
+
+    close(fd);
+    return 0;
+}
+
+} // namespace
+
+int runGameClient(const string& socketPath, unsigned int width, unsigned int height, unsigned int no_of_items) {
+    int fd = connectToServer(socketPath);
+    if (fd < 0) {
+        return 1;
+    }
+
+    pair<int, int> consoleSize = getConsoleSize();
+    string hello = "HELLO " + std::to_string(consoleSize.first) + " " + std::to_string(consoleSize.second) + " " +
+        std::to_string(width) + " " + std::to_string(height) + " " + std::to_string(no_of_items) + "\n";
+    return relayTerminal(fd, hello, true);
+}
+
+int runSpectatorClient(const string& socketPath, bool listOnly, unsigned long long gameId) {
+    int fd = connectToServer(socketPath);
+    if (fd < 0) {
+        return 1;
+    }
+
+    if (listOnly) {
+        return relayTerminal(fd, "WATCH\n", false);
+    }
+    return relayTerminal(fd, "WATCH " + std::to_string(gameId) + "\n", false);
+}
+
+#else
+
+bool GameServer::run(const string&, unsigned int) {
+    cerr << "Error: Server mode is only available on Linux\n";
+    return false;
+}
+
+int runGameClient(const string&, unsigned int, unsigned int, unsigned int) {
+    cerr << "Error: The game client is only available on Linux\n";
+    return 1;
+}
+
+int runSpectatorClient(const string&, bool, unsigned long long) {
+    cerr << "Error: The game client is only available on Linux\n";
+    return 1;
+}
+
+#endif
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <string>
+
+/**
+ * @brief Hosts many independent games over a local Unix domain socket (Linux only).
+ *
+ * A small pool of worker threads each runs its own epoll loop. Every worker
+ * watches the listening socket (EPOLLEXCLUSIVE wakes just one of them) and owns
+ * the sessions it accepts, so a session is only ever touched by one thread and
+ * needs no locking. Games render into a per-session byte buffer that is flushed
+ * with nonblocking writes; a client that stops reading is dropped once its
+ * backlog grows past a limit.
+ *
+ * Protocol: the client sends one line
+ *   HELLO <terminal_columns> <terminal_rows> <width> <height> <number_of_items>
+ * and from then on raw key presses; the server sends the game's ANSI output and
+ * closes the connection when the game ends. Every game gets a numeric id (told
+ * to the player when it starts); a connection that sends
+ *   WATCH <id>
+ * instead becomes a spectator of that game (see SpectatorHub), and a bare
+ * WATCH gets the list of games being played.
+ */
+class GameServer {
+public:
+    static const char* DEFAULT_SOCKET_PATH;
+
+    /**
+     * @brief Serve until SIGINT/SIGTERM.
+     * @param socketPath Path of the Unix socket (a stale socket file is replaced)
+     * @param threadCount Number of event loop threads, 0 for a default
+     * @return False if the socket could not be set up
+     */
+    static bool run(const std::string& socketPath, unsigned int threadCount);
+};
+
+/**
+ * @brief Thin terminal client for GameServer: forwards raw key presses and
+ * writes whatever the server sends straight to stdout.
+ * @return Process exit code
+ */
+int runGameClient(const std::string& socketPath, unsigned int width, unsigned int height, unsigned int no_of_items);
+
+/**
+ * @brief Follow someone else's game read-only (q stops watching).
+ * @param listOnly Print the games being played instead of watching one
+ * @return Process exit code
+ */
+int runSpectatorClient(const std::string& socketPath, bool listOnly, unsigned long long gameId);
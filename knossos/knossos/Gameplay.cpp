@@ -2,119 +2,348 @@
 #include <vector>
 #include <cctype>
 #include <chrono>
+#include <thread>
 
 #include "Matrix.h"
 #include "Gameplay.h"
 #include "ConsoleHandler.h"
 #include "RNGEngine.h"
 #include "FileHandler.h"
+#include "ReplayLog.h"
+#include "DifficultySearch.h"
+#include "MemoryStats.h"
+#include "Minimap.h"
 
-using std::cout;
+using std::cerr;
 using std::pair;
 using std::vector;
 using std::chrono::microseconds;
 using std::chrono::milliseconds;
 using std::chrono::duration_cast;
-std::chrono::high_resolution_clock;
+using std::chrono::high_resolution_clock;
+
+// A Minotaur this close (in steps) when the hero takes the stairs comes along,
+// arriving on the stairs this many turns later
+static const int MINOTAUR_FOLLOW_DISTANCE = 4;
+static const unsigned int MINOTAUR_STAIRS_TURNS = 3;
 
 void Gameplay::printMatrixCharacter(char symbol) const {
     if (symbol == 'R') {
-        cout << ANSICodes::ROBOT_STYLE << 'R' << ANSICodes::RESET;
+        out << ANSICodes::ROBOT_STYLE << 'R' << ANSICodes::RESET;
     }
     else if (symbol == 'M') {
-        cout << ANSICodes::MINOTAUR_STYLE << 'M' << ANSICodes::RESET;
+        out << ANSICodes::MINOTAUR_STYLE << 'M' << ANSICodes::RESET;
     }
     else if (symbol == 'P') {
-        cout << ANSICodes::ITEM_STYLE << 'P' << ANSICodes::RESET;
+        out << ANSICodes::ITEM_STYLE << 'P' << ANSICodes::RESET;
     }
     else if (symbol == 'E') {
-        cout << ANSICodes::EXIT_STYLE << 'E' << ANSICodes::RESET;
+        out << ANSICodes::EXIT_STYLE << 'E' << ANSICodes::RESET;
     }
     else if (symbol == '#') {
-        cout << ANSICodes::WALL_STYLE << '#' << ANSICodes::RESET;
+        out << ANSICodes::WALL_STYLE << '#' << ANSICodes::RESET;
     }
     else if (symbol == 'U') {
-		cout << ANSICodes::ENTRANCE_STYLE << 'U' << ANSICodes::RESET;
+		out << ANSICodes::ENTRANCE_STYLE << 'U' << ANSICodes::RESET;
 	}
 	else if (symbol == 'I') {
-		cout << ANSICodes::EXIT_STYLE << 'I' << ANSICodes::RESET;
+		out << ANSICodes::EXIT_STYLE << 'I' << ANSICodes::RESET;
+	}
+	else if (symbol == '<' || symbol == '>') {
+		out << ANSICodes::STAIRS_STYLE << symbol << ANSICodes::RESET;
 	}
     else {
-        cout << symbol;
+        out << symbol;
     }
 }
 
 void Gameplay::updateMatrixCharacter(unsigned int x, unsigned int y, char symbol) const {
-	moveCursorToMatrixPosition(x, y, height, initial_console_size);
-	printMatrixCharacter(symbol);
-	cout.flush(); 
+	if (headless) return;
+	MemoryScope scope(MemorySubsystem::RENDERING);
+
+	moveCursorToMatrixPosition(x, y, height, initial_console_size, out);
+	// Out of sight (e.g. the Minotaur moving in the dark), the cell keeps its fog or memory
+	if (viewLimited() && !fieldOfView->isVisible(x, y)) {
+		drawCell(x, y);
+	}
+	else {
+		printMatrixCharacter(symbol);
+	}
+	out.flush(); 
 }
 
 // Position cursor at robot's location so that it blinks there
 void Gameplay::positionCursorAtRobot() const {
-	moveCursorToMatrixPosition(robot_x, robot_y, height, initial_console_size);
+	if (headless) return;
+
+	moveCursorToMatrixPosition(robot_x, robot_y, height, initial_console_size, out);
 }
 
 void Gameplay::printHermesSpeech() const {
-    cout << "\x1B[38;2;0;0;155;47m" << "\n - A swift message from Hermes, messenger of the gods: \n" << ANSICodes::RESET;
-    cout << "\n   \"Brave traveler, I guide all who wander through unknown paths.\n";
-    cout << "    Use WASD to move your mechanical companion through this labyrinth -\n";
-    cout << "    W for north, A for west, S for south, D for east.\n";
-    cout << "    If the divine display becomes corrupted, press E to restore it.\n";
-    cout << "    Should you wish to return to the mortal realm, press Q to depart.\n\n";
-    cout << "    Move wisely, for speed and cunning shall serve you well here.\n";
-    cout << "    May the gods favor your journey!\"\n\n";
+    out << "\x1B[38;2;0;0;155;47m" << "\n - A swift message from Hermes, messenger of the gods: \n" << ANSICodes::RESET;
+    out << "\n   \"Brave traveler, I guide all who wander through unknown paths.\n";
+    out << "    Use WASD to move your mechanical companion through this labyrinth -\n";
+    out << "    W for north, A for west, S for south, D for east.\n";
+    out << "    If the divine display becomes corrupted, press E to restore it.\n";
+    out << "    Lost in a labyrinth too vast for your screen? M shows all of it at a glance.\n";
+    out << "    Should you wish to return to the mortal realm, press Q to depart.\n\n";
+    out << "    Move wisely, for speed and cunning shall serve you well here.\n";
+    out << "    May the gods favor your journey!\"\n\n";
 }
 
 void Gameplay::printHephaestusSpeech() const {
-    cout << "\x1B[38;2;0;0;155;47m" << "\n - Hephaestus, god of forge, warns: \n" << ANSICodes::RESET;
-    cout << "\n   \"Beware, mortal! I have scattered my crafted relics throughout this maze.\n";
-    cout << "    Each 'P' holds a mystery - you won't know what I've forged until you step upon it!\n\n";
-    cout << "    My divine creations include:\n";
-    cout << "	  * Sword - Sharp enough to cut through even a Minotaur's hide! *forge-ive me the pun*\n";
-    cout << "	  * Shield - Defense so strong, it'll make you feel *metal-ly* prepared!\n";
-    cout << "	  * Hammer - Breaks walls like my legendary smithing breaks expectations!\n";
-    cout << "	  * Fog of War - Clouds your vision... I was having a *mist-ical* day when I made this one!\n\n";
-    cout << "    Remember: Each blessing lasts but 3 moves. Use them *smith-ly*!\"\n\n\n";
+    out << "\x1B[38;2;0;0;155;47m" << "\n - Hephaestus, god of forge, warns: \n" << ANSICodes::RESET;
+    out << "\n   \"Beware, mortal! I have scattered my crafted relics throughout this maze.\n";
+    out << "    Each 'P' holds a mystery - you won't know what I've forged until you step upon it!\n\n";
+    out << "    My divine creations include:\n";
+    out << "	  * Sword - Sharp enough to cut through even a Minotaur's hide! *forge-ive me the pun*\n";
+    out << "	  * Shield - Defense so strong, it'll make you feel *metal-ly* prepared!\n";
+    out << "	  * Hammer - Breaks walls like my legendary smithing breaks expectations!\n";
+    out << "	  * Fog of War - Clouds your vision... I was having a *mist-ical* day when I made this one!\n\n";
+    out << "    Remember: Each blessing lasts but 3 moves. Use them *smith-ly*!\"\n\n\n";
 }
 
 void Gameplay::printWelcomeMessage() const {
-    cout << "\n";
-    cout << "\x1B[38;2;0;0;155;47m";
-    cout << "                                                                           \n";
-    cout << " ============= Welcome to the Labyrinth of Knossos, Theseus! ============= \n";
-    cout << "                                                                           \n";
-    cout << ANSICodes::RESET;
-    cout << "\n\n\n";
+    out << "\n";
+    out << "\x1B[38;2;0;0;155;47m";
+    out << "                                                                           \n";
+    out << " ============= Welcome to the Labyrinth of Knossos, Theseus! ============= \n";
+    out << "                                                                           \n";
+    out << ANSICodes::RESET;
+    out << "\n\n\n";
 }
 
 void Gameplay::printDaedalusLegend() const {
     auto duration_microseconds = matrix_generation_time;
     auto duration_milliseconds = duration_cast<milliseconds>(matrix_generation_time);
 
-    cout << "\x1B[38;2;0;0;155;47m" << " - Quick Trivia: " << ANSICodes::RESET << " Legend says that it took Daedalus only " << duration_milliseconds.count() << " ms ("
+    out << "\x1B[38;2;0;0;155;47m" << " - Quick Trivia: " << ANSICodes::RESET << " Legend says that it took Daedalus only " << duration_milliseconds.count() << " ms ("
         << duration_microseconds.count() << " microseconds) to build the labyrinth (apparently Zeus helped him)...\n\n";
 }
 
-void Gameplay::initializeGame(unsigned int no_of_items) {
+void Gameplay::printIntroduction() const {
+	printWelcomeMessage();
+	printHermesSpeech();
+	printHephaestusSpeech();
+}
+
+bool Gameplay::initializeGame(unsigned int no_of_items) {
+	return initializeGame(no_of_items, RNGEngine::generateSeed());
+}
+
+bool Gameplay::initializeGame(unsigned int no_of_items, unsigned int seed) {
+	BackgroundMaze generation(width, height, no_of_items, seed, level_count);
+	return initializeGame(generation);
+}
+
+bool Gameplay::initializeGame(BackgroundMaze& generation) {
+	// Daedalus builds while the gods speak
+	if (!headless) printIntroduction();
+	if (!awaitMaze(generation)) {
+		return false;
+	}
+
+	// The seed is all a save or a replay needs to rebuild this exact maze later;
+	// everything after generation (Minotaur spawn and moves) keeps drawing from
+	// the same stream, so the key sequence alone reproduces the rest of the game
+	width = generation.getWidth();
+	height = generation.getHeight();
+	no_of_items = generation.getItemCount();
+	seed = generation.getSeed();
+	level_count = generation.getLevelCount();
+	matrix_generation_time = generation.getGenerationTime();
+	RNGEngine::setState(generation.getRngState());
+
+	if (level_count > 1) {
+		levels = generation.takeLevels();
+		matrix = levels->enter(0);
+	}
+	else {
+		matrix = generation.takeMatrix();
+	}
+	
+	robot_x = matrix->getEntranceX();
+	robot_y = 1;
+
+	pair<unsigned int, unsigned int> minotaurPosition = matrix->getRandomPassageForMinotaur(robot_x, minotaur_spawn_band);
+	minotaur_x = minotaurPosition.first;
+	minotaur_y = minotaurPosition.second;
+
+	presentNewGame();
+	return true;
+}
+
+// A maze that takes longer than the introduction shows how far along it is; Q gives up on it
+bool Gameplay::awaitMaze(BackgroundMaze& generation) {
+	if (headless || remote) {
+		return generation.wait();
+	}
+
+	bool shown = false;
+	while (!generation.ready()) {
+		out << "\r  Daedalus is still building... " << static_cast<int>(generation.progress() * 100) << "%  (Q to stop him)";
+		out.flush();
+		shown = true;
+		if (pollKeyPress(100) == 'q') {
+			generation.cancel();
+			break;
+		}
+	}
+	if (shown) {
+		out << "\r\x1B[2K";
+	}
+
+	if (!generation.wait()) {
+		out << "  Daedalus lays down his tools - the labyrinth will wait for another day.\n\n";
+		return false;
+	}
+	return true;
+}
+
+void Gameplay::initializeGame(unsigned int no_of_items, const DifficultyTarget& target) {
+	if (!headless) printIntroduction();
+
+	auto search_start = high_resolution_clock::now();
+	GeneratedMaze maze = DifficultySearch::find(width, height, no_of_items, target, minotaur_spawn_band);
+
+	// Pick up the winner's random stream where its worker left off, so the game
+	// plays out exactly as initializeGame(no_of_items, maze.seed) would
+	this->no_of_items = no_of_items;
+	seed = maze.seed;
+	matrix = maze.matrix;
+	matrix_generation_time = duration_cast<microseconds>(high_resolution_clock::now() - search_start);
+	RNGEngine::setState(maze.rngState);
+
+	robot_x = matrix->getEntranceX();
+	robot_y = 1;
+	minotaur_x = maze.minotaur.first;
+	minotaur_y = maze.minotaur.second;
+
+	presentNewGame();
+}
+
+void Gameplay::presentNewGame() {
+	if (headless) return;
+	MemoryScope scope(MemorySubsystem::RENDERING);
+
+	printDaedalusLegend();
+
+	matrix->printMatrix(robot_x, robot_y, minotaur_x, minotaur_y, out);
+
+	if (!remote) initial_console_size = getConsoleSize();
+	prepareMinimap();
+
+	drawFloorLabel();
+}
+
+void Gameplay::resumeGame(const SavedGame& saved) {
 	printWelcomeMessage();
 
+	no_of_items = saved.no_of_items;
+	seed = saved.seed;
+	RNGEngine::seed(seed);
+
 	matrix = new Matrix(width, height);
 	matrix_generation_time = matrix->generateMatrix(no_of_items);
-	
+	printDaedalusLegend();
+
+	// Bring the regenerated maze up to where the player left it
+	for (const FieldChange& change : saved.field_changes) {
+		matrix->setField(change.x, change.y, change.fieldType);
+	}
+
+	robot_x = saved.robot_x;
+	robot_y = saved.robot_y;
+	minotaur_x = saved.minotaur_x;
+	minotaur_y = saved.minotaur_y;
+	sword_rounds_left = saved.sword_rounds_left;
+	shield_rounds_left = saved.shield_rounds_left;
+	hammer_rounds_left = saved.hammer_rounds_left;
+	fog_of_war_rounds_left = saved.fog_of_war_rounds_left;
+	moves_made = saved.moves_made;
+	game_start_time = high_resolution_clock::now() - saved.game_duration;
+
+	// The rest of the game shouldn't be predictable from the maze seed
+	RNGEngine::seed(RNGEngine::generateSeed());
+
+	printHermesSpeech();
+	printHephaestusSpeech();
+
+	matrix->printMatrix(robot_x, robot_y, minotaur_x, minotaur_y, out);
+
+	if (!remote) initial_console_size = getConsoleSize();
+	prepareMinimap();
+
+	drawActiveEffects();
+}
+
+void Gameplay::initializeLoadedGame(Matrix* loadedMatrix, unsigned int no_of_items, microseconds load_time) {
+	printWelcomeMessage();
+
+	this->no_of_items = no_of_items;
+	hand_made = true;
+
+	matrix = loadedMatrix;
+	width = matrix->getWidth();
+	height = matrix->getHeight();
+	matrix_generation_time = load_time;
+
 	robot_x = matrix->getEntranceX();
 	robot_y = 1;
 
-	pair<unsigned int, unsigned int> minotaurPosition = matrix->getRandomPassageForMinotaur(robot_x);
+	pair<unsigned int, unsigned int> minotaurPosition = matrix->getRandomPassageForMinotaur(robot_x, minotaur_spawn_band);
 	minotaur_x = minotaurPosition.first;
 	minotaur_y = minotaurPosition.second;
 
-    printHermesSpeech();
-    printHephaestusSpeech();
+	printDaedalusLegend();
+	printHermesSpeech();
+	printHephaestusSpeech();
+
+	matrix->printMatrix(robot_x, robot_y, minotaur_x, minotaur_y, out);
 
-	matrix->printMatrix(robot_x, robot_y, minotaur_x, minotaur_y);
+	if (!remote) initial_console_size = getConsoleSize();
+	prepareMinimap();
+}
+
+void Gameplay::initializePooledGame(Matrix* pooledMatrix, unsigned int no_of_items, unsigned int seed, microseconds take_time) {
+	if (!headless) printIntroduction();
+
+	this->no_of_items = no_of_items;
+	this->seed = seed;
+	matrix = pooledMatrix;
+	matrix_generation_time = take_time;
+
+	// The pool keeps the maze, not where the generator's sequence ended after it
+	RNGEngine::seed(RNGEngine::generateSeed());
+
+	robot_x = matrix->getEntranceX();
+	robot_y = 1;
+
+	pair<unsigned int, unsigned int> minotaurPosition = matrix->getRandomPassageForMinotaur(robot_x, minotaur_spawn_band);
+	minotaur_x = minotaurPosition.first;
+	minotaur_y = minotaurPosition.second;
 
-	initial_console_size = getConsoleSize();
+	presentNewGame();
+}
+
+SavedGame Gameplay::createSavedGame() const {
+	SavedGame saved;
+	saved.seed = seed;
+	saved.width = width;
+	saved.height = height;
+	saved.no_of_items = no_of_items;
+	saved.robot_x = robot_x;
+	saved.robot_y = robot_y;
+	saved.minotaur_x = minotaur_x;
+	saved.minotaur_y = minotaur_y;
+	saved.sword_rounds_left = sword_rounds_left;
+	saved.shield_rounds_left = shield_rounds_left;
+	saved.hammer_rounds_left = hammer_rounds_left;
+	saved.fog_of_war_rounds_left = fog_of_war_rounds_left;
+	saved.moves_made = moves_made;
+	saved.game_duration = duration_cast<microseconds>(high_resolution_clock::now() - game_start_time);
+	saved.field_changes = matrix->getFieldChanges();
+	return saved;
 }
 
 pair<unsigned int, unsigned int> Gameplay::getMinotaurBounceCoordinates() {
@@ -157,6 +386,52 @@ bool Gameplay::minotaurAlive() const {
 	return minotaur_x != -1 && minotaur_y != -1;
 }
 
+// On the hero's floor and not still on the stairs
+bool Gameplay::minotaurHere() const {
+	return minotaurAlive() &&
+		(levels == nullptr || (minotaur_level == levels->getCurrentLevel() && minotaur_stairs_turns == 0));
+}
+
+bool Gameplay::takeStairs() {
+	FieldType stairs = matrix->getFieldType(robot_x, robot_y);
+	if (stairs != FieldType::STAIRS_UP && stairs != FieldType::STAIRS_DOWN) {
+		return false;
+	}
+
+	bool followed = minotaurHere() &&
+		abs((int)robot_x - (int)minotaur_x) + abs((int)robot_y - (int)minotaur_y) <= MINOTAUR_FOLLOW_DISTANCE;
+
+	// The hero arrives on the stairs leading back
+	unsigned int level = levels->getCurrentLevel();
+	level = stairs == FieldType::STAIRS_DOWN ? level + 1 : level - 1;
+	matrix = levels->enter(level);
+	robot_x = stairs == FieldType::STAIRS_DOWN ? levels->getUpX(level) : levels->getDownX(level);
+	robot_y = stairs == FieldType::STAIRS_DOWN ? 0 : height - 1;
+
+	if (followed) {
+		minotaur_level = level;
+		minotaur_stairs_turns = MINOTAUR_STAIRS_TURNS;
+		minotaur_x = robot_x;
+		minotaur_y = robot_y;
+	}
+
+	drawFloor();
+	return true;
+}
+
+// A Minotaur who followed the hero steps off the stairs when his turns are up,
+// unless the hero is still standing on them
+void Gameplay::minotaurLeavesStairs() {
+	if (minotaur_level != levels->getCurrentLevel()) return;
+
+	if (minotaur_stairs_turns > 1 || robot_x != minotaur_x || robot_y != minotaur_y) {
+		--minotaur_stairs_turns;
+	}
+	if (minotaur_stairs_turns == 0) {
+		updateMatrixCharacter(minotaur_x, minotaur_y, 'M');
+	}
+}
+
 void Gameplay::moveMinotaur(unsigned int prev_minotaur_x, unsigned int prev_minotaur_y) {
     unsigned int new_minotaur_x = minotaur_x;
     unsigned int new_minotaur_y = minotaur_y;
@@ -252,43 +527,58 @@ void Gameplay::moveMinotaur(unsigned int prev_minotaur_x, unsigned int prev_mino
     }
 }
 
-bool Gameplay::checkGameEndConditions() {
+void Gameplay::saveGameResult(GameResult result) const {
     auto game_end_time = high_resolution_clock::now();
     auto game_duration = duration_cast<microseconds>(game_end_time - game_start_time);
 
+    // A served game ends on a worker thread other sessions share, and a text report per
+    // game would pile up in the server's directory: it only gets the results log entry
+    if (!remote) {
+        fileHandler->saveGameResult(matrix, robot_x, robot_y, minotaur_x, minotaur_y,
+            result, game_duration, moves_made);
+    }
+    fileHandler->appendResultRecord(width, height, no_of_items, result, game_duration, moves_made, seed);
+}
+
+bool Gameplay::checkGameEndConditions() {
     // Check if robot reached exit
     if (matrix->getFieldType(robot_x, robot_y) == FieldType::EXIT) {
-        fileHandler->saveGameResult(matrix, robot_x, robot_y, minotaur_x, minotaur_y,
-            GameResult::VICTORY, game_duration, moves_made);
-
-
-        moveCursorToMatrixPosition(-3, robot_y + static_cast<unsigned int>(4), height, initial_console_size);
-        cout << "\x1B[38;2;255;215;0;46m" << "\n - Zeus, King of Olympus, thunders from above: \n" << ANSICodes::RESET;
-        cout << "\n\n   \"MAGNIFICENT, MORTAL! Your courage rivals that of the greatest heroes!\n";
-        cout << "    By my lightning bolt, you have conquered the labyrinth that has claimed countless souls!\n\n";
-        cout << "    The very stones of Knossos tremble before your triumph!\n";
-        cout << "    Even your Father, Poseidon, bows to your superior wit and valor!\n\n";
-        cout << "    Let it be known across all realms - from the depths of Hades to the heights of Olympus -\n";
-        cout << "    that THIS day, a true champion walked among us!\n\n";
-        cout << "\x1B[38;2;255;215;0;46m" << "    ==== THE HEAVENS REJOICE! ====    \n" << ANSICodes::RESET << "\n\n\n";
+        if (!replaying) {
+            saveGameResult(GameResult::VICTORY);
+        }
+
+        if (headless) return true;
+
+        moveCursorToMatrixPosition(-3, robot_y + static_cast<unsigned int>(4), height, initial_console_size, out);
+        out << "\x1B[38;2;255;215;0;46m" << "\n - Zeus, King of Olympus, thunders from above: \n" << ANSICodes::RESET;
+        out << "\n\n   \"MAGNIFICENT, MORTAL! Your courage rivals that of the greatest heroes!\n";
+        out << "    By my lightning bolt, you have conquered the labyrinth that has claimed countless souls!\n\n";
+        out << "    The very stones of Knossos tremble before your triumph!\n";
+        out << "    Even your Father, Poseidon, bows to your superior wit and valor!\n\n";
+        out << "    Let it be known across all realms - from the depths of Hades to the heights of Olympus -\n";
+        out << "    that THIS day, a true champion walked among us!\n\n";
+        out << "\x1B[38;2;255;215;0;46m" << "    ==== THE HEAVENS REJOICE! ====    \n" << ANSICodes::RESET << "\n\n\n";
         
         return true;
     }
 
     // Check if minotaur caught robot
-    if (robot_x == minotaur_x && robot_y == minotaur_y) {
-        fileHandler->saveGameResult(matrix, robot_x, robot_y, minotaur_x, minotaur_y,
-            GameResult::DEFEATED_BY_MINOTAUR, game_duration, moves_made);
-
-        moveCursorToMatrixPosition(-3, height + static_cast<unsigned int>(2), height, initial_console_size);
-        cout << "\x1B[38;2;0;151;255;47m" << "\n - Poseidon, Lord of the Seas, emerges from the depths: \n" << ANSICodes::RESET;
-        cout << "\n\n   \"My son... my brave Theseus...\n";
-        cout << "    I have watched your journey through these cursed halls with great pride.\n\n";
-        cout << "    Though your mechanical companion has fallen, your courage burns brighter\n";
-        cout << "    than the fire of Olympus itself!\n\n";
-        cout << "    Do not let this defeat *tide* you over with despair - I shall craft you\n";
-        cout << "    a new ally from the depths of my ocean forge!\n\n";
-        cout << "    Rise again, my child. The sea never yields to any beast!\"\n\n\n";
+    if (minotaurHere() && robot_x == minotaur_x && robot_y == minotaur_y) {
+        if (!replaying) {
+            saveGameResult(GameResult::DEFEATED_BY_MINOTAUR);
+        }
+
+        if (headless) return true;
+
+        moveCursorToMatrixPosition(-3, height + static_cast<unsigned int>(2), height, initial_console_size, out);
+        out << "\x1B[38;2;0;151;255;47m" << "\n - Poseidon, Lord of the Seas, emerges from the depths: \n" << ANSICodes::RESET;
+        out << "\n\n   \"My son... my brave Theseus...\n";
+        out << "    I have watched your journey through these cursed halls with great pride.\n\n";
+        out << "    Though your mechanical companion has fallen, your courage burns brighter\n";
+        out << "    than the fire of Olympus itself!\n\n";
+        out << "    Do not let this defeat *tide* you over with despair - I shall craft you\n";
+        out << "    a new ally from the depths of my ocean forge!\n\n";
+        out << "    Rise again, my child. The sea never yields to any beast!\"\n\n\n";
 
         return true;
     }
@@ -297,26 +587,28 @@ bool Gameplay::checkGameEndConditions() {
 }
 
 void Gameplay::fillEffectHearts(unsigned int y, unsigned int no_of_hearts) {
-    moveCursorToMatrixPosition(3 + width + 20, y, height, initial_console_size);
+    if (headless) return;
+
+    moveCursorToMatrixPosition(3 + width + 20, y, height, initial_console_size, out);
 
     for (unsigned int i = 0; i < 3; ++i) {
         if (i < no_of_hearts) {
-            cout << "\x1B[41;36m" << "0" << ANSICodes::RESET;
+            out << "\x1B[41;36m" << "0" << ANSICodes::RESET;
         }
         else {
-            cout << "\x1B[31m" << "0" << ANSICodes::RESET;
+            out << "\x1B[31m" << "0" << ANSICodes::RESET;
         }
         if (i < 2) {
-            cout << " ";
+            out << " ";
         }
     }
 
-    cout.flush();
+    out.flush();
 
-    moveCursorToMatrixPosition(3 + width + 3, y, height, initial_console_size);
-    if (no_of_hearts > 0) cout << "\x1B[5;36m" << "o" << ANSICodes::RESET;
-	else cout << ANSICodes::RESET << "o" << ANSICodes::RESET;
-	cout.flush();
+    moveCursorToMatrixPosition(3 + width + 3, y, height, initial_console_size, out);
+    if (no_of_hearts > 0) out << "\x1B[5;36m" << "o" << ANSICodes::RESET;
+	else out << ANSICodes::RESET << "o" << ANSICodes::RESET;
+	out.flush();
 }
 
 void Gameplay::recalculateEffects() {
@@ -334,7 +626,7 @@ void Gameplay::recalculateEffects() {
     }
     if (fog_of_war_rounds_left > 0) {
         --fog_of_war_rounds_left;
-		if (fog_of_war_rounds_left == 0) {
+		if (fog_of_war_rounds_left == 0 && view_radius == 0) {
 			redrawMatrixAfterFog();
 		}
         fillEffectHearts(7, fog_of_war_rounds_left);
@@ -356,113 +648,159 @@ void Gameplay::activateEffect(ItemType itemType) {
 		hammer_rounds_left = 4;
 		fillEffectHearts(5, hammer_rounds_left);
         break;
-    case ItemType::FOG_OF_WAR:
+    case ItemType::FOG_OF_WAR: {
+		bool fullView = !viewLimited();
 		fog_of_war_rounds_left = 4;
 		fillEffectHearts(7, fog_of_war_rounds_left);
+		if (fullView) {
+			drawView();
+		}
         break;
     }
+    }
 }
 
 void Gameplay::ariadneCongratulates() const {
-    moveCursorToMatrixPosition(3 + width + 32, 0, height, initial_console_size);
-    cout << "\x1B[35;47m" << " - Ariadne, Princess of Crete, emerges from the shadows: " << ANSICodes::RESET;
-    moveCursorToMatrixPosition(3 + width + 32, 2, height, initial_console_size);
-    cout << "  \"Theseus! My heart soars like a dove freed from its cage!\n";
-    moveCursorToMatrixPosition(3 + width + 32, 3, height, initial_console_size);
-    cout << "   You have done what no hero before you could accomplish -\n";
-    moveCursorToMatrixPosition(3 + width + 32, 4, height, initial_console_size);
-    cout << "   you've slain the beast that has haunted my father's kingdom!\n\n";
-    moveCursorToMatrixPosition(3 + width + 32, 5, height, initial_console_size);
-    cout << "   Here, take this golden thread as a token of my gratitude.\n";
-    moveCursorToMatrixPosition(3 + width + 32, 6, height, initial_console_size);
-    cout << "   It shall guide you safely to the exit, for I know every\n";
-    moveCursorToMatrixPosition(3 + width + 32, 7, height, initial_console_size);
-    cout << "   secret passage of this labyrinth by heart.\n\n";
-    moveCursorToMatrixPosition(3 + width + 32, 8, height, initial_console_size);
-    cout << "   But still... there is something far more precious -\n";
-    moveCursorToMatrixPosition(3 + width + 32, 9, height, initial_console_size);
-    cout << "   the love of one who has waited long for a true hero!\"\n\n";
-
-    moveCursorToMatrixPosition(3 + width + 32, 11, height, initial_console_size);
-    cout << "\x1B[38;2;255;215;0m" << " -----<3----<3----<3----<3----<3----<3----<3----<3\n" << ANSICodes::RESET;
+    if (headless) return;
+
+    moveCursorToMatrixPosition(3 + width + 32, 0, height, initial_console_size, out);
+    out << "\x1B[35;47m" << " - Ariadne, Princess of Crete, emerges from the shadows: " << ANSICodes::RESET;
+    moveCursorToMatrixPosition(3 + width + 32, 2, height, initial_console_size, out);
+    out << "  \"Theseus! My heart soars like a dove freed from its cage!\n";
+    moveCursorToMatrixPosition(3 + width + 32, 3, height, initial_console_size, out);
+    out << "   You have done what no hero before you could accomplish -\n";
+    moveCursorToMatrixPosition(3 + width + 32, 4, height, initial_console_size, out);
+    out << "   you've slain the beast that has haunted my father's kingdom!\n\n";
+    moveCursorToMatrixPosition(3 + width + 32, 5, height, initial_console_size, out);
+    out << "   Here, take this golden thread as a token of my gratitude.\n";
+    moveCursorToMatrixPosition(3 + width + 32, 6, height, initial_console_size, out);
+    out << "   It shall guide you safely to the exit, for I know every\n";
+    moveCursorToMatrixPosition(3 + width + 32, 7, height, initial_console_size, out);
+    out << "   secret passage of this labyrinth by heart.\n\n";
+    moveCursorToMatrixPosition(3 + width + 32, 8, height, initial_console_size, out);
+    out << "   But still... there is something far more precious -\n";
+    moveCursorToMatrixPosition(3 + width + 32, 9, height, initial_console_size, out);
+    out << "   the love of one who has waited long for a true hero!\"\n\n";
+
+    moveCursorToMatrixPosition(3 + width + 32, 11, height, initial_console_size, out);
+    out << "\x1B[38;2;255;215;0m" << " -----<3----<3----<3----<3----<3----<3----<3----<3\n" << ANSICodes::RESET;
     positionCursorAtRobot();
 }
 
-void Gameplay::drawFog() const {
-    if (fog_of_war_rounds_left > 0) {
-		moveCursorToMatrixPosition(0, 0, height, initial_console_size);
-        for (int i = 0; i < height; i++) {
-            if (abs((int)i - (int)robot_y) <= 1) {
-                for (int j = 0; j < width; j++) {
-                    if (abs((int)j - (int)robot_x) > 1) {
-                        int rnum = RNGEngine::getRandomNumber(1, 15);
-                        char symbol = rnum == 1 ? '#' : ' ';
-                        rnum = RNGEngine::getRandomNumber(1, 2);
-                        if (rnum % 2 == 0) {
-                            cout << "\x1B[5;34;48;5;248m" << symbol << ANSICodes::RESET;
-                        }
-                        else {
-                            cout << "\x1B[5;35;48;5;248m" << symbol << ANSICodes::RESET;
-                        }
-                    }
-					else {
-						char symbol = matrix->getField(j, i)->getSymbol();
-						if (robot_x == j && robot_y == i) {
-							symbol = 'R';
-						}
-						else if (minotaur_x == j && minotaur_y == i) {
-							symbol = 'M';
-						}
-                        printMatrixCharacter(symbol);
-					}
-                }
-                moveCursorToMatrixPosition(0, i+1, height, initial_console_size);
-                continue;
-            }
-            for (int j = 0; j < width; j++) {
-				int rnum = RNGEngine::getRandomNumber(1, 15);
-				char symbol = rnum == 1 ? '#' : ' ';
-				rnum = RNGEngine::getRandomNumber(1, 2);
-                if (rnum % 2 == 0) {
-                    cout << "\x1B[5;35;48;5;248m" << symbol << ANSICodes::RESET;
-                }
-                else {
-                    cout << "\x1B[5;34;48;5;248m" << symbol << ANSICodes::RESET;
-                }
-            }
-            cout << "\n  ";
+bool Gameplay::viewLimited() const {
+    return view_radius > 0 || fog_of_war_rounds_left > 0;
+}
+
+// Draws at the cursor whatever the hero knows of the cell: the cell itself if it
+// can be seen, a dimmed memory of it in exploration mode, otherwise fog
+void Gameplay::drawCell(unsigned int x, unsigned int y) const {
+    if (!viewLimited() || fieldOfView->isVisible(x, y)) {
+        char symbol = matrix->getField(x, y)->getSymbol();
+        if (robot_x == x && robot_y == y) {
+            symbol = 'R';
         }
-        
-        cout.flush();
+        else if (minotaurHere() && minotaur_x == x && minotaur_y == y) {
+            symbol = 'M';
+        }
+        printMatrixCharacter(symbol);
+    }
+    else if (view_radius > 0 && fieldOfView->isExplored(x, y)) {
+        char symbol = matrix->getField(x, y)->getSymbol();
+        if (symbol == '#') {
+            out << ANSICodes::REMEMBERED_WALL_STYLE << '#' << ANSICodes::RESET;
+        }
+        else {
+            out << ANSICodes::REMEMBERED_STYLE << symbol << ANSICodes::RESET;
+        }
+    }
+    else {
+        int rnum = RNGEngine::getCosmeticRandomNumber(1, 15);
+        char symbol = rnum == 1 ? '#' : ' ';
+        rnum = RNGEngine::getCosmeticRandomNumber(1, 2);
+        if (rnum % 2 == 0) {
+            out << "\x1B[5;34;48;5;248m" << symbol << ANSICodes::RESET;
+        }
+        else {
+            out << "\x1B[5;35;48;5;248m" << symbol << ANSICodes::RESET;
+        }
+    }
+}
 
-        positionCursorAtRobot();
+// Whole-screen redraw of the limited view; only needed when the view first
+// closes in or the screen was wiped - turns go through updateVisibility
+void Gameplay::drawView() {
+    if (headless) return;
+    MemoryScope scope(MemorySubsystem::RENDERING);
+
+    if (fieldOfView == nullptr) {
+        fieldOfView = new FieldOfView(width, height);
+    }
+    vector<pair<unsigned int, unsigned int>> entered, left;
+    fieldOfView->update(*matrix, robot_x, robot_y, fog_of_war_rounds_left > 0 ? 1 : view_radius, entered, left);
+
+    for (unsigned int y = 0; y < height; y++) {
+        moveCursorToMatrixPosition(0, y, height, initial_console_size, out);
+        for (unsigned int x = 0; x < width; x++) {
+            drawCell(x, y);
+        }
+    }
+
+    out.flush();
+
+    positionCursorAtRobot();
+}
+
+void Gameplay::updateVisibility() {
+    if (headless || !viewLimited()) return;
+
+    // The Fog of War closes the view in to the neighbouring cells
+    vector<pair<unsigned int, unsigned int>> entered, left;
+    fieldOfView->update(*matrix, robot_x, robot_y, fog_of_war_rounds_left > 0 ? 1 : view_radius, entered, left);
+
+    for (const auto& cell : entered) {
+        moveCursorToMatrixPosition(cell.first, cell.second, height, initial_console_size, out);
+        drawCell(cell.first, cell.second);
+    }
+    for (const auto& cell : left) {
+        moveCursorToMatrixPosition(cell.first, cell.second, height, initial_console_size, out);
+        drawCell(cell.first, cell.second);
     }
+
+    out.flush();
+
+    positionCursorAtRobot();
 }
 
 void Gameplay::redrawMatrixAfterFog() const {
+    if (headless) return;
+    MemoryScope scope(MemorySubsystem::RENDERING);
+
     if (fog_of_war_rounds_left == 0) {
-        moveCursorToMatrixPosition(0, 0, height, initial_console_size);
+        moveCursorToMatrixPosition(0, 0, height, initial_console_size, out);
         for (int i = 0; i < height; i++) {
                 for (int j = 0; j < width; j++) {
                     char symbol = matrix->getField(j, i)->getSymbol();
                     if (robot_x == j && robot_y == i) {
                         symbol = 'R';
                     }
-                    else if (minotaur_x == j && minotaur_y == i) {
+                    else if (minotaurHere() && minotaur_x == j && minotaur_y == i) {
                         symbol = 'M';
                     }
                     printMatrixCharacter(symbol);
                 }
-            cout << "\n  ";
+            out << "\n  ";
         }
 
-        cout.flush();
+        out.flush();
 
         positionCursorAtRobot();
     }
 }
 
 void Gameplay::drawBrittleWalls() const {
+    if (headless) return;
+    MemoryScope scope(MemorySubsystem::RENDERING);
+
     for (int dx = -1; dx <= 1; dx++) {
         for (int dy = -1; dy <= 1; dy++) {
             int x = robot_x + dx;
@@ -472,9 +810,9 @@ void Gameplay::drawBrittleWalls() const {
                 matrix->getFieldType(x, y) == FieldType::WALL &&
                 !matrix->isBoundaryOrOutside(x, y)) {
 
-                moveCursorToMatrixPosition(x, y, height, initial_console_size);
-                cout << "\x1B[5m#" << ANSICodes::RESET;
-				cout.flush();
+                moveCursorToMatrixPosition(x, y, height, initial_console_size, out);
+                out << "\x1B[5m#" << ANSICodes::RESET;
+				out.flush();
             }
         }
     }
@@ -482,6 +820,9 @@ void Gameplay::drawBrittleWalls() const {
 }
 
 void Gameplay::redrawWallsNormally(unsigned int prev_robot_x, unsigned int prev_robot_y) const {
+    if (headless) return;
+    MemoryScope scope(MemorySubsystem::RENDERING);
+
     for (int dx = -1; dx <= 1; dx++) {
         for (int dy = -1; dy <= 1; dy++) {
             int x = prev_robot_x + dx;
@@ -491,9 +832,9 @@ void Gameplay::redrawWallsNormally(unsigned int prev_robot_x, unsigned int prev_
                 matrix->getFieldType(x, y) == FieldType::WALL &&
                 !matrix->isBoundaryOrOutside(x, y)) {
 
-                moveCursorToMatrixPosition(x, y, height, initial_console_size);
-                cout << ANSICodes::WALL_STYLE << '#' << ANSICodes::RESET;
-                cout.flush();
+                moveCursorToMatrixPosition(x, y, height, initial_console_size, out);
+                out << ANSICodes::WALL_STYLE << '#' << ANSICodes::RESET;
+                out.flush();
             }
         }
     }
@@ -501,10 +842,17 @@ void Gameplay::redrawWallsNormally(unsigned int prev_robot_x, unsigned int prev_
 }
 
 void Gameplay::refreshDisplay() {
+    if (headless) return;
+    MemoryScope scope(MemorySubsystem::RENDERING);
 
-    initial_console_size = getConsoleSize();
 
-    clearScreen();
+    if (remote) {
+        out << "\033[2J\033[H";
+    }
+    else {
+        initial_console_size = getConsoleSize();
+        clearScreen();
+    }
 
 	printWelcomeMessage();
     printDaedalusLegend();
@@ -512,8 +860,139 @@ void Gameplay::refreshDisplay() {
 	printHephaestusSpeech();
 
     // Redraw the entire game state
-    matrix->printMatrix(robot_x, robot_y, minotaur_x, minotaur_y);
+    matrix->printMatrix(robot_x, robot_y, minotaurHere() ? minotaur_x : -1, minotaurHere() ? minotaur_y : -1, out);
+
+    drawActiveEffects();
+}
 
+// Taking the stairs redraws the maze area only; the legends around it stay
+void Gameplay::drawFloor() {
+    // What the hero saw on the floor left behind doesn't apply here
+    delete fieldOfView;
+    fieldOfView = nullptr;
+    delete minimap;
+    minimap = nullptr;
+
+    if (headless) return;
+
+    if (viewLimited()) {
+        drawView();
+    }
+    else {
+        drawMazeRows();
+    }
+    drawFloorLabel();
+    prepareMinimap();
+
+    out.flush();
+
+    positionCursorAtRobot();
+}
+
+// The maze in full view, one cursor move per row
+void Gameplay::drawMazeRows() {
+    for (unsigned int y = 0; y < height; y++) {
+        moveCursorToMatrixPosition(0, y, height, initial_console_size, out);
+        for (unsigned int x = 0; x < width; x++) {
+            drawCell(x, y);
+        }
+    }
+}
+
+// The terminal changed size. The maze is anchored to the bottom of the screen, so
+// everything on it moves: wipe what's visible and draw the maze and the effects
+// beside it at their new places. The speeches above are left to the scrollback
+void Gameplay::relayout() {
+    if (headless || remote) return;
+    MemoryScope scope(MemorySubsystem::RENDERING);
+
+    initial_console_size = getConsoleSize();
+    if (minimap_shown) {
+        relayout_pending = true;
+        drawMinimap();
+        return;
+    }
+    out << "\033[?25l\033[H\033[2J";
+
+    if (!viewLimited()) {
+        drawMazeRows();
+    }
+    drawActiveEffects();
+
+    positionCursorAtRobot();
+    out << "\033[?25h";
+    out.flush();
+}
+
+// Built with the floor, a fraction of what printing it costs, so the first M only draws
+void Gameplay::prepareMinimap() {
+    if (headless || minimap != nullptr) return;
+    MemoryScope scope(MemorySubsystem::RENDERING);
+
+    minimap = new Minimap(*matrix);
+}
+
+// M opens the overview on the alternate screen, so the maze below stays exactly as
+// it was; a second M switches to half blocks (for fonts without braille), a third
+// closes it
+void Gameplay::cycleMinimap() {
+    if (headless) return;
+
+    if (!minimap_shown) {
+        minimap_style = Minimap::Style::BRAILLE;
+        minimap_shown = true;
+        out << "\033[?1049h\033[?25l";
+        drawMinimap();
+    }
+    else if (minimap_style == Minimap::Style::BRAILLE) {
+        minimap_style = Minimap::Style::HALF_BLOCK;
+        drawMinimap();
+    }
+    else {
+        closeMinimap();
+    }
+}
+
+void Gameplay::drawMinimap() {
+    if (minimap == nullptr) {
+        minimap = new Minimap(*matrix);
+    }
+
+    Minimap::Marks marks;
+    marks.robot_x = robot_x;
+    marks.robot_y = robot_y;
+    marks.minotaur = minotaurHere() && (!viewLimited() || fieldOfView->isVisible(minotaur_x, minotaur_y));
+    marks.minotaur_x = minotaur_x;
+    marks.minotaur_y = minotaur_y;
+
+    // In the dark, only what the hero has seen so far
+    const Bitboard* explored = viewLimited() && fieldOfView != nullptr ? &fieldOfView->getExplored() : nullptr;
+    minimap->draw(out, remote ? initial_console_size : getConsoleSize(), minimap_style, marks, explored);
+}
+
+void Gameplay::closeMinimap() {
+    if (!minimap_shown) return;
+
+    minimap_shown = false;
+    out << "\033[?1049l\033[?25h";
+    if (relayout_pending) {
+        relayout_pending = false;
+        relayout();
+    }
+    out.flush();
+}
+
+void Gameplay::drawFloorLabel() {
+    if (headless || levels == nullptr) return;
+
+    unsigned int floor = levels->getCurrentLevel() + 1;
+    moveCursorToMatrixPosition(3 + width + 3, 9, height, initial_console_size, out);
+    out << ANSICodes::STAIRS_STYLE << "Floor " << floor << " of " << levels->getLevelCount() << ANSICodes::RESET
+        << (floor == levels->getLevelCount() ? " - the exit is here  " : " - '>' leads down   ");
+    out.flush();
+}
+
+void Gameplay::drawActiveEffects() {
     // Redraw all effect hearts with current values
     fillEffectHearts(1, sword_rounds_left);
     fillEffectHearts(3, shield_rounds_left);
@@ -521,167 +1000,333 @@ void Gameplay::refreshDisplay() {
     fillEffectHearts(7, fog_of_war_rounds_left);
 
     // Apply current visual effects if active
-    if (fog_of_war_rounds_left > 0) {
-        drawFog();
+    if (viewLimited()) {
+        drawView();
     }
     if (hammer_rounds_left > 0) {
         drawBrittleWalls();
     }
+    drawFloorLabel();
 
     // Position cursor at robot
     positionCursorAtRobot();
-    cout.flush();
+    out.flush();
 }
 
-void Gameplay::startGameLoop() {
-    bool gameRunning = true;
-	bool gaveUpWithQ = false;
-
-    hideCursor();
+bool Gameplay::processTurn(char input) {
+    bool robotMoved = false;
+    unsigned int new_robot_x = robot_x;
+    unsigned int new_robot_y = robot_y;
 
-    // Store previous positions to clear old characters
-    unsigned int prev_robot_x = robot_x;
-    unsigned int prev_robot_y = robot_y;
-    unsigned int prev_minotaur_x = minotaur_x;
-    unsigned int prev_minotaur_y = minotaur_y;
+    // Any other key goes back to the maze first, then does what it always does
+    if (input != 'm') {
+        closeMinimap();
+    }
 
-    // Position cursor at robot initially and show it
-    positionCursorAtRobot();
-	showCursor();
+    switch (input) {
+    case 'm':
+        // Nothing on the maze changes, and nothing may be drawn over the overview
+        cycleMinimap();
+        return true;
+    case 'w':
+        if (robot_y > 0 && (matrix->getField(robot_x, robot_y - 1)->isWalkable() || hammer_rounds_left > 0)) {
+            new_robot_y = robot_y - 1;
+            robotMoved = true;
+        }
+        break;
+    case 's': 
+        if (robot_y < height - 1 && (matrix->getField(robot_x, robot_y + 1)->isWalkable() || hammer_rounds_left > 0)) {
+            new_robot_y = robot_y + 1;
+            robotMoved = true;
+        }
+        break;
+    case 'a': 
+        if (robot_x > 0 && (matrix->getField(robot_x - 1, robot_y)->isWalkable() || hammer_rounds_left > 0)) {
+            new_robot_x = robot_x - 1;
+            robotMoved = true;
+        }
+        break;
+    case 'd': 
+        if (robot_x < width - 1 && (matrix->getField(robot_x + 1, robot_y)->isWalkable() || hammer_rounds_left > 0)) {
+            new_robot_x = robot_x + 1;
+            robotMoved = true;
+        }
+        break;
+    case 'e':
+        refreshDisplay();
+        break;
+    case 'q': {
+        if (!replaying) {
+            saveGameResult(GameResult::FORFEITED);
+
+            // A forfeited game can be picked up again later with --resume (saves rebuild
+            // a single maze from its seed, which a hand-made maze doesn't have); not by a
+            // remote player, whose save would land on the server
+            if (!hand_made && levels == nullptr && !remote) {
+                fileHandler->saveGame(createSavedGame(), save_filename);
+            }
+        }
+        return false;
+    }
+    }
 
-    bool robotMoved = false;
+    if (robotMoved) {
+        moves_made++;
 
-    while (gameRunning) {
-		if (robotMoved) recalculateEffects();
-		if (robotMoved && fog_of_war_rounds_left > 0) {
-            drawFog();
-		}
-		if (hammer_rounds_left > 0) {
-			drawBrittleWalls();
-		}
+        unsigned int prev_robot_x = robot_x;
+        unsigned int prev_robot_y = robot_y;
 
-        // Get valid input - this will ONLY return w, a, s, d, or q
-        // Invalid keys are silently ignored
-        char input = getValidKeyPress();
+        // Clear robot's old position (restore underlying field symbol)
+        MatrixField* oldField = matrix->getField(prev_robot_x, prev_robot_y);
+        updateMatrixCharacter(prev_robot_x, prev_robot_y, oldField->getSymbol());
 
-        // Hide cursor during updates
-        cout << "\033[?25l";
+        // Update robot position
+        robot_x = new_robot_x;
+        robot_y = new_robot_y;
 
-        // Handle user input
-        robotMoved = false;
-        unsigned int new_robot_x = robot_x;
-        unsigned int new_robot_y = robot_y;
+        // Check if robot stepped on an item
+        if (matrix->getFieldType(robot_x, robot_y) == FieldType::ITEM) {
+            MatrixField* field = matrix->getField(robot_x, robot_y);
+            Item* item = dynamic_cast<Item*>(field);
 
-        switch (input) {
-        case 'w':
-            if (robot_y > 0 && (matrix->getField(robot_x, robot_y - 1)->isWalkable() || hammer_rounds_left > 0)) {
-                new_robot_y = robot_y - 1;
-                robotMoved = true;
-            }
-            break;
-        case 's': 
-            if (robot_y < height - 1 && (matrix->getField(robot_x, robot_y + 1)->isWalkable() || hammer_rounds_left > 0)) {
-                new_robot_y = robot_y + 1;
-                robotMoved = true;
+            if (item != nullptr) {
+                activateEffect(item->getItemType());
+                matrix->setField(robot_x, robot_y, FieldType::PASSAGE);
             }
-            break;
-        case 'a': 
-            if (robot_x > 0 && (matrix->getField(robot_x - 1, robot_y)->isWalkable() || hammer_rounds_left > 0)) {
-                new_robot_x = robot_x - 1;
-                robotMoved = true;
-            }
-            break;
-        case 'd': 
-            if (robot_x < width - 1 && (matrix->getField(robot_x + 1, robot_y)->isWalkable() || hammer_rounds_left > 0)) {
-                new_robot_x = robot_x + 1;
-                robotMoved = true;
-            }
-            break;
-		case 'e':
-            refreshDisplay();
-			continue; 
-        case 'q': 
-            gameRunning = false;
-			gaveUpWithQ = true;
+        }
 
-            auto game_end_time = high_resolution_clock::now();
-            auto game_duration = duration_cast<microseconds>(game_end_time - game_start_time);
+        // If robot stepped on a brittle wall, destroy it
+        if (hammer_rounds_left > 0 && matrix->getFieldType(robot_x, robot_y) == FieldType::WALL) {
+            matrix->setField(robot_x, robot_y, FieldType::PASSAGE);
+        }
 
-            fileHandler->saveGameResult(matrix, robot_x, robot_y, minotaur_x, minotaur_y,
-                GameResult::FORFEITED, game_duration, moves_made);
+        // Stairs take the robot to another floor, drawn in place of this one
+        if (levels == nullptr || !takeStairs()) {
+            // Draw robot at new position
+            updateMatrixCharacter(robot_x, robot_y, 'R');
 
-            continue;
+            if (hammer_rounds_left > 0) {
+                redrawWallsNormally(prev_robot_x, prev_robot_y);
+            }
         }
 
-        if (robotMoved) {
-            moves_made++;
+        if (minotaurHere()) {
+            // Now handle Minotaur movement
+            moveMinotaur(minotaur_x, minotaur_y);
+        }
+        else if (minotaur_stairs_turns > 0) {
+            minotaurLeavesStairs();
+        }
 
-            // Clear robot's old position (restore underlying field symbol)
-            MatrixField* oldField = matrix->getField(prev_robot_x, prev_robot_y);
-            updateMatrixCharacter(prev_robot_x, prev_robot_y, oldField->getSymbol());
+        // Check for game end conditions
+        if (checkGameEndConditions()) {
+            return false;
+        }
 
-            // Update robot position
-            robot_x = new_robot_x;
-            robot_y = new_robot_y;
+        recalculateEffects();
+        updateVisibility();
+    }
 
-			// Check if robot stepped on an item
-			if (matrix->getFieldType(robot_x, robot_y) == FieldType::ITEM) {
-                MatrixField* field = matrix->getField(robot_x, robot_y);
-                Item* item = dynamic_cast<Item*>(field);
+    if (hammer_rounds_left > 0) {
+        drawBrittleWalls();
+    }
 
-                if (item != nullptr) {
-                    activateEffect(item->getItemType());
-					matrix->setField(robot_x, robot_y, FieldType::PASSAGE);
-                }
-			}
+    return true;
+}
 
-			// If robot stepped on a brittle wall, destroy it
-			if (hammer_rounds_left > 0 && matrix->getFieldType(robot_x, robot_y) == FieldType::WALL) {
-				matrix->setField(robot_x, robot_y, FieldType::PASSAGE);
-			}
+uint32_t Gameplay::computeStateChecksum() const {
+    // FNV-1a over everything a turn can change; O(1), so it's cheap enough for every key
+    uint32_t hash = 2166136261u;
+    const unsigned int state[] = {
+        robot_x, robot_y, minotaur_x, minotaur_y,
+        sword_rounds_left, shield_rounds_left, hammer_rounds_left, fog_of_war_rounds_left,
+        moves_made, static_cast<unsigned int>(matrix->getFieldChanges().size())
+    };
+
+    for (unsigned int value : state) {
+        for (int shift = 0; shift < 32; shift += 8) {
+            hash ^= (value >> shift) & 0xFF;
+            hash *= 16777619u;
+        }
+    }
+    return hash;
+}
 
-            // Draw robot at new position
-            updateMatrixCharacter(robot_x, robot_y, 'R');
+bool Gameplay::recordReplay(const std::string& filename) {
+    replayLog = new ReplayLog();
+    if (!replayLog->open(filename, seed, width, height, no_of_items, minotaur_spawn_band)) {
+        delete replayLog;
+        replayLog = nullptr;
+        return false;
+    }
+    return true;
+}
 
-            if (hammer_rounds_left > 0) {
-                redrawWallsNormally(prev_robot_x, prev_robot_y);
-            }
+bool Gameplay::runReplay(const Replay& replay, bool render, unsigned int moves_per_second) {
+    headless = !render;
+    replaying = true;
+    minotaur_spawn_band = replay.minotaur_band;
 
-            // Store current positions as previous for next iteration
-            prev_robot_x = robot_x;
-            prev_robot_y = robot_y;
+    if (!initializeGame(replay.no_of_items, replay.seed)) {
+        return false;
+    }
 
-            if (minotaurAlive()) {
-                // Now handle Minotaur movement
-                moveMinotaur(prev_minotaur_x, prev_minotaur_y);
-                prev_minotaur_x = minotaur_x;
-                prev_minotaur_y = minotaur_y;
-            }
+    if (!headless) {
+        positionCursorAtRobot();
+        showCursor(out);
+    }
 
-            // Check for game end conditions
-            if (checkGameEndConditions()) {
-                gameRunning = false;
-                continue;
-            }
+    microseconds total_turn_time = microseconds::zero();
+    microseconds slowest_turn_time = microseconds::zero();
+    auto turn_delay = microseconds(1000000 / (moves_per_second > 0 ? moves_per_second : 1));
+    bool gameRunning = true;
+    size_t turnsPlayed = 0;
+
+    for (const ReplayTurn& turn : replay.turns) {
+        if (!gameRunning) {
+            cerr << "Replay diverged: the game ended after " << turnsPlayed << " of "
+                << replay.turns.size() << " recorded turns\n";
+            return false;
+        }
+
+        auto turn_start = high_resolution_clock::now();
+        gameRunning = processTurn(turn.key);
+        auto turn_time = duration_cast<microseconds>(high_resolution_clock::now() - turn_start);
+
+        total_turn_time += turn_time;
+        if (turn_time > slowest_turn_time) slowest_turn_time = turn_time;
+        ++turnsPlayed;
+
+        uint32_t checksum = computeStateChecksum();
+        if (checksum != turn.checksum) {
+            cerr << "Replay diverged at turn " << turnsPlayed << " (key '" << turn.key << "'): expected state checksum "
+                << turn.checksum << ", got " << checksum << "\n";
+            return false;
+        }
+
+        if (!headless) {
+            positionCursorAtRobot();
+            std::this_thread::sleep_for(turn_delay);
         }
+    }
+
+    if (!headless) {
+        moveCursorToMatrixPosition(-3, height + static_cast<unsigned int>(2), height, initial_console_size, out);
+    }
+
+    out << "\nReplay verified: " << turnsPlayed << " turns on a " << width << "x" << height << " maze (seed " << seed << ")"
+        << (gameRunning ? ", game still in progress at the end of the log" : "") << "\n";
+    out << "  total turn time: " << total_turn_time.count() << " us, average: "
+        << (turnsPlayed > 0 ? total_turn_time.count() / static_cast<long long>(turnsPlayed) : 0)
+        << " us, slowest: " << slowest_turn_time.count() << " us\n";
 
+    return true;
+}
+
+void Gameplay::attachRemoteTerminal(pair<int, int> console_size) {
+    remote = true;
+    initial_console_size = console_size;
+}
+
+void Gameplay::setMinotaurSpawnBand(SpawnBand band) {
+	minotaur_spawn_band = band;
+}
+
+void Gameplay::setViewRadius(unsigned int radius) {
+	view_radius = radius;
+}
+
+void Gameplay::setLevelCount(unsigned int count) {
+	level_count = count;
+}
+
+bool Gameplay::heroEscaped() const {
+	return matrix != nullptr && matrix->getFieldType(robot_x, robot_y) == FieldType::EXIT;
+}
+
+void Gameplay::beginTurns() {
+    hideCursor(out);
+
+    // A resumed game has drawn its view already
+    if (view_radius > 0 && fieldOfView == nullptr) {
+        drawView();
+    }
+
+    // Position cursor at robot initially and show it
+    positionCursorAtRobot();
+	showCursor(out);
+
+    if (hammer_rounds_left > 0) {
+        drawBrittleWalls();
+    }
+}
+
+void Gameplay::renderKeyframe() {
+    refreshDisplay();
+    out << "\033[?25h";
+    out.flush();
+}
+
+bool Gameplay::playTurn(char input) {
+    MemoryScope scope(MemorySubsystem::TURN);
+
+    // Hide cursor during updates
+    out << "\033[?25l";
+
+    bool gameRunning = processTurn(input);
+
+    if (replayLog != nullptr) {
+        replayLog->recordTurn(input, computeStateChecksum());
+    }
+
+    if (gameRunning && !minimap_shown) {
         // Position cursor at robot and show it for next input
         positionCursorAtRobot();
-        cout << "\033[?25h";
+        out << "\033[?25h";
+    }
+    return gameRunning;
+}
+
+void Gameplay::startGameLoop() {
+    bool gameRunning = true;
+    char input = 0;
+
+    beginTurns();
+    watchTerminalResizes();
+
+    while (gameRunning) {
+        // Get valid input - this will ONLY return w, a, s, d, e, m or q, or RESIZE_EVENT
+        // Invalid keys are silently ignored
+        input = getValidKeyPress();
+        if (input == RESIZE_EVENT) {
+            relayout();
+            continue;
+        }
+        gameRunning = playTurn(input);
     }
 
+    finishGame(input);
+}
+
+void Gameplay::finishGame(char last_input) {
+	bool gaveUpWithQ = (last_input == 'q');
+
 	if (gaveUpWithQ) {
-		moveCursorToMatrixPosition(-3, height + static_cast<unsigned int>(2), height, initial_console_size);
-        cout << "\x1B[35;47m" << "\n - Athena, Goddess of Wisdom and Strategy, appears: \n" << ANSICodes::RESET;
-        cout << "\n\n   \"Hold, brave Theseus! Do not let frustration cloud your judgment!\n";
-        cout << "    Even the wisest warriors must sometimes retreat to fight another day.\n\n";
-        cout << "    This labyrinth requires more than courage - it demands cunning and strategy.\n";
-        cout << "    Perhaps... you should seek counsel from one who knows these halls intimately.\n\n";
-        cout << "    There is a maiden named Ariadne, daughter of King Minos himself.\n";
-        cout << "    Her knowledge of this maze surpasses even my own divine wisdom!\n\n";
-        cout << "    Look for her gentle hands - they hold the key to your escape,\n";
-        cout << "    and perhaps something more precious than mere survival.\n\n";
-        cout << "    Trust in her guidance, Theseus, for love and courage together\n";
-        cout << "    can unravel even the most impossible of tangles!\"\n\n\n";
+		moveCursorToMatrixPosition(-3, height + static_cast<unsigned int>(2), height, initial_console_size, out);
+        out << "\x1B[35;47m" << "\n - Athena, Goddess of Wisdom and Strategy, appears: \n" << ANSICodes::RESET;
+        out << "\n\n   \"Hold, brave Theseus! Do not let frustration cloud your judgment!\n";
+        out << "    Even the wisest warriors must sometimes retreat to fight another day.\n\n";
+        out << "    This labyrinth requires more than courage - it demands cunning and strategy.\n";
+        out << "    Perhaps... you should seek counsel from one who knows these halls intimately.\n\n";
+        out << "    There is a maiden named Ariadne, daughter of King Minos himself.\n";
+        out << "    Her knowledge of this maze surpasses even my own divine wisdom!\n\n";
+        out << "    Look for her gentle hands - they hold the key to your escape,\n";
+        out << "    and perhaps something more precious than mere survival.\n\n";
+        out << "    Trust in her guidance, Theseus, for love and courage together\n";
+        out << "    can unravel even the most impossible of tangles!\"\n\n";
+        if (!save_filename.empty()) {
+            out << "   (Your journey was recorded in " << save_filename << " - return with --resume " << save_filename << ")\n";
+        }
+        out << "\n";
 	}
 }
\ No newline at end of file
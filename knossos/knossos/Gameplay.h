@@ -1,8 +1,18 @@
 #pragma once
 
 #include <chrono>
+#include <string>
+#include <cstdint>
+#include <iostream>
 #include "Matrix.h"
 #include "FileHandler.h"
+#include "ReplayLog.h"
+#include "FieldOfView.h"
+#include "LevelStack.h"
+#include "BackgroundMaze.h"
+#include "Minimap.h"
+
+struct DifficultyTarget;
 
 using std::pair;
 using std::make_pair;
@@ -27,6 +37,26 @@ private:
 	FileHandler* fileHandler;
 	high_resolution_clock::time_point game_start_time;
 	unsigned int moves_made;
+	unsigned int seed;
+	unsigned int no_of_items;
+	std::string save_filename;
+	ReplayLog* replayLog;
+	bool headless;
+	bool replaying;
+	bool hand_made;     // loaded from a maze file - no seed can rebuild it
+	bool remote;        // the terminal belongs to a network client, not to this process
+	SpawnBand minotaur_spawn_band;
+	unsigned int view_radius;       // 0 unless playing in exploration mode
+	FieldOfView* fieldOfView;       // created the first time the view is limited
+	unsigned int level_count;       // floors of a new game; 1 = the classic single maze
+	LevelStack* levels;             // owns matrix (the current floor) when there are floors
+	unsigned int minotaur_level;
+	unsigned int minotaur_stairs_turns;     // > 0 while he follows the hero down or up the stairs
+	Minimap* minimap;               // of the current floor, built once it's needed
+	bool minimap_shown;             // on the alternate screen, over the untouched maze
+	Minimap::Style minimap_style;
+	bool relayout_pending;          // the terminal was resized while the minimap was up
+	std::ostream& out;
 
 	void printMatrixCharacter(char symbol) const;
 	void updateMatrixCharacter(unsigned int x, unsigned int y, char symbol) const;
@@ -36,21 +66,42 @@ private:
 	void activateEffect(ItemType itemType);
 	void recalculateEffects();
 	void fillEffectHearts(unsigned int y, unsigned int no_of_hearts);
-	void drawFog() const;
+	bool viewLimited() const;
+	void drawCell(unsigned int x, unsigned int y) const;
+	void drawView();
+	void updateVisibility();
 	void redrawMatrixAfterFog() const;
 	bool minotaurAlive() const;
+	bool minotaurHere() const;
+	bool takeStairs();
+	void minotaurLeavesStairs();
+	void drawFloor();
+	void drawMazeRows();
+	void relayout();
+	void prepareMinimap();
+	void cycleMinimap();
+	void drawMinimap();
+	void drawFloorLabel();
 	void ariadneCongratulates() const;
 	pair<unsigned int, unsigned int> getMinotaurBounceCoordinates();
 	void drawBrittleWalls() const;
 	void redrawWallsNormally(unsigned int prev_robot_x, unsigned int prev_robot_y) const;
 	void refreshDisplay();
+	void drawActiveEffects();
+	SavedGame createSavedGame() const;
+	bool processTurn(char input);
+	void saveGameResult(GameResult result) const;
+	uint32_t computeStateChecksum() const;
 	void printHermesSpeech() const;
 	void printHephaestusSpeech() const;
 	void printWelcomeMessage() const;
 	void printDaedalusLegend() const;
+	void printIntroduction() const;
+	bool awaitMaze(BackgroundMaze& generation);
+	void presentNewGame();
 
 public:
-	Gameplay(unsigned int width, unsigned int height)
+	Gameplay(unsigned int width, unsigned int height, std::ostream& out = std::cout)
 		: width(width), height(height),
 		robot_x(0), robot_y(0),
 		minotaur_x(0), minotaur_y(0),
@@ -59,14 +110,73 @@ public:
 		initial_console_size(make_pair(0,0)), matrix(nullptr), 
 		matrix_generation_time(microseconds::zero()), 
 		fileHandler(new FileHandler()), game_start_time(high_resolution_clock::now()), 
-		moves_made(0) {}
+		moves_made(0), seed(0), no_of_items(0),
+		replayLog(nullptr), headless(false), replaying(false), hand_made(false),
+		remote(false), view_radius(0), fieldOfView(nullptr), level_count(1), levels(nullptr),
+		minotaur_level(0), minotaur_stairs_turns(0), minimap(nullptr), minimap_shown(false),
+		minimap_style(Minimap::Style::BRAILLE), relayout_pending(false), out(out) {}
 
 	~Gameplay() {
-		delete matrix;
+		if (levels == nullptr) delete matrix;
+		delete levels;
 		delete fileHandler;
+		delete replayLog;
+		delete fieldOfView;
+		delete minimap;
 	}
 
-	void initializeGame(unsigned int no_of_items);
+	// The maze is generated while the introduction is printed; false if the player
+	// gave up waiting for it (Q)
+	bool initializeGame(unsigned int no_of_items);
+	bool initializeGame(unsigned int no_of_items, unsigned int seed);
+	// Play a maze that is being (or has been) built in the background, e.g. the next
+	// level prefetched during the current one; its floors replace setLevelCount
+	bool initializeGame(BackgroundMaze& generation);
+	// Search all cores for a maze within the target (see DifficultySearch) and play it
+	void initializeGame(unsigned int no_of_items, const DifficultyTarget& target);
+	void resumeGame(const SavedGame& saved);
+	// Play on a maze built elsewhere (e.g. by MazeLoader); takes ownership of it
+	void initializeLoadedGame(Matrix* loadedMatrix, unsigned int no_of_items, microseconds load_time);
+	// Play a maze taken from a MazePool; takes ownership of it. The seed still rebuilds
+	// the maze for a save, but the game draws from a fresh seed after it
+	void initializePooledGame(Matrix* pooledMatrix, unsigned int no_of_items, unsigned int seed, microseconds take_time);
 	void startGameLoop();
+
+	// Render for a terminal of the given size elsewhere (e.g. a server client)
+	// instead of querying this process's console
+	void attachRemoteTerminal(pair<int, int> console_size);
+
+	// How far from the hero the Minotaur may start; set before initializing the game
+	void setMinotaurSpawnBand(SpawnBand band);
+
+	// Exploration mode: only what the hero can see from where they stand, up to
+	// radius cells away, is shown; places seen before stay on screen dimmed
+	void setViewRadius(unsigned int radius);
+
+	// Stack this many floors, linked by stairs, in a new game (set before initializeGame)
+	void setLevelCount(unsigned int count);
+
+	// Whether the game ended with the hero out of the labyrinth
+	bool heroEscaped() const;
+
+	// The pieces of startGameLoop, for callers that deliver keys themselves:
+	// beginTurns once, playTurn per key until it returns false, then finishGame
+	void beginTurns();
+	bool playTurn(char input);
+	void finishGame(char last_input);
+
+	// Redraw the whole screen as it stands (for someone who starts watching mid-game)
+	void renderKeyframe();
+
+	// Back from the M overview to the maze if it is open, as any key but M does; lets a
+	// caller keep the overview's output apart from the turn's (e.g. from spectators)
+	void closeMinimap();
+
+	// Append every accepted key and a state checksum to a replay log
+	bool recordReplay(const std::string& filename);
+
+	// Re-execute a recorded game, verifying the checksum after every key;
+	// without rendering it runs at full speed and reports per-turn timings
+	bool runReplay(const Replay& replay, bool render, unsigned int moves_per_second);
 	
 };
\ No newline at end of file
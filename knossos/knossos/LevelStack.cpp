@@ -0,0 +1,133 @@
+#include <thread>
+#include <atomic>
+#include <algorithm>
+
+#include "LevelStack.h"
+#include "MarathonMaze.h"
+#include "RNGEngine.h"
+
+using std::vector;
+using std::chrono::microseconds;
+using std::chrono::duration_cast;
+using std::chrono::high_resolution_clock;
+
+namespace {
+
+// Floor 0 is the classic maze of the seed; the others follow from it
+unsigned int levelSeed(unsigned int seed, unsigned int level) {
+    return seed + level * 0x9E3779B9u;
+}
+
+}
+
+LevelStack::LevelStack(unsigned int width, unsigned int height, unsigned int count)
+    : width(width), height(height), levels(count, Level{ nullptr, vector<uint8_t>(), 0, 0 }), current(0) {}
+
+LevelStack::~LevelStack() {
+    for (Level& level : levels) {
+        delete level.matrix;
+    }
+}
+
+microseconds LevelStack::generate(unsigned int no_of_items, unsigned int seed) {
+    auto start_time = high_resolution_clock::now();
+    const mersenne_twister callerState = RNGEngine::getState();
+    const unsigned int count = getLevelCount();
+
+    // One floor per task; each worker seeds its own thread's engine, and packs
+    // the floors that won't be resident at the start right where it built them
+    std::atomic<unsigned int> nextLevel(0);
+    auto worker = [&]() {
+        for (unsigned int index = nextLevel++; index < count; index = nextLevel++) {
+            Level& level = levels[index];
+            RNGEngine::seed(levelSeed(seed, index));
+            level.matrix = new Matrix(width, height);
+            level.matrix->generateMatrix(no_of_items);
+
+            level.upX = level.matrix->getEntranceX();
+            for (unsigned int x = 0; x < width; ++x) {
+                if (level.matrix->getFieldType(x, height - 1) == FieldType::EXIT) level.downX = x;
+            }
+            if (index > 0) level.matrix->initializeField(level.upX, 0, FieldType::STAIRS_UP);
+            if (index + 1 < count) level.matrix->initializeField(level.downX, height - 1, FieldType::STAIRS_DOWN);
+
+            if (index > 1) pageOut(level);
+        }
+    };
+
+    unsigned int threadCount = std::max(1u, std::min(count, std::thread::hardware_concurrency()));
+    vector<std::thread> threads;
+    for (unsigned int i = 1; i < threadCount; ++i) {
+        threads.emplace_back(worker);
+    }
+    worker();
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+
+    RNGEngine::setState(callerState);
+    current = 0;
+    return duration_cast<microseconds>(high_resolution_clock::now() - start_time);
+}
+
+// The Matrix's list of changes goes with it: multi-level games are not saved,
+// and the packed cells already hold every change
+void LevelStack::pageOut(Level& level) {
+    level.packed.assign((static_cast<size_t>(width) * height + 1) / 2, 0);
+    for (unsigned int y = 0; y < height; ++y) {
+        for (unsigned int x = 0; x < width; ++x) {
+            size_t cell = static_cast<size_t>(y) * width + x;
+            level.packed[cell / 2] |= TiledCell::of(level.matrix->getField(x, y)) << (cell % 2 * 4);
+        }
+    }
+    delete level.matrix;
+    level.matrix = nullptr;
+}
+
+void LevelStack::pageIn(Level& level) {
+    level.matrix = new Matrix(width, height, false);
+    for (unsigned int y = 0; y < height; ++y) {
+        for (unsigned int x = 0; x < width; ++x) {
+            size_t cell = static_cast<size_t>(y) * width + x;
+            uint8_t code = (level.packed[cell / 2] >> (cell % 2 * 4)) & 0x0F;
+            if (TiledCell::fieldType(code) == FieldType::ITEM) {
+                level.matrix->initializeItem(x, y, TiledCell::itemType(code));
+            }
+            else {
+                level.matrix->initializeField(x, y, TiledCell::fieldType(code));
+            }
+        }
+    }
+    level.packed.clear();
+    level.packed.shrink_to_fit();
+}
+
+Matrix* LevelStack::enter(unsigned int level) {
+    current = level;
+    for (unsigned int index = 0; index < levels.size(); ++index) {
+        bool wanted = index + 1 >= level && index <= level + 1;
+        if (wanted && levels[index].matrix == nullptr) {
+            pageIn(levels[index]);
+        }
+        else if (!wanted && levels[index].matrix != nullptr) {
+            pageOut(levels[index]);
+        }
+    }
+    return levels[level].matrix;
+}
+
+size_t LevelStack::residentLevels() const {
+    size_t resident = 0;
+    for (const Level& level : levels) {
+        if (level.matrix != nullptr) ++resident;
+    }
+    return resident;
+}
+
+size_t LevelStack::packedBytes() const {
+    size_t bytes = 0;
+    for (const Level& level : levels) {
+        bytes += level.packed.size();
+    }
+    return bytes;
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <vector>
+#include <chrono>
+#include <cstdint>
+#include "Matrix.h"
+
+/**
+ * @brief The floors of a multi-level game. On every floor but the last the exit is a
+ * staircase down, which arrives where the next floor's entrance would be - a
+ * staircase up. The first floor keeps its entrance, the last one its exit.
+ *
+ * Floors are generated in parallel, each from its own seed on its own thread. Only
+ * the current floor and the ones right above and below it are Matrix objects; the
+ * others are paged out as 4-bit TiledCell codes, two per byte, which keeps the
+ * changes made on them (taken items, broken walls) at a fraction of the size.
+ */
+class LevelStack {
+private:
+    struct Level {
+        Matrix* matrix;                 // nullptr while paged out
+        std::vector<uint8_t> packed;    // the floor as it was when paged out
+        unsigned int upX;               // stairs up (or the entrance) on the top row
+        unsigned int downX;             // stairs down (or the exit) on the bottom row
+    };
+
+    unsigned int width;
+    unsigned int height;
+    std::vector<Level> levels;
+    unsigned int current;
+
+    void pageOut(Level& level);
+    void pageIn(Level& level);
+
+public:
+    LevelStack(unsigned int width, unsigned int height, unsigned int count);
+    ~LevelStack();
+    LevelStack(const LevelStack&) = delete;
+    LevelStack& operator=(const LevelStack&) = delete;
+
+    /**
+     * @brief Build every floor on all cores; the calling thread's random sequence is
+     * left as it was, so a game draws the same numbers with or without floors
+     * @return Wall-clock time of the whole build
+     */
+    std::chrono::microseconds generate(unsigned int no_of_items, unsigned int seed);
+
+    // Make the floor current, paging its neighbours in and every other floor out
+    Matrix* enter(unsigned int level);
+
+    Matrix* getCurrent() const { return levels[current].matrix; }
+    unsigned int getCurrentLevel() const { return current; }
+    unsigned int getLevelCount() const { return static_cast<unsigned int>(levels.size()); }
+    unsigned int getUpX(unsigned int level) const { return levels[level].upX; }
+    unsigned int getDownX(unsigned int level) const { return levels[level].downX; }
+    size_t residentLevels() const;
+    size_t packedBytes() const;
+};
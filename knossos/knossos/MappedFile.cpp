@@ -0,0 +1,115 @@
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+#include "MappedFile.h"
+
+using std::string;
+
+#ifdef _WIN32
+MappedFile::MappedFile()
+    : mappedData(nullptr), mappedSize(0), fileHandle(INVALID_HANDLE_VALUE), mappingHandle(nullptr) {}
+
+bool MappedFile::open(const string& filename) {
+    close();
+
+    fileHandle = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+        nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (fileHandle == INVALID_HANDLE_VALUE) {
+        return false;
+    }
+
+    LARGE_INTEGER fileSize;
+    if (!GetFileSizeEx(fileHandle, &fileSize)) {
+        close();
+        return false;
+    }
+    mappedSize = static_cast<size_t>(fileSize.QuadPart);
+    if (mappedSize == 0) {
+        return true;
+    }
+
+    mappingHandle = CreateFileMappingA(fileHandle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (mappingHandle == nullptr) {
+        close();
+        return false;
+    }
+
+    mappedData = static_cast<const char*>(MapViewOfFile(mappingHandle, FILE_MAP_READ, 0, 0, 0));
+    if (mappedData == nullptr) {
+        close();
+        return false;
+    }
+    return true;
+}
+
+void MappedFile::close() {
+    if (mappedData != nullptr) {
+        UnmapViewOfFile(mappedData);
+    }
+    if (mappingHandle != nullptr) {
+        CloseHandle(mappingHandle);
+    }
+    if (fileHandle != INVALID_HANDLE_VALUE) {
+        CloseHandle(fileHandle);
+    }
+    mappedData = nullptr;
+    mappedSize = 0;
+    mappingHandle = nullptr;
+    fileHandle = INVALID_HANDLE_VALUE;
+}
+#else
+MappedFile::MappedFile()
+    : mappedData(nullptr), mappedSize(0), fileDescriptor(-1) {}
+
+bool MappedFile::open(const string& filename) {
+    close();
+
+    fileDescriptor = ::open(filename.c_str(), O_RDONLY);
+    if (fileDescriptor < 0) {
+        return false;
+    }
+
+    struct stat fileInfo;
+    if (fstat(fileDescriptor, &fileInfo) != 0) {
+        close();
+        return false;
+    }
+    mappedSize = static_cast<size_t>(fileInfo.st_size);
+    if (mappedSize == 0) {
+        return true;
+    }
+
+    void* address = mmap(nullptr, mappedSize, PROT_READ, MAP_SHARED, fileDescriptor, 0);
+    if (address == MAP_FAILED) {
+        close();
+        return false;
+    }
+    mappedData = static_cast<const char*>(address);
+
+    // Readers of mapped files mostly stream through them front to back
+    madvise(address, mappedSize, MADV_SEQUENTIAL);
+    return true;
+}
+
+void MappedFile::close() {
+    if (mappedData != nullptr) {
+        munmap(const_cast<char*>(mappedData), mappedSize);
+    }
+    if (fileDescriptor >= 0) {
+        ::close(fileDescriptor);
+    }
+    mappedData = nullptr;
+    mappedSize = 0;
+    fileDescriptor = -1;
+}
+#endif
+
+MappedFile::~MappedFile() {
+    close();
+}
\ No newline at end of file
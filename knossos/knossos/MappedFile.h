@@ -0,0 +1,32 @@
+#pragma once
+
+#include <string>
+#include <cstddef>
+
+/**
+ * @brief Read-only memory mapping of a whole file (RAII).
+ */
+class MappedFile {
+private:
+    const char* mappedData;
+    size_t mappedSize;
+#ifdef _WIN32
+    void* fileHandle;
+    void* mappingHandle;
+#else
+    int fileDescriptor;
+#endif
+
+public:
+    MappedFile();
+    ~MappedFile();
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    // An empty file opens successfully with size() == 0 and data() == nullptr
+    bool open(const std::string& filename);
+    void close();
+
+    const char* data() const { return mappedData; }
+    size_t size() const { return mappedSize; }
+};
\ No newline at end of file
@@ -0,0 +1,352 @@
+#include <vector>
+#include <cstdlib>
+#include <algorithm>
+
+#include "MarathonGame.h"
+#include "ConsoleHandler.h"
+#include "RNGEngine.h"
+
+using std::vector;
+using std::make_pair;
+using std::chrono::high_resolution_clock;
+using std::chrono::duration_cast;
+using std::chrono::microseconds;
+
+MarathonGame::MarathonGame(MarathonMaze& maze, std::ostream& out)
+    : maze(maze), out(out),
+    robot_x(maze.getStartX()), robot_y(maze.getStartY()),
+    minotaur_x(0), minotaur_y(0), minotaur_alive(false),
+    sword_rounds_left(0), shield_rounds_left(0), hammer_rounds_left(0), fog_of_war_rounds_left(0),
+    moves_made(0), game_start_time(high_resolution_clock::now()), last_turn_time(microseconds::zero()),
+    view_x(0), view_y(0), view_width(0), view_height(0) {}
+
+bool MarathonGame::isWalkable(unsigned int x, unsigned int y) {
+    return TiledCell::fieldType(maze.getCell(x, y)) != FieldType::WALL;
+}
+
+// No BFS over the whole maze here: the Minotaur starts on a passage somewhere
+// below the robot, within a screen or two of it
+void MarathonGame::spawnMinotaur() {
+    const int reach = 128;
+    for (int attempt = 0; attempt < 1000; ++attempt) {
+        int x = static_cast<int>(robot_x) + static_cast<int>(RNGEngine::getRandomNumber(0, 2 * reach)) - reach;
+        int y = static_cast<int>(robot_y) + static_cast<int>(RNGEngine::getRandomNumber(reach / 4, reach));
+        if (x <= 0 || y <= 0 || x >= static_cast<int>(maze.getWidth()) - 1 || y >= static_cast<int>(maze.getHeight()) - 1) {
+            continue;
+        }
+        if (maze.getCell(x, y) == TiledCell::PASSAGE) {
+            minotaur_x = x;
+            minotaur_y = y;
+            minotaur_alive = true;
+            return;
+        }
+    }
+}
+
+pair<unsigned int, unsigned int> MarathonGame::getMinotaurBounceCoordinates() {
+    vector<pair<unsigned int, unsigned int>> validBouncePositions;
+
+    for (int dx = -2; dx <= 2; dx++) {
+        for (int dy = -2; dy <= 2; dy++) {
+            if (abs(dx) + abs(dy) != 2) continue;
+
+            int new_x = static_cast<int>(robot_x) + dx;
+            int new_y = static_cast<int>(robot_y) + dy;
+            if (new_x >= 0 && new_y >= 0 && isWalkable(new_x, new_y)) {
+                validBouncePositions.push_back(make_pair(new_x, new_y));
+            }
+        }
+    }
+
+    if (validBouncePositions.empty()) {
+        return make_pair(minotaur_x, minotaur_y);
+    }
+    return validBouncePositions[RNGEngine::getRandomNumber(0, validBouncePositions.size() - 1)];
+}
+
+// Same rules as Gameplay::moveMinotaur
+void MarathonGame::moveMinotaur() {
+    unsigned int new_minotaur_x = minotaur_x;
+    unsigned int new_minotaur_y = minotaur_y;
+
+    bool robotInEatingRange = abs((int)robot_x - (int)minotaur_x) + abs((int)robot_y - (int)minotaur_y) == 1;
+
+    if (robotInEatingRange) {
+        if (sword_rounds_left > 0) {
+            minotaur_alive = false;
+            drawCell(minotaur_x, minotaur_y);
+            return;
+        }
+
+        new_minotaur_x = robot_x;
+        new_minotaur_y = robot_y;
+        if (shield_rounds_left > 0) {
+            pair<unsigned int, unsigned int> bouncePosition = getMinotaurBounceCoordinates();
+            new_minotaur_x = bouncePosition.first;
+            new_minotaur_y = bouncePosition.second;
+        }
+    }
+    else {
+        vector<pair<unsigned int, unsigned int>> validMoves;
+        if (isWalkable(minotaur_x, minotaur_y - 1)) validMoves.push_back(make_pair(minotaur_x, minotaur_y - 1));
+        if (isWalkable(minotaur_x, minotaur_y + 1)) validMoves.push_back(make_pair(minotaur_x, minotaur_y + 1));
+        if (isWalkable(minotaur_x - 1, minotaur_y)) validMoves.push_back(make_pair(minotaur_x - 1, minotaur_y));
+        if (isWalkable(minotaur_x + 1, minotaur_y)) validMoves.push_back(make_pair(minotaur_x + 1, minotaur_y));
+
+        if (!validMoves.empty()) {
+            pair<unsigned int, unsigned int> move = validMoves[RNGEngine::getRandomNumber(0, validMoves.size() - 1)];
+            new_minotaur_x = move.first;
+            new_minotaur_y = move.second;
+        }
+    }
+
+    unsigned int prev_minotaur_x = minotaur_x, prev_minotaur_y = minotaur_y;
+    minotaur_x = new_minotaur_x;
+    minotaur_y = new_minotaur_y;
+
+    // Destroy the item he stepped on, if any
+    if (TiledCell::fieldType(maze.getCell(minotaur_x, minotaur_y)) == FieldType::ITEM) {
+        maze.setCell(minotaur_x, minotaur_y, TiledCell::PASSAGE);
+    }
+    drawCell(prev_minotaur_x, prev_minotaur_y);
+    drawCell(minotaur_x, minotaur_y);
+}
+
+void MarathonGame::activateEffect(ItemType itemType) {
+    switch (itemType) {
+    case ItemType::SWORD: sword_rounds_left = 4; break;
+    case ItemType::SHIELD: shield_rounds_left = 4; break;
+    case ItemType::HAMMER: hammer_rounds_left = 4; break;
+    case ItemType::FOG_OF_WAR: fog_of_war_rounds_left = 4; break;
+    }
+}
+
+void MarathonGame::recalculateEffects() {
+    if (sword_rounds_left > 0) --sword_rounds_left;
+    if (shield_rounds_left > 0) --shield_rounds_left;
+    if (hammer_rounds_left > 0) --hammer_rounds_left;
+    if (fog_of_war_rounds_left > 0) --fog_of_war_rounds_left;
+}
+
+namespace {
+
+// Start of a window of the given size along one axis, re-centred on the robot once
+// it gets within a fifth of either edge (and kept inside the maze)
+unsigned int followAxis(unsigned int start, unsigned int size, unsigned int robot, unsigned int extent) {
+    unsigned int margin = size / 5;
+    bool nearStart = robot < start + margin && start > 0;
+    bool nearEnd = robot + margin >= start + size && start + size < extent;
+    if (!nearStart && !nearEnd) {
+        return start;
+    }
+    return std::min(robot - std::min(robot, size / 2), extent - size);
+}
+
+}
+
+bool MarathonGame::followRobot() {
+    unsigned int new_view_x = followAxis(view_x, view_width, robot_x, maze.getWidth());
+    unsigned int new_view_y = followAxis(view_y, view_height, robot_y, maze.getHeight());
+    bool moved = new_view_x != view_x || new_view_y != view_y;
+    view_x = new_view_x;
+    view_y = new_view_y;
+    return moved;
+}
+
+bool MarathonGame::inView(unsigned int x, unsigned int y) const {
+    return x >= view_x && y >= view_y && x < view_x + view_width && y < view_y + view_height;
+}
+
+void MarathonGame::drawCell(unsigned int x, unsigned int y) {
+    if (!inView(x, y)) return;
+
+    out << "\033[" << (y - view_y + 3) << ";" << (x - view_x + 2) << "H";
+    printCell(x, y);
+}
+
+void MarathonGame::printCell(unsigned int x, unsigned int y) {
+    if (fog_of_war_rounds_left > 0 && (abs((int)x - (int)robot_x) > 1 || abs((int)y - (int)robot_y) > 1)) {
+        char symbol = RNGEngine::getCosmeticRandomNumber(1, 15) == 1 ? '#' : ' ';
+        out << (RNGEngine::getCosmeticRandomNumber(1, 2) == 1 ? "\x1B[5;34;48;5;248m" : "\x1B[5;35;48;5;248m")
+            << symbol << ANSICodes::RESET;
+        return;
+    }
+
+    if (x == robot_x && y == robot_y) {
+        out << ANSICodes::ROBOT_STYLE << 'R' << ANSICodes::RESET;
+        return;
+    }
+    if (minotaur_alive && x == minotaur_x && y == minotaur_y) {
+        out << ANSICodes::MINOTAUR_STYLE << 'M' << ANSICodes::RESET;
+        return;
+    }
+
+    uint8_t cell = maze.getCell(x, y);
+    char symbol = TiledCell::symbol(cell);
+    switch (TiledCell::fieldType(cell)) {
+    case FieldType::WALL: out << ANSICodes::WALL_STYLE << symbol << ANSICodes::RESET; break;
+    case FieldType::ENTRANCE: out << ANSICodes::ENTRANCE_STYLE << symbol << ANSICodes::RESET; break;
+    case FieldType::EXIT: out << ANSICodes::EXIT_STYLE << symbol << ANSICodes::RESET; break;
+    case FieldType::ITEM: out << ANSICodes::ITEM_STYLE << symbol << ANSICodes::RESET; break;
+    default: out << symbol; break;
+    }
+}
+
+void MarathonGame::drawMap() {
+    pair<int, int> console = getConsoleSize();
+    view_width = std::min<unsigned int>(maze.getWidth(), std::max(console.first - 2, 16));
+    view_height = std::min<unsigned int>(maze.getHeight(), std::max(console.second - 3, 8));
+    view_x = std::min(view_x, maze.getWidth() - view_width);
+    view_y = std::min(view_y, maze.getHeight() - view_height);
+    followRobot();
+
+    // One cursor move per row; the cells of a row follow each other
+    out << "\033[2J";
+    for (unsigned int y = view_y; y < view_y + view_height; ++y) {
+        out << "\033[" << (y - view_y + 3) << ";2H";
+        for (unsigned int x = view_x; x < view_x + view_width; ++x) {
+            printCell(x, y);
+        }
+    }
+}
+
+void MarathonGame::drawStatus() {
+    out << "\033[1;1H\033[2K" << "\x1B[38;2;0;0;155;47m" << " " << maze.title() << " " << ANSICodes::RESET
+        << "  robot (" << robot_x << ", " << robot_y << ")  moves " << moves_made << "  " << maze.cacheStatus()
+        << "  turn " << last_turn_time.count() << " us";
+    out << "\033[2;1H\033[2K" << " sword " << sword_rounds_left << "  shield " << shield_rounds_left
+        << "  hammer " << hammer_rounds_left << "  fog " << fog_of_war_rounds_left
+        << (minotaur_alive ? "" : "  - the Minotaur is slain!") << "   (WASD move, E redraw, Q quit)";
+}
+
+bool MarathonGame::processTurn(char input, GameResult& result) {
+    if (input == 'q') {
+        result = GameResult::FORFEITED;
+        return false;
+    }
+    if (input == 'e') {
+        drawMap();
+        return true;
+    }
+    // The overview needs the whole maze in memory, which is what this mode avoids
+    if (input == 'm') {
+        return true;
+    }
+
+    unsigned int new_robot_x = robot_x, new_robot_y = robot_y;
+    switch (input) {
+    case 'w': --new_robot_y; break;
+    case 's': ++new_robot_y; break;
+    case 'a': --new_robot_x; break;
+    case 'd': ++new_robot_x; break;
+    }
+    if (new_robot_x >= maze.getWidth() || new_robot_y >= maze.getHeight()) {
+        return true;
+    }
+
+    uint8_t target = maze.getCell(new_robot_x, new_robot_y);
+    bool walkable = TiledCell::fieldType(target) != FieldType::WALL ||
+        (hammer_rounds_left > 0 && !maze.isBoundary(new_robot_x, new_robot_y));
+    if (!walkable) {
+        return true;
+    }
+
+    auto turn_start = high_resolution_clock::now();
+    ++moves_made;
+
+    unsigned int prev_robot_x = robot_x, prev_robot_y = robot_y;
+    robot_x = new_robot_x;
+    robot_y = new_robot_y;
+
+    if (TiledCell::fieldType(target) == FieldType::ITEM) {
+        activateEffect(TiledCell::itemType(target));
+        maze.setCell(robot_x, robot_y, TiledCell::PASSAGE);
+    }
+    else if (TiledCell::fieldType(target) == FieldType::WALL) {
+        maze.setCell(robot_x, robot_y, TiledCell::PASSAGE);     // broken with the hammer
+    }
+
+    if (minotaur_alive) {
+        moveMinotaur();
+    }
+
+    if (TiledCell::fieldType(maze.getCell(robot_x, robot_y)) == FieldType::EXIT) {
+        result = GameResult::VICTORY;
+        return false;
+    }
+    if (minotaur_alive && robot_x == minotaur_x && robot_y == minotaur_y) {
+        result = GameResult::DEFEATED_BY_MINOTAUR;
+        return false;
+    }
+
+    bool wasFoggy = fog_of_war_rounds_left > 0;
+    recalculateEffects();
+
+    // Whatever the robot and the Minotaur may step onto next is mapped in advance
+    maze.prefetchAround(robot_x, robot_y);
+    if (minotaur_alive) {
+        maze.prefetchAround(minotaur_x, minotaur_y);
+    }
+
+    // The fog moves with the robot; otherwise only the two cells it touched change
+    if (followRobot() || wasFoggy) {
+        drawMap();
+    }
+    else {
+        drawCell(prev_robot_x, prev_robot_y);
+        drawCell(robot_x, robot_y);
+    }
+
+    last_turn_time = duration_cast<microseconds>(high_resolution_clock::now() - turn_start);
+    return true;
+}
+
+void MarathonGame::play() {
+    spawnMinotaur();
+    maze.prefetchAround(robot_x, robot_y);
+
+    hideCursor(out);
+    drawMap();
+    drawStatus();
+    out << "\033[" << (robot_y - view_y + 3) << ";" << (robot_x - view_x + 2) << "H";
+    showCursor(out);
+
+    watchTerminalResizes();
+
+    GameResult result = GameResult::FORFEITED;
+    bool gameRunning = true;
+    while (gameRunning) {
+        char input = getValidKeyPress();
+
+        out << "\033[?25l";
+        if (input == RESIZE_EVENT) {
+            // drawMap sizes the window to the terminal afresh
+            drawMap();
+        }
+        else {
+            gameRunning = processTurn(input, result);
+        }
+        drawStatus();
+        out << "\033[" << (robot_y - view_y + 3) << ";" << (robot_x - view_x + 2) << "H" << "\033[?25h";
+        out.flush();
+    }
+
+    auto game_duration = duration_cast<microseconds>(high_resolution_clock::now() - game_start_time);
+    FileHandler().appendResultRecord(maze.getWidth(), maze.getHeight(), maze.getItemCount(), result, game_duration,
+        moves_made, maze.getSeed());
+
+    out << "\033[" << (view_height + 3) << ";1H\n";
+    if (result == GameResult::VICTORY) {
+        out << "\x1B[38;2;255;215;0;46m" << " - Zeus thunders: \"A marathon of " << moves_made
+            << " steps - the heavens rejoice!\" " << ANSICodes::RESET << "\n\n";
+    }
+    else if (result == GameResult::DEFEATED_BY_MINOTAUR) {
+        out << "\x1B[38;2;0;151;255;47m" << " - Poseidon: \"The beast caught you after " << moves_made
+            << " steps. Rise again, my child!\" " << ANSICodes::RESET << "\n\n";
+    }
+    else {
+        out << "\x1B[35;47m" << " - Athena: \"Even the longest road is walked one step at a time.\" "
+            << ANSICodes::RESET << "\n\n";
+    }
+    out.flush();
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <iostream>
+#include <chrono>
+#include "MarathonMaze.h"
+#include "FileHandler.h"
+
+using std::pair;
+
+/**
+ * @brief The game on a MarathonMaze (a TiledMaze on disk, or the endless
+ * ChunkedWorld): same rules as Gameplay (items, Minotaur), but the screen is a
+ * window onto the maze that follows the robot, so nothing on screen or in memory
+ * depends on the size of the maze.
+ */
+class MarathonGame {
+private:
+    MarathonMaze& maze;
+    std::ostream& out;
+    unsigned int robot_x;
+    unsigned int robot_y;
+    unsigned int minotaur_x;
+    unsigned int minotaur_y;
+    bool minotaur_alive;
+    unsigned int sword_rounds_left;
+    unsigned int shield_rounds_left;
+    unsigned int hammer_rounds_left;
+    unsigned int fog_of_war_rounds_left;
+    unsigned int moves_made;
+    std::chrono::high_resolution_clock::time_point game_start_time;
+    std::chrono::microseconds last_turn_time;
+
+    // Maze cell at the top-left of the map window, and the window's size
+    unsigned int view_x;
+    unsigned int view_y;
+    unsigned int view_width;
+    unsigned int view_height;
+
+    void spawnMinotaur();
+    bool isWalkable(unsigned int x, unsigned int y);
+    void moveMinotaur();
+    pair<unsigned int, unsigned int> getMinotaurBounceCoordinates();
+    void activateEffect(ItemType itemType);
+    void recalculateEffects();
+    bool followRobot();
+    bool inView(unsigned int x, unsigned int y) const;
+    void drawCell(unsigned int x, unsigned int y);
+    void printCell(unsigned int x, unsigned int y);
+    void drawMap();
+    void drawStatus();
+    bool processTurn(char input, GameResult& result);
+
+public:
+    MarathonGame(MarathonMaze& maze, std::ostream& out = std::cout);
+
+    void play();
+};
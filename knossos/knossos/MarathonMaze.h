@@ -0,0 +1,51 @@
+#pragma once
+
+#include <string>
+#include <cstdint>
+#include "MatrixField.h"
+
+// 4-bit cell codes, where a Matrix per maze would take too much memory
+// (marathon tiles, endless chunks, floors of a multi-level game paged out)
+namespace TiledCell {
+    const uint8_t PASSAGE = 0;
+    const uint8_t WALL = 1;
+    const uint8_t ENTRANCE = 2;
+    const uint8_t EXIT = 3;
+    const uint8_t SWORD = 4;
+    const uint8_t SHIELD = 5;
+    const uint8_t HAMMER = 6;
+    const uint8_t FOG_OF_WAR = 7;
+    const uint8_t STAIRS_UP = 8;
+    const uint8_t STAIRS_DOWN = 9;
+
+    FieldType fieldType(uint8_t cell);
+    ItemType itemType(uint8_t cell);     // only for cells whose fieldType is ITEM
+    char symbol(uint8_t cell);
+    uint8_t of(const MatrixField* field);
+}
+
+/**
+ * @brief What MarathonGame plays on: a maze that is never all in memory at once,
+ * read cell by cell and told every turn where the robot and the Minotaur are so
+ * it can have the cells around them ready in time.
+ */
+class MarathonMaze {
+public:
+    virtual ~MarathonMaze() = default;
+
+    virtual uint8_t getCell(unsigned int x, unsigned int y) = 0;
+    virtual void setCell(unsigned int x, unsigned int y, uint8_t cell) = 0;
+    virtual bool isBoundary(unsigned int x, unsigned int y) const = 0;
+    virtual void prefetchAround(unsigned int x, unsigned int y) = 0;
+
+    virtual unsigned int getWidth() const = 0;
+    virtual unsigned int getHeight() const = 0;
+    virtual unsigned int getStartX() const = 0;
+    virtual unsigned int getStartY() const = 0;
+    virtual unsigned int getItemCount() const = 0;
+    virtual unsigned int getSeed() const = 0;
+
+    // Name of the maze and the state of its cache, for the status line
+    virtual std::string title() const = 0;
+    virtual std::string cacheStatus() const = 0;
+};
@@ -2,11 +2,15 @@
 #include <set>
 #include <chrono>
 #include <stdexcept>
+#include <deque>
+#include <cstdint>
+#include <algorithm>
 
 #include "Matrix.h"
 #include "MatrixField.h"
 #include "ConsoleHandler.h"
 #include "RNGEngine.h"
+#include "MemoryStats.h"
 
 using std::vector;
 using std::set;
@@ -17,20 +21,19 @@ using std::cerr;
 using std::chrono::high_resolution_clock;
 using std::chrono::duration_cast;
 using std::chrono::microseconds;
-using std::chrono::milliseconds;
 using std::min;
-using std::random_shuffle;
 using std::out_of_range;
 
-Matrix::Matrix(unsigned int w, unsigned int h)
-	: width(w), height(h), fields(nullptr) {
+Matrix::Matrix(unsigned int w, unsigned int h, bool fillWithWalls)
+	: width(w), height(h), fields(nullptr), cancelled(nullptr), progress(nullptr) {
 
+	MemoryScope scope(MemorySubsystem::MAZE);
 	fields = new MatrixField * *[width];
 
 	for (unsigned int i = 0; i < width; ++i) {
 		fields[i] = new MatrixField * [height];
 		for (unsigned int j = 0; j < height; ++j) {
-			fields[i][j] = new Wall();
+			fields[i][j] = fillWithWalls ? new Wall() : nullptr;
 		}
 	}
 }
@@ -62,33 +65,33 @@ FieldType Matrix::getFieldType(unsigned int x, unsigned int y) const {
 }
 
 void Matrix::setField(unsigned int x, unsigned int y, FieldType fieldType) {
-	if (x < width && x >= 0 && y < height && y >= 0) {
+	initializeField(x, y, fieldType);
+	fieldChanges.push_back({ x, y, fieldType });
+}
+
+void Matrix::initializeField(unsigned int x, unsigned int y, FieldType fieldType) {
+	if (x < width && y < height) {
 		delete fields[x][y];
-		switch (fieldType) {
-		case FieldType::PASSAGE:
-			fields[x][y] = new Passage();
-			break;
-		case FieldType::WALL:
-			fields[x][y] = new Wall();
-			break;
-		case FieldType::ENTRANCE:
-			fields[x][y] = new Entrance();
-			break;
-		case FieldType::EXIT:
-			fields[x][y] = new Exit();
-			break;
-		case FieldType::ITEM:
-			fields[x][y] = createRandomItem();
-			break;
-		default:
-			fields[x][y] = new Passage();
-		}
+		fields[x][y] = createField(fieldType);
 	}
 	else {
 		throw out_of_range("Coordinates out of bounds");
 	}
 }
 
+MatrixField* Matrix::createField(FieldType fieldType) const {
+	switch (fieldType) {
+	case FieldType::PASSAGE: return new Passage();
+	case FieldType::WALL: return new Wall();
+	case FieldType::ENTRANCE: return new Entrance();
+	case FieldType::EXIT: return new Exit();
+	case FieldType::ITEM: return createRandomItem();
+	case FieldType::STAIRS_UP: return new StairsUp();
+	case FieldType::STAIRS_DOWN: return new StairsDown();
+	default: return new Passage();
+	}
+}
+
 bool Matrix::isBoundaryOrOutside(unsigned int x, unsigned int y) const {
 	return (x <= 0 || x >= width - 1 || y <= 0 || y >= height - 1);
 }
@@ -115,47 +118,65 @@ void Matrix::generativePrim(unsigned int entrance_x) {
 	// frontiers are potential extensions to the ever-growing explorable area of the maze
 	vector<pair<unsigned int, unsigned int>> frontiers;
 	pair<unsigned int, unsigned int> current(entrance_x, 1);
-	set<pair<unsigned int, unsigned int>> visited;
 
-	frontiers.push_back(make_pair(entrance_x, 3));
-	visited.insert(make_pair(entrance_x, 3));
+	// one flag per cell (column-major, like fields) instead of a set - large mazes queue millions of frontiers
+	vector<char> visited(static_cast<size_t>(width) * height, 0);
+	auto markVisited = [&](unsigned int x, unsigned int y) {
+		visited[static_cast<size_t>(x) * height + y] = 1;
+		frontiers.push_back(make_pair(x, y));
+	};
+
+	markVisited(entrance_x, 3);
 	if (!isBoundaryOrOutside(entrance_x + 2, 1)) {
-		frontiers.push_back(make_pair(entrance_x + 2, 1));
-		visited.insert(make_pair(entrance_x + 2, 1));
+		markVisited(entrance_x + 2, 1);
 	}
 	if (!isBoundaryOrOutside(entrance_x - 2, 1)) {
-		frontiers.push_back(make_pair(entrance_x - 2, 1));
-		visited.insert(make_pair(entrance_x - 2, 1));
+		markVisited(entrance_x - 2, 1);
 	}
 
+	pair<unsigned int, unsigned int> reconnectionPoints[4];
+	unsigned int steps = 0;
+
 	while (!frontiers.empty())
 	{
+		if ((++steps & 4095) == 0) {
+			if (cancelled != nullptr && *cancelled) {
+				return;
+			}
+			if (progress != nullptr) {
+				progress->store(steps, std::memory_order_relaxed);
+			}
+		}
+
+		// the order of the frontier list doesn't matter, so the chosen one is swapped out in O(1)
 		unsigned int chosenOne = RNGEngine::getRandomNumber(0, (unsigned int)frontiers.size() - 1);
 		current = frontiers[chosenOne];
-		frontiers.erase(frontiers.begin() + chosenOne);
+		frontiers[chosenOne] = frontiers.back();
+		frontiers.pop_back();
 		delete fields[current.first][current.second];
 		fields[current.first][current.second] = new Passage();
 
-		vector<pair<unsigned int, unsigned int>> potentialMazeReconnectionPoints;
-		potentialMazeReconnectionPoints.push_back(make_pair(current.first, current.second - 2));
-		potentialMazeReconnectionPoints.push_back(make_pair(current.first + 2, current.second));
-		potentialMazeReconnectionPoints.push_back(make_pair(current.first, current.second + 2));
-		potentialMazeReconnectionPoints.push_back(make_pair(current.first - 2, current.second));
-
-		for (auto it = potentialMazeReconnectionPoints.begin(); it != potentialMazeReconnectionPoints.end();) {
-			if (isBoundaryOrOutside(it->first, it->second) || !(getFieldType(it->first, it->second) == FieldType::PASSAGE)) {
-				if (!isBoundaryOrOutside(it->first, it->second) && visited.find(*it) == visited.end()) {
-					frontiers.push_back(make_pair(it->first, it->second));
-					visited.insert(make_pair(it->first, it->second));
-				}
-				it = potentialMazeReconnectionPoints.erase(it);
+		const pair<unsigned int, unsigned int> neighbours[4] = {
+			make_pair(current.first, current.second - 2),
+			make_pair(current.first + 2, current.second),
+			make_pair(current.first, current.second + 2),
+			make_pair(current.first - 2, current.second)
+		};
+
+		unsigned int reconnectionCount = 0;
+		for (const pair<unsigned int, unsigned int>& neighbour : neighbours) {
+			if (isBoundaryOrOutside(neighbour.first, neighbour.second)) {
+				continue;
 			}
-			else {
-				++it;
+			if (getFieldType(neighbour.first, neighbour.second) == FieldType::PASSAGE) {
+				reconnectionPoints[reconnectionCount++] = neighbour;
+			}
+			else if (!visited[static_cast<size_t>(neighbour.first) * height + neighbour.second]) {
+				markVisited(neighbour.first, neighbour.second);
 			}
 		}
 
-		pair<unsigned int, unsigned int> chosenPoint = potentialMazeReconnectionPoints[RNGEngine::getRandomNumber(0, (unsigned int)potentialMazeReconnectionPoints.size() - 1)];
+		pair<unsigned int, unsigned int> chosenPoint = reconnectionPoints[RNGEngine::getRandomNumber(0, reconnectionCount - 1)];
 
 		delete fields[(current.first + chosenPoint.first) / 2][(current.second + chosenPoint.second) / 2];
 		fields[(current.first + chosenPoint.first) / 2][(current.second + chosenPoint.second) / 2] = new Passage();
@@ -163,100 +184,169 @@ void Matrix::generativePrim(unsigned int entrance_x) {
 	}
 }
 
-void Matrix::assurePathConnectivity(unsigned int exit_x) {
-	if (height % 2 == 0) {
-		delete fields[exit_x][height - 2];
-		fields[exit_x][height - 2] = new Passage();
+void Matrix::breakUpBottomRow() {
+	// With an even height the row above the bottom wall lies between Prim's grid lines and
+	// is solid wall; randomly convert some of it to passages so it looks less "wally"
+	for (unsigned int x = 1; x < width - 1; ++x) {
+		if (getFieldType(x, height - 2) == FieldType::WALL) {
+			if (RNGEngine::getRandomNumber(1, 3) == 1) {
+				delete fields[x][height - 2];
+				fields[x][height - 2] = new Passage();
+			}
+		}
+	}
+}
 
-		bool fullPathExists = getFieldType(exit_x, height - 3) == FieldType::PASSAGE;
+namespace {
 
-		// connect to nearest passage in the second-to-last row from the boundary
-		if (!fullPathExists) {
-			int connectionFound = -1;
+// Disjoint sets over cell indices: union by rank with path halving, near-linear overall
+class CellSets {
+private:
+	vector<uint32_t> parent;
+	vector<uint8_t> rank;
 
-			for (int offset = 1; offset < (int)width; ++offset) {
-				if (exit_x + offset < width - 1) {
-					if (getFieldType(exit_x + offset, height - 3) == FieldType::PASSAGE) {
-						connectionFound = exit_x + offset;
-						break;
-					}
-				}
-				if (exit_x >= offset && exit_x - offset > 0) {
-					if (getFieldType(exit_x - offset, height - 3) == FieldType::PASSAGE) {
-						connectionFound = exit_x - offset;
-						break;
-					}
-				}
-			}
-
-			if (connectionFound != -1) {
-				int start = (exit_x < connectionFound) ? exit_x : connectionFound;
-				int end = (exit_x > connectionFound) ? exit_x : connectionFound;
+public:
+	explicit CellSets(size_t cells) : parent(cells), rank(cells, 0) {
+		for (size_t i = 0; i < cells; ++i) parent[i] = static_cast<uint32_t>(i);
+	}
 
-				for (int x = start; x <= end; ++x) {
-					if (x > 0 && x < width - 1) {
-						delete fields[x][height - 3];
-						fields[x][height - 3] = new Passage();
-					}
-				}
-			}
+	uint32_t find(uint32_t cell) {
+		while (parent[cell] != cell) {
+			parent[cell] = parent[parent[cell]];
+			cell = parent[cell];
 		}
+		return cell;
+	}
 
-		// Randomly convert some walls in the second-to-last row to passages to make it look less "wally"
-		for (unsigned int x = 1; x < width - 1; ++x) {
-			if (getFieldType(x, height - 2) == FieldType::WALL) {
-				if (RNGEngine::getRandomNumber(1, 3) == 1) {
-					delete fields[x][height - 2];
-					fields[x][height - 2] = new Passage();
-				}
+	void unite(uint32_t a, uint32_t b) {
+		a = find(a);
+		b = find(b);
+		if (a == b) return;
+		if (rank[a] < rank[b]) std::swap(a, b);
+		parent[b] = a;
+		if (rank[a] == rank[b]) ++rank[a];
+	}
+};
+
+}
+
+void Matrix::connectComponents(unsigned int robot_x, unsigned int robot_y) {
+	const size_t cells = static_cast<size_t>(width) * height;
+	if (cells > UINT32_MAX) {
+		throw out_of_range("Maze too large for the connectivity pass");
+	}
+
+	// One column-major sweep (the order the cells were allocated in) labels every
+	// open cell, joining it with the open cells to its left and above
+	vector<uint8_t> open(cells);
+	CellSets components(cells);
+	vector<uint32_t> required;     // cells that must be reachable: exit and items
+
+	for (unsigned int x = 0; x < width; ++x) {
+		for (unsigned int y = 0; y < height; ++y) {
+			size_t cell = static_cast<size_t>(x) * height + y;
+			FieldType type = fields[x][y]->getFieldType();
+			open[cell] = type != FieldType::WALL;
+			if (!open[cell]) continue;
+
+			if (type == FieldType::EXIT || type == FieldType::ITEM) {
+				required.push_back(static_cast<uint32_t>(cell));
 			}
+			if (y > 0 && open[cell - 1]) components.unite(static_cast<uint32_t>(cell), static_cast<uint32_t>(cell - 1));
+			if (x > 0 && open[cell - height]) components.unite(static_cast<uint32_t>(cell), static_cast<uint32_t>(cell - height));
 		}
 	}
-	else {
-		if (getFieldType(exit_x, height - 2) == FieldType::WALL) {
-			delete fields[exit_x][height - 2];
-			fields[exit_x][height - 2] = new Passage();
-		}
-
-		bool needsHorizontalConnection = true;
 
-		if (exit_x > 0 && getFieldType(exit_x - 1, height - 2) == FieldType::PASSAGE) {
-			needsHorizontalConnection = false;
+	const uint32_t start = static_cast<uint32_t>(static_cast<size_t>(robot_x) * height + robot_y);
+
+	// Each required cell cut off from the start gets a 0-1 BFS of its own, outwards until
+	// it settles on the start's component: open cells cost nothing, interior walls one
+	// carving each. Stranded pieces (the exit behind a wall, an item in the bottom row) sit
+	// right next to the rest, so these searches stay small; their state is reset cell by cell
+	const uint32_t UNSETTLED = UINT32_MAX;
+	const long long steps[4] = { -1, 1, -static_cast<long long>(height), static_cast<long long>(height) };
+	vector<uint32_t> cost;
+	vector<uint8_t> cameFrom;      // index into steps of the move that reached the cell
+	vector<uint32_t> touched;
+	std::deque<uint32_t> frontier;
+
+	for (uint32_t origin : required) {
+		if (components.find(origin) == components.find(start)) {
+			continue;
 		}
-		if (exit_x < width - 1 && getFieldType(exit_x + 1, height - 2) == FieldType::PASSAGE) {
-			needsHorizontalConnection = false;
+		if (cost.empty()) {
+			cost.assign(cells, UNSETTLED);
+			cameFrom.assign(cells, 0);
 		}
 
-		if (needsHorizontalConnection) {
-			int connectionFound = -1;
+		uint32_t mainComponent = components.find(start);
+		uint32_t link = UNSETTLED;
+		cost[origin] = 0;
+		touched.push_back(origin);
+		frontier.push_back(origin);
+
+		while (!frontier.empty()) {
+			uint32_t cell = frontier.front();
+			frontier.pop_front();
+			if (open[cell] && components.find(cell) == mainComponent) {
+				link = cell;
+				break;
+			}
 
-			for (int offset = 1; offset < (int)width; ++offset) {
-				if (exit_x + offset < width - 1) {
-					if (getFieldType(exit_x + offset, height - 2) == FieldType::PASSAGE) {
-						connectionFound = exit_x + offset;
-						break;
-					}
-				}
-				if (exit_x >= offset && exit_x - offset > 0) {
-					if (getFieldType(exit_x - offset, height - 2) == FieldType::PASSAGE) {
-						connectionFound = exit_x - offset;
-						break;
-					}
+			unsigned int x = cell / height, y = cell % height;
+			for (uint8_t step = 0; step < 4; ++step) {
+				unsigned int next_x = x + (step == 2 ? -1 : step == 3 ? 1 : 0);
+				unsigned int next_y = y + (step == 0 ? -1 : step == 1 ? 1 : 0);
+				if (next_x >= width || next_y >= height) continue;
+
+				uint32_t next = static_cast<uint32_t>(cell + steps[step]);
+				// The outer wall stays intact; only the doors in it are open
+				if (!open[next] && isBoundaryOrOutside(next_x, next_y)) continue;
+
+				uint32_t nextCost = cost[cell] + (open[next] ? 0 : 1);
+				if (nextCost < cost[next]) {
+					if (cost[next] == UNSETTLED) touched.push_back(next);
+					cost[next] = nextCost;
+					cameFrom[next] = step;
+					if (open[next]) frontier.push_front(next);
+					else frontier.push_back(next);
 				}
 			}
+		}
 
-			if (connectionFound != -1) {
-				int start = (exit_x < connectionFound) ? exit_x : connectionFound;
-				int end = (exit_x > connectionFound) ? exit_x : connectionFound;
+		if (link == UNSETTLED) {
+			throw std::logic_error("Connectivity pass could not link a required cell to the start");
+		}
 
-				for (int x = start; x <= end; ++x) {
-					if (x > 0 && x < width - 1) {
-						delete fields[x][height - 2];
-						fields[x][height - 2] = new Passage();
-					}
-				}
+		// Carve the way back to the origin; the path joins both components
+		for (uint32_t cell = link; cell != origin;) {
+			uint32_t previous = static_cast<uint32_t>(cell - steps[cameFrom[cell]]);
+			if (!open[cell]) {
+				unsigned int x = cell / height, y = cell % height;
+				delete fields[x][y];
+				fields[x][y] = new Passage();
+				open[cell] = 1;
 			}
+			components.unite(cell, previous);
+			cell = previous;
 		}
+
+		for (uint32_t cell : touched) cost[cell] = UNSETTLED;
+		touched.clear();
+		frontier.clear();
+	}
+}
+
+void Matrix::initializeItem(unsigned int x, unsigned int y, ItemType itemType) {
+	if (x >= width || y >= height) {
+		throw out_of_range("Coordinates out of bounds");
+	}
+	delete fields[x][y];
+	switch (itemType) {
+	case ItemType::SWORD: fields[x][y] = new Sword(); break;
+	case ItemType::SHIELD: fields[x][y] = new Shield(); break;
+	case ItemType::HAMMER: fields[x][y] = new Hammer(); break;
+	case ItemType::FOG_OF_WAR: fields[x][y] = new FogOfWar(); break;
 	}
 }
 
@@ -292,7 +382,7 @@ void Matrix::placeItems(unsigned int no_of_items, unsigned int robot_x, unsigned
 
 	unsigned int itemsToPlace = min(no_of_items, static_cast<unsigned int>(availablePositions.size()));
 
-	random_shuffle(availablePositions.begin(), availablePositions.end());
+	RNGEngine::shuffle(availablePositions.begin(), availablePositions.end());
 
 	for (unsigned int i = 0; i < itemsToPlace; ++i) {
 		unsigned int x = availablePositions[i].first;
@@ -313,91 +403,165 @@ bool Matrix::minotaurPositionChessboardCheck(unsigned int robot_x, pair<unsigned
 	return ((robot_x + 1) % 2 == (minotaur_pos.first + minotaur_pos.second) % 2);
 }
 
-pair<unsigned int, unsigned int> Matrix::getRandomPassageForMinotaur(unsigned int robot_x) const {
-	vector<pair<unsigned int, unsigned int>> availablePositions;
+pair<unsigned int, unsigned int> Matrix::getRandomPassageForMinotaur(unsigned int robot_x, SpawnBand band) const {
+	const unsigned int robot_y = 1;
+	const unsigned int UNREACHED = static_cast<unsigned int>(-1);
+
+	// One BFS from the robot's start; cells are column-major like fields, and the
+	// queue doubles as the list of reachable cells in order of distance
+	vector<unsigned int> distance(static_cast<size_t>(width) * height, UNREACHED);
+	vector<size_t> reached;
+	reached.reserve(static_cast<size_t>(width) * height / 2);
+
+	size_t start = static_cast<size_t>(robot_x) * height + robot_y;
+	distance[start] = 0;
+	reached.push_back(start);
+
+	for (size_t head = 0; head < reached.size(); ++head) {
+		size_t cell = reached[head];
+		unsigned int x = static_cast<unsigned int>(cell / height);
+		unsigned int y = static_cast<unsigned int>(cell % height);
+
+		const pair<unsigned int, unsigned int> neighbours[4] = {
+			make_pair(x, y - 1), make_pair(x + 1, y), make_pair(x, y + 1), make_pair(x - 1, y)
+		};
+		for (const pair<unsigned int, unsigned int>& neighbour : neighbours) {
+			if (neighbour.first >= width || neighbour.second >= height) continue;
+
+			size_t next = static_cast<size_t>(neighbour.first) * height + neighbour.second;
+			if (distance[next] == UNREACHED && fields[neighbour.first][neighbour.second]->isWalkable()) {
+				distance[next] = distance[cell] + 1;
+				reached.push_back(next);
+			}
+		}
+	}
 
-	for (unsigned int x = 1; x < width - 1; ++x) {
-		for (unsigned int y = 1; y < height - 1; ++y) {
-			if (x == robot_x && y == 1) continue;
+	unsigned int farthest = distance[reached.back()];
+	unsigned int low = farthest * band.low / 100;
+	unsigned int high = (farthest * band.high + 99) / 100;
 
-			if (getFieldType(x, y) == FieldType::PASSAGE) {
-				availablePositions.push_back(make_pair(x, y));
+	vector<pair<unsigned int, unsigned int>> availablePositions;
+	pair<unsigned int, unsigned int> closest = make_pair(-1, -1);
+	unsigned int closestGap = UNREACHED;
+
+	for (size_t cell : reached) {
+		pair<unsigned int, unsigned int> position = make_pair(static_cast<unsigned int>(cell / height), static_cast<unsigned int>(cell % height));
+		if (cell == start || fields[position.first][position.second]->getFieldType() != FieldType::PASSAGE ||
+			!minotaurPositionChessboardCheck(robot_x, position)) {
+			continue;
+		}
+
+		unsigned int steps = distance[cell];
+		if (steps >= low && steps <= high) {
+			availablePositions.push_back(position);
+		}
+		else {
+			unsigned int gap = steps < low ? low - steps : steps - high;
+			if (gap < closestGap) {
+				closestGap = gap;
+				closest = position;
 			}
 		}
 	}
 
-	if (availablePositions.empty()) {
-		cerr << "Warning: No available positions for minotaur!\n";
-		return make_pair(-1, -1);
+	if (!availablePositions.empty()) {
+		return availablePositions[RNGEngine::getRandomNumber(0, static_cast<unsigned int>(availablePositions.size()) - 1)];
 	}
-
-	pair<unsigned int, unsigned int> minotaur_pos = availablePositions[RNGEngine::getRandomNumber(0, static_cast<unsigned int>(availablePositions.size()) - 1)];
-	while (!minotaurPositionChessboardCheck(robot_x, minotaur_pos)) {
-		minotaur_pos = availablePositions[RNGEngine::getRandomNumber(0, static_cast<unsigned int>(availablePositions.size()) - 1)];
+	if (closestGap == UNREACHED) {
+		cerr << "Warning: No available positions for minotaur!\n";
 	}
-	return minotaur_pos;
+	return closest;
 }
 
-microseconds Matrix::generateMatrix(unsigned int no_of_items) {
+microseconds Matrix::generateMatrix(unsigned int no_of_items, bool connectExit) {
 	auto start_time = high_resolution_clock::now();
 
-	pair<unsigned int, unsigned int> entrance_and_exit = setEntranceAndExit();
-
-	generativePrim(entrance_and_exit.first);
+	pair<unsigned int, unsigned int> entrance_and_exit;
+	{
+		MemoryScope scope(MemorySubsystem::PRIM);
+		entrance_and_exit = setEntranceAndExit();
 
-	assurePathConnectivity(entrance_and_exit.second);
+		generativePrim(entrance_and_exit.first);
 
-	placeItems(no_of_items, entrance_and_exit.first, 1);
+		// A cancelled Prim leaves half a maze: nothing after it is worth doing
+		if (cancelled != nullptr && *cancelled) {
+			return duration_cast<microseconds>(high_resolution_clock::now() - start_time);
+		}
 
-	auto end_time = high_resolution_clock::now();
+		if (connectExit && height % 2 == 0) {
+			breakUpBottomRow();
+		}
+	}
+	{
+		MemoryScope scope(MemorySubsystem::ITEMS);
+		placeItems(no_of_items, entrance_and_exit.first, 1);
+	}
 
-	auto duration_microseconds = duration_cast<microseconds>(end_time - start_time);
-	auto duration_milliseconds = duration_cast<milliseconds>(end_time - start_time);
+	// Whatever Prim and the bottom row left unreachable (the exit, stray items) gets linked up
+	if (connectExit) {
+		MemoryScope scope(MemorySubsystem::CONNECT);
+		connectComponents(entrance_and_exit.first, 1);
+	}
 
-	cout << "\x1B[38;2;0;0;155;47m" << " - Quick Trivia: " << ANSICodes::RESET << " Legend says that it took Daedalus only " << duration_milliseconds.count() << " ms ("
-		<< duration_microseconds.count() << " microseconds) to build the labyrinth (apparently Zeus helped him)...\n\n";
+	auto end_time = high_resolution_clock::now();
 
-	return duration_microseconds;
+	return duration_cast<microseconds>(end_time - start_time);
 }
 
-void Matrix::printMatrix(unsigned int robot_x, unsigned int robot_y, unsigned int minotaur_x, unsigned int minotaur_y) const {
+void Matrix::printMatrix(unsigned int robot_x, unsigned int robot_y, unsigned int minotaur_x, unsigned int minotaur_y, std::ostream& out) const {
+	MemoryScope scope(MemorySubsystem::RENDERING);
+
 	for (unsigned int i = 0; i < height; ++i) {
-		cout << "  ";
+		out << "  ";
 		for (unsigned int j = 0; j < width; ++j) {
 			if (robot_x == j && robot_y == i)
-				cout << ANSICodes::ROBOT_STYLE << 'R' << ANSICodes::RESET;
+				out << ANSICodes::ROBOT_STYLE << 'R' << ANSICodes::RESET;
 			else if (minotaur_x == j && minotaur_y == i)
-				cout << ANSICodes::MINOTAUR_STYLE << 'M' << ANSICodes::RESET;
+				out << ANSICodes::MINOTAUR_STYLE << 'M' << ANSICodes::RESET;
 			else {
 				if (fields[j][i]->getFieldType() == FieldType::WALL)
-					cout << ANSICodes::WALL_STYLE << fields[j][i]->getSymbol() << ANSICodes::RESET;
+					out << ANSICodes::WALL_STYLE << fields[j][i]->getSymbol() << ANSICodes::RESET;
 				else if (fields[j][i]->getFieldType() == FieldType::ITEM)
-					cout << ANSICodes::ITEM_STYLE << fields[j][i]->getSymbol() << ANSICodes::RESET;
+					out << ANSICodes::ITEM_STYLE << fields[j][i]->getSymbol() << ANSICodes::RESET;
 				else if (fields[j][i]->getFieldType() == FieldType::ENTRANCE)
-					cout << ANSICodes::ENTRANCE_STYLE << fields[j][i]->getSymbol() << ANSICodes::RESET;
+					out << ANSICodes::ENTRANCE_STYLE << fields[j][i]->getSymbol() << ANSICodes::RESET;
 				else if (fields[j][i]->getFieldType() == FieldType::EXIT)
-					cout << ANSICodes::EXIT_STYLE << fields[j][i]->getSymbol() << ANSICodes::RESET;
-				else cout << fields[j][i]->getSymbol();
+					out << ANSICodes::EXIT_STYLE << fields[j][i]->getSymbol() << ANSICodes::RESET;
+				else if (fields[j][i]->getFieldType() == FieldType::STAIRS_UP || fields[j][i]->getFieldType() == FieldType::STAIRS_DOWN)
+					out << ANSICodes::STAIRS_STYLE << fields[j][i]->getSymbol() << ANSICodes::RESET;
+				else out << fields[j][i]->getSymbol();
 			}
 		}
 
 		if (i == 1) { 
-			cout << "      o Sword: \x1B[31m        0 0 0" << ANSICodes::RESET;
+			out << "      o Sword: \x1B[31m        0 0 0" << ANSICodes::RESET;
 		}
 		else if (i == 3) {
-			cout << "      o Shield: \x1B[31m       0 0 0" << ANSICodes::RESET;
+			out << "      o Shield: \x1B[31m       0 0 0" << ANSICodes::RESET;
 		}
 		else if (i == 5) {
-			cout << "      o Hammer: \x1B[31m       0 0 0" << ANSICodes::RESET;
+			out << "      o Hammer: \x1B[31m       0 0 0" << ANSICodes::RESET;
 		} 
 		else if (i == 7) { 
-			cout << "      o Fog of War: \x1B[31m   0 0 0" << ANSICodes::RESET;
+			out << "      o Fog of War: \x1B[31m   0 0 0" << ANSICodes::RESET;
 		}
 
-		cout << "\n";
+		out << "\n";
 	}
-	cout << "\n";
+	out << "\n";
+}
+void Matrix::setCancellation(const std::atomic<bool>* flag) {
+	cancelled = flag;
 }
+
+void Matrix::setProgress(std::atomic<unsigned int>* counter) {
+	progress = counter;
+}
+
+const vector<FieldChange>& Matrix::getFieldChanges() const {
+	return fieldChanges;
+}
+
 unsigned int Matrix::getEntranceX() const {
 	for (unsigned int x = 0; x < width; ++x) {
 		if (getFieldType(x, 0) == FieldType::ENTRANCE) {
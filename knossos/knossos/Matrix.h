@@ -1,36 +1,79 @@
 #pragma once
 
 #include <chrono>
+#include <vector>
+#include <atomic>
+#include <iostream>
 #include "MatrixField.h"
 
 using std::pair;
+using std::vector;
 using std::chrono::microseconds;
 
+// Where the Minotaur may start: a range of walking distances from the hero's start,
+// in percent of the distance to the farthest cell the hero can reach
+struct SpawnBand {
+	unsigned int low;
+	unsigned int high;
+
+	SpawnBand(unsigned int low = 30, unsigned int high = 60) : low(low), high(high) {}
+};
+
 class Matrix {
 private:
 	unsigned int width;
 	unsigned int height;
 	MatrixField*** fields;
+	vector<FieldChange> fieldChanges;
+	const std::atomic<bool>* cancelled;
+	std::atomic<unsigned int>* progress;
 
 	pair<unsigned int, unsigned int> setEntranceAndExit();
 	bool minotaurPositionChessboardCheck(unsigned int robot_x, pair<unsigned int, unsigned int> minotaur_pos) const;
 	void generativePrim(unsigned int entrance_x);
-	void assurePathConnectivity(unsigned int exit_x);
+	void breakUpBottomRow();
+	// Link every component holding the exit or an item to the robot's start by carving the fewest walls
+	void connectComponents(unsigned int robot_x, unsigned int robot_y);
 	void placeItems(unsigned int no_of_items, unsigned int robot_x, unsigned int robot_y);
 	MatrixField* createRandomItem() const;
+	MatrixField* createField(FieldType fieldType) const;
 
 public:
+	// Bump whenever generateMatrix consumes randomness differently - seeds from
+	// saves made by another generator version no longer reproduce the same maze
+	static const unsigned int GENERATOR_VERSION = 4;
 
-	Matrix(unsigned int w, unsigned int h);
+	/**
+	 * @brief Allocate a w x h matrix, walled in completely unless fillWithWalls is false,
+	 * in which case every cell must be filled through initializeField before use
+	 */
+	Matrix(unsigned int w, unsigned int h, bool fillWithWalls = true);
 	~Matrix();
 
 	bool isBoundaryOrOutside(unsigned int x, unsigned int y) const;
 	MatrixField* getField(unsigned int x, unsigned int y) const;
 	FieldType getFieldType(unsigned int x, unsigned int y) const;
 	void setField(unsigned int x, unsigned int y, FieldType fieldType);
-	microseconds generateMatrix(unsigned int no_of_items);
-	void printMatrix(unsigned int robot_x, unsigned int robot_y, unsigned int minotaur_x, unsigned int minotaur_y) const;
-	pair<unsigned int, unsigned int> getRandomPassageForMinotaur(unsigned int robot_x) const;
+	// Like setField, but not recorded as a change - for building a maze from outside
+	// (e.g. a loaded file). Safe to call concurrently for distinct cells.
+	void initializeField(unsigned int x, unsigned int y, FieldType fieldType);
+	// initializeField for an item of a known kind (ITEM fields are otherwise drawn at random)
+	void initializeItem(unsigned int x, unsigned int y, ItemType itemType);
+	// connectExit = false leaves the bare Prim maze, items possibly out of reach (for analysing the generator, not for play)
+	microseconds generateMatrix(unsigned int no_of_items, bool connectExit = true);
+	// Once the flag is set, generateMatrix gives up early and leaves an unusable maze
+	void setCancellation(const std::atomic<bool>* flag);
+	// Prim's step count (one per cell it carves) is published here every few thousand steps
+	void setProgress(std::atomic<unsigned int>* counter);
+	void printMatrix(unsigned int robot_x, unsigned int robot_y, unsigned int minotaur_x, unsigned int minotaur_y, std::ostream& out = std::cout) const;
+	/**
+	 * @brief Pick the Minotaur's start: uniformly among passages of the robot's chessboard
+	 * color whose walking distance from the robot lies in the band. With none in the band,
+	 * the reachable cell closest to it (first in BFS order) is taken. One BFS, no retries.
+	 * @return (-1, -1) if the robot can't reach any suitable passage at all
+	 */
+	pair<unsigned int, unsigned int> getRandomPassageForMinotaur(unsigned int robot_x, SpawnBand band = SpawnBand()) const;
+	const vector<FieldChange>& getFieldChanges() const;
 	unsigned int getEntranceX() const;
 	unsigned int getWidth() const;
 	unsigned int getHeight() const;
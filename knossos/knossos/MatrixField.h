@@ -7,7 +7,16 @@ enum class FieldType {
 	WALL,
 	ENTRANCE,
 	EXIT,
-	ITEM
+	ITEM,
+	STAIRS_UP,      // multi-level games: linked to the stairs down of the floor above
+	STAIRS_DOWN
+};
+
+// A single in-game modification of the generated maze (broken wall, consumed item)
+struct FieldChange {
+	unsigned int x;
+	unsigned int y;
+	FieldType fieldType;
 };
 
 enum class ItemType {
@@ -101,6 +110,40 @@ public:
 	}
 };
 
+class StairsUp : public MatrixField {
+public:
+	StairsUp() : MatrixField(FieldType::STAIRS_UP, '<', true) {}
+
+	FieldType getFieldType() const override {
+		return FieldType::STAIRS_UP;
+	}
+
+	char getSymbol() const override {
+		return '<';
+	}
+
+	bool isWalkable() const override {
+		return true;
+	}
+};
+
+class StairsDown : public MatrixField {
+public:
+	StairsDown() : MatrixField(FieldType::STAIRS_DOWN, '>', true) {}
+
+	FieldType getFieldType() const override {
+		return FieldType::STAIRS_DOWN;
+	}
+
+	char getSymbol() const override {
+		return '>';
+	}
+
+	bool isWalkable() const override {
+		return true;
+	}
+};
+
 class Item : public MatrixField {
 protected:
 	ItemType itemType;
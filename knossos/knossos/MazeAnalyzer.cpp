@@ -0,0 +1,239 @@
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <atomic>
+#include <thread>
+#include <chrono>
+#include <memory>
+#include <cstdint>
+#include <algorithm>
+#include <climits>
+
+#include "MazeAnalyzer.h"
+#include "Bitboard.h"
+#include "MazeLoader.h"
+#include "RNGEngine.h"
+
+using std::string;
+using std::vector;
+using std::cout;
+using std::cerr;
+using std::make_pair;
+
+namespace {
+
+// Cell codes of the analysis grid
+const uint8_t CELL_WALL = 0;
+const uint8_t CELL_OPEN = 1;
+const uint8_t CELL_ITEM = 2;
+
+}
+
+MazeMetrics MazeAnalyzer::analyze(const Matrix& matrix, const string& source) {
+    return analyze(matrix, source, make_pair(UINT_MAX, UINT_MAX));
+}
+
+MazeMetrics MazeAnalyzer::analyze(const Matrix& matrix, const string& source, pair<unsigned int, unsigned int> minotaur) {
+    const unsigned int width = matrix.getWidth();
+    const unsigned int height = matrix.getHeight();
+
+    MazeMetrics metrics = {};
+    metrics.source = source;
+    metrics.width = width;
+    metrics.height = height;
+    metrics.solutionLength = -1;
+    metrics.minotaurDistance = -1;
+
+    // Column-major like the matrix itself, so it's read in allocation order; the
+    // bitboards of open cells and items are filled in the same pass
+    vector<uint8_t> cells(static_cast<size_t>(width) * height);
+    Bitboard open(width, height), items(width, height);
+    pair<unsigned int, unsigned int> entrance = make_pair(UINT_MAX, UINT_MAX), exit = make_pair(UINT_MAX, UINT_MAX);
+
+    for (unsigned int x = 0; x < width; ++x) {
+        uint8_t* column = &cells[static_cast<size_t>(x) * height];
+        for (unsigned int y = 0; y < height; ++y) {
+            FieldType type = matrix.getFieldType(x, y);
+            column[y] = type == FieldType::WALL ? CELL_WALL : type == FieldType::ITEM ? CELL_ITEM : CELL_OPEN;
+            if (type != FieldType::WALL) open.set(x, y);
+            if (type == FieldType::ITEM) items.set(x, y);
+            else if (type == FieldType::ENTRANCE) entrance = make_pair(x, y);
+            else if (type == FieldType::EXIT) exit = make_pair(x, y);
+        }
+    }
+
+    // The single pass: degrees, items and straight runs. Vertical runs are the
+    // current column's, horizontal runs carry over per row from column to column
+    vector<unsigned int> horizontalRun(height, 0);
+
+    for (unsigned int x = 0; x < width; ++x) {
+        const uint8_t* column = &cells[static_cast<size_t>(x) * height];
+        const uint8_t* left = x > 0 ? column - height : nullptr;
+        const uint8_t* right = x + 1 < width ? column + height : nullptr;
+        unsigned int verticalRun = 0;
+
+        for (unsigned int y = 0; y < height; ++y) {
+            if (column[y] == CELL_WALL) {
+                verticalRun = 0;
+                horizontalRun[y] = 0;
+                continue;
+            }
+
+            ++metrics.openCells;
+            if (column[y] == CELL_ITEM) ++metrics.items;
+
+            unsigned int degree = (y > 0 && column[y - 1] != CELL_WALL) + (y + 1 < height && column[y + 1] != CELL_WALL) +
+                (left && left[y] != CELL_WALL) + (right && right[y] != CELL_WALL);
+            ++metrics.degreeHistogram[degree];
+
+            metrics.longestCorridor = std::max(metrics.longestCorridor, std::max(++verticalRun, ++horizontalRun[y]));
+        }
+    }
+
+    unsigned int junctions = metrics.degreeHistogram[3] + metrics.degreeHistogram[4];
+    metrics.deadEnds = metrics.degreeHistogram[1];
+    metrics.deadEndRatio = metrics.openCells ? static_cast<double>(metrics.deadEnds) / metrics.openCells : 0.0;
+    metrics.riverFactor = static_cast<double>(metrics.degreeHistogram[2]) / std::max(1u, metrics.deadEnds + junctions);
+
+    // The one BFS, from the entrance, a distance layer at a time: the solution length
+    // and the Minotaur's distance are the layers their cells turn up in, the reachable
+    // items those among the cells reached once the layers run out
+    if (entrance.first == UINT_MAX) {
+        return metrics;
+    }
+
+    Bitboard start(width, height);
+    start.set(entrance.first, entrance.second);
+    DistanceLayers layers(open, start);
+    const bool minotaurInside = minotaur.first < width && minotaur.second < height;
+    do {
+        const Bitboard& frontier = layers.frontier();
+        if (exit.first != UINT_MAX && frontier.test(exit.first, exit.second)) {
+            metrics.solutionLength = layers.distance();
+        }
+        if (minotaurInside && frontier.test(minotaur.first, minotaur.second)) {
+            metrics.minotaurDistance = layers.distance();
+        }
+    } while (layers.next());
+
+    items &= layers.reached();
+    metrics.reachableItems = static_cast<unsigned int>(items.count());
+    return metrics;
+}
+
+void MazeAnalyzer::writeCsvHeader(std::ostream& out) {
+    out << "source,width,height,open_cells,solution_length,dead_ends,dead_end_ratio,"
+        << "degree_0,degree_1,degree_2,degree_3,degree_4,longest_corridor,river_factor,items,reachable_items,minotaur_distance\n";
+}
+
+void MazeAnalyzer::writeCsvRow(std::ostream& out, const MazeMetrics& metrics) {
+    out << metrics.source << ',' << metrics.width << ',' << metrics.height << ',' << metrics.openCells << ','
+        << metrics.solutionLength << ',' << metrics.deadEnds << ',' << metrics.deadEndRatio;
+    for (unsigned int count : metrics.degreeHistogram) {
+        out << ',' << count;
+    }
+    out << ',' << metrics.longestCorridor << ',' << metrics.riverFactor << ','
+        << metrics.items << ',' << metrics.reachableItems << ',' << metrics.minotaurDistance << '\n';
+}
+
+bool MazeAnalyzer::run(const AnalysisRequest& request) {
+    const bool fromFiles = !request.mazeFiles.empty();
+    const size_t total = fromFiles ? request.mazeFiles.size() : request.count;
+    const unsigned int firstSeed = request.hasSeed ? request.firstSeed : RNGEngine::generateSeed();
+
+    unsigned int threadCount = request.threads ? request.threads : std::thread::hardware_concurrency();
+    threadCount = static_cast<unsigned int>(std::max<size_t>(1, std::min<size_t>(threadCount ? threadCount : 1, total)));
+
+    std::ofstream csvFile;
+    if (!request.csvFile.empty()) {
+        csvFile.open(request.csvFile);
+        if (!csvFile) {
+            cerr << "Error: Could not write " << request.csvFile << "\n";
+            return false;
+        }
+    }
+    std::ostream& out = request.csvFile.empty() ? cout : csvFile;
+
+    // Whole mazes are the unit of work: each worker claims the next index, builds
+    // the maze on its own thread (the RNG is per thread) and fills that result slot
+    vector<MazeMetrics> results(total);
+    vector<char> failed(total, 0);
+    std::atomic<size_t> nextMaze(0);
+    std::atomic<size_t> mazesDone(0);
+    bool progressShown = false;
+
+    auto worker = [&]() {
+        for (size_t index = nextMaze++; index < total; index = nextMaze++) {
+            std::unique_ptr<Matrix> matrix;
+            string source;
+            pair<unsigned int, unsigned int> minotaur = make_pair(UINT_MAX, UINT_MAX);
+
+            if (fromFiles) {
+                source = request.mazeFiles[index];
+                unsigned int no_of_items = 0;
+                string error;
+                matrix.reset(MazeLoader::loadMaze(source, no_of_items, error));
+                if (!matrix) {
+                    cerr << "Error: " << error << "\n";
+                    failed[index] = 1;
+                    ++mazesDone;
+                    continue;
+                }
+            }
+            else {
+                unsigned int seed = firstSeed + static_cast<unsigned int>(index);
+                source = std::to_string(seed);
+                RNGEngine::seed(seed);
+                matrix.reset(new Matrix(request.width, request.height));
+                matrix->generateMatrix(request.no_of_items, !request.primOnly);
+
+                // Drawn right after generation, exactly as a new game does
+                minotaur = matrix->getRandomPassageForMinotaur(matrix->getEntranceX());
+            }
+
+            results[index] = analyze(*matrix, source, minotaur);
+            ++mazesDone;
+        }
+    };
+
+    auto start_time = std::chrono::steady_clock::now();
+
+    vector<std::thread> threads;
+    for (unsigned int i = 1; i < threadCount; ++i) {
+        threads.emplace_back(worker);
+    }
+
+    // Progress goes to stderr so the CSV can be piped; a small job simply finishes quietly
+    std::thread progress([&]() {
+        auto lastReport = std::chrono::steady_clock::now();
+        while (mazesDone < total) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(50));
+            if (std::chrono::steady_clock::now() - lastReport >= std::chrono::seconds(2)) {
+                cerr << "\r" << mazesDone << " / " << total << " mazes analysed" << std::flush;
+                progressShown = true;
+                lastReport = std::chrono::steady_clock::now();
+            }
+        }
+    });
+
+    worker();
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+    progress.join();
+
+    writeCsvHeader(out);
+    size_t written = 0;
+    for (size_t i = 0; i < total; ++i) {
+        if (!failed[i]) {
+            writeCsvRow(out, results[i]);
+            ++written;
+        }
+    }
+    out.flush();
+
+    auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start_time);
+    cerr << (progressShown ? "\n" : "") << "Analysed " << written << " mazes in " << elapsed.count() << " ms on " << threadCount << " threads\n";
+
+    return written == total;
+}
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <iostream>
+#include "Matrix.h"
+
+// What to analyse: a run of consecutive seeds, or maze files (see MazeLoader)
+struct AnalysisRequest {
+    unsigned int width;
+    unsigned int height;
+    unsigned int no_of_items;
+    bool hasSeed;
+    unsigned int firstSeed;
+    unsigned int count;
+    bool primOnly;              // stop after generativePrim, without the connectivity pass
+    std::vector<std::string> mazeFiles;
+    unsigned int threads;       // 0 for one per hardware thread
+    std::string csvFile;        // empty for stdout
+
+    AnalysisRequest() : width(0), height(0), no_of_items(0), hasSeed(false), firstSeed(0), count(1),
+        primOnly(false), threads(0) {}
+};
+
+struct MazeMetrics {
+    std::string source;             // seed or file name
+    unsigned int width;
+    unsigned int height;
+    unsigned int openCells;         // everything walkable, items and doors included
+    long long solutionLength;       // steps from entrance to exit, -1 if there's no way out
+    unsigned int deadEnds;
+    double deadEndRatio;            // dead ends per open cell
+    unsigned int degreeHistogram[5];    // open cells by number of open neighbours
+    unsigned int longestCorridor;   // longest straight run of open cells
+    double riverFactor;             // corridor cells per dead end or junction
+    unsigned int items;
+    unsigned int reachableItems;
+    long long minotaurDistance;     // steps from the entrance to where the Minotaur spawns, -1 if unknown
+};
+
+/**
+ * @brief Objective maze difficulty metrics.
+ *
+ * A maze is read into a compact byte grid once, every local metric comes out of a
+ * single pass over that grid and the solution length and reachable items out of
+ * one bitboard BFS from the entrance (see DistanceLayers). Batches spread whole
+ * mazes over worker threads, each of which generates and analyses its own mazes,
+ * and are written out as CSV.
+ *
+ * The river factor is the average number of plain corridor cells (exactly two
+ * open neighbours) per decision point (dead end or junction): mazes that "flow"
+ * in long winding passages score high, bushy mazes with many short branches low.
+ */
+class MazeAnalyzer {
+public:
+    static MazeMetrics analyze(const Matrix& matrix, const std::string& source);
+
+    // Also measures how far from the entrance the Minotaur starts
+    static MazeMetrics analyze(const Matrix& matrix, const std::string& source, pair<unsigned int, unsigned int> minotaur);
+
+    // Generate or load every maze of the request in parallel and write one CSV row each
+    static bool run(const AnalysisRequest& request);
+
+    static void writeCsvHeader(std::ostream& out);
+    static void writeCsvRow(std::ostream& out, const MazeMetrics& metrics);
+};
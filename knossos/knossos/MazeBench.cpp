@@ -0,0 +1,111 @@
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <algorithm>
+
+#include "MazeBench.h"
+#include "FixedMatrix.h"
+#include "RNGEngine.h"
+#include "MemoryStats.h"
+
+using std::cout;
+using std::cerr;
+using std::pair;
+using std::chrono::steady_clock;
+
+namespace {
+
+// Seeds compared cell by cell before anything is timed
+const unsigned int COMPARED_SEEDS = 200;
+
+template <typename Tier>
+bool sameMaze(const Tier& fixed, const Matrix& matrix) {
+    for (unsigned int x = 0; x < Tier::getWidth(); ++x) {
+        for (unsigned int y = 0; y < Tier::getHeight(); ++y) {
+            if (fixed.getCell(x, y) != TiledCell::of(matrix.getField(x, y))) return false;
+        }
+    }
+    return true;
+}
+
+double secondsSince(steady_clock::time_point start) {
+    return std::chrono::duration<double>(steady_clock::now() - start).count();
+}
+
+}
+
+bool MazeBench::run(const BenchRequest& request) {
+    const unsigned int firstSeed = request.hasSeed ? request.firstSeed : RNGEngine::generateSeed();
+    const unsigned int compared = std::min(request.count, COMPARED_SEEDS);
+    bool identical = true;
+    double matrixSeconds = 0, tierSeconds = 0;
+    uint64_t matrixAllocations = 0, tierAllocations = 0;
+    unsigned long long checksum = 0;    // keeps the timed work from being optimised away
+
+    bool tiered = MatrixTiers::withTier(request.width, request.height, [&](auto& tier) {
+        using Tier = typename std::decay<decltype(tier)>::type;
+
+        for (unsigned int i = 0; i < compared && identical; ++i) {
+            Matrix matrix(request.width, request.height);
+            RNGEngine::seed(firstSeed + i);
+            matrix.generateMatrix(request.no_of_items);
+            pair<unsigned int, unsigned int> matrixMinotaur = matrix.getRandomPassageForMinotaur(matrix.getEntranceX());
+
+            Tier fixed;
+            RNGEngine::seed(firstSeed + i);
+            fixed.generateMatrix(request.no_of_items);
+            pair<unsigned int, unsigned int> fixedMinotaur = fixed.getRandomPassageForMinotaur(fixed.getEntranceX());
+
+            if (!sameMaze(fixed, matrix) || fixedMinotaur != matrixMinotaur) {
+                cerr << "Error: Seed " << firstSeed + i << " gives a different maze as a FixedMatrix\n";
+                identical = false;
+            }
+        }
+        if (!identical) return;
+
+        uint64_t allocationsBefore = MemoryStats::snapshot().allocations();
+        auto start = steady_clock::now();
+        for (unsigned int i = 0; i < request.count; ++i) {
+            Matrix matrix(request.width, request.height);
+            RNGEngine::seed(firstSeed + i);
+            matrix.generateMatrix(request.no_of_items);
+            checksum += matrix.getRandomPassageForMinotaur(matrix.getEntranceX()).first;
+        }
+        matrixSeconds = secondsSince(start);
+        matrixAllocations = MemoryStats::snapshot().allocations() - allocationsBefore;
+
+        allocationsBefore = MemoryStats::snapshot().allocations();
+        start = steady_clock::now();
+        for (unsigned int i = 0; i < request.count; ++i) {
+            Tier fixed;
+            RNGEngine::seed(firstSeed + i);
+            fixed.generateMatrix(request.no_of_items);
+            checksum -= fixed.getRandomPassageForMinotaur(fixed.getEntranceX()).first;
+        }
+        tierSeconds = secondsSince(start);
+        tierAllocations = MemoryStats::snapshot().allocations() - allocationsBefore;
+    });
+
+    if (!tiered) {
+        cerr << "Error: " << request.width << "x" << request.height << " has no fixed-size tier (17x17, 31x31 or 63x63)\n";
+        return false;
+    }
+    if (!identical) {
+        return false;
+    }
+
+    cout << request.count << " mazes of " << request.width << "x" << request.height << " with " << request.no_of_items
+        << " items, seeds " << firstSeed << " to " << firstSeed + request.count - 1 << ", generated and given a Minotaur\n\n";
+    cout << "                us per maze   mazes per second\n" << std::fixed << std::setprecision(1);
+    cout << "Matrix      " << std::setw(15) << matrixSeconds * 1e6 / request.count << std::setw(19) << request.count / matrixSeconds << "\n";
+    cout << "FixedMatrix " << std::setw(15) << tierSeconds * 1e6 / request.count << std::setw(19) << request.count / tierSeconds << "\n\n";
+    cout << "Speedup: " << std::setprecision(2) << matrixSeconds / tierSeconds << "x, the first " << compared
+        << " mazes identical" << (checksum == 0 ? "" : " (Minotaur starts differ later on)") << "\n";
+
+    if (MemoryStats::ENABLED) {
+        cout << "Allocations per maze: " << static_cast<double>(matrixAllocations) / request.count << " as a Matrix, "
+            << static_cast<double>(tierAllocations) / request.count << " as a FixedMatrix\n\n";
+        MemoryStats::printSummary(MemoryStats::snapshot(), cout);
+    }
+    return checksum == 0;
+}
@@ -0,0 +1,25 @@
+#pragma once
+
+// Mazes of consecutive seeds, generated once as a Matrix and once as its FixedMatrix tier
+struct BenchRequest {
+    unsigned int width;
+    unsigned int height;
+    unsigned int no_of_items;
+    bool hasSeed;
+    unsigned int firstSeed;
+    unsigned int count;
+
+    BenchRequest() : width(0), height(0), no_of_items(0), hasSeed(false), firstSeed(0), count(DEFAULT_COUNT) {}
+
+    static const unsigned int DEFAULT_COUNT = 10000;
+};
+
+/**
+ * @brief Times generating a maze and picking the Minotaur's start, as a heap Matrix
+ * against the FixedMatrix of the same size (see MatrixTiers), after checking on the
+ * first seeds that both come out cell for cell the same.
+ */
+class MazeBench {
+public:
+    static bool run(const BenchRequest& request);
+};
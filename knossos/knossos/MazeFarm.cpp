@@ -0,0 +1,348 @@
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <algorithm>
+#include <cstdio>
+
+#include "MazeFarm.h"
+#include "MazeRecord.h"
+#include "BoundedQueue.h"
+#include "Bitboard.h"
+#include "FixedMatrix.h"
+#include "AsyncFileWriter.h"
+#include "RNGEngine.h"
+
+using std::string;
+using std::vector;
+using std::cout;
+using std::cerr;
+using std::atomic;
+using std::chrono::steady_clock;
+using std::chrono::duration_cast;
+
+namespace {
+
+// What the queues between the stages may hold at most, roughly
+const size_t QUEUED_BYTES = 256 * 1024 * 1024;
+// A Matrix costs a pointer and a heap cell per field
+const size_t MATRIX_BYTES_PER_CELL = 24;
+
+// A maze generated as a FixedMatrix tier, kept as its cells once the tier is gone
+struct TierCells {
+    unsigned int width;
+    unsigned int height;
+    vector<uint8_t> cells;      // TiledCell codes, column-major like FixedMatrix
+
+    unsigned int getWidth() const { return width; }
+    unsigned int getHeight() const { return height; }
+    FieldType getFieldType(unsigned int x, unsigned int y) const {
+        return TiledCell::fieldType(cells[static_cast<size_t>(x) * height + y]);
+    }
+};
+
+struct FarmedMaze {
+    unsigned int seed;
+    Matrix* matrix;             // nullptr when the size has a tier
+    TierCells tier;
+};
+
+// Busy time is spent on mazes; the rest of a stage's time it waits on its queues
+struct StageStats {
+    const char* name;
+    unsigned int workers;
+    atomic<uint64_t> done;
+    atomic<uint64_t> busyMicros;
+    atomic<uint64_t> starvedMicros;     // for input
+    atomic<uint64_t> blockedMicros;     // for room in the next queue
+    uint64_t depthSum;                  // of the input queue, sampled by the monitor
+    uint64_t depthSamples;
+    size_t depthMax;
+
+    StageStats(const char* name, unsigned int workers) : name(name), workers(workers), done(0), busyMicros(0),
+        starvedMicros(0), blockedMicros(0), depthSum(0), depthSamples(0), depthMax(0) {}
+};
+
+uint64_t microsSince(steady_clock::time_point start) {
+    return duration_cast<std::chrono::microseconds>(steady_clock::now() - start).count();
+}
+
+// The queues never block, so waiting is up to the caller: spin, then yield, then sleep
+void backOff(unsigned int attempt) {
+    if (attempt < 16) return;
+    if (attempt < 64) std::this_thread::yield();
+    else std::this_thread::sleep_for(std::chrono::microseconds(200));
+}
+
+template <typename T>
+void pushWaiting(BoundedQueue<T>& queue, T& value, StageStats& stage) {
+    if (queue.tryPush(value)) return;
+    auto start = steady_clock::now();
+    for (unsigned int attempt = 0; !queue.tryPush(value); ++attempt) {
+        backOff(attempt);
+    }
+    stage.blockedMicros += microsSince(start);
+}
+
+// False once the queue is empty and the stage feeding it has finished
+template <typename T>
+bool popWaiting(BoundedQueue<T>& queue, T& value, const atomic<bool>& upstreamDone, StageStats& stage) {
+    if (queue.tryPop(value)) return true;
+    auto start = steady_clock::now();
+    for (unsigned int attempt = 0;; ++attempt) {
+        // Read before the last look at the queue, so nothing pushed before it is missed
+        bool finished = upstreamDone.load();
+        if (queue.tryPop(value)) {
+            stage.starvedMicros += microsSince(start);
+            return true;
+        }
+        if (finished) {
+            stage.starvedMicros += microsSince(start);
+            return false;
+        }
+        backOff(attempt);
+    }
+}
+
+// Exit and every item reachable from the entrance, and as many items as asked for
+template <typename Maze>
+bool playable(const Maze& matrix, unsigned int no_of_items) {
+    const unsigned int width = matrix.getWidth();
+    const unsigned int height = matrix.getHeight();
+    Bitboard open(width, height), items(width, height), entrance(width, height);
+    unsigned int exit_x = width;
+
+    for (unsigned int x = 0; x < width; ++x) {
+        for (unsigned int y = 0; y < height; ++y) {
+            FieldType type = matrix.getFieldType(x, y);
+            if (type == FieldType::WALL) continue;
+            open.set(x, y);
+            if (type == FieldType::ITEM) items.set(x, y);
+            else if (type == FieldType::ENTRANCE) entrance.set(x, y);
+            else if (type == FieldType::EXIT) exit_x = x;
+        }
+    }
+
+    size_t itemCount = items.count();
+    if (itemCount != no_of_items || exit_x == width) {
+        return false;
+    }
+    Bitboard reached = entrance.floodFill(open);
+    items &= reached;
+    return reached.test(exit_x, height - 1) && items.count() == itemCount;
+}
+
+string libraryFileName(const string& prefix, unsigned int number) {
+    char suffix[16];
+    std::snprintf(suffix, sizeof(suffix), "_%04u.kml", number);
+    return prefix + suffix;
+}
+
+}
+
+bool MazeFarm::run(const FarmRequest& request) {
+    const unsigned int firstSeed = request.hasSeed ? request.firstSeed : RNGEngine::generateSeed();
+    const size_t cells = static_cast<size_t>(request.width) * request.height;
+    const size_t recordBytes = MazeRecord::recordSize(request.width, request.height);
+
+    unsigned int generators = request.threads ? request.threads : std::thread::hardware_concurrency();
+    generators = std::max(1u, std::min(generators ? generators : 1, request.count));
+
+    const size_t matrixSlots = std::max<size_t>(2, std::min<size_t>(64, QUEUED_BYTES / 2 / (cells * MATRIX_BYTES_PER_CELL)));
+    const size_t recordSlots = std::max<size_t>(2, std::min<size_t>(256, QUEUED_BYTES / 2 / recordBytes));
+    BoundedQueue<FarmedMaze> generated(matrixSlots);
+    BoundedQueue<FarmedMaze> validated(matrixSlots);
+    BoundedQueue<string> serialized(recordSlots);
+
+    StageStats generation("generate", generators), validation("validate", 1), serialization("serialize", 1), output("write", 1);
+    StageStats* stages[] = { &generation, &validation, &serialization, &output };
+    atomic<bool> generationDone(false), validationDone(false), serializationDone(false), outputDone(false);
+    atomic<uint64_t> rejected(0);
+
+    std::atomic<unsigned int> nextMaze(0);
+    std::atomic<unsigned int> generatorsLeft(generators);
+    auto generate = [&]() {
+        for (unsigned int index = nextMaze++; index < request.count; index = nextMaze++) {
+            auto start = steady_clock::now();
+            FarmedMaze maze = { firstSeed + index, nullptr, TierCells() };
+            RNGEngine::seed(maze.seed);
+            bool tiered = MatrixTiers::withTier(request.width, request.height, [&](auto& tier) {
+                tier.generateMatrix(request.no_of_items);
+                maze.tier.width = request.width;
+                maze.tier.height = request.height;
+                maze.tier.cells.assign(tier.getCells(), tier.getCells() + cells);
+            });
+            if (!tiered) {
+                maze.matrix = new Matrix(request.width, request.height);
+                maze.matrix->generateMatrix(request.no_of_items);
+            }
+            generation.busyMicros += microsSince(start);
+            pushWaiting(generated, maze, generation);
+            ++generation.done;
+        }
+        if (--generatorsLeft == 0) generationDone = true;
+    };
+
+    auto validate = [&]() {
+        FarmedMaze maze;
+        while (popWaiting(generated, maze, generationDone, validation)) {
+            auto start = steady_clock::now();
+            bool keep = maze.matrix != nullptr ? playable(*maze.matrix, request.no_of_items) : playable(maze.tier, request.no_of_items);
+            validation.busyMicros += microsSince(start);
+            ++validation.done;
+            if (keep) {
+                pushWaiting(validated, maze, validation);
+            }
+            else {
+                delete maze.matrix;
+                ++rejected;
+            }
+        }
+        validationDone = true;
+    };
+
+    auto serialize = [&]() {
+        FarmedMaze maze;
+        while (popWaiting(validated, maze, validationDone, serialization)) {
+            auto start = steady_clock::now();
+            string record;
+            record.reserve(recordBytes);
+            if (maze.matrix != nullptr) {
+                MazeRecord::append(record, *maze.matrix, maze.seed, request.no_of_items);
+                delete maze.matrix;
+            }
+            else {
+                MazeRecord::append(record, maze.tier.cells.data(), request.width, request.height, maze.seed, request.no_of_items);
+            }
+            serialization.busyMicros += microsSince(start);
+            pushWaiting(serialized, record, serialization);
+            ++serialization.done;
+        }
+        serializationDone = true;
+    };
+
+    // Records gather in one buffer behind room for the header; a full buffer is one file
+    vector<string> files;
+    uint64_t bytesWritten = 0;
+    bool writeFailed = false;
+    auto write = [&]() {
+        string batch(MazeRecord::LIBRARY_HEADER_BYTES, '\0');
+        batch.reserve(std::max(request.fileBytes, recordBytes) + MazeRecord::LIBRARY_HEADER_BYTES);
+        uint32_t inBatch = 0;
+
+        auto flush = [&]() {
+            MazeRecord::writeLibraryHeader(batch, 0, inBatch, request.width, request.height, request.no_of_items);
+            string path = libraryFileName(request.outputPrefix, static_cast<unsigned int>(files.size()) + 1);
+            if (!writeFailed && AsyncFileWriter::writeFileAtomically(path, batch)) {
+                files.push_back(path);
+                bytesWritten += batch.size();
+            }
+            else if (!writeFailed) {
+                cerr << "\nError: Could not write " << path << " - the remaining mazes are dropped\n";
+                writeFailed = true;
+            }
+            batch.resize(MazeRecord::LIBRARY_HEADER_BYTES);
+            inBatch = 0;
+        };
+
+        string record;
+        while (popWaiting(serialized, record, serializationDone, output)) {
+            auto start = steady_clock::now();
+            if (inBatch > 0 && batch.size() + record.size() > request.fileBytes) {
+                flush();
+            }
+            batch += record;
+            ++inBatch;
+            ++output.done;
+            output.busyMicros += microsSince(start);
+        }
+        if (inBatch > 0) {
+            auto start = steady_clock::now();
+            flush();
+            output.busyMicros += microsSince(start);
+        }
+        outputDone = true;
+    };
+
+    auto start_time = steady_clock::now();
+    vector<std::thread> threads;
+    for (unsigned int i = 0; i < generators; ++i) {
+        threads.emplace_back(generate);
+    }
+    threads.emplace_back(validate);
+    threads.emplace_back(serialize);
+    threads.emplace_back(write);
+
+    // Queue depths are sampled often, rates reported once a second; a short run stays quiet
+    bool progressShown = false;
+    uint64_t lastDone[4] = { 0, 0, 0, 0 };
+    auto lastReport = steady_clock::now();
+    while (!outputDone) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        const size_t depths[] = { 0, generated.size(), validated.size(), serialized.size() };
+        for (int i = 1; i < 4; ++i) {
+            stages[i]->depthSum += depths[i];
+            ++stages[i]->depthSamples;
+            stages[i]->depthMax = std::max(stages[i]->depthMax, depths[i]);
+        }
+
+        double sinceReport = std::chrono::duration<double>(steady_clock::now() - lastReport).count();
+        if (sinceReport >= 1.0) {
+            std::ostringstream line;
+            line << "\r" << output.done << " / " << request.count << " mazes" << std::fixed << std::setprecision(1);
+            for (int i = 0; i < 4; ++i) {
+                uint64_t done = stages[i]->done;
+                if (i > 0) line << "  [" << depths[i] << "]";
+                line << "  " << stages[i]->name << " " << (done - lastDone[i]) / sinceReport << "/s";
+                lastDone[i] = done;
+            }
+            cerr << line.str() << "   " << std::flush;
+            progressShown = true;
+            lastReport = steady_clock::now();
+        }
+    }
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+
+    const double seconds = std::chrono::duration<double>(steady_clock::now() - start_time).count();
+    if (progressShown) {
+        cerr << "\n";
+    }
+
+    cout << "Farmed " << output.done << " mazes (" << rejected << " rejected) into " << files.size() << " files, "
+        << std::fixed << std::setprecision(1) << bytesWritten / (1024.0 * 1024.0) << " MB, in " << seconds << " s\n\n";
+    cout << "stage        mazes   per second   busy   waiting for input   waiting for room   queue before (avg / max)\n";
+
+    const StageStats* bottleneck = stages[0];
+    double bottleneckBusy = 0;
+    for (const StageStats* stage : stages) {
+        double available = seconds * 1e6 * stage->workers;
+        double busy = stage->busyMicros / available;
+        if (busy > bottleneckBusy) {
+            bottleneckBusy = busy;
+            bottleneck = stage;
+        }
+
+        cout << std::left << std::setw(10) << stage->name << std::right << std::setw(8) << stage->done
+            << std::setw(13) << std::setprecision(1) << stage->done / seconds
+            << std::setw(6) << static_cast<int>(busy * 100 + 0.5) << "%"
+            << std::setw(19) << static_cast<int>(stage->starvedMicros / available * 100 + 0.5) << "%"
+            << std::setw(18) << static_cast<int>(stage->blockedMicros / available * 100 + 0.5) << "%";
+        if (stage->depthSamples > 0) {
+            cout << std::setw(16) << std::setprecision(1) << static_cast<double>(stage->depthSum) / stage->depthSamples
+                << " / " << stage->depthMax;
+        }
+        cout << "\n";
+    }
+    cout << "\nBottleneck: " << bottleneck->name << " (" << static_cast<int>(bottleneckBusy * 100 + 0.5) << "% busy";
+    if (bottleneck->workers > 1) {
+        cout << " across " << bottleneck->workers << " threads";
+    }
+    cout << ")\n";
+
+    return !writeFailed;
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <string>
+#include <cstddef>
+
+// A library of consecutive seeds, written as numbered .kml files (see MazeRecord)
+struct FarmRequest {
+    unsigned int width;
+    unsigned int height;
+    unsigned int no_of_items;
+    bool hasSeed;
+    unsigned int firstSeed;
+    unsigned int count;
+    unsigned int threads;       // generation workers, 0 for one per hardware thread
+    std::string outputPrefix;   // files are <prefix>_0001.kml, <prefix>_0002.kml, ...
+    size_t fileBytes;           // a file is written once this much is batched
+
+    FarmRequest() : width(0), height(0), no_of_items(0), hasSeed(false), firstSeed(0), count(0),
+        threads(0), fileBytes(DEFAULT_FILE_BYTES) {}
+
+    static const size_t DEFAULT_FILE_BYTES = 64 * 1024 * 1024;
+};
+
+/**
+ * @brief Pre-generates maze libraries in a four-stage pipeline.
+ *
+ * Generation workers build mazes from consecutive seeds; a validation stage drops
+ * any maze whose exit or items can't be reached from the entrance, or that holds
+ * fewer items than asked for; a serialization stage packs the survivors into
+ * records; and one I/O stage gathers records until a file's worth is ready, then
+ * writes it out in one go. The stages hand mazes along through bounded lock-free
+ * queues, so a slow stage holds up the ones before it instead of piling up memory.
+ *
+ * Every second a line with each stage's rate and the depth of its input queue goes
+ * to stderr; the summary at the end shows how busy each stage was and names the
+ * busiest one - the bottleneck.
+ */
+class MazeFarm {
+public:
+    static bool run(const FarmRequest& request);
+};
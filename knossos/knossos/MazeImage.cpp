@@ -0,0 +1,421 @@
+#include <fstream>
+#include <iostream>
+#include <vector>
+#include <cstdint>
+#include <algorithm>
+#include <cctype>
+
+#include "MazeImage.h"
+#include "Matrix.h"
+
+using std::string;
+using std::vector;
+using std::ofstream;
+using std::cerr;
+
+// Rows fetched from the matrix at once. Cells are stored column by column, so
+// reading a band column-wise touches each column's slice once
+static const unsigned int ROW_BAND = 64;
+
+// Compressed data is handed out in IDAT chunks of about this size
+static const size_t IDAT_CHUNK_SIZE = 1 << 20;
+
+static const uint8_t LEVEL_WALL = 0;
+static const uint8_t LEVEL_MINOTAUR = 3;
+static const uint8_t LEVEL_DOOR = 6;
+static const uint8_t LEVEL_ITEM = 9;
+static const uint8_t LEVEL_ROBOT = 12;
+static const uint8_t LEVEL_PASSAGE = 15;
+
+// Gray level of every cell in rows [firstRow, lastRow), row-major into levels
+static void readBand(const Matrix& matrix, unsigned int firstRow, unsigned int lastRow,
+    const ImageOverlays& overlays, vector<uint8_t>& levels) {
+
+    unsigned int width = matrix.getWidth();
+    levels.resize(static_cast<size_t>(lastRow - firstRow) * width);
+
+    for (unsigned int x = 0; x < width; ++x) {
+        for (unsigned int y = firstRow; y < lastRow; ++y) {
+            uint8_t level;
+            switch (matrix.getFieldType(x, y)) {
+            case FieldType::WALL: level = LEVEL_WALL; break;
+            case FieldType::ITEM: level = overlays.items ? LEVEL_ITEM : LEVEL_PASSAGE; break;
+            case FieldType::ENTRANCE:
+            case FieldType::EXIT:
+            case FieldType::STAIRS_UP:
+            case FieldType::STAIRS_DOWN: level = overlays.entrance_exit ? LEVEL_DOOR : LEVEL_PASSAGE; break;
+            default: level = LEVEL_PASSAGE;
+            }
+            levels[static_cast<size_t>(y - firstRow) * width + x] = level;
+        }
+    }
+
+    // The characters sit on top of whatever cell they're on
+    if (overlays.robot && overlays.robot_y >= firstRow && overlays.robot_y < lastRow && overlays.robot_x < width) {
+        levels[static_cast<size_t>(overlays.robot_y - firstRow) * width + overlays.robot_x] = LEVEL_ROBOT;
+    }
+    if (overlays.minotaur && overlays.minotaur_y >= firstRow && overlays.minotaur_y < lastRow && overlays.minotaur_x < width) {
+        levels[static_cast<size_t>(overlays.minotaur_y - firstRow) * width + overlays.minotaur_x] = LEVEL_MINOTAUR;
+    }
+}
+
+bool MazeImage::writePBM(const Matrix& matrix, const string& filename) {
+    ofstream file(filename, std::ios::binary);
+    if (!file.is_open()) {
+        cerr << "Error: Could not create image file " << filename << "\n";
+        return false;
+    }
+
+    unsigned int width = matrix.getWidth();
+    unsigned int height = matrix.getHeight();
+    size_t rowBytes = (width + 7) / 8;
+
+    file << "P4\n" << width << " " << height << "\n";
+
+    ImageOverlays none;
+    vector<uint8_t> levels;
+    vector<char> packed;
+
+    for (unsigned int bandStart = 0; bandStart < height; bandStart += ROW_BAND) {
+        unsigned int bandEnd = std::min(height, bandStart + ROW_BAND);
+        readBand(matrix, bandStart, bandEnd, none, levels);
+
+        // 1 is black in PBM; rows are padded to whole bytes
+        packed.assign(rowBytes * (bandEnd - bandStart), 0);
+        for (unsigned int row = 0; row < bandEnd - bandStart; ++row) {
+            const uint8_t* rowLevels = &levels[static_cast<size_t>(row) * width];
+            char* out = &packed[row * rowBytes];
+            for (unsigned int x = 0; x < width; ++x) {
+                if (rowLevels[x] == LEVEL_WALL) {
+                    out[x >> 3] |= static_cast<char>(0x80 >> (x & 7));
+                }
+            }
+        }
+        file.write(packed.data(), packed.size());
+    }
+
+    if (!file.good()) {
+        cerr << "Error: Could not write image file " << filename << "\n";
+        return false;
+    }
+    return true;
+}
+
+namespace {
+
+uint32_t crc32Table[256];
+
+void initializeCrc32Table() {
+    static bool initialized = false;
+    if (initialized) return;
+    for (uint32_t n = 0; n < 256; ++n) {
+        uint32_t c = n;
+        for (int k = 0; k < 8; ++k) {
+            c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+        }
+        crc32Table[n] = c;
+    }
+    initialized = true;
+}
+
+uint32_t updateCrc32(uint32_t crc, const uint8_t* data, size_t length) {
+    for (size_t i = 0; i < length; ++i) {
+        crc = crc32Table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+    }
+    return crc;
+}
+
+void appendBigEndian(vector<uint8_t>& out, uint32_t value) {
+    out.push_back(static_cast<uint8_t>(value >> 24));
+    out.push_back(static_cast<uint8_t>(value >> 16));
+    out.push_back(static_cast<uint8_t>(value >> 8));
+    out.push_back(static_cast<uint8_t>(value));
+}
+
+void writeChunk(ofstream& file, const char* type, const uint8_t* data, size_t length) {
+    vector<uint8_t> header;
+    appendBigEndian(header, static_cast<uint32_t>(length));
+    header.insert(header.end(), type, type + 4);
+
+    uint32_t crc = updateCrc32(0xFFFFFFFFu, header.data() + 4, 4);
+    crc = updateCrc32(crc, data, length) ^ 0xFFFFFFFFu;
+
+    vector<uint8_t> trailer;
+    appendBigEndian(trailer, crc);
+
+    file.write(reinterpret_cast<const char*>(header.data()), header.size());
+    file.write(reinterpret_cast<const char*>(data), length);
+    file.write(reinterpret_cast<const char*>(trailer.data()), trailer.size());
+}
+
+/**
+ * @brief zlib stream holding a single fixed-Huffman deflate block, fed one scanline at a time.
+ *
+ * Maze scanlines repeat a lot - long runs of wall or passage, and rows identical
+ * to the one above - so only two match distances are tried: 1 (runs) and one
+ * scanline back. That needs just the previous scanline as history and gets most
+ * of what a full LZ77 search would.
+ */
+class ScanlineDeflater {
+private:
+    static const unsigned int MIN_MATCH = 3;
+    static const unsigned int MAX_MATCH = 258;
+    static const size_t MAX_DISTANCE = 32768;
+
+    struct Code {
+        uint16_t bits;      // already bit-reversed, ready for LSB-first output
+        uint8_t length;
+    };
+
+    vector<uint8_t>& output;
+    uint64_t bitBuffer;
+    unsigned int bitCount;
+    uint32_t adlerA;
+    uint32_t adlerB;
+    size_t scanlineLength;
+    vector<uint8_t> history;    // previous scanline followed by the current one
+    bool havePrevious;
+
+    Code literalCodes[288];
+    uint8_t lengthSymbol[MAX_MATCH + 1];
+
+    static const uint16_t LENGTH_BASE[29];
+    static const uint8_t LENGTH_EXTRA[29];
+    static const uint16_t DISTANCE_BASE[30];
+    static const uint8_t DISTANCE_EXTRA[30];
+
+    static uint16_t reverseBits(uint16_t code, unsigned int length) {
+        uint16_t reversed = 0;
+        for (unsigned int i = 0; i < length; ++i) {
+            reversed = static_cast<uint16_t>((reversed << 1) | ((code >> i) & 1));
+        }
+        return reversed;
+    }
+
+    void putBits(uint32_t value, unsigned int count) {
+        bitBuffer |= static_cast<uint64_t>(value) << bitCount;
+        bitCount += count;
+        while (bitCount >= 8) {
+            output.push_back(static_cast<uint8_t>(bitBuffer));
+            bitBuffer >>= 8;
+            bitCount -= 8;
+        }
+    }
+
+    void putSymbol(unsigned int symbol) {
+        putBits(literalCodes[symbol].bits, literalCodes[symbol].length);
+    }
+
+    void putMatch(unsigned int length, size_t distance) {
+        unsigned int index = lengthSymbol[length];
+        putSymbol(257 + index);
+        putBits(length - LENGTH_BASE[index], LENGTH_EXTRA[index]);
+
+        unsigned int distanceIndex = 0;
+        while (distanceIndex + 1 < 30 && DISTANCE_BASE[distanceIndex + 1] <= distance) {
+            ++distanceIndex;
+        }
+        // Distance codes are all 5 bits in the fixed code
+        putBits(reverseBits(static_cast<uint16_t>(distanceIndex), 5), 5);
+        putBits(static_cast<uint32_t>(distance - DISTANCE_BASE[distanceIndex]), DISTANCE_EXTRA[distanceIndex]);
+    }
+
+    void updateAdler(const uint8_t* data, size_t length) {
+        // 5552 is the largest block for which the sums can't overflow before the modulo
+        while (length > 0) {
+            size_t block = std::min<size_t>(length, 5552);
+            for (size_t i = 0; i < block; ++i) {
+                adlerA += data[i];
+                adlerB += adlerA;
+            }
+            adlerA %= 65521;
+            adlerB %= 65521;
+            data += block;
+            length -= block;
+        }
+    }
+
+    unsigned int matchLength(size_t position, size_t distance, size_t limit) const {
+        const uint8_t* current = &history[position];
+        const uint8_t* earlier = current - distance;
+        unsigned int length = 0;
+        while (length < limit && current[length] == earlier[length]) {
+            ++length;
+        }
+        return length;
+    }
+
+public:
+    ScanlineDeflater(size_t scanlineLength, vector<uint8_t>& output)
+        : output(output), bitBuffer(0), bitCount(0), adlerA(1), adlerB(0),
+        scanlineLength(scanlineLength), history(2 * scanlineLength), havePrevious(false) {
+
+        for (unsigned int symbol = 0; symbol < 288; ++symbol) {
+            uint16_t code;
+            uint8_t length;
+            if (symbol < 144) { code = static_cast<uint16_t>(0x30 + symbol); length = 8; }
+            else if (symbol < 256) { code = static_cast<uint16_t>(0x190 + symbol - 144); length = 9; }
+            else if (symbol < 280) { code = static_cast<uint16_t>(symbol - 256); length = 7; }
+            else { code = static_cast<uint16_t>(0xC0 + symbol - 280); length = 8; }
+            literalCodes[symbol].bits = reverseBits(code, length);
+            literalCodes[symbol].length = length;
+        }
+        for (unsigned int length = MIN_MATCH, index = 0; length <= MAX_MATCH; ++length) {
+            while (index + 1 < 29 && LENGTH_BASE[index + 1] <= length) {
+                ++index;
+            }
+            lengthSymbol[length] = static_cast<uint8_t>(index);
+        }
+
+        // zlib header (32K window, no dictionary), then the only block: final, fixed Huffman
+        output.push_back(0x78);
+        output.push_back(0x01);
+        putBits(1, 1);
+        putBits(1, 2);
+    }
+
+    void writeScanline(const uint8_t* scanline) {
+        std::copy(scanline, scanline + scanlineLength, history.begin() + scanlineLength);
+        updateAdler(scanline, scanlineLength);
+
+        bool canMatchAbove = havePrevious && scanlineLength <= MAX_DISTANCE;
+        size_t end = 2 * scanlineLength;
+
+        for (size_t position = scanlineLength; position < end;) {
+            size_t limit = std::min<size_t>(MAX_MATCH, end - position);
+            unsigned int runLength = position > scanlineLength || havePrevious ? matchLength(position, 1, limit) : 0;
+            unsigned int aboveLength = canMatchAbove ? matchLength(position, scanlineLength, limit) : 0;
+
+            if (runLength >= MIN_MATCH && runLength >= aboveLength) {
+                putMatch(runLength, 1);
+                position += runLength;
+            }
+            else if (aboveLength >= MIN_MATCH) {
+                putMatch(aboveLength, scanlineLength);
+                position += aboveLength;
+            }
+            else {
+                putSymbol(history[position]);
+                ++position;
+            }
+        }
+
+        std::copy(history.begin() + scanlineLength, history.end(), history.begin());
+        havePrevious = true;
+    }
+
+    void finish() {
+        putSymbol(256);
+        if (bitCount > 0) {
+            putBits(0, 8 - bitCount);
+        }
+        appendBigEndian(output, (adlerB << 16) | adlerA);
+    }
+};
+
+const uint16_t ScanlineDeflater::LENGTH_BASE[29] = {
+    3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+    35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258 };
+const uint8_t ScanlineDeflater::LENGTH_EXTRA[29] = {
+    0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+    3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0 };
+const uint16_t ScanlineDeflater::DISTANCE_BASE[30] = {
+    1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193,
+    257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577 };
+const uint8_t ScanlineDeflater::DISTANCE_EXTRA[30] = {
+    0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6,
+    7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13 };
+
+} // namespace
+
+bool MazeImage::writePNG(const Matrix& matrix, const string& filename, const ImageOverlays& overlays) {
+    ofstream file(filename, std::ios::binary);
+    if (!file.is_open()) {
+        cerr << "Error: Could not create image file " << filename << "\n";
+        return false;
+    }
+
+    initializeCrc32Table();
+
+    unsigned int width = matrix.getWidth();
+    unsigned int height = matrix.getHeight();
+    uint8_t bitDepth = overlays.any() ? 4 : 1;
+    size_t rowBytes = (static_cast<size_t>(width) * bitDepth + 7) / 8;
+
+    static const uint8_t SIGNATURE[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+    file.write(reinterpret_cast<const char*>(SIGNATURE), sizeof(SIGNATURE));
+
+    vector<uint8_t> header;
+    appendBigEndian(header, width);
+    appendBigEndian(header, height);
+    header.push_back(bitDepth);
+    header.push_back(0);    // grayscale
+    header.push_back(0);    // deflate
+    header.push_back(0);    // adaptive filtering (every row uses filter 0)
+    header.push_back(0);    // not interlaced
+    writeChunk(file, "IHDR", header.data(), header.size());
+
+    vector<uint8_t> compressed;
+    compressed.reserve(IDAT_CHUNK_SIZE + rowBytes + 64);
+    ScanlineDeflater deflater(rowBytes + 1, compressed);
+
+    vector<uint8_t> levels;
+    vector<uint8_t> scanline(rowBytes + 1);
+
+    for (unsigned int bandStart = 0; bandStart < height; bandStart += ROW_BAND) {
+        unsigned int bandEnd = std::min(height, bandStart + ROW_BAND);
+        readBand(matrix, bandStart, bandEnd, overlays, levels);
+
+        for (unsigned int row = 0; row < bandEnd - bandStart; ++row) {
+            const uint8_t* rowLevels = &levels[static_cast<size_t>(row) * width];
+            std::fill(scanline.begin(), scanline.end(), 0);
+            uint8_t* pixels = &scanline[1];
+
+            for (unsigned int x = 0; x < width; ++x) {
+                if (bitDepth == 1) {
+                    if (rowLevels[x] != LEVEL_WALL) {
+                        pixels[x >> 3] |= static_cast<uint8_t>(0x80 >> (x & 7));
+                    }
+                }
+                else {
+                    pixels[x >> 1] |= static_cast<uint8_t>((x & 1) ? rowLevels[x] : rowLevels[x] << 4);
+                }
+            }
+
+            deflater.writeScanline(scanline.data());
+
+            if (compressed.size() >= IDAT_CHUNK_SIZE) {
+                writeChunk(file, "IDAT", compressed.data(), compressed.size());
+                compressed.clear();
+            }
+        }
+    }
+
+    deflater.finish();
+    writeChunk(file, "IDAT", compressed.data(), compressed.size());
+    writeChunk(file, "IEND", nullptr, 0);
+
+    if (!file.good()) {
+        cerr << "Error: Could not write image file " << filename << "\n";
+        return false;
+    }
+    return true;
+}
+
+bool MazeImage::write(const Matrix& matrix, const string& filename, const ImageOverlays& overlays) {
+    string extension = filename.size() >= 4 ? filename.substr(filename.size() - 4) : "";
+    std::transform(extension.begin(), extension.end(), extension.begin(), ::tolower);
+
+    if (extension == ".pbm") {
+        if (overlays.any()) {
+            cerr << "Note: PBM is 1-bit, overlays are only drawn in PNG images\n";
+        }
+        return writePBM(matrix, filename);
+    }
+    if (extension == ".png") {
+        return writePNG(matrix, filename, overlays);
+    }
+
+    cerr << "Error: Image files must end in .pbm or .png (got " << filename << ")\n";
+    return false;
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <string>
+
+class Matrix;
+
+// What to mark on top of walls and passages; positions are only used when enabled
+struct ImageOverlays {
+    bool items;
+    bool entrance_exit;
+    bool robot;
+    bool minotaur;
+    unsigned int robot_x;
+    unsigned int robot_y;
+    unsigned int minotaur_x;
+    unsigned int minotaur_y;
+
+    ImageOverlays() : items(false), entrance_exit(false), robot(false), minotaur(false),
+        robot_x(0), robot_y(0), minotaur_x(0), minotaur_y(0) {}
+
+    bool any() const { return items || entrance_exit || robot || minotaur; }
+};
+
+/**
+ * @brief Exports a maze as an image, one pixel per cell.
+ *
+ * Rows are streamed to the file a band at a time, so memory use depends on the
+ * maze width only. PBM is plain 1-bit (black walls); PNG is grayscale - 1-bit
+ * without overlays, 4-bit with them:
+ *   wall 0, Minotaur 3, entrance/exit 6, item 9, robot 12, passage 15
+ */
+class MazeImage {
+public:
+    static bool writePBM(const Matrix& matrix, const std::string& filename);
+    static bool writePNG(const Matrix& matrix, const std::string& filename, const ImageOverlays& overlays);
+
+    // Picks the format from the extension (.pbm or .png)
+    static bool write(const Matrix& matrix, const std::string& filename, const ImageOverlays& overlays);
+};
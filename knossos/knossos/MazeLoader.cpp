@@ -0,0 +1,490 @@
+#include <vector>
+#include <thread>
+#include <cstdint>
+#include <cstring>
+#include <algorithm>
+#include <cctype>
+
+#include "MazeLoader.h"
+#include "MappedFile.h"
+#include "Bitboard.h"
+
+using std::string;
+using std::vector;
+using std::thread;
+using std::pair;
+using std::make_pair;
+
+// Below this many rows per thread, starting threads costs more than it saves
+static const size_t MIN_ROWS_PER_THREAD = 64;
+
+namespace {
+
+struct LoadError {
+    bool failed;
+    size_t line;        // 1-based
+    size_t column;      // 1-based, 0 when the whole line is at fault
+    string message;
+
+    LoadError() : failed(false), line(0), column(0) {}
+
+    void set(size_t errorLine, size_t errorColumn, const string& errorMessage) {
+        if (!failed) {
+            failed = true;
+            line = errorLine;
+            column = errorColumn;
+            message = errorMessage;
+        }
+    }
+};
+
+struct RowRangeResult {
+    LoadError error;
+    bool badLineEnding;     // rows aren't where the uniform stride says they are
+    unsigned int entrances;
+    unsigned int exits;
+    unsigned int items;
+    unsigned int entrance_x;
+    unsigned int exit_x;
+
+    RowRangeResult() : badLineEnding(false), entrances(0), exits(0), items(0), entrance_x(0), exit_x(0) {}
+};
+
+struct MazeLayout {
+    const char* data;
+    unsigned int width;
+    unsigned int height;
+    size_t stride;          // width + line ending length
+    size_t lineEndLength;
+};
+
+} // namespace
+
+static string describe(const string& filename, const LoadError& error) {
+    string location = filename + ":" + std::to_string(error.line);
+    if (error.column > 0) {
+        location += ":" + std::to_string(error.column);
+    }
+    return location + ": " + error.message;
+}
+
+static string quoted(char c) {
+    if (c == '\t') return "a tab";
+    if (static_cast<unsigned char>(c) < 32 || static_cast<unsigned char>(c) > 126) return "a non-printable character";
+    return string("'") + c + "'";
+}
+
+// Rows handled together when filling the matrix. Cells are stored column by column,
+// so walking a band column-wise writes each column's slice contiguously while the
+// band's text rows stay in cache
+static const unsigned int ROW_BAND = 64;
+
+static bool classify(char symbol, FieldType& fieldType) {
+    switch (symbol) {
+    case '#': fieldType = FieldType::WALL; return true;
+    case '.':
+    case ' ': fieldType = FieldType::PASSAGE; return true;
+    case 'U': fieldType = FieldType::ENTRANCE; return true;
+    case 'I': fieldType = FieldType::EXIT; return true;
+    case 'P': fieldType = FieldType::ITEM; return true;
+    default: return false;
+    }
+}
+
+// Check one row and mark its open cells; the matrix itself is filled per band afterwards
+static bool validateRow(const MazeLayout& layout, unsigned int y, uint8_t* openCells, RowRangeResult& result) {
+    const unsigned int width = layout.width;
+    const unsigned int height = layout.height;
+    const char* row = layout.data + y * layout.stride;
+
+    // The last row may legitimately end without a line break
+    if (y + 1 < height) {
+        bool terminated = row[width] == '\n' || (layout.lineEndLength == 2 && row[width] == '\r' && row[width + 1] == '\n');
+        if (!terminated) {
+            result.badLineEnding = true;
+            return false;
+        }
+    }
+
+    uint8_t* openRow = openCells + static_cast<size_t>(y) * width;
+
+    for (unsigned int x = 0; x < width; ++x) {
+        char symbol = row[x];
+        FieldType fieldType;
+
+        if (!classify(symbol, fieldType)) {
+            if (symbol == '\n' || symbol == '\r') {
+                result.badLineEnding = true;
+            }
+            else {
+                result.error.set(y + 1, x + 1, "unexpected character " + quoted(symbol) + " (use # . U I P)");
+            }
+            return false;
+        }
+
+        if (fieldType == FieldType::WALL) {
+            continue;
+        }
+        openRow[x] = 1;
+
+        bool onBoundary = x == 0 || x == width - 1 || y == 0 || y == height - 1;
+        bool corner = (x == 0 || x == width - 1) && (y == 0 || y == height - 1);
+
+        if (fieldType == FieldType::ENTRANCE) {
+            if (y != 0 || corner) {
+                result.error.set(y + 1, x + 1, "the entrance 'U' must be in the top wall");
+                return false;
+            }
+            if (++result.entrances > 1) {
+                result.error.set(y + 1, x + 1, "second entrance - a maze has exactly one 'U'");
+                return false;
+            }
+            result.entrance_x = x;
+        }
+        else if (fieldType == FieldType::EXIT) {
+            if (y != height - 1 || corner) {
+                result.error.set(y + 1, x + 1, "the exit 'I' must be in the bottom wall");
+                return false;
+            }
+            if (++result.exits > 1) {
+                result.error.set(y + 1, x + 1, "second exit - a maze has exactly one 'I'");
+                return false;
+            }
+            result.exit_x = x;
+        }
+        else if (onBoundary) {
+            result.error.set(y + 1, x + 1, "gap in the outer wall - the border must be '#' apart from 'U' and 'I'");
+            return false;
+        }
+        else if (fieldType == FieldType::ITEM) {
+            ++result.items;
+        }
+    }
+    return true;
+}
+
+// Parse rows [firstRow, lastRow) straight into the matrix; every row is found by
+// offset, so ranges are independent and need no shared state
+static void parseRows(const MazeLayout& layout, unsigned int firstRow, unsigned int lastRow,
+    Matrix* matrix, uint8_t* openCells, RowRangeResult& result) {
+
+    for (unsigned int bandStart = firstRow; bandStart < lastRow; bandStart += ROW_BAND) {
+        unsigned int bandEnd = std::min(lastRow, bandStart + ROW_BAND);
+
+        for (unsigned int y = bandStart; y < bandEnd; ++y) {
+            if (!validateRow(layout, y, openCells, result)) {
+                return;
+            }
+        }
+
+        for (unsigned int x = 0; x < layout.width; ++x) {
+            for (unsigned int y = bandStart; y < bandEnd; ++y) {
+                FieldType fieldType = FieldType::WALL;
+                classify(layout.data[y * layout.stride + x], fieldType);
+                matrix->initializeField(x, y, fieldType);
+            }
+        }
+    }
+}
+
+// Slow path for a malformed file: walk the real lines to name the first one whose length is off
+static void locateIrregularLine(const char* data, size_t size, unsigned int width, LoadError& error) {
+    size_t line = 1;
+    size_t lineStart = 0;
+
+    for (size_t i = 0; i <= size; ++i) {
+        if (i < size && data[i] != '\n') continue;
+
+        size_t length = i - lineStart;
+        if (length > 0 && data[lineStart + length - 1] == '\r') {
+            --length;
+        }
+        if (length != width) {
+            error.set(line, length < width ? length + 1 : width + 1,
+                "expected " + std::to_string(width) + " columns like line 1, found " + std::to_string(length));
+            return;
+        }
+        lineStart = i + 1;
+        ++line;
+    }
+    error.set(line, 0, "inconsistent line endings");
+}
+
+// A bitboard flood fill from the entrance: open runs are claimed a word at a time
+static bool exitReachable(const uint8_t* openCells, unsigned int width, unsigned int height,
+    unsigned int entrance_x, unsigned int exit_x) {
+
+    Bitboard open(width, height);
+    for (unsigned int y = 0; y < height; ++y) {
+        const uint8_t* row = openCells + static_cast<size_t>(y) * width;
+        for (unsigned int x = 0; x < width; ++x) {
+            if (row[x]) open.set(x, y);
+        }
+    }
+
+    Bitboard entrance(width, height);
+    entrance.set(entrance_x, 0);
+    return entrance.floodFill(open).test(exit_x, height - 1);
+}
+
+// Shared by every format: one way in, one way out, and a path between them
+static void checkPlayable(const uint8_t* openCells, unsigned int width, unsigned int height,
+    unsigned int entrances, unsigned int exits, unsigned int entrance_x, unsigned int exit_x, LoadError& error) {
+
+    if (entrances == 0) {
+        error.set(1, 0, "no entrance - put one 'U' in the top wall");
+    }
+    else if (exits == 0) {
+        error.set(height, 0, "no exit - put one 'I' in the bottom wall");
+    }
+    else if (!openCells[static_cast<size_t>(width) + entrance_x]) {
+        error.set(2, entrance_x + 1, "the cell below the entrance must be open - the hero starts there");
+    }
+    else if (!exitReachable(openCells, width, height, entrance_x, exit_x)) {
+        error.set(height, exit_x + 1, "the exit cannot be reached from the entrance");
+    }
+}
+
+// Skips whitespace and # comments in a PBM header, then reads one decimal number
+static bool readHeaderNumber(const char* data, size_t size, size_t& offset, uint64_t& value) {
+    while (offset < size) {
+        if (data[offset] == '#') {
+            while (offset < size && data[offset] != '\n') ++offset;
+        }
+        else if (isspace(static_cast<unsigned char>(data[offset]))) {
+            ++offset;
+        }
+        else {
+            break;
+        }
+    }
+
+    size_t start = offset;
+    value = 0;
+    while (offset < size && isdigit(static_cast<unsigned char>(data[offset])) && value <= UINT32_MAX) {
+        value = value * 10 + static_cast<uint64_t>(data[offset] - '0');
+        ++offset;
+    }
+    return offset > start;
+}
+
+Matrix* MazeLoader::loadMaze(const string& filename, unsigned int& no_of_items, string& error) {
+    string extension = filename.size() >= 4 ? filename.substr(filename.size() - 4) : "";
+    std::transform(extension.begin(), extension.end(), extension.begin(), ::tolower);
+
+    if (extension == ".pbm") {
+        no_of_items = 0;
+        return loadPBMMaze(filename, error);
+    }
+    return loadTextMaze(filename, no_of_items, error);
+}
+
+Matrix* MazeLoader::loadPBMMaze(const string& filename, string& error) {
+    MappedFile file;
+    if (!file.open(filename)) {
+        error = filename + ": could not open the image";
+        return nullptr;
+    }
+
+    const char* data = file.data();
+    size_t size = file.size();
+    size_t offset = 2;
+    uint64_t width = 0, height = 0;
+
+    if (size < 2 || data[0] != 'P' || data[1] != '4' ||
+        !readHeaderNumber(data, size, offset, width) || !readHeaderNumber(data, size, offset, height) ||
+        offset >= size || !isspace(static_cast<unsigned char>(data[offset]))) {
+        error = filename + ": not a binary PBM (P4) image";
+        return nullptr;
+    }
+    ++offset;   // exactly one whitespace character separates the header from the pixels
+
+    if (width <= 15 || height <= 15) {
+        error = filename + ": the maze must be larger than 15 x 15 (found " +
+            std::to_string(width) + " x " + std::to_string(height) + ")";
+        return nullptr;
+    }
+    if (width * height > UINT32_MAX) {
+        error = filename + ": the maze is too large";
+        return nullptr;
+    }
+
+    size_t rowBytes = static_cast<size_t>((width + 7) / 8);
+    if (size - offset < rowBytes * height) {
+        error = filename + ": the image data is truncated";
+        return nullptr;
+    }
+
+    unsigned int w = static_cast<unsigned int>(width);
+    unsigned int h = static_cast<unsigned int>(height);
+    const uint8_t* pixels = reinterpret_cast<const uint8_t*>(data + offset);
+
+    // Black (1) is wall; a white pixel in the top row is the entrance, in the bottom row the exit
+    vector<uint8_t> openCells(static_cast<size_t>(w) * h, 0);
+    unsigned int entrances = 0, exits = 0;
+    unsigned int entrance_x = 0, exit_x = 0;
+    LoadError loadError;
+
+    for (unsigned int y = 0; y < h && !loadError.failed; ++y) {
+        const uint8_t* row = pixels + y * rowBytes;
+        uint8_t* openRow = &openCells[static_cast<size_t>(y) * w];
+
+        for (unsigned int x = 0; x < w; ++x) {
+            if (row[x >> 3] & (0x80 >> (x & 7))) {
+                continue;
+            }
+            openRow[x] = 1;
+
+            bool corner = (x == 0 || x == w - 1) && (y == 0 || y == h - 1);
+            if (y == 0 && !corner) {
+                if (++entrances > 1) {
+                    loadError.set(y + 1, x + 1, "second gap in the top wall - a maze has exactly one entrance");
+                    break;
+                }
+                entrance_x = x;
+            }
+            else if (y == h - 1 && !corner) {
+                if (++exits > 1) {
+                    loadError.set(y + 1, x + 1, "second gap in the bottom wall - a maze has exactly one exit");
+                    break;
+                }
+                exit_x = x;
+            }
+            else if (x == 0 || x == w - 1 || corner) {
+                loadError.set(y + 1, x + 1, "gap in the outer wall");
+                break;
+            }
+        }
+    }
+
+    if (!loadError.failed) {
+        checkPlayable(openCells.data(), w, h, entrances, exits, entrance_x, exit_x, loadError);
+    }
+    if (loadError.failed) {
+        error = describe(filename, loadError);
+        return nullptr;
+    }
+
+    // Cells are stored column by column - fill in bands, walking each band column-wise
+    Matrix* matrix = new Matrix(w, h, false);
+    for (unsigned int bandStart = 0; bandStart < h; bandStart += ROW_BAND) {
+        unsigned int bandEnd = std::min(h, bandStart + ROW_BAND);
+        for (unsigned int x = 0; x < w; ++x) {
+            for (unsigned int y = bandStart; y < bandEnd; ++y) {
+                const uint8_t* row = pixels + y * rowBytes;
+                bool wall = (row[x >> 3] & (0x80 >> (x & 7))) != 0;
+                FieldType fieldType = wall ? FieldType::WALL : FieldType::PASSAGE;
+                if (y == 0 && x == entrance_x) fieldType = FieldType::ENTRANCE;
+                if (y == h - 1 && x == exit_x) fieldType = FieldType::EXIT;
+                matrix->initializeField(x, y, fieldType);
+            }
+        }
+    }
+    return matrix;
+}
+
+Matrix* MazeLoader::loadTextMaze(const string& filename, unsigned int& no_of_items, string& error) {
+    MappedFile file;
+    if (!file.open(filename)) {
+        error = filename + ": could not open the maze file";
+        return nullptr;
+    }
+
+    const char* data = file.data();
+    size_t size = file.size();
+
+    // Blank lines at the very end are an editor habit, not part of the maze
+    while (size > 0 && (data[size - 1] == '\n' || data[size - 1] == '\r')) {
+        --size;
+    }
+    if (size == 0) {
+        error = filename + ": the maze file is empty";
+        return nullptr;
+    }
+
+    const char* firstBreak = static_cast<const char*>(memchr(data, '\n', size));
+    size_t firstLength = firstBreak ? static_cast<size_t>(firstBreak - data) : size;
+
+    MazeLayout layout;
+    layout.data = data;
+    layout.lineEndLength = (firstBreak && firstLength > 0 && data[firstLength - 1] == '\r') ? 2 : 1;
+    layout.width = static_cast<unsigned int>(firstLength - (layout.lineEndLength == 2 ? 1 : 0));
+    layout.stride = layout.width + layout.lineEndLength;
+
+    LoadError loadError;
+
+    // With uniform rows the file size alone gives the height, and row y starts at y * stride
+    if ((size + layout.lineEndLength) % layout.stride != 0) {
+        locateIrregularLine(data, size, layout.width, loadError);
+        error = describe(filename, loadError);
+        return nullptr;
+    }
+    size_t rows = (size + layout.lineEndLength) / layout.stride;
+
+    if (layout.width <= 15 || rows <= 15) {
+        error = filename + ": the maze must be larger than 15 x 15 (found " +
+            std::to_string(layout.width) + " x " + std::to_string(rows) + ")";
+        return nullptr;
+    }
+    if (static_cast<uint64_t>(layout.width) * rows > UINT32_MAX) {
+        error = filename + ": the maze is too large";
+        return nullptr;
+    }
+    layout.height = static_cast<unsigned int>(rows);
+
+    Matrix* matrix = new Matrix(layout.width, layout.height, false);
+    vector<uint8_t> openCells(static_cast<size_t>(layout.width) * layout.height, 0);
+
+    size_t threadCount = std::max<size_t>(1, std::min<size_t>(thread::hardware_concurrency(), rows / MIN_ROWS_PER_THREAD));
+    vector<RowRangeResult> results(threadCount);
+    vector<thread> workers;
+
+    unsigned int rowsPerThread = static_cast<unsigned int>((rows + threadCount - 1) / threadCount);
+    for (size_t t = 0; t < threadCount; ++t) {
+        unsigned int firstRow = static_cast<unsigned int>(t * rowsPerThread);
+        unsigned int lastRow = std::min<unsigned int>(layout.height, firstRow + rowsPerThread);
+
+        // The calling thread takes the last range itself
+        if (t + 1 == threadCount) {
+            parseRows(layout, firstRow, lastRow, matrix, openCells.data(), results[t]);
+        }
+        else {
+            workers.emplace_back(parseRows, std::cref(layout), firstRow, lastRow, matrix, openCells.data(), std::ref(results[t]));
+        }
+    }
+    for (thread& worker : workers) {
+        worker.join();
+    }
+
+    // Ranges are in file order, so the first failing range holds the earliest error
+    unsigned int entrances = 0, exits = 0, items = 0;
+    unsigned int entrance_x = 0, exit_x = 0;
+    for (const RowRangeResult& result : results) {
+        if (result.badLineEnding) {
+            locateIrregularLine(data, size, layout.width, loadError);
+            break;
+        }
+        if (result.error.failed) {
+            loadError = result.error;
+            break;
+        }
+        entrances += result.entrances;
+        exits += result.exits;
+        items += result.items;
+        if (result.entrances) entrance_x = result.entrance_x;
+        if (result.exits) exit_x = result.exit_x;
+    }
+
+    if (!loadError.failed) {
+        checkPlayable(openCells.data(), layout.width, layout.height, entrances, exits, entrance_x, exit_x, loadError);
+    }
+
+    if (loadError.failed) {
+        error = describe(filename, loadError);
+        delete matrix;
+        return nullptr;
+    }
+
+    no_of_items = items;
+    return matrix;
+}
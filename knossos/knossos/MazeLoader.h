@@ -0,0 +1,36 @@
+#pragma once
+
+#include <string>
+#include "Matrix.h"
+
+/**
+ * @brief Loads hand-drawn text mazes ('#' wall, '.' or ' ' passage, 'U' entrance,
+ * 'I' exit, 'P' item - the symbols saveMatrixState writes).
+ *
+ * The file is memory-mapped and split into row ranges that are parsed in
+ * parallel straight into the Matrix cells. Every row must have the same width,
+ * the outer wall must be closed except for one entrance in the top row and one
+ * exit in the bottom row, and the exit must be reachable from the entrance.
+ * Mazes exported as PBM images (see MazeImage) load back the same way.
+ */
+class MazeLoader {
+public:
+    /**
+     * @brief Parse and validate a maze file.
+     * @param filename Text maze to load
+     * @param no_of_items Set to the number of 'P' cells found
+     * @param error Set to "file:line:column: message" when loading fails
+     * @return The new matrix (owned by the caller), or nullptr on failure
+     */
+    static Matrix* loadTextMaze(const std::string& filename, unsigned int& no_of_items, std::string& error);
+
+    /**
+     * @brief Build a maze from a binary PBM (P4): black pixels are walls, the single
+     * gap in the top row is the entrance and the one in the bottom row the exit.
+     * Same validation as text mazes; images carry no items.
+     */
+    static Matrix* loadPBMMaze(const std::string& filename, std::string& error);
+
+    // Picks the format from the extension: .pbm images, anything else is text
+    static Matrix* loadMaze(const std::string& filename, unsigned int& no_of_items, std::string& error);
+};
@@ -0,0 +1,405 @@
+#ifdef _WIN32
+#define NOMINMAX
+#include <windows.h>
+#include <direct.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/file.h>
+#include <sys/stat.h>
+#include <sys/resource.h>
+#ifdef __linux__
+#include <sys/syscall.h>
+#endif
+#endif
+
+#include <cerrno>
+#include <cstring>
+
+#include "MazePool.h"
+#include "MazeRecord.h"
+#include "FixedMatrix.h"
+#include "MappedFile.h"
+#include "RNGEngine.h"
+#include "BinaryIO.h"
+
+using std::string;
+
+namespace {
+
+const char POOL_MAGIC[4] = { 'K', 'N', 'M', 'P' };
+const uint16_t POOL_VERSION = 1;
+
+// A pool file opened read-write and locked exclusively until it is closed
+class LockedFile {
+private:
+#ifdef _WIN32
+    HANDLE handle;
+#else
+    int fd;
+#endif
+
+public:
+    LockedFile();
+    ~LockedFile() { close(); }
+    LockedFile(const LockedFile&) = delete;
+    LockedFile& operator=(const LockedFile&) = delete;
+
+    // Creates the file if needed and blocks until no one else holds the lock
+    bool open(const string& filename);
+    void close();
+
+    uint64_t size();
+    bool read(uint64_t offset, char* data, size_t size);
+    bool write(uint64_t offset, const char* data, size_t size);
+    bool truncate(uint64_t size);
+};
+
+#ifdef _WIN32
+LockedFile::LockedFile() : handle(INVALID_HANDLE_VALUE) {}
+
+// The lock covers a byte far past the end, so mapping and reading the records stays allowed
+OVERLAPPED lockRange() {
+    OVERLAPPED range = {};
+    range.OffsetHigh = 0x7FFFFFFF;
+    return range;
+}
+
+bool LockedFile::open(const string& filename) {
+    handle = CreateFileA(filename.c_str(), GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ | FILE_SHARE_WRITE,
+        nullptr, OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (handle == INVALID_HANDLE_VALUE) {
+        return false;
+    }
+    OVERLAPPED range = lockRange();
+    if (!LockFileEx(handle, LOCKFILE_EXCLUSIVE_LOCK, 0, 1, 0, &range)) {
+        close();
+        return false;
+    }
+    return true;
+}
+
+void LockedFile::close() {
+    if (handle != INVALID_HANDLE_VALUE) {
+        OVERLAPPED range = lockRange();
+        UnlockFileEx(handle, 0, 1, 0, &range);
+        CloseHandle(handle);
+        handle = INVALID_HANDLE_VALUE;
+    }
+}
+
+uint64_t LockedFile::size() {
+    LARGE_INTEGER fileSize;
+    return GetFileSizeEx(handle, &fileSize) ? static_cast<uint64_t>(fileSize.QuadPart) : 0;
+}
+
+bool LockedFile::read(uint64_t offset, char* data, size_t size) {
+    OVERLAPPED position = {};
+    position.Offset = static_cast<DWORD>(offset);
+    position.OffsetHigh = static_cast<DWORD>(offset >> 32);
+    DWORD done = 0;
+    return ReadFile(handle, data, static_cast<DWORD>(size), &done, &position) && done == size;
+}
+
+bool LockedFile::write(uint64_t offset, const char* data, size_t size) {
+    OVERLAPPED position = {};
+    position.Offset = static_cast<DWORD>(offset);
+    position.OffsetHigh = static_cast<DWORD>(offset >> 32);
+    DWORD done = 0;
+    return WriteFile(handle, data, static_cast<DWORD>(size), &done, &position) && done == size;
+}
+
+bool LockedFile::truncate(uint64_t size) {
+    LARGE_INTEGER end;
+    end.QuadPart = static_cast<LONGLONG>(size);
+    return SetFilePointerEx(handle, end, nullptr, FILE_BEGIN) && SetEndOfFile(handle);
+}
+
+bool makeDirectory(const string& directory) {
+    return _mkdir(directory.c_str()) == 0 || errno == EEXIST;
+}
+
+void lowerThreadPriority() {
+    SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_LOWEST);
+}
+#else
+LockedFile::LockedFile() : fd(-1) {}
+
+bool LockedFile::open(const string& filename) {
+    fd = ::open(filename.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        return false;
+    }
+    while (flock(fd, LOCK_EX) != 0) {
+        if (errno != EINTR) {
+            close();
+            return false;
+        }
+    }
+    return true;
+}
+
+// Closing the descriptor releases the lock
+void LockedFile::close() {
+    if (fd >= 0) {
+        ::close(fd);
+        fd = -1;
+    }
+}
+
+uint64_t LockedFile::size() {
+    struct stat fileInfo;
+    return fstat(fd, &fileInfo) == 0 ? static_cast<uint64_t>(fileInfo.st_size) : 0;
+}
+
+bool LockedFile::read(uint64_t offset, char* data, size_t size) {
+    while (size > 0) {
+        ssize_t done = pread(fd, data, size, static_cast<off_t>(offset));
+        if (done <= 0) {
+            if (done < 0 && errno == EINTR) continue;
+            return false;
+        }
+        data += done;
+        offset += done;
+        size -= done;
+    }
+    return true;
+}
+
+bool LockedFile::write(uint64_t offset, const char* data, size_t size) {
+    while (size > 0) {
+        ssize_t done = pwrite(fd, data, size, static_cast<off_t>(offset));
+        if (done < 0) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+        data += done;
+        offset += done;
+        size -= done;
+    }
+    return true;
+}
+
+bool LockedFile::truncate(uint64_t size) {
+    return ftruncate(fd, static_cast<off_t>(size)) == 0;
+}
+
+bool makeDirectory(const string& directory) {
+    return mkdir(directory.c_str(), 0755) == 0 || errno == EEXIST;
+}
+
+// Nice values are per thread on Linux; elsewhere setpriority would slow the whole game down
+void lowerThreadPriority() {
+#ifdef __linux__
+    setpriority(PRIO_PROCESS, static_cast<id_t>(syscall(SYS_gettid)), 19);
+#endif
+}
+#endif
+
+struct PoolHeader {
+    uint32_t taken;
+    uint32_t count;
+};
+
+string encodeHeader(unsigned int width, unsigned int height, unsigned int no_of_items, const PoolHeader& header) {
+    string buffer(POOL_MAGIC, sizeof(POOL_MAGIC));
+    appendU16(buffer, POOL_VERSION);
+    appendU16(buffer, static_cast<uint16_t>(Matrix::GENERATOR_VERSION));
+    appendU32(buffer, width);
+    appendU32(buffer, height);
+    appendU32(buffer, no_of_items);
+    appendU32(buffer, header.taken);
+    appendU32(buffer, header.count);
+    buffer.resize(MazePool::POOL_HEADER_BYTES, 0);
+    return buffer;
+}
+
+// False for a new file, one of another version or size, or one cut short
+bool readHeader(LockedFile& file, unsigned int width, unsigned int height, unsigned int no_of_items, PoolHeader& header) {
+    char buffer[MazePool::POOL_HEADER_BYTES];
+    if (file.size() < MazePool::POOL_HEADER_BYTES || !file.read(0, buffer, sizeof(buffer))) {
+        return false;
+    }
+    if (std::memcmp(buffer, POOL_MAGIC, sizeof(POOL_MAGIC)) != 0 || readU16(buffer + 4) != POOL_VERSION ||
+        readU16(buffer + 6) != Matrix::GENERATOR_VERSION || readU32(buffer + 8) != width ||
+        readU32(buffer + 12) != height || readU32(buffer + 16) != no_of_items) {
+        return false;
+    }
+    header.taken = readU32(buffer + 20);
+    header.count = readU32(buffer + 24);
+    uint64_t records = (file.size() - MazePool::POOL_HEADER_BYTES) / MazeRecord::recordSize(width, height);
+    return header.taken <= header.count && header.count <= records;
+}
+
+}
+
+MazePool::MazePool(const string& directory, unsigned int width, unsigned int height, unsigned int no_of_items)
+    : directory(directory), width(width), height(height), no_of_items(no_of_items), stopping(false) {
+    filename = directory + "/pool_" + std::to_string(width) + "x" + std::to_string(height) + "x" +
+        std::to_string(no_of_items) + ".kmp";
+}
+
+MazePool::~MazePool() {
+    stopping = true;
+    if (refiller.joinable()) {
+        refiller.join();
+    }
+}
+
+bool MazePool::open(string& error) {
+    if (!makeDirectory(directory)) {
+        error = "Cannot create the maze pool directory " + directory;
+        return false;
+    }
+
+    LockedFile file;
+    if (!file.open(filename)) {
+        error = "Cannot open the maze pool " + filename;
+        return false;
+    }
+    PoolHeader header;
+    if (readHeader(file, width, height, no_of_items, header)) {
+        return true;
+    }
+
+    // New, or left by another generator version: nothing in it can be played
+    header = PoolHeader{ 0, 0 };
+    string encoded = encodeHeader(width, height, no_of_items, header);
+    if (!file.truncate(0) || !file.write(0, encoded.data(), encoded.size())) {
+        error = "Cannot write the maze pool " + filename;
+        return false;
+    }
+    return true;
+}
+
+Matrix* MazePool::take(unsigned int& seed) {
+    LockedFile file;
+    PoolHeader header;
+    if (!file.open(filename) || !readHeader(file, width, height, no_of_items, header) || header.taken == header.count) {
+        return nullptr;
+    }
+
+    // Copied out under the lock: a refill may move the records once it is released
+    const size_t recordBytes = MazeRecord::recordSize(width, height);
+    const uint64_t offset = POOL_HEADER_BYTES + static_cast<uint64_t>(header.taken) * recordBytes;
+    string record;
+    {
+        MappedFile mapping;
+        if (!mapping.open(filename) || mapping.size() < offset + recordBytes) {
+            return nullptr;
+        }
+        record.assign(mapping.data() + offset, recordBytes);
+    }
+
+    ++header.taken;
+    string encoded = encodeHeader(width, height, no_of_items, header);
+    if (!file.write(0, encoded.data(), encoded.size())) {
+        return nullptr;
+    }
+    file.close();
+
+    unsigned int items = 0;
+    return MazeRecord::decode(record.data(), seed, items);
+}
+
+unsigned int MazePool::available() {
+    LockedFile file;
+    PoolHeader header;
+    if (!file.open(filename) || !readHeader(file, width, height, no_of_items, header)) {
+        return 0;
+    }
+    return header.count - header.taken;
+}
+
+bool MazePool::addMaze(const string& record, unsigned int depth, bool& full, string& error) {
+    LockedFile file;
+    if (!file.open(filename)) {
+        error = "Cannot open the maze pool " + filename;
+        return false;
+    }
+    PoolHeader header;
+    if (!readHeader(file, width, height, no_of_items, header)) {
+        header = PoolHeader{ 0, 0 };
+    }
+    full = header.count - header.taken >= depth;
+    if (full) {
+        return true;    // another process got there first
+    }
+
+    // Once more has been taken than is left, the rest moves to the front. The two
+    // ranges can't overlap, so the records stay intact until the header points at them
+    const size_t recordBytes = MazeRecord::recordSize(width, height);
+    if (header.taken > 0 && header.taken >= header.count - header.taken) {
+        string live(static_cast<size_t>(header.count - header.taken) * recordBytes, '\0');
+        if (!live.empty() && (!file.read(POOL_HEADER_BYTES + static_cast<uint64_t>(header.taken) * recordBytes, &live[0], live.size()) ||
+            !file.write(POOL_HEADER_BYTES, live.data(), live.size()))) {
+            error = "Cannot compact the maze pool " + filename;
+            return false;
+        }
+        header = PoolHeader{ 0, header.count - header.taken };
+        string encoded = encodeHeader(width, height, no_of_items, header);
+        if (!file.write(0, encoded.data(), encoded.size()) || !file.truncate(POOL_HEADER_BYTES + live.size())) {
+            error = "Cannot compact the maze pool " + filename;
+            return false;
+        }
+    }
+
+    // The record goes in before the header counts it
+    if (!file.write(POOL_HEADER_BYTES + static_cast<uint64_t>(header.count) * recordBytes, record.data(), record.size())) {
+        error = "Cannot write to the maze pool " + filename;
+        return false;
+    }
+    ++header.count;
+    string encoded = encodeHeader(width, height, no_of_items, header);
+    if (!file.write(0, encoded.data(), encoded.size())) {
+        error = "Cannot write to the maze pool " + filename;
+        return false;
+    }
+    full = header.count - header.taken >= depth;
+    return true;
+}
+
+bool MazePool::refill(unsigned int depth, string& error) {
+    if (available() >= depth) {
+        return true;
+    }
+
+    while (!stopping) {
+        // Same sequence as a new game: seed, generate (a FixedMatrix draws the same maze)
+        unsigned int seed = RNGEngine::generateSeed();
+        RNGEngine::seed(seed);
+        string record;
+        bool tiered = MatrixTiers::withTier(width, height, [&](auto& tier) {
+            tier.generateMatrix(no_of_items);
+            MazeRecord::append(record, tier.getCells(), width, height, seed, no_of_items);
+        });
+        if (!tiered) {
+            Matrix matrix(width, height);
+            matrix.setCancellation(&stopping);
+            matrix.generateMatrix(no_of_items);
+            matrix.setCancellation(nullptr);
+            if (stopping) {
+                break;
+            }
+            MazeRecord::append(record, matrix, seed, no_of_items);
+        }
+
+        bool full = false;
+        if (!addMaze(record, depth, full, error)) {
+            return false;
+        }
+        if (full) {
+            break;
+        }
+    }
+    return true;
+}
+
+// Errors are dropped: the game owns the screen by now, and the next start refills anyway
+void MazePool::startRefill(unsigned int depth) {
+    refiller = std::thread([this, depth]() {
+        lowerThreadPriority();
+        string error;
+        refill(depth, error);
+    });
+}
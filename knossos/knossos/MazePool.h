@@ -0,0 +1,63 @@
+#pragma once
+
+#include <string>
+#include <thread>
+#include <atomic>
+#include <cstdint>
+#include "Matrix.h"
+
+/**
+ * @brief A directory of ready-made mazes for deployments that start game after game
+ * at the same few settings: one pool file per (width, height, items), named
+ * pool_<width>x<height>x<items>.kmp.
+ *
+ * A pool file is a POOL_HEADER_BYTES header - magic "KNMP", format version (u16),
+ * Matrix::GENERATOR_VERSION (u16), width, height, items, records taken from the
+ * front and records in the file (u32 each) - followed by MazeRecords. The header
+ * only changes under an exclusive lock on the file, so any number of processes can
+ * take and refill at once and no record is ever taken twice. A taker copies its
+ * record out of the mapping before the lock is released, which lets a refill move
+ * the untaken records back to the front once the taken ones outnumber them.
+ *
+ * Mazes are generated from fresh seeds exactly as a new game would, so a save of a
+ * pooled game resumes like any other.
+ */
+class MazePool {
+public:
+    static const size_t POOL_HEADER_BYTES = 32;
+    static const unsigned int DEFAULT_DEPTH = 8;
+
+    MazePool(const std::string& directory, unsigned int width, unsigned int height, unsigned int no_of_items);
+    // Stops a background refill, dropping the maze it was in the middle of
+    ~MazePool();
+    MazePool(const MazePool&) = delete;
+    MazePool& operator=(const MazePool&) = delete;
+
+    // Creates the directory (one level) and the pool file if they don't exist yet;
+    // a pool of another generator version is emptied
+    bool open(std::string& error);
+
+    // The oldest maze in the pool, or nullptr once it has run dry
+    Matrix* take(unsigned int& seed);
+
+    // Generate until the pool holds depth mazes; false (with the reason) on I/O errors
+    bool refill(unsigned int depth, std::string& error);
+    // The same on a low-priority thread, for while a game is being played
+    void startRefill(unsigned int depth);
+
+    // Mazes ready to be taken
+    unsigned int available();
+
+    const std::string& getFilename() const { return filename; }
+
+private:
+    std::string directory;
+    std::string filename;
+    unsigned int width;
+    unsigned int height;
+    unsigned int no_of_items;
+    std::thread refiller;
+    std::atomic<bool> stopping;
+
+    bool addMaze(const std::string& record, unsigned int depth, bool& full, std::string& error);
+};
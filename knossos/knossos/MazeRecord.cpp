@@ -0,0 +1,83 @@
+#include "MazeRecord.h"
+#include "MarathonMaze.h"
+#include "BinaryIO.h"
+
+using std::string;
+
+namespace {
+
+const char LIBRARY_MAGIC[4] = { 'K', 'N', 'M', 'L' };
+const uint16_t LIBRARY_VERSION = 1;
+
+template <typename CellAt>
+void appendRecord(string& buffer, unsigned int width, unsigned int height, unsigned int seed,
+    unsigned int no_of_items, CellAt cellAt) {
+    appendU32(buffer, seed);
+    appendU32(buffer, width);
+    appendU32(buffer, height);
+    appendU32(buffer, no_of_items);
+
+    // Cell pairs run on across row ends, so an odd width costs no padding
+    size_t start = buffer.size();
+    buffer.resize(start + (static_cast<size_t>(width) * height + 1) / 2, 0);
+    char* cells = &buffer[start];
+    size_t cell = 0;
+    for (unsigned int y = 0; y < height; ++y) {
+        for (unsigned int x = 0; x < width; ++x, ++cell) {
+            cells[cell / 2] |= static_cast<char>(cellAt(x, y) << (cell % 2 * 4));
+        }
+    }
+}
+
+}
+
+size_t MazeRecord::recordSize(unsigned int width, unsigned int height) {
+    return RECORD_HEADER_BYTES + (static_cast<size_t>(width) * height + 1) / 2;
+}
+
+void MazeRecord::append(string& buffer, const Matrix& matrix, unsigned int seed, unsigned int no_of_items) {
+    appendRecord(buffer, matrix.getWidth(), matrix.getHeight(), seed, no_of_items,
+        [&](unsigned int x, unsigned int y) { return TiledCell::of(matrix.getField(x, y)); });
+}
+
+void MazeRecord::append(string& buffer, const uint8_t* cells, unsigned int width, unsigned int height,
+    unsigned int seed, unsigned int no_of_items) {
+    appendRecord(buffer, width, height, seed, no_of_items,
+        [&](unsigned int x, unsigned int y) { return cells[static_cast<size_t>(x) * height + y]; });
+}
+
+Matrix* MazeRecord::decode(const char* record, unsigned int& seed, unsigned int& no_of_items) {
+    seed = readU32(record);
+    const unsigned int width = readU32(record + 4);
+    const unsigned int height = readU32(record + 8);
+    no_of_items = readU32(record + 12);
+
+    const char* cells = record + RECORD_HEADER_BYTES;
+    Matrix* matrix = new Matrix(width, height, false);
+    size_t cell = 0;
+    for (unsigned int y = 0; y < height; ++y) {
+        for (unsigned int x = 0; x < width; ++x, ++cell) {
+            uint8_t code = (static_cast<unsigned char>(cells[cell / 2]) >> (cell % 2 * 4)) & 0x0F;
+            if (TiledCell::fieldType(code) == FieldType::ITEM) {
+                matrix->initializeItem(x, y, TiledCell::itemType(code));
+            }
+            else {
+                matrix->initializeField(x, y, TiledCell::fieldType(code));
+            }
+        }
+    }
+    return matrix;
+}
+
+void MazeRecord::writeLibraryHeader(string& buffer, size_t offset, uint32_t records,
+    unsigned int width, unsigned int height, unsigned int no_of_items) {
+
+    string header(LIBRARY_MAGIC, sizeof(LIBRARY_MAGIC));
+    appendU16(header, LIBRARY_VERSION);
+    appendU16(header, static_cast<uint16_t>(Matrix::GENERATOR_VERSION));
+    appendU32(header, records);
+    appendU32(header, width);
+    appendU32(header, height);
+    appendU32(header, no_of_items);
+    buffer.replace(offset, header.size(), header);
+}
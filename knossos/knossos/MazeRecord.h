@@ -0,0 +1,35 @@
+#pragma once
+
+#include <string>
+#include <cstdint>
+#include <cstddef>
+#include "Matrix.h"
+
+/**
+ * @brief A generated maze as one self-contained binary record (little-endian): seed,
+ * width, height and number of items (u32 each), then every cell as a 4-bit TiledCell
+ * code, row-major, two per byte with even x in the low nibble.
+ *
+ * A maze library (.kml, see MazeFarm) is a LIBRARY_HEADER_BYTES header - magic
+ * "KNML", format version (u16), Matrix::GENERATOR_VERSION (u16), record count (u32),
+ * width, height, items (u32 each, for libraries of one size) - followed by records.
+ */
+class MazeRecord {
+public:
+    static const size_t RECORD_HEADER_BYTES = 16;
+    static const size_t LIBRARY_HEADER_BYTES = 24;
+
+    static size_t recordSize(unsigned int width, unsigned int height);
+
+    static void append(std::string& buffer, const Matrix& matrix, unsigned int seed, unsigned int no_of_items);
+    // The same from TiledCell codes, column-major (x * height + y) as FixedMatrix keeps them
+    static void append(std::string& buffer, const uint8_t* cells, unsigned int width, unsigned int height,
+        unsigned int seed, unsigned int no_of_items);
+
+    // The maze of a record written by append (record must hold all of it), with its seed and items
+    static Matrix* decode(const char* record, unsigned int& seed, unsigned int& no_of_items);
+
+    // Writes the library header at offset, which must have LIBRARY_HEADER_BYTES of room
+    static void writeLibraryHeader(std::string& buffer, size_t offset, uint32_t records,
+        unsigned int width, unsigned int height, unsigned int no_of_items);
+};
@@ -0,0 +1,184 @@
+#include <iomanip>
+
+#include "MemoryStats.h"
+
+#ifdef KNOSSOS_MEMORY_STATS
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+#ifdef _WIN32
+#define NOMINMAX
+#include <windows.h>
+#include <psapi.h>
+#pragma comment(lib, "psapi.lib")
+#else
+#include <sys/resource.h>
+#endif
+#endif
+
+using std::setw;
+
+namespace {
+
+const int SUBSYSTEMS = static_cast<int>(MemorySubsystem::COUNT);
+
+const char* const SUBSYSTEM_NAMES[SUBSYSTEMS] = {
+    "other", "maze cells", "prim", "items", "connect", "turn", "rendering", "files"
+};
+
+#ifdef KNOSSOS_MEMORY_STATS
+
+struct Counters {
+    std::atomic<uint64_t> allocations;
+    std::atomic<uint64_t> frees;
+    std::atomic<uint64_t> bytesAllocated;
+    std::atomic<uint64_t> bytesFreed;
+};
+
+// Zero-initialised before any constructor runs, so allocations during static
+// initialisation are counted too
+Counters counters[SUBSYSTEMS];
+std::atomic<uint64_t> heapBytes;
+std::atomic<uint64_t> peakHeapBytes;
+thread_local MemorySubsystem currentSubsystem = MemorySubsystem::OTHER;
+
+// Every block carries its size and owner in front; 16 bytes keep new's alignment
+const size_t HEADER_BYTES = 16;
+
+struct BlockHeader {
+    size_t size;
+    MemorySubsystem subsystem;
+};
+
+void* allocate(size_t size) {
+    void* block = std::malloc(size + HEADER_BYTES);
+    if (block == nullptr) {
+        return nullptr;
+    }
+    BlockHeader* header = static_cast<BlockHeader*>(block);
+    header->size = size;
+    header->subsystem = currentSubsystem;
+
+    Counters& owner = counters[static_cast<int>(header->subsystem)];
+    owner.allocations.fetch_add(1, std::memory_order_relaxed);
+    owner.bytesAllocated.fetch_add(size, std::memory_order_relaxed);
+
+    uint64_t now = heapBytes.fetch_add(size, std::memory_order_relaxed) + size;
+    uint64_t peak = peakHeapBytes.load(std::memory_order_relaxed);
+    while (now > peak && !peakHeapBytes.compare_exchange_weak(peak, now, std::memory_order_relaxed)) {}
+
+    return static_cast<char*>(block) + HEADER_BYTES;
+}
+
+void release(void* pointer) {
+    if (pointer == nullptr) {
+        return;
+    }
+    BlockHeader* header = reinterpret_cast<BlockHeader*>(static_cast<char*>(pointer) - HEADER_BYTES);
+
+    Counters& owner = counters[static_cast<int>(header->subsystem)];
+    owner.frees.fetch_add(1, std::memory_order_relaxed);
+    owner.bytesFreed.fetch_add(header->size, std::memory_order_relaxed);
+    heapBytes.fetch_sub(header->size, std::memory_order_relaxed);
+
+    std::free(header);
+}
+
+void* allocateOrThrow(size_t size) {
+    void* pointer = allocate(size);
+    if (pointer == nullptr) {
+        throw std::bad_alloc();
+    }
+    return pointer;
+}
+
+uint64_t peakResidentBytes() {
+#ifdef _WIN32
+    PROCESS_MEMORY_COUNTERS memory;
+    if (GetProcessMemoryInfo(GetCurrentProcess(), &memory, sizeof(memory))) {
+        return memory.PeakWorkingSetSize;
+    }
+    return 0;
+#else
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0) {
+        return 0;
+    }
+#ifdef __APPLE__
+    return static_cast<uint64_t>(usage.ru_maxrss);
+#else
+    return static_cast<uint64_t>(usage.ru_maxrss) * 1024;   // kilobytes elsewhere
+#endif
+#endif
+}
+
+#endif
+
+}
+
+#ifdef KNOSSOS_MEMORY_STATS
+
+void* operator new(size_t size) { return allocateOrThrow(size); }
+void* operator new[](size_t size) { return allocateOrThrow(size); }
+void* operator new(size_t size, const std::nothrow_t&) noexcept { return allocate(size); }
+void* operator new[](size_t size, const std::nothrow_t&) noexcept { return allocate(size); }
+
+void operator delete(void* pointer) noexcept { release(pointer); }
+void operator delete[](void* pointer) noexcept { release(pointer); }
+void operator delete(void* pointer, size_t) noexcept { release(pointer); }
+void operator delete[](void* pointer, size_t) noexcept { release(pointer); }
+void operator delete(void* pointer, const std::nothrow_t&) noexcept { release(pointer); }
+void operator delete[](void* pointer, const std::nothrow_t&) noexcept { release(pointer); }
+
+MemoryScope::MemoryScope(MemorySubsystem subsystem) : previous(currentSubsystem) {
+    currentSubsystem = subsystem;
+}
+
+MemoryScope::~MemoryScope() {
+    currentSubsystem = previous;
+}
+
+#endif
+
+uint64_t MemorySnapshot::allocations() const {
+    uint64_t total = 0;
+    for (const SubsystemMemory& subsystem : subsystems) {
+        total += subsystem.allocations;
+    }
+    return total;
+}
+
+MemorySnapshot MemoryStats::snapshot() {
+    MemorySnapshot snapshot = MemorySnapshot();
+#ifdef KNOSSOS_MEMORY_STATS
+    for (int i = 0; i < SUBSYSTEMS; ++i) {
+        snapshot.subsystems[i].allocations = counters[i].allocations.load(std::memory_order_relaxed);
+        snapshot.subsystems[i].frees = counters[i].frees.load(std::memory_order_relaxed);
+        snapshot.subsystems[i].bytesAllocated = counters[i].bytesAllocated.load(std::memory_order_relaxed);
+        snapshot.subsystems[i].bytesFreed = counters[i].bytesFreed.load(std::memory_order_relaxed);
+    }
+    snapshot.heapBytes = heapBytes.load(std::memory_order_relaxed);
+    snapshot.peakHeapBytes = peakHeapBytes.load(std::memory_order_relaxed);
+    snapshot.peakResidentBytes = peakResidentBytes();
+#endif
+    return snapshot;
+}
+
+const char* MemoryStats::subsystemName(MemorySubsystem subsystem) {
+    return SUBSYSTEM_NAMES[static_cast<int>(subsystem)];
+}
+
+void MemoryStats::printSummary(const MemorySnapshot& snapshot, std::ostream& out) {
+    out << "subsystem     allocations        frees   allocated KB     live KB\n" << std::fixed << std::setprecision(1);
+    for (int i = 0; i < SUBSYSTEMS; ++i) {
+        const SubsystemMemory& subsystem = snapshot.subsystems[i];
+        if (subsystem.allocations == 0) continue;
+
+        out << std::left << setw(12) << SUBSYSTEM_NAMES[i] << std::right << setw(13) << subsystem.allocations
+            << setw(13) << subsystem.frees << setw(15) << subsystem.bytesAllocated / 1024.0
+            << setw(12) << static_cast<int64_t>(subsystem.bytesAllocated - subsystem.bytesFreed) / 1024.0 << "\n";
+    }
+    out << "\nHeap " << snapshot.heapBytes / 1024.0 << " KB now, " << snapshot.peakHeapBytes / 1024.0
+        << " KB at its peak; peak resident " << snapshot.peakResidentBytes / (1024.0 * 1024.0) << " MB\n";
+}
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <cstdint>
+#include <iostream>
+
+/*
+ * Heap instrumentation, built only with KNOSSOS_MEMORY_STATS defined. It replaces the
+ * global operator new and delete to count allocations, frees and bytes for whichever
+ * subsystem the allocating thread is in (see MemoryScope), and keeps the current and
+ * peak heap size. Without the define there is no replacement, MemoryScope is empty
+ * and MemoryStats::ENABLED is false, so all of it compiles away.
+ */
+
+enum class MemorySubsystem : uint8_t {
+    OTHER,
+    MAZE,           // a Matrix's cells
+    PRIM,           // generation: entrance, exit and generativePrim
+    ITEMS,          // generation: placeItems
+    CONNECT,        // generation: connectComponents
+    TURN,           // a Gameplay turn, less its drawing
+    RENDERING,
+    FILES,          // FileHandler and the background writer
+    COUNT
+};
+
+struct SubsystemMemory {
+    uint64_t allocations;
+    uint64_t frees;
+    uint64_t bytesAllocated;
+    uint64_t bytesFreed;        // of blocks this subsystem allocated, whoever freed them
+};
+
+struct MemorySnapshot {
+    SubsystemMemory subsystems[static_cast<int>(MemorySubsystem::COUNT)];
+    uint64_t heapBytes;
+    uint64_t peakHeapBytes;
+    uint64_t peakResidentBytes;     // as the OS reports it
+
+    uint64_t allocations() const;
+    const SubsystemMemory& of(MemorySubsystem subsystem) const { return subsystems[static_cast<int>(subsystem)]; }
+};
+
+class MemoryStats {
+public:
+#ifdef KNOSSOS_MEMORY_STATS
+    static const bool ENABLED = true;
+#else
+    static const bool ENABLED = false;
+#endif
+
+    // All zero when not ENABLED
+    static MemorySnapshot snapshot();
+
+    static const char* subsystemName(MemorySubsystem subsystem);
+
+    // One row per subsystem that allocated anything, then the heap and resident peaks
+    static void printSummary(const MemorySnapshot& snapshot, std::ostream& out);
+};
+
+// Attributes this thread's allocations to a subsystem until it goes out of scope
+class MemoryScope {
+#ifdef KNOSSOS_MEMORY_STATS
+private:
+    MemorySubsystem previous;
+
+public:
+    explicit MemoryScope(MemorySubsystem subsystem);
+    ~MemoryScope();
+#else
+public:
+    explicit MemoryScope(MemorySubsystem) {}
+#endif
+
+    MemoryScope(const MemoryScope&) = delete;
+    MemoryScope& operator=(const MemoryScope&) = delete;
+};
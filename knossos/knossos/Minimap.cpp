@@ -0,0 +1,181 @@
+#include <algorithm>
+
+#include "Minimap.h"
+#include "ConsoleHandler.h"
+#include "MemoryStats.h"
+
+using std::string;
+using std::vector;
+
+namespace {
+
+// Foreground only: a glyph is mostly empty space, which a background would fill in
+const char* const MAP_ROBOT_STYLE = "\x1B[1;34m";
+const char* const MAP_MINOTAUR_STYLE = "\x1B[1;38;2;150;75;0m";
+
+// Bit of each dot of a braille character, by row and column (U+2800 + bits)
+const uint8_t BRAILLE_DOTS[4][2] = { { 0x01, 0x08 }, { 0x02, 0x10 }, { 0x04, 0x20 }, { 0x40, 0x80 } };
+
+const char* const HALF_BLOCKS[4] = { " ", "\xE2\x96\x80", "\xE2\x96\x84", "\xE2\x96\x88" };    // none, upper, lower, full
+
+unsigned int ceilDiv(unsigned int value, unsigned int divisor) {
+    return (value + divisor - 1) / divisor;
+}
+
+void appendBraille(string& frame, uint8_t bits) {
+    frame += '\xE2';
+    frame += static_cast<char>(0xA0 | (bits >> 6));
+    frame += static_cast<char>(0x80 | (bits & 0x3F));
+}
+
+}
+
+// One pass over the fields, in the order Matrix keeps them, for walls, items and the exit
+Minimap::Minimap(const Matrix& matrix)
+    : matrix(matrix), width(matrix.getWidth()), height(matrix.getHeight()),
+    walls(width, height), items(width, height),
+    changesSeen(matrix.getFieldChanges().size()), exit_x(0) {
+
+    for (unsigned int x = 0; x < width; ++x) {
+        for (unsigned int y = 0; y < height; ++y) {
+            FieldType type = matrix.getFieldType(x, y);
+            if (type == FieldType::WALL) walls.set(x, y);
+            else if (type == FieldType::ITEM) items.set(x, y);
+            else if ((type == FieldType::EXIT || type == FieldType::STAIRS_DOWN) && y == height - 1) exit_x = x;
+        }
+    }
+
+    wallBlocks = walls.blockCounts();
+    itemBlocks = items.blockCounts();
+}
+
+// Several changes to one cell end where the cell is now, so only that is looked at
+void Minimap::catchUpWithChanges() {
+    const vector<FieldChange>& changes = matrix.getFieldChanges();
+    for (; changesSeen < changes.size(); ++changesSeen) {
+        unsigned int x = changes[changesSeen].x;
+        unsigned int y = changes[changesSeen].y;
+        FieldType type = matrix.getFieldType(x, y);
+        if (type == FieldType::WALL) walls.set(x, y);
+        else walls.reset(x, y);
+        if (type == FieldType::ITEM) items.set(x, y);
+        else items.reset(x, y);
+
+        size_t blockX = x / Bitboard::BLOCK;
+        size_t blockY = y / Bitboard::BLOCK;
+        size_t block = blockY * walls.blocksPerRow() + blockX;
+        wallBlocks[block] = static_cast<uint8_t>(walls.blockCount(blockX, blockY));
+        itemBlocks[block] = static_cast<uint8_t>(items.blockCount(blockX, blockY));
+    }
+}
+
+void Minimap::draw(std::ostream& out, pair<int, int> console_size, Style style, const Marks& marks, const Bitboard* explored) {
+    MemoryScope scope(MemorySubsystem::RENDERING);
+    catchUpWithChanges();
+
+    const unsigned int dotsAcross = style == Style::BRAILLE ? 2 : 1;
+    const unsigned int dotsDown = style == Style::BRAILLE ? 4 : 2;
+    const unsigned int columns = static_cast<unsigned int>(std::max(1, console_size.first - 4));
+    const unsigned int rows = static_cast<unsigned int>(std::max(1, console_size.second - 3));
+
+    // The smallest square of cells per dot that fits the maze on screen; from a
+    // block up, whole blocks, so the cached counts add up to the dots
+    unsigned int scale = std::max(1u, std::max(ceilDiv(width, columns * dotsAcross), ceilDiv(height, rows * dotsDown)));
+    if (scale >= Bitboard::BLOCK) {
+        scale = ceilDiv(scale, Bitboard::BLOCK) * Bitboard::BLOCK;
+    }
+    const unsigned int dotsX = ceilDiv(width, scale);
+    const unsigned int dotsY = ceilDiv(height, scale);
+
+    vector<uint32_t> wallCells(static_cast<size_t>(dotsX) * dotsY, 0);
+    vector<uint32_t> itemCells(wallCells.size(), 0);
+    vector<uint32_t> exploredCells(wallCells.size(), 0);
+
+    if (scale % Bitboard::BLOCK == 0) {
+        const unsigned int blocksPerDot = scale / Bitboard::BLOCK;
+        const size_t stride = walls.blocksPerRow();
+        const unsigned int blocksX = ceilDiv(width, Bitboard::BLOCK);
+        vector<uint8_t> exploredBlocks;
+        if (explored != nullptr) {
+            exploredBlocks = explored->blockCounts();
+        }
+
+        for (size_t blockY = 0; blockY < walls.blockRows(); ++blockY) {
+            size_t dotRow = blockY / blocksPerDot * dotsX;
+            for (unsigned int blockX = 0; blockX < blocksX; ++blockX) {
+                size_t dot = dotRow + blockX / blocksPerDot;
+                size_t block = blockY * stride + blockX;
+                wallCells[dot] += wallBlocks[block];
+                itemCells[dot] += itemBlocks[block];
+                if (explored != nullptr) exploredCells[dot] += exploredBlocks[block];
+            }
+        }
+    }
+    else {
+        // Less than a block per dot: the maze is at most a few screens big
+        for (unsigned int y = 0; y < height; ++y) {
+            size_t dotRow = static_cast<size_t>(y / scale) * dotsX;
+            for (unsigned int x = 0; x < width; ++x) {
+                size_t dot = dotRow + x / scale;
+                wallCells[dot] += walls.test(x, y);
+                itemCells[dot] += items.test(x, y);
+                if (explored != nullptr) exploredCells[dot] += explored->test(x, y);
+            }
+        }
+    }
+
+    auto dotOf = [&](unsigned int x, unsigned int y) { return static_cast<size_t>(y / scale) * dotsX + x / scale; };
+    const size_t robotDot = dotOf(marks.robot_x, marks.robot_y);
+    const size_t minotaurDot = marks.minotaur ? dotOf(marks.minotaur_x, marks.minotaur_y) : wallCells.size();
+    const size_t exitDot = dotOf(exit_x, height - 1);
+
+    string frame = "\033[H\033[2J";
+    frame += " Overview of the " + std::to_string(width) + " x " + std::to_string(height) + " labyrinth, one dot to " +
+        std::to_string(scale) + " x " + std::to_string(scale) + " cells - M: " +
+        (style == Style::BRAILLE ? "half blocks" : "back to the maze") + ", or move on\n\n";
+
+    const unsigned int glyphsX = ceilDiv(dotsX, dotsAcross);
+    const unsigned int glyphsY = ceilDiv(dotsY, dotsDown);
+    for (unsigned int glyphY = 0; glyphY < glyphsY; ++glyphY) {
+        frame += "  ";
+        for (unsigned int glyphX = 0; glyphX < glyphsX; ++glyphX) {
+            uint8_t bits = 0;
+            const char* glyphStyle = nullptr;
+            int priority = 0;
+
+            for (unsigned int row = 0; row < dotsDown; ++row) {
+                for (unsigned int column = 0; column < dotsAcross; ++column) {
+                    unsigned int dotX = glyphX * dotsAcross + column;
+                    unsigned int dotY = glyphY * dotsDown + row;
+                    if (dotX >= dotsX || dotY >= dotsY) continue;
+
+                    size_t dot = static_cast<size_t>(dotY) * dotsX + dotX;
+                    uint8_t bit = style == Style::BRAILLE ? BRAILLE_DOTS[row][column] : static_cast<uint8_t>(1 << row);
+                    bool known = explored == nullptr || exploredCells[dot] > 0;
+                    unsigned int cells = std::min(scale, width - dotX * scale) * std::min(scale, height - dotY * scale);
+
+                    if (known && wallCells[dot] * 2 > cells) bits |= bit;
+
+                    // The most important thing in the character gives it its colour and shows its dot
+                    int dotPriority = dot == robotDot ? 4 : dot == minotaurDot ? 3 :
+                        (dot == exitDot && known) ? 2 : (itemCells[dot] > 0 && known) ? 1 : 0;
+                    if (dotPriority > 0) bits |= bit;
+                    if (dotPriority > priority) {
+                        priority = dotPriority;
+                        glyphStyle = priority == 4 ? MAP_ROBOT_STYLE : priority == 3 ? MAP_MINOTAUR_STYLE :
+                            priority == 2 ? ANSICodes::EXIT_STYLE : ANSICodes::ITEM_STYLE;
+                    }
+                }
+            }
+
+            if (glyphStyle != nullptr) frame += glyphStyle;
+            if (style == Style::BRAILLE) appendBraille(frame, bits);
+            else frame += HALF_BLOCKS[bits];
+            if (glyphStyle != nullptr) frame += ANSICodes::RESET;
+        }
+        frame += "\n";
+    }
+
+    out << frame;
+    out.flush();
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <vector>
+#include <string>
+#include <utility>
+#include <cstdint>
+#include <iostream>
+#include "Matrix.h"
+#include "Bitboard.h"
+
+using std::pair;
+
+/**
+ * @brief The whole maze shrunk to fit the terminal: braille characters (2x4 dots)
+ * or half blocks (1x2), each dot a square of cells that is mostly wall. The hero,
+ * the Minotaur and the exit are marked; given an explored set, only explored
+ * places are drawn.
+ *
+ * Walls and items are counted per 8x8 block of cells once, on whole words at a time
+ * (see Bitboard::blockCounts). Afterwards only the blocks holding the Matrix's new
+ * field changes - broken walls, taken items - are counted again, so a frame costs
+ * about as much as the screen, not the maze.
+ */
+class Minimap {
+public:
+    enum class Style { BRAILLE, HALF_BLOCK };
+
+    struct Marks {
+        unsigned int robot_x;
+        unsigned int robot_y;
+        bool minotaur;
+        unsigned int minotaur_x;
+        unsigned int minotaur_y;
+    };
+
+    // The matrix must outlive the minimap (a new floor needs a new one)
+    explicit Minimap(const Matrix& matrix);
+
+    // A whole screen: a title line, then the map; explored may be nullptr
+    void draw(std::ostream& out, pair<int, int> console_size, Style style, const Marks& marks, const Bitboard* explored);
+
+private:
+    const Matrix& matrix;
+    unsigned int width;
+    unsigned int height;
+    Bitboard walls;
+    Bitboard items;
+    std::vector<uint8_t> wallBlocks;
+    std::vector<uint8_t> itemBlocks;
+    size_t changesSeen;
+    unsigned int exit_x;        // the exit, or the stairs down, on the bottom row
+
+    void catchUpWithChanges();
+};
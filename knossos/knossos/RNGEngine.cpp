@@ -8,7 +8,9 @@ using std::mersenne_twister;
 
 
 random_device RNGEngine::rd;
-mersenne_twister RNGEngine::gen(RNGEngine::rd());
+std::mutex RNGEngine::rdMutex;
+thread_local mersenne_twister RNGEngine::gen(RNGEngine::generateSeed());
+thread_local mersenne_twister RNGEngine::cosmeticGen(RNGEngine::generateSeed());
 
 /**
 * @brief Generate a random number within the specified range [min, max]
@@ -19,4 +21,27 @@ mersenne_twister RNGEngine::gen(RNGEngine::rd());
 unsigned int RNGEngine::getRandomNumber(unsigned int min, unsigned int max) {
 	uniform_int_distribution<unsigned int> distrib(min, max);
 	return distrib(gen);
+}
+
+unsigned int RNGEngine::getCosmeticRandomNumber(unsigned int min, unsigned int max) {
+	uniform_int_distribution<unsigned int> distrib(min, max);
+	return distrib(cosmeticGen);
+}
+
+unsigned int RNGEngine::generateSeed() {
+	// random_device isn't guaranteed to be safe to call from several threads at once
+	std::lock_guard<std::mutex> lock(rdMutex);
+	return rd();
+}
+
+void RNGEngine::seed(unsigned int seed) {
+	gen.seed(seed);
+}
+
+mersenne_twister RNGEngine::getState() {
+	return gen;
+}
+
+void RNGEngine::setState(const mersenne_twister& state) {
+	gen = state;
 }
\ No newline at end of file
@@ -1,5 +1,7 @@
 #pragma once
 #include <random>
+#include <algorithm>
+#include <mutex>
 
 #define mersenne_twister mt19937
 
@@ -9,7 +11,12 @@ using std::mersenne_twister;
 class RNGEngine {
 private:
     static random_device rd;
-    static mersenne_twister gen;
+    static std::mutex rdMutex;
+
+    // One engine per thread: parallel workers never share state, and seeding
+    // affects only the calling thread's sequence
+    static thread_local mersenne_twister gen;
+    static thread_local mersenne_twister cosmeticGen;
 
     RNGEngine() = default;
 
@@ -24,4 +31,37 @@ public:
      * @return Random integer in the range [min, max]
      */
     static unsigned int getRandomNumber(unsigned int min, unsigned int max);
+
+    /**
+     * @brief Random number for purely visual effects (e.g. fog noise).
+     * Drawn from a separate stream so rendering never shifts the gameplay sequence,
+     * which keeps seeded games and replays deterministic with or without a display.
+     */
+    static unsigned int getCosmeticRandomNumber(unsigned int min, unsigned int max);
+
+    /**
+     * @brief Draw a fresh seed from the hardware entropy source
+     */
+    static unsigned int generateSeed();
+
+    /**
+     * @brief Reseed the generator so that everything drawn afterwards is reproducible
+     * @param seed Seed for the Mersenne Twister
+     */
+    static void seed(unsigned int seed);
+
+    /**
+     * @brief The calling thread's gameplay generator, to continue its exact sequence
+     * on another thread (e.g. a maze generated by a worker, played on the main thread)
+     */
+    static mersenne_twister getState();
+    static void setState(const mersenne_twister& state);
+
+    /**
+     * @brief Shuffle a range using the engine (unlike random_shuffle, this follows the seed)
+     */
+    template <typename RandomIt>
+    static void shuffle(RandomIt first, RandomIt last) {
+        std::shuffle(first, last, gen);
+    }
 };
\ No newline at end of file
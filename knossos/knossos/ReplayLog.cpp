@@ -0,0 +1,112 @@
+#include <iostream>
+
+#include "ReplayLog.h"
+#include "BinaryIO.h"
+#include "Matrix.h"
+
+using std::string;
+using std::ifstream;
+using std::ios;
+using std::cerr;
+
+static const char REPLAY_MAGIC[4] = { 'K', 'N', 'R', 'P' };
+static const uint16_t REPLAY_FORMAT_VERSION = 2;
+static const size_t REPLAY_HEADER_SIZE = 4 + 2 + 2 + 4 * 4 + 2 * 2;
+static const size_t REPLAY_TURN_SIZE = 1 + 4;
+
+bool ReplayLog::open(const string& filename, unsigned int seed,
+    unsigned int width, unsigned int height, unsigned int no_of_items, SpawnBand minotaur_band) {
+
+    file.open(filename, ios::binary | ios::trunc);
+
+    if (!file.is_open()) {
+        cerr << "Error: Could not create replay log " << filename << "\n";
+        return false;
+    }
+
+    string header;
+    header.append(REPLAY_MAGIC, sizeof(REPLAY_MAGIC));
+    appendU16(header, REPLAY_FORMAT_VERSION);
+    appendU16(header, static_cast<uint16_t>(Matrix::GENERATOR_VERSION));
+    appendU32(header, seed);
+    appendU32(header, width);
+    appendU32(header, height);
+    appendU32(header, no_of_items);
+    appendU16(header, static_cast<uint16_t>(minotaur_band.low));
+    appendU16(header, static_cast<uint16_t>(minotaur_band.high));
+
+    file.write(header.data(), header.size());
+    file.flush();
+
+    return file.good();
+}
+
+void ReplayLog::recordTurn(char key, uint32_t checksum) {
+    if (!file.is_open()) {
+        return;
+    }
+
+    string entry;
+    appendU8(entry, static_cast<uint8_t>(key));
+    appendU32(entry, checksum);
+
+    file.write(entry.data(), entry.size());
+    file.flush();
+}
+
+bool ReplayLog::load(const string& filename, Replay& replay) {
+    ifstream input(filename, ios::binary);
+
+    if (!input.is_open()) {
+        cerr << "Error: Could not open replay log " << filename << "\n";
+        return false;
+    }
+
+    string contents((std::istreambuf_iterator<char>(input)), std::istreambuf_iterator<char>());
+
+    if (contents.size() < REPLAY_HEADER_SIZE || contents.compare(0, sizeof(REPLAY_MAGIC), REPLAY_MAGIC, sizeof(REPLAY_MAGIC)) != 0) {
+        cerr << "Error: " << filename << " is not a replay log\n";
+        return false;
+    }
+
+    size_t offset = sizeof(REPLAY_MAGIC);
+    uint16_t formatVersion = readU16(contents, offset);
+    uint16_t generatorVersion = readU16(contents, offset);
+
+    if (formatVersion != REPLAY_FORMAT_VERSION) {
+        cerr << "Error: Unsupported replay format version " << formatVersion << "\n";
+        return false;
+    }
+    if (generatorVersion != Matrix::GENERATOR_VERSION) {
+        cerr << "Error: Replay was recorded with a different maze generator (version " << generatorVersion
+            << ", this build has " << Matrix::GENERATOR_VERSION << ")\n";
+        return false;
+    }
+
+    replay.seed = readU32(contents, offset);
+    replay.width = readU32(contents, offset);
+    replay.height = readU32(contents, offset);
+    replay.no_of_items = readU32(contents, offset);
+    replay.minotaur_band.low = readU16(contents, offset);
+    replay.minotaur_band.high = readU16(contents, offset);
+
+    if (replay.width <= 15 || replay.height <= 15) {
+        cerr << "Error: Replay log " << filename << " is corrupted\n";
+        return false;
+    }
+
+    // A partially written last entry (crash mid-write) is simply dropped
+    size_t turnCount = (contents.size() - offset) / REPLAY_TURN_SIZE;
+    replay.turns.clear();
+    replay.turns.reserve(turnCount);
+
+    for (size_t i = 0; i < turnCount; ++i) {
+        ReplayTurn turn;
+        turn.key = static_cast<char>(readU8(contents.data() + offset));
+        turn.checksum = readU32(contents.data() + offset + 1);
+        offset += REPLAY_TURN_SIZE;
+        replay.turns.push_back(turn);
+    }
+
+    return true;
+}
\ No newline at end of file
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <fstream>
+#include <cstdint>
+#include "Matrix.h"
+
+struct ReplayTurn {
+    char key;
+    uint32_t checksum;     // Gameplay state checksum after the key was processed
+};
+
+struct Replay {
+    unsigned int seed;
+    unsigned int width;
+    unsigned int height;
+    unsigned int no_of_items;
+    SpawnBand minotaur_band;
+    std::vector<ReplayTurn> turns;
+};
+
+/**
+ * @brief Input log that is enough to re-execute a game exactly: the maze seed,
+ * dimensions and Minotaur spawn band up front, then one 5-byte entry
+ * (key + state checksum) per accepted key.
+ */
+class ReplayLog {
+private:
+    std::ofstream file;
+
+public:
+    ReplayLog() = default;
+    ~ReplayLog() = default;
+
+    bool open(const std::string& filename, unsigned int seed,
+        unsigned int width, unsigned int height, unsigned int no_of_items, SpawnBand minotaur_band);
+
+    // Appended and flushed per turn, so a crash still leaves a replayable log
+    void recordTurn(char key, uint32_t checksum);
+
+    static bool load(const std::string& filename, Replay& replay);
+};
\ No newline at end of file
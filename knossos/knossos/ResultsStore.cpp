@@ -0,0 +1,453 @@
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <algorithm>
+#include <cstring>
+#include <cstdio>
+
+#ifdef _WIN32
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#include "ResultsStore.h"
+#include "MappedFile.h"
+#include "BinaryIO.h"
+
+using std::string;
+using std::vector;
+using std::cout;
+using std::cerr;
+using std::nth_element;
+
+const char* ResultsStore::DEFAULT_FILENAME = "knossos_results.klog";
+
+static const char STORE_MAGIC[4] = { 'K', 'N', 'R', 'S' };
+static const uint16_t STORE_FORMAT_VERSION = 1;
+
+static const char RECORD_TAG = 'R';
+static const char SUMMARY_TAG = 'S';
+
+// How far past the end of a block a reader looks for that block's summary;
+// it lands right behind the block unless other appends sneak in between
+static const uint64_t SUMMARY_PROBE_SLOTS = 64;
+
+// Slot layout: tag in the first byte, its complement in the last one, so a torn
+// or foreign slot is never mistaken for a record
+static bool slotHasTag(const char* slot, char tag) {
+    return slot[0] == tag && static_cast<unsigned char>(slot[ResultsStore::SLOT_SIZE - 1]) ==
+        static_cast<unsigned char>(~static_cast<unsigned char>(tag));
+}
+
+static void sealSlot(string& slot, char tag) {
+    slot.resize(ResultsStore::SLOT_SIZE, '\0');
+    slot[0] = tag;
+    slot[ResultsStore::SLOT_SIZE - 1] = static_cast<char>(~static_cast<unsigned char>(tag));
+}
+
+static string encodeHeader() {
+    string slot(STORE_MAGIC, sizeof(STORE_MAGIC));
+    appendU16(slot, STORE_FORMAT_VERSION);
+    appendU16(slot, static_cast<uint16_t>(ResultsStore::SLOT_SIZE));
+    appendU32(slot, ResultsStore::BLOCK_SLOTS);
+    slot.resize(ResultsStore::SLOT_SIZE, '\0');
+    return slot;
+}
+
+static string encodeRecord(const ResultRecord& record) {
+    string slot;
+    appendU8(slot, 0);                                    // tag, set by sealSlot
+    appendU8(slot, static_cast<uint8_t>(record.result));
+    appendU16(slot, 0);
+    appendU32(slot, record.width);
+    appendU32(slot, record.height);
+    appendU32(slot, record.no_of_items);
+    appendU64(slot, record.timestamp);
+    appendU64(slot, record.duration);
+    appendU32(slot, record.moves);
+    appendU32(slot, record.seed);
+    appendU32(slot, record.peak_heap_kb);
+    appendU32(slot, record.peak_resident_kb);
+    appendU32(slot, record.allocations);
+    appendU32(slot, record.turn_allocations);
+    sealSlot(slot, RECORD_TAG);
+    return slot;
+}
+
+struct BlockSummary {
+    uint32_t records;
+    uint64_t first_slot;
+    uint64_t last_slot;
+    uint64_t min_timestamp;
+    uint64_t max_timestamp;
+    uint32_t min_width;
+    uint32_t max_width;
+    uint32_t min_height;
+    uint32_t max_height;
+};
+
+static string encodeSummary(const BlockSummary& summary) {
+    string slot;
+    appendU32(slot, 0);                                   // tag, set by sealSlot
+    appendU32(slot, summary.records);
+    appendU64(slot, summary.first_slot);
+    appendU64(slot, summary.last_slot);
+    appendU64(slot, summary.min_timestamp);
+    appendU64(slot, summary.max_timestamp);
+    appendU32(slot, summary.min_width);
+    appendU32(slot, summary.max_width);
+    appendU32(slot, summary.min_height);
+    appendU32(slot, summary.max_height);
+    sealSlot(slot, SUMMARY_TAG);
+    return slot;
+}
+
+static BlockSummary decodeSummary(const char* slot) {
+    BlockSummary summary;
+    summary.records = readU32(slot + 4);
+    summary.first_slot = readU64(slot + 8);
+    summary.last_slot = readU64(slot + 16);
+    summary.min_timestamp = readU64(slot + 24);
+    summary.max_timestamp = readU64(slot + 32);
+    summary.min_width = readU32(slot + 40);
+    summary.max_width = readU32(slot + 44);
+    summary.min_height = readU32(slot + 48);
+    summary.max_height = readU32(slot + 52);
+    return summary;
+}
+
+static BlockSummary summarizeBlock(const char* slots, uint64_t firstSlot, uint64_t slotCount) {
+    BlockSummary summary;
+    summary.records = 0;
+    summary.first_slot = firstSlot;
+    summary.last_slot = firstSlot + slotCount - 1;
+    summary.min_timestamp = UINT64_MAX;
+    summary.max_timestamp = 0;
+    summary.min_width = UINT32_MAX;
+    summary.max_width = 0;
+    summary.min_height = UINT32_MAX;
+    summary.max_height = 0;
+
+    for (uint64_t i = 0; i < slotCount; ++i) {
+        const char* slot = slots + i * ResultsStore::SLOT_SIZE;
+        if (!slotHasTag(slot, RECORD_TAG)) {
+            continue;
+        }
+        uint32_t width = readU32(slot + 4);
+        uint32_t height = readU32(slot + 8);
+        uint64_t timestamp = readU64(slot + 16);
+
+        ++summary.records;
+        summary.min_timestamp = std::min(summary.min_timestamp, timestamp);
+        summary.max_timestamp = std::max(summary.max_timestamp, timestamp);
+        summary.min_width = std::min(summary.min_width, width);
+        summary.max_width = std::max(summary.max_width, width);
+        summary.min_height = std::min(summary.min_height, height);
+        summary.max_height = std::max(summary.max_height, height);
+    }
+    return summary;
+}
+
+#ifdef _WIN32
+static bool createStoreIfMissing(const string& filename) {
+    if (GetFileAttributesA(filename.c_str()) != INVALID_FILE_ATTRIBUTES) {
+        return true;
+    }
+
+    // Build the header in a private file, then move it into place; if another
+    // process won the race the move fails and we simply use their file
+    string tempPath = filename + ".tmp." + std::to_string(GetCurrentProcessId());
+    HANDLE file = CreateFileA(tempPath.c_str(), GENERIC_WRITE, 0, nullptr, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE) {
+        return false;
+    }
+    string header = encodeHeader();
+    DWORD written = 0;
+    WriteFile(file, header.data(), static_cast<DWORD>(header.size()), &written, nullptr);
+    CloseHandle(file);
+
+    MoveFileExA(tempPath.c_str(), filename.c_str(), MOVEFILE_WRITE_THROUGH);
+    DeleteFileA(tempPath.c_str());
+    return GetFileAttributesA(filename.c_str()) != INVALID_FILE_ATTRIBUTES;
+}
+
+// Appends one slot; returns the index of the slot it landed in, or -1
+static int64_t appendSlot(HANDLE file, const string& slot) {
+    DWORD written = 0;
+    if (!WriteFile(file, slot.data(), static_cast<DWORD>(slot.size()), &written, nullptr) || written != slot.size()) {
+        return -1;
+    }
+    // FILE_APPEND_DATA appends atomically, but Windows doesn't report where; the size
+    // right after is exact unless another process appended in between, in which case
+    // a block may stay without a summary and readers just scan it
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(file, &size)) {
+        return -1;
+    }
+    return size.QuadPart / ResultsStore::SLOT_SIZE - 1;
+}
+
+static bool readSlots(HANDLE file, uint64_t firstSlot, uint64_t slotCount, vector<char>& buffer) {
+    buffer.resize(static_cast<size_t>(slotCount * ResultsStore::SLOT_SIZE));
+    OVERLAPPED position = {};
+    uint64_t offset = firstSlot * ResultsStore::SLOT_SIZE;
+    position.Offset = static_cast<DWORD>(offset & 0xFFFFFFFF);
+    position.OffsetHigh = static_cast<DWORD>(offset >> 32);
+    DWORD bytesRead = 0;
+    return ReadFile(file, buffer.data(), static_cast<DWORD>(buffer.size()), &bytesRead, &position) && bytesRead == buffer.size();
+}
+
+bool ResultsStore::append(const string& filename, const ResultRecord& record) {
+    if (!createStoreIfMissing(filename)) {
+        cerr << "Error: Could not create results log " << filename << "\n";
+        return false;
+    }
+
+    HANDLE file = CreateFileA(filename.c_str(), FILE_APPEND_DATA | GENERIC_READ,
+        FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE) {
+        cerr << "Error: Could not open results log " << filename << "\n";
+        return false;
+    }
+#else
+static bool createStoreIfMissing(const string& filename) {
+    if (access(filename.c_str(), F_OK) == 0) {
+        return true;
+    }
+
+    // Build the header in a private file, then link it into place; link() fails with
+    // EEXIST if another process won the race, and then we simply use their file
+    string tempPath = filename + ".tmp." + std::to_string(getpid());
+    int fd = open(tempPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        return false;
+    }
+    string header = encodeHeader();
+    bool written = write(fd, header.data(), header.size()) == static_cast<ssize_t>(header.size());
+    close(fd);
+
+    bool linked = written && (link(tempPath.c_str(), filename.c_str()) == 0 || errno == EEXIST);
+    unlink(tempPath.c_str());
+    return linked;
+}
+
+// Appends one slot; returns the index of the slot it landed in, or -1
+static int64_t appendSlot(int fd, const string& slot) {
+    // A single O_APPEND write: the kernel picks the offset and writes under the inode
+    // lock, so records from concurrent processes never interleave
+    if (write(fd, slot.data(), slot.size()) != static_cast<ssize_t>(slot.size())) {
+        return -1;
+    }
+    // The file offset is left right behind our own write, whatever others appended since
+    off_t end = lseek(fd, 0, SEEK_CUR);
+    if (end < 0) {
+        return -1;
+    }
+    return static_cast<int64_t>(end) / ResultsStore::SLOT_SIZE - 1;
+}
+
+static bool readSlots(int fd, uint64_t firstSlot, uint64_t slotCount, vector<char>& buffer) {
+    buffer.resize(static_cast<size_t>(slotCount * ResultsStore::SLOT_SIZE));
+    ssize_t bytesRead = pread(fd, buffer.data(), buffer.size(), static_cast<off_t>(firstSlot * ResultsStore::SLOT_SIZE));
+    return bytesRead == static_cast<ssize_t>(buffer.size());
+}
+
+bool ResultsStore::append(const string& filename, const ResultRecord& record) {
+    if (!createStoreIfMissing(filename)) {
+        cerr << "Error: Could not create results log " << filename << "\n";
+        return false;
+    }
+
+    int file = open(filename.c_str(), O_RDWR | O_APPEND);
+    if (file < 0) {
+        cerr << "Error: Could not open results log " << filename << "\n";
+        return false;
+    }
+#endif
+
+    int64_t slot = appendSlot(file, encodeRecord(record));
+    bool appended = slot >= 0;
+
+    // Whoever fills the last slot of a block indexes it; a summary can itself land in
+    // the last slot of the next block, hence the loop
+    vector<char> block;
+    while (slot >= 0 && (slot + 1) % BLOCK_SLOTS == 0) {
+        uint64_t firstSlot = static_cast<uint64_t>(slot + 1) - BLOCK_SLOTS;
+        if (!readSlots(file, firstSlot, BLOCK_SLOTS, block)) {
+            break;
+        }
+        slot = appendSlot(file, encodeSummary(summarizeBlock(block.data(), firstSlot, BLOCK_SLOTS)));
+    }
+
+#ifdef _WIN32
+    CloseHandle(file);
+#else
+    close(file);
+#endif
+
+    if (!appended) {
+        cerr << "Error: Could not append to results log " << filename << "\n";
+    }
+    return appended;
+}
+
+static bool summaryMatches(const BlockSummary& summary, const ResultQuery& query) {
+    return summary.records > 0 &&
+        summary.max_timestamp >= query.from_timestamp && summary.min_timestamp <= query.to_timestamp &&
+        summary.max_width >= query.min_size && summary.min_width <= query.max_size &&
+        summary.max_height >= query.min_size && summary.min_height <= query.max_size;
+}
+
+static uint64_t percentile(vector<uint64_t>& values, unsigned int percent) {
+    if (values.empty()) {
+        return 0;
+    }
+    // Nearest-rank percentile; nth_element keeps this linear even for millions of games
+    size_t rank = (values.size() * percent + 99) / 100;
+    size_t index = rank > 0 ? rank - 1 : 0;
+    nth_element(values.begin(), values.begin() + index, values.end());
+    return values[index];
+}
+
+bool ResultsStore::query(const string& filename, const ResultQuery& query, ResultStatistics& statistics) {
+    statistics = ResultStatistics();
+
+    MappedFile file;
+    if (!file.open(filename)) {
+        cerr << "Error: Could not open results log " << filename << "\n";
+        return false;
+    }
+
+    if (file.size() < SLOT_SIZE || memcmp(file.data(), STORE_MAGIC, sizeof(STORE_MAGIC)) != 0 ||
+        readU16(file.data() + 4) != STORE_FORMAT_VERSION || readU16(file.data() + 6) != SLOT_SIZE ||
+        readU32(file.data() + 8) != BLOCK_SLOTS) {
+        cerr << "Error: " << filename << " is not a results log\n";
+        return false;
+    }
+
+    // A trailing partial slot is an append still in flight - ignore it
+    uint64_t slotCount = file.size() / SLOT_SIZE;
+    const char* slots = file.data();
+
+    vector<uint64_t> durations;
+    durations.reserve(static_cast<size_t>(slotCount));
+
+    for (uint64_t blockStart = 0; blockStart < slotCount; blockStart += BLOCK_SLOTS) {
+        uint64_t blockEnd = std::min(blockStart + BLOCK_SLOTS, slotCount);
+        ++statistics.blocks_total;
+
+        if (blockEnd - blockStart == BLOCK_SLOTS) {
+            bool skipBlock = false;
+            uint64_t probeEnd = std::min(blockEnd + SUMMARY_PROBE_SLOTS, slotCount);
+
+            for (uint64_t probe = blockEnd; probe < probeEnd; ++probe) {
+                const char* slot = slots + probe * SLOT_SIZE;
+                if (slotHasTag(slot, SUMMARY_TAG)) {
+                    BlockSummary summary = decodeSummary(slot);
+                    if (summary.first_slot == blockStart) {
+                        skipBlock = !summaryMatches(summary, query);
+                        break;
+                    }
+                }
+            }
+
+            if (skipBlock) {
+                ++statistics.blocks_skipped;
+                continue;
+            }
+        }
+
+        for (uint64_t index = blockStart; index < blockEnd; ++index) {
+            const char* slot = slots + index * SLOT_SIZE;
+            if (!slotHasTag(slot, RECORD_TAG)) {
+                continue;
+            }
+
+            uint8_t result = readU8(slot + 1);
+            uint32_t width = readU32(slot + 4);
+            uint32_t height = readU32(slot + 8);
+            uint64_t timestamp = readU64(slot + 16);
+
+            if (timestamp < query.from_timestamp || timestamp > query.to_timestamp ||
+                width < query.min_size || width > query.max_size ||
+                height < query.min_size || height > query.max_size || result > 3) {
+                continue;
+            }
+
+            ++statistics.games;
+            ++statistics.results_by_type[result];
+            statistics.total_moves += readU32(slot + 32);
+            durations.push_back(readU64(slot + 24));
+
+            // Records from older or uninstrumented builds have zeros here
+            uint32_t peakHeap = readU32(slot + 40);
+            if (peakHeap > 0) {
+                ++statistics.instrumented_games;
+                statistics.instrumented_moves += readU32(slot + 32);
+                statistics.turn_allocations += readU32(slot + 52);
+                statistics.peak_heap_kb_total += peakHeap;
+                statistics.peak_heap_kb_max = std::max<uint64_t>(statistics.peak_heap_kb_max, peakHeap);
+                statistics.peak_resident_kb_max = std::max<uint64_t>(statistics.peak_resident_kb_max, readU32(slot + 44));
+            }
+        }
+    }
+
+    if (!durations.empty()) {
+        statistics.duration_max = *std::max_element(durations.begin(), durations.end());
+    }
+    statistics.duration_p50 = percentile(durations, 50);
+    statistics.duration_p90 = percentile(durations, 90);
+    statistics.duration_p99 = percentile(durations, 99);
+
+    return true;
+}
+
+static string formatDuration(uint64_t microseconds) {
+    char buffer[32];
+    if (microseconds >= 60000000ULL) {
+        snprintf(buffer, sizeof(buffer), "%.1f min", microseconds / 60000000.0);
+    }
+    else {
+        snprintf(buffer, sizeof(buffer), "%.2f s", microseconds / 1000000.0);
+    }
+    return buffer;
+}
+
+void ResultsStore::printStatistics(const string& filename, const ResultStatistics& statistics) {
+    static const char* resultNames[4] = { "Victories", "Minotaur slain", "Defeated", "Forfeited" };
+
+    cout << "\nResults in " << filename << ": " << statistics.games << " matching games ("
+        << statistics.blocks_skipped << " of " << statistics.blocks_total << " index blocks skipped)\n\n";
+
+    if (statistics.games == 0) {
+        return;
+    }
+
+    cout << std::fixed << std::setprecision(1);
+    for (int i = 0; i < 4; ++i) {
+        cout << "  " << std::left << std::setw(16) << resultNames[i] << std::right << std::setw(6)
+            << 100.0 * statistics.results_by_type[i] / statistics.games << "%  (" << statistics.results_by_type[i] << ")\n";
+    }
+
+    cout << "\n  Average moves:   " << static_cast<double>(statistics.total_moves) / statistics.games << "\n";
+    cout << "  Duration p50:    " << formatDuration(statistics.duration_p50) << "\n";
+    cout << "  Duration p90:    " << formatDuration(statistics.duration_p90) << "\n";
+    cout << "  Duration p99:    " << formatDuration(statistics.duration_p99) << "\n";
+    cout << "  Duration max:    " << formatDuration(statistics.duration_max) << "\n\n";
+
+    if (statistics.instrumented_games > 0) {
+        cout << "  Memory (" << statistics.instrumented_games << " of the games from instrumented builds):\n";
+        cout << "  Peak heap:       " << static_cast<double>(statistics.peak_heap_kb_total) / statistics.instrumented_games
+            << " KB average, " << statistics.peak_heap_kb_max << " KB max\n";
+        cout << "  Peak resident:   " << statistics.peak_resident_kb_max / 1024.0 << " MB max\n";
+        if (statistics.instrumented_moves > 0) {
+            cout << "  Allocations:     " << static_cast<double>(statistics.turn_allocations) / statistics.instrumented_moves
+                << " per move\n";
+        }
+        cout << "\n";
+    }
+}
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <string>
+#include <cstdint>
+#include "FileHandler.h"
+
+struct ResultRecord {
+    uint64_t timestamp;         // end of game, microseconds since the Unix epoch
+    uint32_t width;
+    uint32_t height;
+    uint32_t no_of_items;
+    GameResult result;
+    uint64_t duration;          // microseconds
+    uint32_t moves;
+    uint32_t seed;
+    uint32_t peak_heap_kb;          // this and the rest stay 0 unless built with KNOSSOS_MEMORY_STATS
+    uint32_t peak_resident_kb;
+    uint32_t allocations;
+    uint32_t turn_allocations;      // made during Gameplay turns
+};
+
+// Inclusive ranges; the size range applies to both width and height
+struct ResultQuery {
+    uint64_t from_timestamp;
+    uint64_t to_timestamp;
+    uint32_t min_size;
+    uint32_t max_size;
+
+    ResultQuery() : from_timestamp(0), to_timestamp(UINT64_MAX), min_size(0), max_size(UINT32_MAX) {}
+};
+
+struct ResultStatistics {
+    uint64_t games;
+    uint64_t results_by_type[4];    // indexed by GameResult
+    uint64_t total_moves;
+    uint64_t duration_p50;
+    uint64_t duration_p90;
+    uint64_t duration_p99;
+    uint64_t duration_max;
+    uint64_t instrumented_games;    // the ones with memory figures
+    uint64_t instrumented_moves;
+    uint64_t turn_allocations;
+    uint64_t peak_heap_kb_total;
+    uint64_t peak_heap_kb_max;
+    uint64_t peak_resident_kb_max;
+    uint64_t blocks_total;
+    uint64_t blocks_skipped;        // ruled out by the in-file index without reading records
+};
+
+/**
+ * @brief Single append-only log of game results made of fixed-size 64-byte slots.
+ *
+ * Slot 0 is a header, every other slot is either a result record or a block summary.
+ * Processes append records without locking: each record is one O_APPEND write, so the
+ * kernel serialises concurrent appends. Whoever's slot completes a block of BLOCK_SLOTS
+ * slots appends a summary (min/max timestamp, width and height) for it right behind,
+ * which lets queries skip whole blocks that can't match.
+ */
+class ResultsStore {
+public:
+    static const char* DEFAULT_FILENAME;
+    static const uint32_t SLOT_SIZE = 64;
+    static const uint32_t BLOCK_SLOTS = 1024;
+
+    static bool append(const std::string& filename, const ResultRecord& record);
+
+    // Memory-maps the log and aggregates all records matching the query
+    static bool query(const std::string& filename, const ResultQuery& query, ResultStatistics& statistics);
+
+    static void printStatistics(const std::string& filename, const ResultStatistics& statistics);
+};
\ No newline at end of file
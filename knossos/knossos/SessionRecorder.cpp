@@ -0,0 +1,373 @@
+#include <sstream>
+#include <csignal>
+#include <cstdlib>
+#include <ctime>
+#include <cerrno>
+
+#ifdef _WIN32
+#include <io.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#endif
+
+#include "SessionRecorder.h"
+#include "ConsoleHandler.h"
+
+using std::string;
+using std::cerr;
+
+SessionRecorder* SessionRecorder::active = nullptr;
+
+namespace {
+
+// Signals that end the process; the recording is drained before they take effect
+#ifdef _WIN32
+const int FATAL_SIGNALS[] = { SIGINT, SIGTERM, SIGBREAK, SIGABRT, SIGSEGV };
+#else
+const int FATAL_SIGNALS[] = { SIGINT, SIGTERM, SIGHUP, SIGQUIT, SIGABRT, SIGSEGV };
+#endif
+const size_t SIGNAL_COUNT = sizeof(FATAL_SIGNALS) / sizeof(FATAL_SIGNALS[0]);
+void (*previousHandlers[SIGNAL_COUNT])(int);
+
+// How long a signal handler waits for the writer thread to let go of the ring
+const unsigned long SIGNAL_SPIN_LIMIT = 100000000;
+
+const char HEX_DIGITS[] = "0123456789abcdef";
+
+char* appendUnicodeEscape(char* out, unsigned char c) {
+    *out++ = '\\';
+    *out++ = 'u';
+    *out++ = '0';
+    *out++ = '0';
+    *out++ = HEX_DIGITS[c >> 4];
+    *out++ = HEX_DIGITS[c & 15];
+    return out;
+}
+
+char* appendAscii(char* out, unsigned char c) {
+    switch (c) {
+    case '"': *out++ = '\\'; *out++ = '"'; break;
+    case '\\': *out++ = '\\'; *out++ = '\\'; break;
+    case '\n': *out++ = '\\'; *out++ = 'n'; break;
+    case '\r': *out++ = '\\'; *out++ = 'r'; break;
+    case '\t': *out++ = '\\'; *out++ = 't'; break;
+    default:
+        if (c < 0x20 || c == 0x7F) out = appendUnicodeEscape(out, c);
+        else *out++ = static_cast<char>(c);
+    }
+    return out;
+}
+
+// Digits without snprintf, which a signal handler can't rely on
+char* appendNumber(char* out, uint64_t value, unsigned int minimumDigits) {
+    char digits[20];
+    unsigned int count = 0;
+    do {
+        digits[count++] = static_cast<char>('0' + value % 10);
+        value /= 10;
+    } while (value > 0 || count < minimumDigits);
+    while (count > 0) *out++ = digits[--count];
+    return out;
+}
+
+string jsonString(const string& text) {
+    string escaped;
+    char buffer[6];
+    for (char c : text) {
+        escaped.append(buffer, appendAscii(buffer, static_cast<unsigned char>(c)) - buffer);
+    }
+    return escaped;
+}
+
+#ifdef _WIN32
+int openRecording(const string& filename) {
+    return _open(filename.c_str(), _O_WRONLY | _O_CREAT | _O_TRUNC | _O_BINARY, _S_IREAD | _S_IWRITE);
+}
+long writeSome(int fd, const char* data, size_t size) { return _write(fd, data, static_cast<unsigned int>(size)); }
+void closeRecording(int fd) { _close(fd); }
+#else
+int openRecording(const string& filename) {
+    return open(filename.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+}
+long writeSome(int fd, const char* data, size_t size) { return static_cast<long>(write(fd, data, size)); }
+void closeRecording(int fd) { close(fd); }
+#endif
+
+}
+
+int SessionRecorder::TeeBuffer::overflow(int c) {
+    if (traits_type::eq_int_type(c, traits_type::eof())) {
+        return traits_type::not_eof(c);
+    }
+    char character = traits_type::to_char_type(c);
+    recorder.capture(&character, 1);
+    return terminal->sputc(character);
+}
+
+std::streamsize SessionRecorder::TeeBuffer::xsputn(const char* s, std::streamsize n) {
+    std::streamsize written = terminal->sputn(s, n);
+    if (written > 0) {
+        recorder.capture(s, static_cast<size_t>(written));
+    }
+    return written;
+}
+
+int SessionRecorder::TeeBuffer::sync() {
+    recorder.flushChunk();
+    return terminal->pubsync();
+}
+
+SessionRecorder::SessionRecorder() : ring(RING_BYTES), stopping(false), draining(false), capturing(false),
+    droppedBytes(0), writeFailed(false), fd(-1), stream(nullptr), tee(nullptr), pendingSize(0), carrySize(0) {}
+
+SessionRecorder::~SessionRecorder() {
+    stop();
+}
+
+bool SessionRecorder::start(const string& filename, std::ostream& recordedStream) {
+    if (active != nullptr) {
+        cerr << "Error: A session is already being recorded\n";
+        return false;
+    }
+
+    fd = openRecording(filename);
+    if (fd < 0) {
+        cerr << "Error: Could not create recording " << filename << "\n";
+        return false;
+    }
+
+    const char* term = std::getenv("TERM");
+    pair<int, int> size = getConsoleSize();
+    std::ostringstream header;
+    header << "{\"version\": 2, \"width\": " << size.first << ", \"height\": " << size.second
+        << ", \"timestamp\": " << static_cast<long long>(std::time(nullptr))
+        << ", \"env\": {\"TERM\": \"" << jsonString(term != nullptr ? term : "xterm-256color") << "\"}}\n";
+    if (!writeAll(header.str().data(), header.str().size())) {
+        cerr << "Error: Could not write recording " << filename << "\n";
+        closeRecording(fd);
+        fd = -1;
+        return false;
+    }
+
+    startTime = std::chrono::steady_clock::now();
+    stopping = false;
+    active = this;
+    writer = std::thread(&SessionRecorder::runWriter, this);
+    for (size_t i = 0; i < SIGNAL_COUNT; ++i) {
+        previousHandlers[i] = std::signal(FATAL_SIGNALS[i], onSignal);
+    }
+
+    stream = &recordedStream;
+    stream->flush();
+    tee = new TeeBuffer(stream->rdbuf(), *this);
+    stream->rdbuf(tee);
+    return true;
+}
+
+void SessionRecorder::stop() {
+    if (active != this) {
+        return;
+    }
+
+    stream->flush();
+    stream->rdbuf(tee->original());
+    delete tee;
+    tee = nullptr;
+    flushChunk();
+
+    stopping = true;
+    writer.join();
+    for (size_t i = 0; i < SIGNAL_COUNT; ++i) {
+        std::signal(FATAL_SIGNALS[i], previousHandlers[i] == SIG_ERR ? SIG_DFL : previousHandlers[i]);
+    }
+    active = nullptr;
+    closeRecording(fd);
+    fd = -1;
+
+    if (writeFailed) {
+        cerr << "Error: Could not write the whole recording\n";
+    }
+    if (droppedBytes > 0) {
+        cerr << "Warning: The recording is missing " << droppedBytes << " bytes of output the disk couldn't keep up with\n";
+    }
+}
+
+void SessionRecorder::capture(const char* data, size_t size) {
+    capturing.store(true, std::memory_order_relaxed);
+    std::atomic_signal_fence(std::memory_order_seq_cst);
+
+    while (size > 0) {
+        size_t taken = std::min(size, CHUNK_BYTES - pendingSize);
+        std::memcpy(pending + pendingSize, data, taken);
+        pendingSize += taken;
+        data += taken;
+        size -= taken;
+        if (pendingSize == CHUNK_BYTES) {
+            commitPending();
+        }
+    }
+
+    std::atomic_signal_fence(std::memory_order_seq_cst);
+    capturing.store(false, std::memory_order_relaxed);
+}
+
+void SessionRecorder::flushChunk() {
+    capturing.store(true, std::memory_order_relaxed);
+    std::atomic_signal_fence(std::memory_order_seq_cst);
+    commitPending();
+    std::atomic_signal_fence(std::memory_order_seq_cst);
+    capturing.store(false, std::memory_order_relaxed);
+}
+
+void SessionRecorder::commitPending() {
+    if (pendingSize == 0) {
+        return;
+    }
+    ChunkHeader header;
+    header.micros = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - startTime).count());
+    header.size = static_cast<uint32_t>(pendingSize);
+    if (!ring.tryWrite(&header, sizeof(header), pending, pendingSize)) {
+        droppedBytes += pendingSize;
+    }
+    pendingSize = 0;
+}
+
+void SessionRecorder::runWriter() {
+#ifndef _WIN32
+    // Asynchronous signals go to the game thread, never to the one that may hold the ring
+    sigset_t signals;
+    sigemptyset(&signals);
+    for (int signal : FATAL_SIGNALS) {
+        if (signal != SIGSEGV) sigaddset(&signals, signal);
+    }
+    pthread_sigmask(SIG_BLOCK, &signals, nullptr);
+#endif
+
+    while (true) {
+        // Read first, so everything committed before stop() is still drained below
+        bool finished = stopping.load(std::memory_order_acquire);
+        if (!draining.exchange(true, std::memory_order_acquire)) {
+            drainRing();
+            if (finished && carrySize > 0) {
+                std::memcpy(payload, carry, carrySize);
+                size_t size = carrySize;
+                carrySize = 0;
+                uint64_t micros = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(
+                    std::chrono::steady_clock::now() - startTime).count());
+                writeAll(line, formatEvent(micros, size, true));
+            }
+            draining.store(false, std::memory_order_release);
+        }
+        if (finished) {
+            return;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(2));
+    }
+}
+
+void SessionRecorder::drainRing() {
+    while (ring.readable() >= sizeof(ChunkHeader)) {
+        ChunkHeader header;
+        ring.read(&header, sizeof(header));
+        std::memcpy(payload, carry, carrySize);
+        ring.read(payload + carrySize, header.size);
+        size_t size = carrySize + header.size;
+        carrySize = 0;
+        size_t length = formatEvent(header.micros, size, false);
+        if (!writeAll(line, length)) {
+            writeFailed = true;
+        }
+    }
+}
+
+bool SessionRecorder::writeAll(const char* data, size_t size) {
+    while (size > 0) {
+        long written = writeSome(fd, data, size);
+        if (written < 0 && errno == EINTR) {
+            continue;
+        }
+        if (written <= 0) {
+            return false;
+        }
+        data += written;
+        size -= static_cast<size_t>(written);
+    }
+    return true;
+}
+
+// [seconds, "o", "text"] with the text as JSON, which has to be valid UTF-8: sequences
+// cut off at the end of a chunk wait for the next one, and bytes that aren't UTF-8
+// at all come out as the Latin-1 characters they would be
+size_t SessionRecorder::formatEvent(uint64_t micros, size_t size, bool final) {
+    char* out = line;
+    *out++ = '[';
+    out = appendNumber(out, micros / 1000000, 1);
+    *out++ = '.';
+    out = appendNumber(out, micros % 1000000, 6);
+    const char middle[] = ", \"o\", \"";
+    std::memcpy(out, middle, sizeof(middle) - 1);
+    out += sizeof(middle) - 1;
+
+    for (size_t i = 0; i < size;) {
+        unsigned char c = static_cast<unsigned char>(payload[i]);
+        if (c < 0x80) {
+            out = appendAscii(out, c);
+            ++i;
+            continue;
+        }
+
+        size_t length = c >= 0xC2 && c <= 0xDF ? 2 : c >= 0xE0 && c <= 0xEF ? 3 : c >= 0xF0 && c <= 0xF4 ? 4 : 0;
+        size_t valid = 1;
+        while (valid < length && i + valid < size && (static_cast<unsigned char>(payload[i + valid]) & 0xC0) == 0x80) {
+            ++valid;
+        }
+
+        if (length > 0 && valid == length) {
+            std::memcpy(out, payload + i, length);
+            out += length;
+            i += length;
+        }
+        else if (length > 0 && i + valid == size && !final) {
+            std::memcpy(carry, payload + i, valid);
+            carrySize = valid;
+            break;
+        }
+        else {
+            out = appendUnicodeEscape(out, c);
+            ++i;
+        }
+    }
+
+    *out++ = '"';
+    *out++ = ']';
+    *out++ = '\n';
+    return static_cast<size_t>(out - line);
+}
+
+void SessionRecorder::onSignal(int signal) {
+    SessionRecorder* recorder = active;
+    if (recorder != nullptr) {
+        // Only if the interrupted code wasn't halfway through the pending chunk
+        if (!recorder->capturing.load(std::memory_order_relaxed)) {
+            recorder->commitPending();
+        }
+
+        unsigned long spins = 0;
+        while (recorder->draining.exchange(true, std::memory_order_acquire) && spins < SIGNAL_SPIN_LIMIT) {
+            ++spins;
+        }
+        if (spins < SIGNAL_SPIN_LIMIT) {
+            recorder->drainRing();
+            recorder->draining.store(false, std::memory_order_release);
+        }
+    }
+
+    // Then on to what the signal would have done anyway
+    std::signal(signal, SIG_DFL);
+    std::raise(signal);
+}
@@ -0,0 +1,93 @@
+#pragma once
+
+#include <string>
+#include <iostream>
+#include <streambuf>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include "ByteRing.h"
+
+/**
+ * @brief Records everything written to a stream (cout, normally) as an asciicast v2
+ * file - what asciinema plays back.
+ *
+ * The stream keeps writing straight to the terminal; a copy of the bytes collects
+ * in a small chunk that goes into a lock-free ring, stamped with the time, whenever
+ * the stream is flushed or the chunk fills up. A background thread drains the ring
+ * into the file, so the game thread never waits on the disk. If the ring is ever
+ * full, the chunk is dropped and counted rather than waited for.
+ *
+ * SIGINT, SIGTERM and friends drain whatever is still in the ring before the
+ * process goes down, so a recording survives being killed mid-game.
+ */
+class SessionRecorder {
+public:
+    static const size_t RING_BYTES = 4 * 1024 * 1024;
+    static const size_t CHUNK_BYTES = 4096;
+
+    SessionRecorder();
+    ~SessionRecorder();
+    SessionRecorder(const SessionRecorder&) = delete;
+    SessionRecorder& operator=(const SessionRecorder&) = delete;
+
+    // Only one recording at a time; false (with a message) if the file can't be created
+    bool start(const std::string& filename, std::ostream& stream = std::cout);
+    void stop();
+
+private:
+    class TeeBuffer : public std::streambuf {
+    private:
+        std::streambuf* terminal;
+        SessionRecorder& recorder;
+
+    protected:
+        int overflow(int c) override;
+        std::streamsize xsputn(const char* s, std::streamsize n) override;
+        int sync() override;
+
+    public:
+        TeeBuffer(std::streambuf* terminal, SessionRecorder& recorder) : terminal(terminal), recorder(recorder) {}
+        std::streambuf* original() const { return terminal; }
+    };
+
+    struct ChunkHeader {
+        uint64_t micros;        // since the recording started
+        uint32_t size;
+    };
+
+    static SessionRecorder* active;
+
+    ByteRing ring;
+    std::thread writer;
+    std::atomic<bool> stopping;
+    std::atomic<bool> draining;         // whoever holds it reads the ring: the writer, or a signal handler
+    std::atomic<bool> capturing;        // the producer is touching the pending chunk
+    std::atomic<uint64_t> droppedBytes;
+    std::atomic<bool> writeFailed;
+    int fd;
+    std::ostream* stream;
+    TeeBuffer* tee;
+    std::chrono::steady_clock::time_point startTime;
+
+    // Producer side
+    char pending[CHUNK_BYTES];
+    size_t pendingSize;
+
+    // Consumer side, fixed-size so a signal handler can use it too
+    char payload[CHUNK_BYTES + 4];
+    unsigned char carry[4];             // an incomplete UTF-8 sequence left over from the last chunk
+    size_t carrySize;
+    char line[(CHUNK_BYTES + 4) * 6 + 64];     // every byte may need a \u00XX escape
+
+    void capture(const char* data, size_t size);
+    void commitPending();
+    void flushChunk();
+    void runWriter();
+    void drainRing();
+    bool writeAll(const char* data, size_t size);
+    size_t formatEvent(uint64_t micros, size_t size, bool final);     // of the bytes in payload
+
+    static void onSignal(int signal);
+};
@@ -0,0 +1,396 @@
+#include "SpectatorHub.h"
+
+#ifdef __linux__
+
+#include <sstream>
+#include <algorithm>
+#include <cerrno>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+
+using std::string;
+using std::vector;
+using std::shared_ptr;
+
+namespace {
+
+// Past this much unsent output (or two keyframes, on big mazes) a spectator skips
+// ahead to the next keyframe
+const size_t MAX_SPECTATOR_BACKLOG = 256 * 1024;
+
+const int MAX_HUB_EVENTS = 256;
+const int MAX_WRITE_FRAMES = 64;
+
+}
+
+SpectatorChannel::SpectatorChannel(SpectatorHub& hub, uint64_t gameId, std::pair<int, int> consoleSize)
+    : hub(hub), queuedForHub(false), finished(false), spectatorCount(0), keyframeRequested(false),
+    gameId(gameId), consoleSize(consoleSize) {}
+
+void SpectatorChannel::publish(shared_ptr<const string> bytes, bool keyframe) {
+    bool wakeHub;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (finished) return;
+        pending.push_back(SpectatorFrame{ std::move(bytes), keyframe });
+        wakeHub = !queuedForHub;
+        queuedForHub = true;
+    }
+    // Only the first frame since the hub last looked costs a wakeup
+    if (wakeHub) {
+        hub.markDirty(shared_from_this());
+    }
+}
+
+void SpectatorChannel::finish() {
+    bool wakeHub;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (finished) return;
+        finished = true;
+        wakeHub = !queuedForHub;
+        queuedForHub = true;
+    }
+    hub.unregister(gameId);
+    if (wakeHub) {
+        hub.markDirty(shared_from_this());
+    }
+}
+
+SpectatorHub::SpectatorHub() : nextGameId(1), epollFd(-1), wakeFd(-1), stopping(false) {}
+
+SpectatorHub::~SpectatorHub() {
+    stop();
+    for (auto& entry : spectators) {
+        close(entry.first);
+    }
+    for (auto& adopted : newSpectators) {
+        close(adopted.first);
+    }
+    if (wakeFd >= 0) close(wakeFd);
+    if (epollFd >= 0) close(epollFd);
+}
+
+bool SpectatorHub::start() {
+    epollFd = epoll_create1(EPOLL_CLOEXEC);
+    wakeFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (epollFd < 0 || wakeFd < 0) {
+        return false;
+    }
+
+    epoll_event event = {};
+    event.events = EPOLLIN;
+    event.data.fd = wakeFd;
+    if (epoll_ctl(epollFd, EPOLL_CTL_ADD, wakeFd, &event) != 0) {
+        return false;
+    }
+
+    thread = std::thread(&SpectatorHub::run, this);
+    return true;
+}
+
+void SpectatorHub::stop() {
+    if (thread.joinable()) {
+        stopping = true;
+        wake();
+        thread.join();
+    }
+}
+
+shared_ptr<SpectatorChannel> SpectatorHub::openChannel(std::pair<int, int> consoleSize) {
+    std::lock_guard<std::mutex> lock(mutex);
+    shared_ptr<SpectatorChannel> channel = std::make_shared<SpectatorChannel>(*this, nextGameId++, consoleSize);
+    channels[channel->gameId] = channel;
+    return channel;
+}
+
+bool SpectatorHub::watch(int fd, uint64_t gameId, string& error) {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    auto found = channels.find(gameId);
+    shared_ptr<SpectatorChannel> channel = found != channels.end() ? found->second.lock() : nullptr;
+    if (!channel) {
+        error = "Error: No game " + std::to_string(gameId) + " is being played\n";
+        return false;
+    }
+
+    // The newcomer starts from a full redraw, which the game is asked for right away
+    ++channel->spectatorCount;
+    channel->keyframeRequested = true;
+    newSpectators.emplace_back(fd, std::move(channel));
+    wake();
+    return true;
+}
+
+string SpectatorHub::listGames() {
+    std::lock_guard<std::mutex> lock(mutex);
+    std::ostringstream list;
+
+    for (auto it = channels.begin(); it != channels.end();) {
+        shared_ptr<SpectatorChannel> channel = it->second.lock();
+        if (!channel) {
+            it = channels.erase(it);
+            continue;
+        }
+        list << channel->gameId << "  " << channel->consoleSize.first << "x" << channel->consoleSize.second
+            << " terminal, " << channel->spectatorCount << " watching\n";
+        ++it;
+    }
+    return list.str();
+}
+
+void SpectatorHub::wake() {
+    uint64_t one = 1;
+    ssize_t ignored = write(wakeFd, &one, sizeof(one));
+    (void)ignored;
+}
+
+void SpectatorHub::markDirty(shared_ptr<SpectatorChannel> channel) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        dirtyChannels.push_back(std::move(channel));
+    }
+    wake();
+}
+
+void SpectatorHub::unregister(uint64_t gameId) {
+    std::lock_guard<std::mutex> lock(mutex);
+    channels.erase(gameId);
+}
+
+void SpectatorHub::run() {
+    epoll_event events[MAX_HUB_EVENTS];
+
+    while (!stopping) {
+        int count = epoll_wait(epollFd, events, MAX_HUB_EVENTS, 250);
+        if (count < 0 && errno != EINTR) {
+            return;
+        }
+
+        for (int i = 0; i < count; ++i) {
+            int fd = events[i].data.fd;
+            if (fd == wakeFd) {
+                uint64_t value;
+                ssize_t ignored = read(wakeFd, &value, sizeof(value));
+                (void)ignored;
+                continue;
+            }
+
+            auto found = spectators.find(fd);
+            if (found == spectators.end()) {
+                continue;
+            }
+
+            if (events[i].events & (EPOLLERR | EPOLLHUP | EPOLLRDHUP)) {
+                dropSpectator(fd);
+                continue;
+            }
+            if (events[i].events & EPOLLIN) {
+                // Spectators have nothing to say; anything they send is discarded
+                char buffer[256];
+                ssize_t received = read(fd, buffer, sizeof(buffer));
+                if (received == 0 || (received < 0 && errno != EAGAIN && errno != EINTR)) {
+                    dropSpectator(fd);
+                    continue;
+                }
+            }
+            if ((events[i].events & EPOLLOUT) && !flush(*found->second)) {
+                dropSpectator(fd);
+            }
+        }
+
+        // Adopt before delivering, so a game that ends meanwhile still closes its new spectators
+        adoptSpectators();
+        deliverFrames();
+    }
+}
+
+void SpectatorHub::adoptSpectators() {
+    vector<std::pair<int, shared_ptr<SpectatorChannel>>> adopted;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        adopted.swap(newSpectators);
+    }
+
+    for (auto& entry : adopted) {
+        int fd = entry.first;
+
+        epoll_event event = {};
+        event.events = EPOLLIN | EPOLLRDHUP;
+        event.data.fd = fd;
+        if (epoll_ctl(epollFd, EPOLL_CTL_ADD, fd, &event) != 0) {
+            --entry.second->spectatorCount;
+            close(fd);
+            continue;
+        }
+
+        Spectator* spectator = new Spectator();
+        spectator->fd = fd;
+        spectator->channel = std::move(entry.second);
+        spectator->sentOfFront = 0;
+        spectator->queuedBytes = 0;
+        spectator->keyframeBytes = 0;
+        spectator->awaitingKeyframe = true;
+        spectator->waitingForWritable = false;
+        spectator->closing = false;
+
+        audiences[spectator->channel.get()].push_back(spectator);
+        spectators[fd].reset(spectator);
+    }
+}
+
+void SpectatorHub::deliverFrames() {
+    vector<shared_ptr<SpectatorChannel>> dirty;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        dirty.swap(dirtyChannels);
+    }
+
+    vector<SpectatorFrame> frames;
+
+    for (shared_ptr<SpectatorChannel>& channel : dirty) {
+        bool finished;
+        {
+            std::lock_guard<std::mutex> lock(channel->mutex);
+            frames.swap(channel->pending);
+            channel->queuedForHub = false;
+            finished = channel->finished;
+        }
+
+        auto audience = audiences.find(channel.get());
+        if (audience != audiences.end()) {
+            vector<int> dropped;
+            for (Spectator* spectator : audience->second) {
+                for (const SpectatorFrame& frame : frames) {
+                    enqueue(*spectator, frame);
+                }
+                if (finished) {
+                    spectator->closing = true;
+                }
+                if (!flush(*spectator)) {
+                    dropped.push_back(spectator->fd);
+                }
+            }
+            for (int fd : dropped) {
+                dropSpectator(fd);
+            }
+        }
+        frames.clear();
+    }
+}
+
+void SpectatorHub::enqueue(Spectator& spectator, const SpectatorFrame& frame) {
+    if (spectator.awaitingKeyframe) {
+        // Deltas mean nothing without the screen they apply to
+        if (!frame.keyframe) return;
+        spectator.awaitingKeyframe = false;
+    }
+    else if (frame.keyframe) {
+        // Already in step with the game: the deltas got it to the same screen
+        return;
+    }
+
+    spectator.queue.push_back(frame);
+    spectator.queuedBytes += frame.bytes->size();
+    if (frame.keyframe) {
+        spectator.keyframeBytes = frame.bytes->size();
+    }
+
+    size_t limit = std::max(MAX_SPECTATOR_BACKLOG, 2 * spectator.keyframeBytes);
+    if (spectator.queuedBytes - spectator.sentOfFront > limit) {
+        // Too far behind - forget the older backlog (except a frame already half on the
+        // wire). A keyframe being queued is itself the fresh start; after a delta, pick
+        // up again from the next full redraw
+        auto first = spectator.queue.begin() + (spectator.sentOfFront > 0 ? 1 : 0);
+        auto last = frame.keyframe ? spectator.queue.end() - 1 : spectator.queue.end();
+        for (auto it = first; it != last; ++it) {
+            spectator.queuedBytes -= it->bytes->size();
+        }
+        spectator.queue.erase(first, last);
+
+        if (!frame.keyframe) {
+            spectator.awaitingKeyframe = true;
+            spectator.channel->keyframeRequested = true;
+        }
+    }
+}
+
+// Write queued frames straight from the shared buffers; false means the spectator should go
+bool SpectatorHub::flush(Spectator& spectator) {
+    while (!spectator.queue.empty()) {
+        iovec parts[MAX_WRITE_FRAMES];
+        int partCount = 0;
+        for (auto it = spectator.queue.begin(); it != spectator.queue.end() && partCount < MAX_WRITE_FRAMES; ++it) {
+            size_t skip = partCount == 0 ? spectator.sentOfFront : 0;
+            parts[partCount].iov_base = const_cast<char*>(it->bytes->data() + skip);
+            parts[partCount].iov_len = it->bytes->size() - skip;
+            ++partCount;
+        }
+
+        ssize_t sent = writev(spectator.fd, parts, partCount);
+        if (sent < 0 && errno == EINTR) {
+            continue;
+        }
+        if (sent < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            break;
+        }
+        if (sent < 0) {
+            return false;
+        }
+
+        size_t remaining = static_cast<size_t>(sent);
+        while (remaining > 0) {
+            size_t frontLeft = spectator.queue.front().bytes->size() - spectator.sentOfFront;
+            if (remaining < frontLeft) {
+                spectator.sentOfFront += remaining;
+                break;
+            }
+            remaining -= frontLeft;
+            spectator.queuedBytes -= spectator.queue.front().bytes->size();
+            spectator.queue.pop_front();
+            spectator.sentOfFront = 0;
+        }
+    }
+
+    bool drained = spectator.queue.empty();
+    if (drained && spectator.closing) {
+        return false;
+    }
+
+    // Only ask for EPOLLOUT while something is actually waiting
+    if (drained == spectator.waitingForWritable) {
+        epoll_event event = {};
+        event.events = EPOLLIN | EPOLLRDHUP | (drained ? 0u : static_cast<uint32_t>(EPOLLOUT));
+        event.data.fd = spectator.fd;
+        epoll_ctl(epollFd, EPOLL_CTL_MOD, spectator.fd, &event);
+        spectator.waitingForWritable = !drained;
+    }
+    return true;
+}
+
+void SpectatorHub::dropSpectator(int fd) {
+    auto found = spectators.find(fd);
+    if (found == spectators.end()) return;
+
+    Spectator* spectator = found->second.get();
+    SpectatorChannel* channel = spectator->channel.get();
+    --channel->spectatorCount;
+
+    auto audience = audiences.find(channel);
+    if (audience != audiences.end()) {
+        vector<Spectator*>& members = audience->second;
+        members.erase(std::remove(members.begin(), members.end(), spectator), members.end());
+        if (members.empty()) {
+            audiences.erase(audience);
+        }
+    }
+
+    // Closing the descriptor also removes it from the epoll set
+    close(fd);
+    spectators.erase(found);
+}
+
+#endif
@@ -0,0 +1,124 @@
+#pragma once
+
+#ifdef __linux__
+
+#include <string>
+#include <memory>
+#include <vector>
+#include <deque>
+#include <mutex>
+#include <atomic>
+#include <thread>
+#include <cstdint>
+#include <unordered_map>
+#include <utility>
+
+// One turn's worth of screen output. The bytes are shared, never copied per spectator
+struct SpectatorFrame {
+    std::shared_ptr<const std::string> bytes;
+    bool keyframe;      // a full redraw - the only frame a newly joined or lagging spectator can start from
+};
+
+class SpectatorHub;
+
+/**
+ * @brief The outgoing side of one watched game. Written by the game's thread,
+ * read by the hub thread; publishing is O(1) however many spectators there are.
+ */
+class SpectatorChannel : public std::enable_shared_from_this<SpectatorChannel> {
+private:
+    friend class SpectatorHub;
+
+    SpectatorHub& hub;
+    std::mutex mutex;
+    std::vector<SpectatorFrame> pending;    // published, not yet picked up by the hub
+    bool queuedForHub;
+    bool finished;
+    std::atomic<unsigned int> spectatorCount;
+    std::atomic<bool> keyframeRequested;
+
+public:
+    const uint64_t gameId;
+    const std::pair<int, int> consoleSize;  // the player's terminal, which the frames are laid out for
+
+    SpectatorChannel(SpectatorHub& hub, uint64_t gameId, std::pair<int, int> consoleSize);
+
+    bool watched() const { return spectatorCount > 0; }
+
+    // True once per request - the game should then publish a keyframe
+    bool takeKeyframeRequest() { return keyframeRequested.exchange(false); }
+
+    void publish(std::shared_ptr<const std::string> bytes, bool keyframe);
+
+    // The game is over: spectators get what's queued, then their connection is closed
+    void finish();
+};
+
+/**
+ * @brief Fans game frames out to spectator connections on its own thread.
+ *
+ * Each spectator keeps a queue of shared frames and is written with writev
+ * straight from them. A spectator whose backlog grows too large loses the
+ * queue and waits for the next keyframe instead of buffering without bound.
+ */
+class SpectatorHub {
+private:
+    struct Spectator {
+        int fd;
+        std::shared_ptr<SpectatorChannel> channel;
+        std::deque<SpectatorFrame> queue;
+        size_t sentOfFront;     // bytes of queue.front() already written
+        size_t queuedBytes;
+        size_t keyframeBytes;   // of the latest keyframe queued - the backlog allows two
+        bool awaitingKeyframe;
+        bool waitingForWritable;
+        bool closing;           // the game has ended - close once the queue drains
+    };
+
+    std::mutex mutex;           // guards everything up to the hub-thread-only section
+    std::unordered_map<uint64_t, std::weak_ptr<SpectatorChannel>> channels;
+    std::vector<std::shared_ptr<SpectatorChannel>> dirtyChannels;
+    std::vector<std::pair<int, std::shared_ptr<SpectatorChannel>>> newSpectators;
+    uint64_t nextGameId;
+
+    int epollFd;
+    int wakeFd;
+    std::atomic<bool> stopping;
+    std::thread thread;
+
+    // Hub thread only
+    std::unordered_map<int, std::unique_ptr<Spectator>> spectators;
+    std::unordered_map<SpectatorChannel*, std::vector<Spectator*>> audiences;
+
+    void run();
+    void wake();
+    void markDirty(std::shared_ptr<SpectatorChannel> channel);
+    void unregister(uint64_t gameId);
+    void adoptSpectators();
+    void deliverFrames();
+    void enqueue(Spectator& spectator, const SpectatorFrame& frame);
+    bool flush(Spectator& spectator);
+    void dropSpectator(int fd);
+
+public:
+    SpectatorHub();
+    ~SpectatorHub();
+    SpectatorHub(const SpectatorHub&) = delete;
+    SpectatorHub& operator=(const SpectatorHub&) = delete;
+
+    bool start();
+    void stop();
+
+    // A channel (with a fresh game id) for a game that is about to start
+    std::shared_ptr<SpectatorChannel> openChannel(std::pair<int, int> consoleSize);
+
+    // Hand a connected socket over to the hub; false (with a message) if there's no such game
+    bool watch(int fd, uint64_t gameId, std::string& error);
+
+    // "id  columns x rows" for every game currently running, one per line
+    std::string listGames();
+
+    friend class SpectatorChannel;
+};
+
+#endif
@@ -0,0 +1,401 @@
+#include <fstream>
+#include <sstream>
+#include <vector>
+#include <set>
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+#include "TiledMaze.h"
+#include "BinaryIO.h"
+#include "EllerRows.h"
+
+using std::string;
+using std::vector;
+using std::pair;
+
+namespace {
+
+const char MAGIC[4] = { 'K', 'N', 'T', 'M' };
+const uint32_t FORMAT_VERSION = 1;
+const size_t HEADER_BYTES = 4096;
+
+// The file format's own alignment; tiles are mapped at the system's page size, which
+// may be larger (16 KB or 64 KB on some ARM systems)
+size_t roundUpToPage(size_t bytes) {
+    return (bytes + 4095) / 4096 * 4096;
+}
+
+// TILE_SIZE consecutive maze rows, cut into tiles, waiting to be written out
+class TileBand {
+private:
+    vector<uint8_t> cells;
+
+public:
+    unsigned int firstRow;
+
+    explicit TileBand(unsigned int tilesX)
+        : cells(tilesX * TiledMaze::TILE_BYTES, 0x11), firstRow(0) {}
+
+    void set(unsigned int x, unsigned int y, uint8_t cell) {
+        size_t inTile = static_cast<size_t>(y - firstRow) * TiledMaze::TILE_SIZE + x % TiledMaze::TILE_SIZE;
+        uint8_t& byte = cells[(x / TiledMaze::TILE_SIZE) * TiledMaze::TILE_BYTES + inTile / 2];
+        byte = inTile % 2 == 0 ? (byte & 0xF0) | cell : (byte & 0x0F) | (cell << 4);
+    }
+
+    // Tiles of a band are consecutive in the file, left to right
+    void flush(std::ofstream& file) {
+        file.write(reinterpret_cast<const char*>(cells.data()), cells.size());
+        std::fill(cells.begin(), cells.end(), 0x11);
+        firstRow += TiledMaze::TILE_SIZE;
+    }
+};
+
+}
+
+namespace TiledCell {
+
+FieldType fieldType(uint8_t cell) {
+    switch (cell) {
+    case PASSAGE: return FieldType::PASSAGE;
+    case ENTRANCE: return FieldType::ENTRANCE;
+    case EXIT: return FieldType::EXIT;
+    case SWORD: case SHIELD: case HAMMER: case FOG_OF_WAR: return FieldType::ITEM;
+    case STAIRS_UP: return FieldType::STAIRS_UP;
+    case STAIRS_DOWN: return FieldType::STAIRS_DOWN;
+    default: return FieldType::WALL;
+    }
+}
+
+ItemType itemType(uint8_t cell) {
+    switch (cell) {
+    case SHIELD: return ItemType::SHIELD;
+    case HAMMER: return ItemType::HAMMER;
+    case FOG_OF_WAR: return ItemType::FOG_OF_WAR;
+    default: return ItemType::SWORD;
+    }
+}
+
+uint8_t of(const MatrixField* field) {
+    switch (field->getFieldType()) {
+    case FieldType::PASSAGE: return PASSAGE;
+    case FieldType::ENTRANCE: return ENTRANCE;
+    case FieldType::EXIT: return EXIT;
+    case FieldType::STAIRS_UP: return STAIRS_UP;
+    case FieldType::STAIRS_DOWN: return STAIRS_DOWN;
+    case FieldType::ITEM:
+        switch (static_cast<const Item*>(field)->getItemType()) {
+        case ItemType::SHIELD: return SHIELD;
+        case ItemType::HAMMER: return HAMMER;
+        case ItemType::FOG_OF_WAR: return FOG_OF_WAR;
+        default: return SWORD;
+        }
+    default: return WALL;
+    }
+}
+
+char symbol(uint8_t cell) {
+    switch (fieldType(cell)) {
+    case FieldType::PASSAGE: return '.';
+    case FieldType::ENTRANCE: return 'U';
+    case FieldType::EXIT: return 'I';
+    case FieldType::ITEM: return 'P';
+    case FieldType::STAIRS_UP: return '<';
+    case FieldType::STAIRS_DOWN: return '>';
+    default: return '#';
+    }
+}
+
+}
+
+bool TiledMaze::generate(const string& filename, unsigned int width, unsigned int height,
+    unsigned int no_of_items, unsigned int seed, string& error) {
+    // Rooms sit on odd coordinates with walls between them, like the Prim mazes
+    const unsigned int columns = (width - 1) / 2;
+    const unsigned int rows = (height - 1) / 2;
+    if (columns < 2 || rows < 2 || no_of_items >= static_cast<unsigned long long>(columns) * rows / 2) {
+        error = "Maze too small for " + std::to_string(no_of_items) + " items";
+        return false;
+    }
+
+    const unsigned int tilesX = (width + TILE_SIZE - 1) / TILE_SIZE;
+    const unsigned int tilesY = (height + TILE_SIZE - 1) / TILE_SIZE;
+    const uint64_t tileCount = static_cast<uint64_t>(tilesX) * tilesY;
+    const size_t tilesOffset = roundUpToPage(HEADER_BYTES + tileCount * 8);
+
+    std::ofstream file(filename, std::ios::binary | std::ios::trunc);
+    if (!file) {
+        error = "Cannot create " + filename;
+        return false;
+    }
+
+    mersenne_twister rng(seed);
+    auto draw = [&](unsigned int min, unsigned int max) {
+        return std::uniform_int_distribution<unsigned int>(min, max)(rng);
+    };
+    unsigned int entranceX = 2 * draw(0, columns - 1) + 1;
+    unsigned int exitX = 2 * draw(0, columns - 1) + 1;
+
+    // Items go on rooms, drawn up front and handed out as the rows stream by
+    std::set<pair<unsigned int, unsigned int>> itemRooms;     // (row, column)
+    while (itemRooms.size() < no_of_items) {
+        unsigned int column = draw(0, columns - 1);
+        unsigned int row = draw(0, rows - 1);
+        if (row == 0 && 2 * column + 1 == entranceX) continue;      // the robot starts there
+        itemRooms.insert(std::make_pair(row, column));
+    }
+
+    string header;
+    header.append(MAGIC, 4);
+    appendU32(header, FORMAT_VERSION);
+    appendU32(header, width);
+    appendU32(header, height);
+    appendU32(header, TILE_SIZE);
+    appendU32(header, entranceX);
+    appendU32(header, exitX);
+    appendU32(header, no_of_items);
+    appendU32(header, seed);
+    header.resize(HEADER_BYTES, '\0');
+    file.write(header.data(), header.size());
+
+    string index;
+    for (uint64_t tile = 0; tile < tileCount; ++tile) {
+        appendU64(index, tilesOffset + tile * TILE_BYTES);
+        if (index.size() >= (1 << 20)) {
+            file.write(index.data(), index.size());
+            index.clear();
+        }
+    }
+    index.resize(index.size() + (tilesOffset - HEADER_BYTES - tileCount * 8), '\0');
+    file.write(index.data(), index.size());
+
+    TileBand band(tilesX);
+    auto put = [&](unsigned int x, unsigned int y, uint8_t cell) {
+        while (y >= band.firstRow + TILE_SIZE) band.flush(file);
+        band.set(x, y, cell);
+    };
+
+    put(entranceX, 0, TiledCell::ENTRANCE);
+
+    EllerRows eller(columns, rng);
+    auto nextItem = itemRooms.begin();
+    for (unsigned int row = 0; row < rows; ++row) {
+        unsigned int y = 2 * row + 1;
+        eller.nextRow(row == rows - 1);
+
+        for (unsigned int c = 0; c < columns; ++c) {
+            put(2 * c + 1, y, TiledCell::PASSAGE);
+        }
+        for (; nextItem != itemRooms.end() && nextItem->first == row; ++nextItem) {
+            put(2 * nextItem->second + 1, y, TiledCell::SWORD + draw(0, 3));
+        }
+        // Walls are written too: the openings are coin flips, and a branch on them would mispredict half the time
+        for (unsigned int c = 0; c + 1 < columns; ++c) {
+            put(2 * c + 2, y, eller.east[c] ? TiledCell::PASSAGE : TiledCell::WALL);
+        }
+        for (unsigned int c = 0; c < columns; ++c) {
+            put(2 * c + 1, y + 1, eller.down[c] ? TiledCell::PASSAGE : TiledCell::WALL);
+        }
+    }
+
+    // An even height leaves a solid row above the outer wall; the exit cuts through it
+    for (unsigned int y = 2 * rows; y < height - 1; ++y) {
+        put(exitX, y, TiledCell::PASSAGE);
+    }
+    put(exitX, height - 1, TiledCell::EXIT);
+    while (band.firstRow < tilesY * TILE_SIZE) band.flush(file);
+
+    file.close();
+    if (!file) {
+        error = "Failed writing " + filename;
+        return false;
+    }
+    return true;
+}
+
+TiledMaze::TiledMaze()
+    : width(0), height(0), tilesX(0), tilesY(0), entranceX(0), exitX(0), no_of_items(0), seed(0),
+    fileDescriptor(-1), capacity(0), misses(0), lastTile(UINT64_MAX), lastData(nullptr) {}
+
+TiledMaze::~TiledMaze() {
+    close();
+}
+
+bool TiledMaze::isBoundary(unsigned int x, unsigned int y) const {
+    return x == 0 || y == 0 || x >= width - 1 || y >= height - 1;
+}
+
+void TiledMaze::setCell(unsigned int x, unsigned int y, uint8_t cell) {
+    changes[static_cast<uint64_t>(y) * width + x] = cell;
+}
+
+uint8_t TiledMaze::getCell(unsigned int x, unsigned int y) {
+    if (x >= width || y >= height) {
+        return TiledCell::WALL;
+    }
+    if (!changes.empty()) {
+        auto change = changes.find(static_cast<uint64_t>(y) * width + x);
+        if (change != changes.end()) return change->second;
+    }
+
+    const uint8_t* data = tile(static_cast<uint64_t>(y / TILE_SIZE) * tilesX + x / TILE_SIZE);
+    size_t inTile = static_cast<size_t>(y % TILE_SIZE) * TILE_SIZE + x % TILE_SIZE;
+    return inTile % 2 == 0 ? data[inTile / 2] & 0x0F : data[inTile / 2] >> 4;
+}
+
+void TiledMaze::prefetchAround(unsigned int x, unsigned int y) {
+    int tileX = static_cast<int>(x / TILE_SIZE), tileY = static_cast<int>(y / TILE_SIZE);
+    for (int dy = -1; dy <= 1; ++dy) {
+        for (int dx = -1; dx <= 1; ++dx) {
+            int nx = tileX + dx, ny = tileY + dy;
+            if (nx < 0 || ny < 0 || nx >= static_cast<int>(tilesX) || ny >= static_cast<int>(tilesY)) continue;
+            tile(static_cast<uint64_t>(ny) * tilesX + nx);
+        }
+    }
+}
+
+string TiledMaze::title() const {
+    return "Marathon " + std::to_string(width) + "x" + std::to_string(height);
+}
+
+string TiledMaze::cacheStatus() const {
+    std::ostringstream status;
+    double mappedMegabytes = mapped.size() * (TILE_BYTES / 1024.0) / 1024.0;
+    status << "exit at x=" << exitX << "  |  tiles mapped " << mapped.size() << "/" << capacity
+        << " (" << static_cast<int>(mappedMegabytes * 10) / 10.0 << " MB)";
+    return status.str();
+}
+
+#ifndef _WIN32
+bool TiledMaze::open(const string& filename, size_t budgetBytes, string& error) {
+    close();
+
+    fileDescriptor = ::open(filename.c_str(), O_RDONLY);
+    if (fileDescriptor < 0) {
+        error = "Cannot open " + filename;
+        return false;
+    }
+
+    char header[40];
+    struct stat fileInfo;
+    if (pread(fileDescriptor, header, sizeof(header), 0) != sizeof(header) || fstat(fileDescriptor, &fileInfo) != 0 ||
+        std::memcmp(header, MAGIC, 4) != 0) {
+        error = filename + " is not a tiled maze";
+        close();
+        return false;
+    }
+    if (readU32(header + 4) != FORMAT_VERSION || readU32(header + 16) != TILE_SIZE) {
+        error = filename + " was written by an incompatible version";
+        close();
+        return false;
+    }
+
+    width = readU32(header + 8);
+    height = readU32(header + 12);
+    entranceX = readU32(header + 20);
+    exitX = readU32(header + 24);
+    no_of_items = readU32(header + 28);
+    seed = readU32(header + 32);
+    tilesX = (width + TILE_SIZE - 1) / TILE_SIZE;
+    tilesY = (height + TILE_SIZE - 1) / TILE_SIZE;
+
+    uint64_t tileCount = static_cast<uint64_t>(tilesX) * tilesY;
+    if (width < 3 || height < 3 || entranceX >= width || exitX >= width ||
+        static_cast<uint64_t>(fileInfo.st_size) < roundUpToPage(HEADER_BYTES + tileCount * 8) + tileCount * TILE_BYTES) {
+        error = filename + " is truncated or corrupt";
+        close();
+        return false;
+    }
+
+    // The prefetched neighbourhoods of the robot and the Minotaur must always fit
+    capacity = std::max<size_t>(budgetBytes / TILE_BYTES, 18);
+    return true;
+}
+
+void TiledMaze::close() {
+    for (const MappedTile& mappedTile : recentlyUsed) {
+        munmap(mappedTile.mapping, mappedTile.mappingBytes);
+    }
+    recentlyUsed.clear();
+    mapped.clear();
+    changes.clear();
+    lastTile = UINT64_MAX;
+    lastData = nullptr;
+    if (fileDescriptor >= 0) {
+        ::close(fileDescriptor);
+        fileDescriptor = -1;
+    }
+}
+
+const uint8_t* TiledMaze::tile(uint64_t index) {
+    if (index == lastTile) {
+        return lastData;
+    }
+
+    auto found = mapped.find(index);
+    if (found != mapped.end()) {
+        recentlyUsed.splice(recentlyUsed.begin(), recentlyUsed, found->second);
+    }
+    else {
+        ++misses;
+        if (mapped.size() >= capacity) {
+            evictLeastRecentlyUsed();
+        }
+
+        // The index is read on demand too, so nothing grows with the size of the maze
+        char entry[8];
+        void* mapping = MAP_FAILED;
+        size_t intoPage = 0;
+        if (pread(fileDescriptor, entry, sizeof(entry), HEADER_BYTES + index * 8) == sizeof(entry)) {
+            // mmap only takes offsets at a page boundary, so the tile may start further in
+            static const size_t pageBytes = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+            uint64_t offset = readU64(entry);
+            intoPage = static_cast<size_t>(offset % pageBytes);
+            mapping = mmap(nullptr, intoPage + TILE_BYTES, PROT_READ, MAP_SHARED, fileDescriptor, static_cast<off_t>(offset - intoPage));
+        }
+        if (mapping == MAP_FAILED) {
+            throw std::runtime_error("Cannot map tile " + std::to_string(index) + " of the maze");
+        }
+        // Starts the read in the background; the first access only waits if it isn't done yet
+        madvise(mapping, intoPage + TILE_BYTES, MADV_WILLNEED);
+
+        recentlyUsed.push_front(MappedTile{ index, static_cast<const uint8_t*>(mapping) + intoPage, mapping, intoPage + TILE_BYTES });
+        mapped[index] = recentlyUsed.begin();
+    }
+
+    lastTile = index;
+    lastData = recentlyUsed.front().data;
+    return lastData;
+}
+
+void TiledMaze::evictLeastRecentlyUsed() {
+    const MappedTile& victim = recentlyUsed.back();
+    munmap(victim.mapping, victim.mappingBytes);
+    if (victim.index == lastTile) {
+        lastTile = UINT64_MAX;
+        lastData = nullptr;
+    }
+    mapped.erase(victim.index);
+    recentlyUsed.pop_back();
+}
+#else
+bool TiledMaze::open(const string& filename, size_t budgetBytes, string& error) {
+    error = "Tiled mazes are only playable on POSIX systems";
+    return false;
+}
+
+void TiledMaze::close() {}
+
+const uint8_t* TiledMaze::tile(uint64_t index) {
+    return nullptr;
+}
+
+void TiledMaze::evictLeastRecentlyUsed() {}
+#endif
@@ -0,0 +1,95 @@
+#pragma once
+
+#include <string>
+#include <list>
+#include <unordered_map>
+#include <cstdint>
+#include <cstddef>
+#include "MarathonMaze.h"
+
+/**
+ * @brief A maze kept on disk for mazes too large for memory ("marathon" mazes).
+ *
+ * File layout (little-endian): a 4096-byte header, an index with the file offset
+ * of every tile (row-major over the tile grid), then the tiles themselves. A tile
+ * is TILE_SIZE x TILE_SIZE cells, row-major, two 4-bit cells per byte (even x in
+ * the low nibble) - 32 KB each, so every tile starts on a page boundary.
+ *
+ * While playing, tiles are mapped one by one and kept in an LRU working set
+ * limited by a memory budget; the tiles around the robot and the Minotaur are
+ * prefetched every turn, so walking onto a new tile never waits for the disk.
+ * Changes made during the game live in a small overlay and never reach the file.
+ */
+class TiledMaze : public MarathonMaze {
+private:
+    struct MappedTile {
+        uint64_t index;
+        const uint8_t* data;
+        void* mapping;          // data rounded down to a page, as mmap needs
+        size_t mappingBytes;
+    };
+
+    unsigned int width;
+    unsigned int height;
+    unsigned int tilesX;
+    unsigned int tilesY;
+    unsigned int entranceX;
+    unsigned int exitX;
+    unsigned int no_of_items;
+    unsigned int seed;
+    int fileDescriptor;
+    size_t capacity;            // tiles that fit in the memory budget
+    uint64_t misses;
+
+    std::list<MappedTile> recentlyUsed;     // front = most recent
+    std::unordered_map<uint64_t, std::list<MappedTile>::iterator> mapped;
+    uint64_t lastTile;          // one-entry cache in front of the map: most lookups hit the same tile
+    const uint8_t* lastData;
+    std::unordered_map<uint64_t, uint8_t> changes;
+
+    const uint8_t* tile(uint64_t index);
+    void evictLeastRecentlyUsed();
+
+public:
+    static const unsigned int TILE_SIZE = 256;
+    static const size_t TILE_BYTES = TILE_SIZE * TILE_SIZE / 2;
+    static const size_t DEFAULT_BUDGET = 64 * 1024 * 1024;
+
+    TiledMaze();
+    ~TiledMaze();
+    TiledMaze(const TiledMaze&) = delete;
+    TiledMaze& operator=(const TiledMaze&) = delete;
+
+    /**
+     * @brief Stream a new maze straight to disk: Eller's algorithm builds it one row
+     * at a time, and a band of TILE_SIZE rows is all that is ever held in memory
+     * (TILE_SIZE / 2 bytes per maze column). The result is a perfect maze, so the
+     * exit and every item are reachable from the entrance.
+     */
+    static bool generate(const std::string& filename, unsigned int width, unsigned int height,
+        unsigned int no_of_items, unsigned int seed, std::string& error);
+
+    bool open(const std::string& filename, size_t budgetBytes, std::string& error);
+    void close();
+
+    uint8_t getCell(unsigned int x, unsigned int y) override;
+    void setCell(unsigned int x, unsigned int y, uint8_t cell) override;
+    bool isBoundary(unsigned int x, unsigned int y) const override;
+
+    // Map the 3x3 tiles around (x, y) ahead of time and ask the kernel to read them in
+    void prefetchAround(unsigned int x, unsigned int y) override;
+
+    unsigned int getWidth() const override { return width; }
+    unsigned int getHeight() const override { return height; }
+    unsigned int getStartX() const override { return entranceX; }
+    unsigned int getStartY() const override { return 1; }
+    unsigned int getItemCount() const override { return no_of_items; }
+    unsigned int getSeed() const override { return seed; }
+    std::string title() const override;
+    std::string cacheStatus() const override;
+
+    unsigned int getExitX() const { return exitX; }
+    size_t mappedTiles() const { return mapped.size(); }
+    size_t tileCapacity() const { return capacity; }
+    uint64_t tileMisses() const { return misses; }
+};
@@ -1,16 +1,334 @@
+#include <iostream>
+#include <chrono>
+#include <memory>
+
 #include "Matrix.h"
 #include "ArgumentsHandler.h"
 #include "Gameplay.h"
+#include "AsyncFileWriter.h"
+#include "ReplayLog.h"
+#include "ResultsStore.h"
+#include "MazeLoader.h"
+#include "MazeImage.h"
+#include "RNGEngine.h"
+#include "GameServer.h"
+#include "MazeAnalyzer.h"
+#include "MazeFarm.h"
+#include "MazeBench.h"
+#include "TiledMaze.h"
+#include "MarathonGame.h"
+#include "ChunkedWorld.h"
+#include "SessionRecorder.h"
+#include "BackgroundMaze.h"
+#include "ConsoleHandler.h"
+#include "MazePool.h"
+
+static int renderMaze(GameOptions& options) {
+	Matrix* matrix = nullptr;
+	string error;
+
+	if (!options.loadFile.empty()) {
+		matrix = MazeLoader::loadMaze(options.loadFile, options.items, error);
+		if (!matrix) {
+			std::cerr << "Error: " << error << "\n";
+			return 1;
+		}
+	}
+	else {
+		unsigned int seed = options.hasSeed ? options.seed : RNGEngine::generateSeed();
+		RNGEngine::seed(seed);
+		matrix = new Matrix(options.width, options.height);
+		matrix->generateMatrix(options.items);
+		std::cout << "Generated a " << options.width << " x " << options.height << " maze from seed " << seed << "\n";
+	}
+
+	// Where a new game would put the hero and the Minotaur
+	ImageOverlays& overlays = options.overlays;
+	overlays.robot_x = matrix->getEntranceX();
+	overlays.robot_y = 1;
+	if (overlays.minotaur) {
+		pair<unsigned int, unsigned int> minotaurPosition = matrix->getRandomPassageForMinotaur(overlays.robot_x);
+		overlays.minotaur_x = minotaurPosition.first;
+		overlays.minotaur_y = minotaurPosition.second;
+	}
+
+	auto export_start = std::chrono::high_resolution_clock::now();
+	bool written = MazeImage::write(*matrix, options.imageFile, overlays);
+	auto export_time = std::chrono::duration_cast<std::chrono::milliseconds>(
+		std::chrono::high_resolution_clock::now() - export_start);
+
+	if (written) {
+		std::cout << "Wrote " << options.imageFile << " in " << export_time.count() << " ms\n";
+	}
+
+	delete matrix;
+	return written ? 0 : 1;
+}
+
+static int runMarathon(const GameOptions& options) {
+	string error;
+
+	if (options.buildMarathon) {
+		unsigned int seed = options.hasSeed ? options.seed : RNGEngine::generateSeed();
+		auto build_start = std::chrono::high_resolution_clock::now();
+		if (!TiledMaze::generate(options.marathonFile, options.width, options.height, options.items, seed, error)) {
+			std::cerr << "Error: " << error << "\n";
+			return 1;
+		}
+		auto build_time = std::chrono::duration_cast<std::chrono::milliseconds>(
+			std::chrono::high_resolution_clock::now() - build_start);
+		std::cout << "Wrote a " << options.width << " x " << options.height << " maze (seed " << seed << ") to "
+			<< options.marathonFile << " in " << build_time.count() << " ms\n";
+		return 0;
+	}
+
+	TiledMaze maze;
+	if (!maze.open(options.marathonFile, options.tileCacheBytes, error)) {
+		std::cerr << "Error: " << error << "\n";
+		return 1;
+	}
+	MarathonGame game(maze);
+	game.play();
+
+	AsyncFileWriter::getInstance().waitForPendingWrites();
+	return 0;
+}
+
+static int runEndless(const GameOptions& options) {
+	unsigned int seed = options.hasSeed ? options.seed : RNGEngine::generateSeed();
+	RNGEngine::seed(seed);
+
+	ChunkedWorld world(seed);
+	MarathonGame game(world);
+	game.play();
+
+	AsyncFileWriter::getInstance().waitForPendingWrites();
+	return 0;
+}
+
+// Each level is a quarter wider and taller than the one before, with one more item
+static BackgroundMaze* buildCampaignLevel(const GameOptions& options, unsigned int level, unsigned int seed) {
+	unsigned int width = options.width + options.width * level / 4;
+	unsigned int height = options.height + options.height * level / 4;
+	return new BackgroundMaze(width, height, options.items + level, seed + level * 0x9E3779B9u, options.levels);
+}
+
+static void playCampaign(const GameOptions& options) {
+	unsigned int seed = RNGEngine::generateSeed();
+	std::unique_ptr<BackgroundMaze> next(buildCampaignLevel(options, 0, seed));
+
+	for (unsigned int level = 0; level < options.campaign; ++level) {
+		std::unique_ptr<BackgroundMaze> current = std::move(next);
+		// The next level is built while this one is played; giving up cancels it
+		if (level + 1 < options.campaign) {
+			next.reset(buildCampaignLevel(options, level + 1, seed));
+		}
+
+		if (level > 0) clearScreen();
+		std::cout << "\n  Level " << level + 1 << " of " << options.campaign << " - "
+			<< current->getWidth() << " x " << current->getHeight() << "\n";
+
+		Gameplay game(current->getWidth(), current->getHeight());
+		game.setMinotaurSpawnBand(options.minotaurBand);
+		game.setViewRadius(options.viewRadius);
+		if (!game.initializeGame(*current)) {
+			return;
+		}
+		game.startGameLoop();
+		if (!game.heroEscaped()) {
+			return;
+		}
+
+		if (level + 1 < options.campaign) {
+			std::cout << "  Press any of W, A, S, D or E to enter level " << level + 2 << ", Q to rest on your laurels\n";
+			// The game's resize watch is still on; a resized window is no answer
+			char key = getValidKeyPress();
+			while (key == RESIZE_EVENT) {
+				key = getValidKeyPress();
+			}
+			if (key == 'q') {
+				return;
+			}
+		}
+	}
+
+	std::cout << "  All " << options.campaign << " labyrinths lie behind you, Theseus.\n\n";
+}
+
+static int fillPool(const GameOptions& options) {
+	MazePool pool(options.poolDirectory, options.width, options.height, options.items);
+	string error;
+	if (!pool.open(error)) {
+		std::cerr << "Error: " << error << "\n";
+		return 1;
+	}
+
+	unsigned int before = pool.available();
+	auto fill_start = std::chrono::high_resolution_clock::now();
+	if (!pool.refill(options.poolDepth, error)) {
+		std::cerr << "Error: " << error << "\n";
+		return 1;
+	}
+	auto fill_time = std::chrono::duration_cast<std::chrono::milliseconds>(
+		std::chrono::high_resolution_clock::now() - fill_start);
+
+	unsigned int after = pool.available();
+	std::cout << pool.getFilename() << ": " << after << " mazes ready (" << (after > before ? after - before : 0)
+		<< " generated in " << fill_time.count() << " ms)\n";
+	return 0;
+}
 
 int main(int argc, char* argv[])
 {
-	unsigned int width, height, no_of_items;
+	GameOptions options;
+
+	handleArguments(argc, argv, options);
+
+	if (options.mode == RunMode::STATS) {
+		ResultStatistics statistics;
+		if (!ResultsStore::query(options.resultsFile, options.statsQuery, statistics)) {
+			return 1;
+		}
+		ResultsStore::printStatistics(options.resultsFile, statistics);
+		return 0;
+	}
+
+	if (options.mode == RunMode::RENDER) {
+		return renderMaze(options);
+	}
+
+	if (options.mode == RunMode::MARATHON) {
+		return runMarathon(options);
+	}
+
+	if (options.mode == RunMode::ENDLESS) {
+		return runEndless(options);
+	}
+
+	if (options.mode == RunMode::ANALYZE) {
+		return MazeAnalyzer::run(options.analysis) ? 0 : 1;
+	}
+
+	if (options.mode == RunMode::FARM) {
+		return MazeFarm::run(options.farm) ? 0 : 1;
+	}
+
+	if (options.mode == RunMode::BENCH) {
+		return MazeBench::run(options.bench) ? 0 : 1;
+	}
+
+	if (options.mode == RunMode::POOL) {
+		return fillPool(options);
+	}
+
+	if (options.mode == RunMode::SERVE) {
+		bool served = GameServer::run(options.socketPath, options.serverThreads);
+		AsyncFileWriter::getInstance().waitForPendingWrites();
+		return served ? 0 : 1;
+	}
+
+	if (options.mode == RunMode::CONNECT) {
+		return runGameClient(options.socketPath, options.width, options.height, options.items);
+	}
+
+	if (options.mode == RunMode::WATCH) {
+		return runSpectatorClient(options.socketPath, !options.hasGameId, options.gameId);
+	}
+
+	// Stops, and finishes the file, whichever way main returns
+	SessionRecorder recorder;
+	if (!options.recordFile.empty() && !recorder.start(options.recordFile)) {
+		return 1;
+	}
+
+	if (!options.replayFile.empty()) {
+		Replay replay;
+		if (!ReplayLog::load(options.replayFile, replay)) {
+			return 1;
+		}
+
+		Gameplay game(replay.width, replay.height);
+		return game.runReplay(replay, options.replayRender, options.replaySpeed) ? 0 : 1;
+	}
+
+	if (!options.loadFile.empty()) {
+		auto load_start = std::chrono::high_resolution_clock::now();
+
+		unsigned int no_of_items = 0;
+		string error;
+		Matrix* matrix = MazeLoader::loadMaze(options.loadFile, no_of_items, error);
+		if (!matrix) {
+			std::cerr << "Error: " << error << "\n";
+			return 1;
+		}
+
+		auto load_time = std::chrono::duration_cast<std::chrono::microseconds>(
+			std::chrono::high_resolution_clock::now() - load_start);
+
+		Gameplay game(matrix->getWidth(), matrix->getHeight());
+		game.setMinotaurSpawnBand(options.minotaurBand);
+		game.setViewRadius(options.viewRadius);
+		game.initializeLoadedGame(matrix, no_of_items, load_time);
+		game.startGameLoop();
+	}
+	else if (!options.resumeFile.empty()) {
+		SavedGame saved;
+		FileHandler fileHandler;
+		if (!fileHandler.loadGame(options.resumeFile, saved)) {
+			return 1;
+		}
+
+		Gameplay game(saved.width, saved.height);
+		game.setViewRadius(options.viewRadius);
+		game.resumeGame(saved);
+		game.startGameLoop();
+	}
+	else if (options.campaign > 0) {
+		playCampaign(options);
+	}
+	else {
+		Gameplay game(options.width, options.height);
+		game.setMinotaurSpawnBand(options.minotaurBand);
+		game.setViewRadius(options.viewRadius);
+		game.setLevelCount(options.levels);
+
+		// A warm pool skips generation; what this game takes is made up for while it's played
+		std::unique_ptr<MazePool> pool;
+		Matrix* pooled = nullptr;
+		unsigned int pooledSeed = 0;
+		auto take_start = std::chrono::high_resolution_clock::now();
+		if (!options.poolDirectory.empty()) {
+			pool.reset(new MazePool(options.poolDirectory, options.width, options.height, options.items));
+			string error;
+			if (!pool->open(error)) {
+				std::cerr << "Error: " << error << "\n";
+				return 1;
+			}
+			pooled = pool->take(pooledSeed);
+		}
+		auto take_time = std::chrono::duration_cast<std::chrono::microseconds>(
+			std::chrono::high_resolution_clock::now() - take_start);
 
-	handleArguments(argc, argv, width, height, no_of_items);
+		if (options.hasDifficulty) {
+			game.initializeGame(options.items, options.difficulty);
+		}
+		else if (pooled != nullptr) {
+			game.initializePooledGame(pooled, options.items, pooledSeed, take_time);
+		}
+		else if (!game.initializeGame(options.items)) {
+			return 0;
+		}
+		if (pool) {
+			pool->startRefill(options.poolDepth);
+		}
+		if (!options.replayLogFile.empty() && !game.recordReplay(options.replayLogFile)) {
+			return 1;
+		}
+		game.startGameLoop();
+	}
 
-	Gameplay game(width, height);
-	game.initializeGame(no_of_items);
-	game.startGameLoop();
+	// Result files are written in the background - don't leave before they're on disk
+	AsyncFileWriter::getInstance().waitForPendingWrites();
 
 	return 0;
 }
\ No newline at end of file